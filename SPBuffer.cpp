@@ -3,7 +3,8 @@
 namespace HSLL
 {
     SPBuffer::SPBuffer(BUFFER_TYPE type)
-        : back(0), front(0), size(0), bsize(0), buffer(nullptr), type(type) {}
+        : back(0), front(0), size(0), bsize(0), buffer(nullptr), type(type),
+          csize(0), head(nullptr), tail(nullptr) {}
 
     bool SPBuffer::Init()
     {
@@ -12,10 +13,69 @@ namespace HSLL
         else
             bsize = tcpConfig.WRITE_BSIZE;
 
+        if (tcpConfig.BUFFER_CHUNK_SIZE)
+            csize = tcpConfig.BUFFER_CHUNK_SIZE;
+
+        return true;
+    }
+
+    bool SPBuffer::attach()
+    {
+        if (csize || buffer)
+            return true;
+
         buffer = (unsigned char *)SPTcpBufferPool::GetBuffer(type);
         return buffer != nullptr;
     }
 
+    bool SPBuffer::attached()
+    {
+        return csize ? head != nullptr : buffer != nullptr;
+    }
+
+    unsigned char *SPBuffer::chunkData(SPChunk *chunk)
+    {
+        return (unsigned char *)chunk + SPSOCK_CHUNK_HEADER_SIZE;
+    }
+
+    SPChunk *SPBuffer::nextChunk(SPChunk *chunk)
+    {
+        SPChunk **link = chunk ? &chunk->next : &head;
+
+        if (*link == nullptr)
+        {
+            SPChunk *spare = (SPChunk *)SPTcpBufferPool::GetBuffer(BUFFER_TYPE_CHUNK);
+            if (spare == nullptr)
+                return nullptr;
+
+            spare->next = nullptr;
+            spare->begin = spare->end = 0;
+            *link = spare;
+        }
+        return *link;
+    }
+
+    SPChunk *SPBuffer::writeChunk(bool alloc)
+    {
+        if (tail && tail->end < csize)
+            return tail;
+
+        if (!alloc)
+            return tail ? tail->next : head;
+
+        return nextChunk(tail);
+    }
+
+    void SPBuffer::freeChunks(SPChunk *chunk)
+    {
+        while (chunk)
+        {
+            SPChunk *next = chunk->next;
+            SPTcpBufferPool::FreeBuffer(chunk, BUFFER_TYPE_CHUNK);
+            chunk = next;
+        }
+    }
+
     unsigned int SPBuffer::bytesRead()
     {
         return size;
@@ -29,25 +89,308 @@ namespace HSLL
     unsigned int SPBuffer::distanceWrite()
     {
         const unsigned int writeAvailable = bytesWrite();
+
+        if (csize)
+        {
+            SPChunk *chunk;
+            if (writeAvailable == 0 || (chunk = writeChunk(true)) == nullptr)
+                return 0;
+
+            const unsigned int linearSpace = csize - chunk->end;
+            return (linearSpace > writeAvailable) ? writeAvailable : linearSpace;
+        }
+
+        if (writeAvailable == 0 || !attach())
+            return 0;
+
         const unsigned int linearSpace = bsize - front;
         return (linearSpace > writeAvailable) ? writeAvailable : linearSpace;
     }
 
     unsigned int SPBuffer::distanceRead()
     {
+        if (csize)
+            return size ? head->end - head->begin : 0;
+
         const unsigned int readAvailable = bytesRead();
         const unsigned int linearSpace = bsize - back;
         return (linearSpace > readAvailable) ? readAvailable : linearSpace;
     }
 
+    unsigned int SPBuffer::writeVec(iovec *vec, unsigned int max)
+    {
+        unsigned int available = bytesWrite();
+
+        if (csize)
+        {
+            unsigned int num = 0;
+            SPChunk *chunk = available ? writeChunk(true) : nullptr;
+
+            while (chunk && num < max)
+            {
+                unsigned int len = csize - chunk->end;
+                if (len > available)
+                    len = available;
+
+                vec[num].iov_base = chunkData(chunk) + chunk->end;
+                vec[num].iov_len = len;
+                num++;
+
+                available -= len;
+                if (available == 0 || num == max)
+                    break;
+
+                chunk = nextChunk(chunk);
+            }
+            return num;
+        }
+
+        const unsigned int first = distanceWrite();
+        if (first == 0)
+            return 0;
+
+        vec[0].iov_base = buffer + front;
+        vec[0].iov_len = first;
+
+        const unsigned int second = available - first;
+        if (second == 0)
+            return 1;
+
+        vec[1].iov_base = buffer;
+        vec[1].iov_len = second;
+        return 2;
+    }
+
+    unsigned int SPBuffer::readVec(iovec *vec, unsigned int max)
+    {
+        if (csize)
+        {
+            unsigned int num = 0;
+            SPChunk *chunk = size ? head : nullptr;
+
+            while (chunk && num < max)
+            {
+                vec[num].iov_base = chunkData(chunk) + chunk->begin;
+                vec[num].iov_len = chunk->end - chunk->begin;
+                num++;
+
+                if (chunk == tail)
+                    break;
+
+                chunk = chunk->next;
+            }
+            return num;
+        }
+
+        const unsigned int first = distanceRead();
+        if (first == 0)
+            return 0;
+
+        vec[0].iov_base = buffer + back;
+        vec[0].iov_len = first;
+
+        const unsigned int second = bytesRead() - first;
+        if (second == 0)
+            return 1;
+
+        vec[1].iov_base = buffer;
+        vec[1].iov_len = second;
+        return 2;
+    }
+
+    unsigned int SPBuffer::viewVec(iovec *vec, unsigned int max, unsigned int offset, unsigned int len)
+    {
+        if (len == 0 || max == 0 || offset > size || len > size - offset)
+            return 0;
+
+        if (csize)
+        {
+            unsigned int num = 0;
+            SPChunk *chunk = head;
+
+            while (offset >= chunk->end - chunk->begin)
+            {
+                offset -= chunk->end - chunk->begin;
+                chunk = chunk->next;
+            }
+
+            while (len)
+            {
+                if (num == max)
+                    return 0;
+
+                unsigned int step = chunk->end - chunk->begin - offset;
+                if (step > len)
+                    step = len;
+
+                vec[num].iov_base = chunkData(chunk) + chunk->begin + offset;
+                vec[num].iov_len = step;
+                num++;
+
+                len -= step;
+                offset = 0;
+                chunk = chunk->next;
+            }
+            return num;
+        }
+
+        const unsigned int pos = (back + offset) % bsize;
+        const unsigned int first = (pos + len > bsize) ? (bsize - pos) : len;
+
+        vec[0].iov_base = buffer + pos;
+        vec[0].iov_len = first;
+
+        if (first == len)
+            return 1;
+
+        if (max < 2)
+            return 0;
+
+        vec[1].iov_base = buffer;
+        vec[1].iov_len = len - first;
+        return 2;
+    }
+
+    long SPBuffer::find(const void *pattern, unsigned int len, unsigned int from)
+    {
+        if (len == 0 || from > size || len > size - from)
+            return -1;
+
+        const unsigned char *bytes = (const unsigned char *)pattern;
+        SPChunk *chunk = csize ? head : nullptr;
+        unsigned int start = 0;
+
+        for (int ring = 0; start < size; ring++)
+        {
+            unsigned char *data;
+            unsigned int dlen;
+
+            if (csize)
+            {
+                data = chunkData(chunk) + chunk->begin;
+                dlen = chunk->end - chunk->begin;
+                chunk = chunk->next;
+            }
+            else
+            {
+                data = (ring == 0) ? buffer + back : buffer;
+                dlen = (ring == 0) ? distanceRead() : size - start;
+            }
+
+            unsigned int pos = (from > start) ? from - start : 0;
+
+            while (pos < dlen)
+            {
+                unsigned char *hit = (unsigned char *)memchr(data + pos, bytes[0], dlen - pos);
+                if (hit == nullptr)
+                    break;
+
+                unsigned int offset = start + (hit - data);
+                if (len > size - offset)
+                    return -1;
+
+                iovec vec[SPSOCK_MAX_IOVEC];
+                unsigned int num = viewVec(vec, SPSOCK_MAX_IOVEC, offset, len);
+                unsigned int matched = 0;
+
+                for (unsigned int i = 0; i < num; i++)
+                {
+                    if (memcmp(vec[i].iov_base, bytes + matched, vec[i].iov_len) != 0)
+                        break;
+                    matched += vec[i].iov_len;
+                }
+
+                if (matched == len)
+                    return offset;
+
+                pos = hit - data + 1;
+            }
+            start += dlen;
+        }
+        return -1;
+    }
+
+    void SPBuffer::release()
+    {
+        if (!csize)
+        {
+            if (size == 0 && buffer)
+            {
+                SPTcpBufferPool::FreeBuffer(buffer, type);
+                buffer = nullptr;
+                front = back = 0;
+            }
+            return;
+        }
+
+        if (size == 0)
+        {
+            freeChunks(head);
+            head = tail = nullptr;
+        }
+        else
+        {
+            freeChunks(tail->next);
+            tail->next = nullptr;
+        }
+    }
+
     void SPBuffer::commitRead(unsigned int len)
     {
+        if (csize)
+        {
+            size -= len;
+
+            if (size == 0)
+            {
+                freeChunks(head);
+                head = tail = nullptr;
+                return;
+            }
+
+            while (len)
+            {
+                unsigned int chunkLen = head->end - head->begin;
+                unsigned int step = (len > chunkLen) ? chunkLen : len;
+
+                head->begin += step;
+                len -= step;
+
+                if (head->begin == head->end)
+                {
+                    SPChunk *drained = head;
+                    head = head->next;
+                    SPTcpBufferPool::FreeBuffer(drained, BUFFER_TYPE_CHUNK);
+                }
+            }
+            return;
+        }
+
         back = (back + len) % bsize;
         size -= len;
+        if (size == 0)
+            front = back = 0;
     }
 
     void SPBuffer::commitWrite(unsigned int len)
     {
+        if (csize)
+        {
+            size += len;
+
+            while (len)
+            {
+                SPChunk *chunk = writeChunk(false);
+                unsigned int space = csize - chunk->end;
+                unsigned int step = (len > space) ? space : len;
+
+                chunk->end += step;
+                len -= step;
+                tail = chunk;
+            }
+            return;
+        }
+
         front = (front + len) % bsize;
         size += len;
         if (size == 0)
@@ -56,16 +399,33 @@ namespace HSLL
 
     unsigned char *SPBuffer::writePtr()
     {
+        if (csize)
+        {
+            SPChunk *chunk = writeChunk(false);
+            return chunkData(chunk) + chunk->end;
+        }
+
         return buffer + front;
     }
 
     unsigned char *SPBuffer::readPtr()
     {
+        if (csize)
+            return chunkData(head) + head->begin;
+
         return buffer + back;
     }
 
     unsigned int SPBuffer::read(void *buf, unsigned int len)
     {
+        if (csize)
+        {
+            unsigned int bytes = peek(buf, len);
+            if (bytes)
+                commitRead(bytes);
+            return bytes;
+        }
+
         if (len == 0 || size == 0)
             return 0;
 
@@ -95,6 +455,24 @@ namespace HSLL
             return 0;
 
         const unsigned int bytesToRead = (len > size) ? size : len;
+
+        if (csize)
+        {
+            unsigned int copied = 0;
+            SPChunk *chunk = head;
+
+            while (copied < bytesToRead)
+            {
+                unsigned int chunkLen = chunk->end - chunk->begin;
+                unsigned int step = (bytesToRead - copied > chunkLen) ? chunkLen : bytesToRead - copied;
+
+                memcpy((unsigned char *)buf + copied, chunkData(chunk) + chunk->begin, step);
+                copied += step;
+                chunk = chunk->next;
+            }
+            return bytesToRead;
+        }
+
         const unsigned int firstChunk = (back + bytesToRead > bsize) ? (bsize - back) : bytesToRead;
         memcpy(buf, buffer + back, firstChunk);
 
@@ -106,10 +484,31 @@ namespace HSLL
 
     unsigned int SPBuffer::write(const void *buf, unsigned int len)
     {
-        if (len == 0 || bytesWrite() == 0)
+        if (len == 0 || bytesWrite() == 0 || !attach())
             return 0;
 
         const unsigned int bytesToWrite = (len > bytesWrite()) ? bytesWrite() : len;
+
+        if (csize)
+        {
+            unsigned int written = 0;
+
+            while (written < bytesToWrite)
+            {
+                unsigned int step = distanceWrite();
+                if (step == 0)
+                    break;
+
+                if (step > bytesToWrite - written)
+                    step = bytesToWrite - written;
+
+                memcpy(writePtr(), (const unsigned char *)buf + written, step);
+                commitWrite(step);
+                written += step;
+            }
+            return written;
+        }
+
         const unsigned int firstChunk = (front + bytesToWrite > bsize) ? (bsize - front) : bytesToWrite;
         memcpy(buffer + front, buf, firstChunk);
 
@@ -125,5 +524,7 @@ namespace HSLL
     {
         if (buffer)
             SPTcpBufferPool::FreeBuffer(buffer, type);
+
+        freeChunks(head);
     }
-}
\ No newline at end of file
+}
@@ -1,14 +1,37 @@
 #ifndef HSLL_BUFFER
 #define HSLL_BUFFER
 
+#include <sys/uio.h>
+
 #include "SPBufferPool.hpp"
 
 namespace HSLL
 {
+/**
+ * @brief Maximum number of I/O vectors used by a single vectored socket call
+ */
+#define SPSOCK_MAX_IOVEC 16
+
+    /**
+     * @brief Header of a chained buffer chunk
+     * @note Stored in the first SPSOCK_CHUNK_HEADER_SIZE bytes of every pool chunk
+     */
+    struct SPChunk
+    {
+        SPChunk *next;      ///< Next chunk in the chain
+        unsigned int begin; ///< Offset of the first unread byte
+        unsigned int end;   ///< Offset one past the last written byte
+    };
+
+    static_assert(sizeof(SPChunk) <= SPSOCK_CHUNK_HEADER_SIZE, "SPChunk exceeds the reserved chunk header");
+
     /**
      * @brief Circular buffer implementation for efficient I/O operations
      * This class provides a thread-unsafe circular buffer with separate
-     * read and write pointers, optimized for network I/O operations
+     * read and write pointers, optimized for network I/O operations.
+     * When BUFFER_CHUNK_SIZE is configured the buffer is instead a chain of pool
+     * chunks that grows on demand up to the configured capacity and returns its
+     * chunks to the pool once they are drained.
      */
     class SPBuffer
     {
@@ -19,14 +42,55 @@ namespace HSLL
         unsigned char *buffer = nullptr; ///< Underlying data storage
         BUFFER_TYPE type;                ///< Buffer type
 
+        unsigned int csize = 0;  ///< Chunk payload size (0 for ring mode)
+        SPChunk *head = nullptr; ///< First chunk of the chain (chained mode)
+        SPChunk *tail = nullptr; ///< Last chunk holding data, followed by spare chunks (chained mode)
+
+        /**
+         * @brief Get the payload of a chunk
+         */
+        static unsigned char *chunkData(SPChunk *chunk);
+
+        /**
+         * @brief Get the chunk receiving the next written byte
+         * @param alloc Allocate and link a spare chunk if none is available
+         * @return Chunk with free space, nullptr if none is available
+         */
+        SPChunk *writeChunk(bool alloc);
+
+        /**
+         * @brief Get the chunk following a chunk, allocating a spare one if needed
+         * @param chunk Chunk whose successor is requested
+         * @return Successor chunk, nullptr on allocation failure
+         */
+        SPChunk *nextChunk(SPChunk *chunk);
+
+        /**
+         * @brief Return every chunk of the chain to the pool
+         */
+        void freeChunks(SPChunk *chunk);
+
     public:
         SPBuffer(BUFFER_TYPE type);
 
         /**
          * @brief Initialize the buffer with specified capacity
+         * @note Storage is attached lazily on the first write
          */
         bool Init();
 
+        /**
+         * @brief Attach storage from the buffer pool if none is attached
+         * @return true if the buffer has storage (always true in chained mode)
+         */
+        bool attach();
+
+        /**
+         * @brief Check whether the buffer currently holds pool storage
+         * @return true if a ring or at least one chunk is attached
+         */
+        bool attached();
+
         /**
          * @brief Get the number of bytes available to read
          * @return Number of bytes currently stored in buffer
@@ -53,6 +117,50 @@ namespace HSLL
          */
         unsigned int distanceRead();
 
+        /**
+         * @brief Get the free space of the buffer as I/O vectors
+         * @param vec Destination array
+         * @param max Number of entries available in vec (at least two)
+         * @return Number of entries filled, two when the ring free space wraps around
+         * @note In chained mode spare chunks are allocated to fill the vectors,
+         *       call release() if they end up unused
+         */
+        unsigned int writeVec(iovec *vec, unsigned int max);
+
+        /**
+         * @brief Get the stored data of the buffer as I/O vectors
+         * @param vec Destination array
+         * @param max Number of entries available in vec (at least two)
+         * @return Number of entries filled, two when the ring data wraps around
+         */
+        unsigned int readVec(iovec *vec, unsigned int max);
+
+        /**
+         * @brief Get a range of the stored data as I/O vectors without copying
+         * @param vec Destination array
+         * @param max Number of entries available in vec
+         * @param offset Bytes to skip from the front of the stored data
+         * @param len Length of the range in bytes
+         * @return Number of entries filled, 0 if the range is empty, not stored or needs more than max entries
+         */
+        unsigned int viewVec(iovec *vec, unsigned int max, unsigned int offset, unsigned int len);
+
+        /**
+         * @brief Search the stored data for a byte sequence
+         * @param pattern Byte sequence to search for
+         * @param len Length of the sequence
+         * @param from Offset in the stored data to start searching at
+         * @return Offset of the first match at or after from, -1 if not found
+         * @note Candidates are located with memchr, matches may span ring or chunk boundaries
+         */
+        long find(const void *pattern, unsigned int len, unsigned int from);
+
+        /**
+         * @brief Return storage holding no data to the pool
+         * @note Releases spare chunks in chained mode and the ring itself once it is empty
+         */
+        void release();
+
         /**
          * @brief Commit read operations (advance read pointer)
          * @param len Number of bytes to advance read pointer
@@ -68,7 +176,7 @@ namespace HSLL
         /**
          * @brief Get direct write pointer
          * @return Pointer to current write position
-         * @warning Must check bytesWrite() before using
+         * @warning Must check distanceWrite() before using
          */
         unsigned char *writePtr();
 
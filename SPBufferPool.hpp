@@ -1,6 +1,9 @@
 #ifndef HSLL_SPBUFFERPOOL
 #define HSLL_SPBUFFERPOOL
 
+#include <mutex>
+#include <atomic>
+
 #include "SPTypes.h"
 #include "noncopyable.h"
 
@@ -8,75 +11,115 @@ using namespace HSLL::DEFER;
 
 namespace HSLL
 {
+/**
+ * @brief Bytes reserved in front of every chunk payload for the chained buffer header
+ */
+#define SPSOCK_CHUNK_HEADER_SIZE 16
+
     /**
-     * @brief Singleton memory pool manager for efficient buffer allocation
-     * Manages separate memory pools for read/write buffers using a linked list structure.
-     * Implements reference counting for block management and memory reuse.
+     * @brief Per-thread memory pool manager for efficient buffer allocation
+     * Every IO and worker thread binds its own pool holding separate free lists for read/write buffers.
+     * Buffers released by a thread other than the owner are pushed onto the owner's
+     * lock-free return stack and reclaimed by the owner on its next allocation.
+     * Threads without a bound pool fall back to a shared pool guarded by a mutex.
      */
     class SPTcpBufferPool : noncopyable
     {
-        static SPTcpBufferPool pool; ///< Singleton instance
+        /**
+         * @brief Header placed in front of every allocated memory block
+         */
+        struct Block
+        {
+            SPTcpBufferPool *owner; ///< Pool that allocated the block
+            unsigned int refCount;  ///< Buffers of the block not yet released to the system
+            unsigned int num;       ///< Number of buffers carved from the block
+        };
+
+        static SPTcpBufferPool shared;              ///< Pool for threads without a bound pool
+        static std::mutex sharedMtx;                ///< Mutex protecting the shared pool
+        static thread_local SPTcpBufferPool *local; ///< Pool bound to the calling thread
+
+        void *buffers[3];                ///< Heads of free lists (indexed by BUFFER_TYPE)
+        unsigned int bSize[3];           ///< Number of available buffers in each free list
+        unsigned int total[3];           ///< Number of buffers carved from live blocks
+        std::atomic<void *> returned[3]; ///< Lock-free stacks of buffers released by other threads
+        void *scratch;                   ///< Scratch read buffer shared by the thread's connections
 
-        void *rBuffers;      ///< Head of free list for read buffers
-        void *wBuffers;      ///< Head of free list for write buffers
-        unsigned int rbSize; ///< Number of available read buffers in pool
-        unsigned int wbSize; ///< Number of available write buffers in pool
+        /**
+         * @brief Get the payload size of a buffer type
+         * @param type Buffer type (read/write)
+         * @return Buffer size in bytes defined by global config
+         * @note Chunks carry the chained buffer header in front of their payload
+         */
+        static unsigned int BufferSize(BUFFER_TYPE type)
+        {
+            if (type == BUFFER_TYPE_CHUNK)
+                return tcpConfig.BUFFER_CHUNK_SIZE + SPSOCK_CHUNK_HEADER_SIZE;
+
+            return (type == BUFFER_TYPE_READ) ? tcpConfig.READ_BSIZE : tcpConfig.WRITE_BSIZE;
+        }
 
         /**
          * @brief Attempt to allocate a block of buffers
-         * @param num Number of buffer pairs (read+write) to allocate
+         * @param type Buffer type (read/write)
+         * @param num Number of buffers to allocate
          * @return true if allocation succeeded, false otherwise
-         * Allocates a memory block containing 'num' read/write buffer pairs.
+         * Allocates a memory block containing 'num' buffers of one type.
          * Each buffer is preceded by metadata (block reference + next pointer).
          * Organized as:
-         * [header][read buffers][write buffers]
+         * [header][buffers]
          */
-        bool tryAlloc(int num)
+        bool tryAlloc(BUFFER_TYPE type, unsigned int num)
         {
-            const int peerReadBSize = tcpConfig.READ_BSIZE + 2 * sizeof(void *);
-            const int peerWriteBSize = tcpConfig.WRITE_BSIZE + 2 * sizeof(void *);
-            const int totalSize = 4 + (peerReadBSize + peerWriteBSize) * num;
+            const size_t peerBSize = BufferSize(type) + 2 * sizeof(void *);
+            const size_t totalSize = sizeof(Block) + peerBSize * num;
 
-            void *buf;
-            if ((buf = malloc(totalSize)) == nullptr)
+            Block *block;
+            if ((block = (Block *)malloc(totalSize)) == nullptr)
                 return false;
 
-            *(unsigned int *)(buf) = num * 2;
-            void *pReadBuf = (char *)(buf) + 4;
-            for (int i = 0; i < num; ++i)
-            {
-                void *current = (char *)(pReadBuf) + i * peerReadBSize;
-                void **node = (void **)(current);
-                node[0] = buf;
-                node[1] = (i < num - 1) ? (char *)(current) + peerReadBSize : rBuffers;
-            }
-            rBuffers = pReadBuf;
-            rbSize += num;
+            block->owner = this;
+            block->refCount = num;
+            block->num = num;
 
-            void *pWriteBuf = (char *)(pReadBuf) + peerReadBSize * num;
-            for (int i = 0; i < num; ++i)
+            void *pBuf = (char *)(block) + sizeof(Block);
+            for (unsigned int i = 0; i < num; ++i)
             {
-                void *current = (char *)(pWriteBuf) + i * peerWriteBSize;
+                void *current = (char *)(pBuf) + i * peerBSize;
                 void **node = (void **)(current);
-                node[0] = buf;
-                node[1] = (i < num - 1) ? (char *)(current) + peerWriteBSize : wBuffers;
+                node[0] = block;
+                node[1] = (i < num - 1) ? (char *)(current) + peerBSize : buffers[type];
             }
-            wBuffers = pWriteBuf;
-            wbSize += num;
+            buffers[type] = pBuf;
+            bSize[type] += num;
+            total[type] += num;
 
             return true;
         }
 
         /**
          * @brief Allocate buffers using exponential backoff strategy
+         * @param type Buffer type (read/write)
          * @return true if allocation succeeded, false on complete failure
+         * @note Never grows the pool beyond BUFFER_POOL_MAX_BLOCK_NUM buffers per type
          */
-        bool Alloc()
+        bool Alloc(BUFFER_TYPE type)
         {
-            int num = tcpConfig.BUFFER_POOL_PEER_ALLOC_NUM;
+            unsigned int num = tcpConfig.BUFFER_POOL_PEER_ALLOC_NUM;
+
+            if (tcpConfig.BUFFER_POOL_MAX_BLOCK_NUM)
+            {
+                unsigned int limit = tcpConfig.BUFFER_POOL_MAX_BLOCK_NUM;
+                if (total[type] >= limit)
+                    return false;
+
+                if (num > limit - total[type])
+                    num = limit - total[type];
+            }
+
             while (num > 0)
             {
-                if (tryAlloc(num))
+                if (tryAlloc(type, num))
                     return true;
                 num /= 2;
             }
@@ -84,87 +127,84 @@ namespace HSLL
         }
 
         /**
-         * @brief Internal method to get a read buffer from pool
-         * @return Pointer to allocated buffer or NULL on failure
+         * @brief Release a buffer node into the local free list
+         * @param node Buffer node (metadata address) owned by this pool
+         * @param type Buffer type (read/write)
+         * Either adds buffer back to free list or decrements block reference count
          */
-        void *GetReadBufferInner()
+        void put(void *node, BUFFER_TYPE type)
         {
-            if (!rBuffers && !Alloc())
-                return NULL;
-
-            void *node = rBuffers;
             void **nodePtr = (void **)(node);
-            rBuffers = nodePtr[1];
-            --rbSize;
+            Block *block = (Block *)(nodePtr[0]);
 
-            return (char *)(node) + 2 * sizeof(void *);
+            if (bSize[type] >= tcpConfig.BUFFER_POOL_MIN_BLOCK_NUM)
+            {
+                if (--block->refCount == 0)
+                {
+                    total[type] -= block->num;
+                    free(block);
+                }
+            }
+            else
+            {
+                nodePtr[1] = buffers[type];
+                buffers[type] = node;
+                ++bSize[type];
+            }
         }
 
         /**
-         * @brief Internal method to get a write buffer from pool
-         * @return Pointer to allocated buffer or NULL on failure
+         * @brief Move buffers released by other threads into the local free list
+         * @param type Buffer type (read/write)
+         * @return true if the free list is not empty afterwards
          */
-        void *GetWriteBufferInner()
+        bool reclaim(BUFFER_TYPE type)
         {
-            if (!wBuffers && !Alloc())
-                return NULL;
-
-            void *node = wBuffers;
-            void **nodePtr = (void **)(node);
-            wBuffers = nodePtr[1];
-            --wbSize;
+            void *node = returned[type].exchange(nullptr, std::memory_order_acquire);
 
-            return (char *)(node) + 2 * sizeof(void *);
+            while (node)
+            {
+                void *next = ((void **)(node))[1];
+                put(node, type);
+                node = next;
+            }
+            return buffers[type] != nullptr;
         }
 
         /**
-         * @brief Internal method to release read buffer back to pool
-         * @param buf Buffer to release (must be pointer returned by GetReadBufferInner)
-         * Either adds buffer back to free list or decrements block reference count
+         * @brief Push a buffer node onto the lock-free return stack
+         * @param node Buffer node (metadata address) owned by this pool
+         * @param type Buffer type (read/write)
+         * @note Safe to call from any thread
          */
-        void FreeReadBuffferInner(void *buf)
+        void giveBack(void *node, BUFFER_TYPE type)
         {
-            void *node = (char *)(buf)-2 * sizeof(void *);
             void **nodePtr = (void **)(node);
-            unsigned int &refCount = *(unsigned int *)(nodePtr[0]);
+            void *head = returned[type].load(std::memory_order_relaxed);
 
-            if (rbSize >= tcpConfig.BUFFER_POOL_MIN_BLOCK_NUM)
+            do
             {
-                --refCount;
-                if (refCount == 0)
-                    free(nodePtr[0]);
-            }
-            else
-            {
-                nodePtr[1] = rBuffers;
-                rBuffers = node;
-                ++rbSize;
-            }
+                nodePtr[1] = head;
+            } while (!returned[type].compare_exchange_weak(head, node, std::memory_order_release,
+                                                           std::memory_order_relaxed));
         }
 
         /**
-         * @brief Internal method to release write buffer back to pool
-         * @param buf Buffer to release (must be pointer returned by GetWriteBufferInner)
-         * Either adds buffer back to free list or decrements block reference count
+         * @brief Internal method to get a buffer from this pool
+         * @param type Buffer type (read/write)
+         * @return Pointer to allocated buffer or NULL on failure
          */
-        void FreeWriteBufferInner(void *buf)
+        void *get(BUFFER_TYPE type)
         {
-            void *node = (char *)(buf)-2 * sizeof(void *);
+            if (!buffers[type] && !reclaim(type) && !Alloc(type))
+                return NULL;
+
+            void *node = buffers[type];
             void **nodePtr = (void **)(node);
-            unsigned int &refCount = *(unsigned int *)(nodePtr[0]);
+            buffers[type] = nodePtr[1];
+            --bSize[type];
 
-            if (wbSize >= tcpConfig.BUFFER_POOL_MIN_BLOCK_NUM)
-            {
-                --refCount;
-                if (refCount == 0)
-                    free(nodePtr[0]);
-            }
-            else
-            {
-                nodePtr[1] = wBuffers;
-                wBuffers = node;
-                ++wbSize;
-            }
+            return (char *)(node) + 2 * sizeof(void *);
         }
 
         /**
@@ -173,75 +213,137 @@ namespace HSLL
          */
         void releaseAllBlocks()
         {
-            while (rBuffers)
+            for (int type = BUFFER_TYPE_READ; type <= BUFFER_TYPE_CHUNK; type++)
             {
-                void **node = (void **)(rBuffers);
-                unsigned int &refCount = *(unsigned int *)(node[0]);
-                rBuffers = node[1];
-                --refCount;
-                if (refCount == 0)
-                    free(node[0]);
-            }
+                reclaim((BUFFER_TYPE)type);
 
-            while (wBuffers)
-            {
-                void **node = (void **)(wBuffers);
-                unsigned int &refCount = *(unsigned int *)(node[0]);
-                wBuffers = node[1];
-                --refCount;
-                if (refCount == 0)
-                    free(node[0]);
+                while (buffers[type])
+                {
+                    void **node = (void **)(buffers[type]);
+                    Block *block = (Block *)(node[0]);
+                    buffers[type] = node[1];
+                    if (--block->refCount == 0)
+                        free(block);
+                }
+
+                bSize[type] = 0;
+                total[type] = 0;
             }
         }
 
+    public:
         /**
-         * @brief Private constructor initializes empty pools
+         * @brief Constructor initializes empty pools
          */
-        SPTcpBufferPool() : rbSize(0), wbSize(0), rBuffers(NULL), wBuffers(NULL) {}
+        SPTcpBufferPool() : buffers{NULL, NULL, NULL}, bSize{0, 0, 0}, total{0, 0, 0},
+                            returned{nullptr, nullptr, nullptr}, scratch(nullptr) {}
 
         /**
          * @brief Destructor cleans up all allocated memory blocks
+         * @note All buffers must be released before the owning pool is destroyed
          */
         ~SPTcpBufferPool()
         {
             releaseAllBlocks();
+            free(scratch);
+        }
+
+        /**
+         * @brief Get the number of buffers in a local free list
+         * @param type Buffer type (read/write)
+         * @note Owner thread only; buffers waiting on the return stack are not counted
+         */
+        unsigned int available(BUFFER_TYPE type) const
+        {
+            return bSize[type];
+        }
+
+        /**
+         * @brief Get the number of buffers carved from live blocks
+         * @param type Buffer type (read/write)
+         * @note Owner thread only
+         */
+        unsigned int allocated(BUFFER_TYPE type) const
+        {
+            return total[type];
+        }
+
+        /**
+         * @brief Binds a pool to the calling thread
+         * @param pool Pool serving all subsequent allocations of this thread (nullptr to unbind)
+         */
+        static void Bind(SPTcpBufferPool *pool)
+        {
+            local = pool;
         }
 
-    public:
         /**
-         * @brief Get a buffer from the appropriate pool
+         * @brief Get a buffer from the pool of the calling thread
          * @param type Buffer type (read/write)
          * @return Pointer to allocated buffer or NULL on failure
          */
         static void *GetBuffer(BUFFER_TYPE type)
         {
-            return (type == BUFFER_TYPE_READ) ? pool.GetReadBufferInner() : pool.GetWriteBufferInner();
+            if (local)
+                return local->get(type);
+
+            std::lock_guard<std::mutex> lock(sharedMtx);
+            return shared.get(type);
         }
 
         /**
-         * @brief Return a buffer to its pool
+         * @brief Get the scratch read buffer of the calling thread
+         * @return READ_BSIZE bytes of scratch space, NULL if no pool is bound or allocation failed
+         * @note The content is only valid until the thread's next use of the scratch buffer
+         */
+        static void *GetScratch()
+        {
+            if (!local)
+                return NULL;
+
+            if (!local->scratch)
+                local->scratch = malloc(tcpConfig.READ_BSIZE);
+
+            return local->scratch;
+        }
+
+        /**
+         * @brief Return a buffer to the pool that allocated it
          * @param buf Buffer to release
          * @param type Buffer type (read/write)
+         * @note Buffers owned by another thread's pool go through its return stack
          */
         static void FreeBuffer(void *buf, BUFFER_TYPE type)
         {
-            (type == BUFFER_TYPE_READ) ? pool.FreeReadBuffferInner(buf) : pool.FreeWriteBufferInner(buf);
+            void *node = (char *)(buf)-2 * sizeof(void *);
+            SPTcpBufferPool *owner = ((Block *)(((void **)(node))[0]))->owner;
+
+            if (owner == local)
+            {
+                owner->put(node, type);
+            }
+            else if (owner == &shared)
+            {
+                std::lock_guard<std::mutex> lock(sharedMtx);
+                shared.put(node, type);
+            }
+            else
+            {
+                owner->giveBack(node, type);
+            }
         }
 
         /**
-         * @brief Resets the buffer pool to initial state, releasing all allocated memory
+         * @brief Resets the shared pool to initial state, releasing all allocated memory
          * @note User must ensure all buffers are returned before calling this method.
          *       Calling this with outstanding buffers will cause memory corruption.
          */
         static void reset()
         {
-            pool.releaseAllBlocks();
-            pool.rbSize = 0;
-            pool.wbSize = 0;
-            pool.rBuffers = nullptr;
-            pool.wBuffers = nullptr;
+            std::lock_guard<std::mutex> lock(sharedMtx);
+            shared.releaseAllBlocks();
         }
     };
 }
 
-#endif
\ No newline at end of file
+#endif
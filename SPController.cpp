@@ -1,23 +1,73 @@
 
 #include "SPController.h"
 
+#include <linux/errqueue.h>
+
+#include "SPUring.hpp"
+#include "SPTimer.hpp"
+#include "SPTls.hpp"
+
 namespace HSLL
 {
+    /**
+     * @brief Sum the lengths of I/O vectors
+     */
+    static size_t IovecLength(const iovec *vec, unsigned int num)
+    {
+        size_t len = 0;
+        for (unsigned int i = 0; i < num; i++)
+            len += vec[i].iov_len;
+        return len;
+    }
+
     // SOCKController Implementation
-    bool SOCKController::init(int fd, void *ctx, IOThreadInfo *info)
+    bool SOCKController::init(int fd, void *ctx, IOThreadInfo *info, const SPListener *listener)
     {
+        this->fd = fd;
+        this->info = info;
+        this->listener = listener;
+        this->ctx = ctx;
+        this->next = nullptr;
+        this->events = tcpConfig.EPOLL_DEFAULT_EVENT;
+        peerClosed = false;
+        connecting = false;
+        adopted = false;
+        handedOff = false;
+        sendHead = sendTail = sendCursor = nullptr;
+        sendBytes = 0;
+        sendGap = 0;
+        zcSeq = 0;
+        zcState = 0;
+        uringFlags = 0;
+        uringEvents = 0;
+        uringRequest = 0;
+        uringHead = uringTail = -1;
+        uringBytes = 0;
+        uringWait = nullptr;
+        edgeEvents = tcpConfig.EPOLL_DEFAULT_EVENT;
+        edgeState.store(0, std::memory_order_relaxed);
+        sendBlocked = false;
+        tls = nullptr;
+        armNext = nullptr;
+        timerDeadline.store(0, std::memory_order_relaxed);
+        timerScheduled.store(0, std::memory_order_relaxed);
+        timerQueued.store(false, std::memory_order_relaxed);
+        timerNext = nullptr;
+        timerPrev = nullptr;
+        timerWait = nullptr;
+        frameScan = 0;
+        readMark = listener->mark.readMark;
+        writeMark = listener->mark.writeMark;
+        maxLatency = listener->mark.maxLatency;
+        holdDeadline = 0;
+        holdIndex = 0;
+
         if (!readBuf.Init())
             return false;
 
         if (!writeBuf.Init())
             return false;
 
-        this->fd = fd;
-        this->info = info;
-        this->ctx = ctx;
-        this->events = tcpConfig.EPOLL_DEFAULT_EVENT;
-        peerClosed = false;
-        ipPort = "[" + std::string(ip) + "]:" + std::to_string(port);
         return true;
     }
 
@@ -46,32 +96,196 @@ namespace HSLL
             if (errno == EINTR)
                 goto retry;
             else if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                sendBlocked = true;
+                return 0;
+            }
+            else
+                return -1;
+        }
+
+        if (ret < (ssize_t)len)
+            sendBlocked = true;
+        return ret;
+    }
+
+    ssize_t SOCKController::readvInner(iovec *vec, unsigned int num)
+    {
+        msghdr msg = {};
+        msg.msg_iov = vec;
+        msg.msg_iovlen = num;
+
+    retry:
+        ssize_t ret = recvmsg(fd, &msg, 0);
+        if (ret == -1)
+        {
+            if (errno == EINTR)
+                goto retry;
+            else if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return 0;
+            else
+                return -1;
+        }
+        return ret;
+    }
+
+    ssize_t SOCKController::writevInner(iovec *vec, unsigned int num)
+    {
+#if defined(SPSOCK_TLS)
+        if (tls)
+            return SPTls::Writev(tls, vec, num, sendBlocked);
+#endif
+
+        msghdr msg = {};
+        msg.msg_iov = vec;
+        msg.msg_iovlen = num;
+
+    retry:
+        ssize_t ret = sendmsg(fd, &msg, MSG_NOSIGNAL);
+        if (ret == -1)
+        {
+            if (errno == EINTR)
+                goto retry;
+            else if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                sendBlocked = true;
                 return 0;
+            }
             else
                 return -1;
         }
+
+        if ((size_t)ret < IovecLength(vec, num))
+            sendBlocked = true;
         return ret;
     }
 
     bool SOCKController::readSocket()
     {
-        unsigned int len;
+        iovec vec[SPSOCK_MAX_IOVEC];
+        unsigned int num;
+        bool ret = true;
+
+#if defined(SPSOCK_URING_SUPPORTED)
+        if (info->ring)
+            return readRing();
+#endif
 
-        while (len = readBuf.distanceWrite())
+#if defined(SPSOCK_TLS)
+        if (tls)
+            return readTls();
+#endif
+
+        if (!readBuf.attached() && !tcpConfig.BUFFER_CHUNK_SIZE)
+        {
+            unsigned char *scratch = (unsigned char *)SPTcpBufferPool::GetScratch();
+
+            if (scratch)
+            {
+                size_t len = readBuf.bytesWrite();
+                ssize_t bytes = readInner(scratch, len);
+
+                if (bytes <= 0)
+                    return bytes == 0;
+
+                if (readBuf.write(scratch, bytes) != bytes)
+                    return false;
+
+                if (bytes < (ssize_t)len)
+                    return true;
+            }
+        }
+
+        while (num = readBuf.writeVec(vec, SPSOCK_MAX_IOVEC))
         {
-            ssize_t bytes = readInner(readBuf.writePtr(), len);
+            size_t len = IovecLength(vec, num);
+            ssize_t bytes = readvInner(vec, num);
 
             if (bytes > 0)
                 readBuf.commitWrite(bytes);
-            else if (bytes == 0)
-                return true;
             else
-                return false;
+                ret = (bytes == 0);
+
+            if (bytes < (ssize_t)len)
+                break;
+        }
+
+        readBuf.release();
+        return ret;
+    }
+
+    bool SOCKController::readRing()
+    {
+#if defined(SPSOCK_URING_SUPPORTED)
+        SPUring *ring = info->ring;
+
+        while (uringHead != -1)
+        {
+            SPUringBuffer *buf = ring->buffer(uringHead);
+            unsigned int len = buf->end - buf->begin;
+            unsigned int bytes = readBuf.write(buf->data + buf->begin, len);
+
+            buf->begin += bytes;
+            uringBytes -= bytes;
 
             if (bytes < len)
-                return true;
+                break;
+
+            int next = buf->next;
+            ring->recycle(uringHead);
+            uringHead = next;
         }
-        return true;
+
+        if (uringHead == -1)
+            uringTail = -1;
+
+        if (uringFlags & URING_FLAG_EOF)
+            peerClosed = true;
+
+        readBuf.release();
+        return !(uringFlags & URING_FLAG_ERROR);
+#else
+        return false;
+#endif
+    }
+
+    bool SOCKController::readTls()
+    {
+#if defined(SPSOCK_TLS)
+        iovec vec[SPSOCK_MAX_IOVEC];
+        unsigned int num;
+        bool ret = true;
+        TLS_READ_STATUS status = TLS_READ_MORE;
+
+        while (status == TLS_READ_MORE && !readFull() && (num = readBuf.writeVec(vec, SPSOCK_MAX_IOVEC)))
+        {
+            ssize_t bytes = SPTls::Readv(tls, vec, num, readBuf.bytesWrite(), status);
+
+            if (bytes > 0)
+                readBuf.commitWrite(bytes);
+            else if (bytes < 0)
+                ret = false;
+            else if (status == TLS_READ_MORE)
+                break;
+        }
+
+        if (status == TLS_READ_CLOSED)
+            peerClosed = true;
+
+        readBuf.release();
+        return ret;
+#else
+        return false;
+#endif
+    }
+
+    bool SOCKController::readFull()
+    {
+#if defined(SPSOCK_TLS)
+        if (tls)
+            return readBuf.bytesWrite() < SPSOCK_TLS_RECORD_SIZE && !SPTls::Pending(tls);
+#endif
+        return readBuf.bytesWrite() == 0;
     }
 
     void *SOCKController::getCtx()
@@ -79,11 +293,26 @@ namespace HSLL
         return ctx;
     }
 
+    const SPPeerAddr *SOCKController::getPeer()
+    {
+        return &peer;
+    }
+
     bool SOCKController::isPeerClosed()
     {
         return peerClosed;
     }
 
+    bool SOCKController::isHandedOff()
+    {
+        return handedOff;
+    }
+
+    bool SOCKController::isConnected()
+    {
+        return !connecting;
+    }
+
     size_t SOCKController::read(void *buf, size_t len)
     {
         return readBuf.read(buf, len);
@@ -96,6 +325,19 @@ namespace HSLL
 
     ssize_t SOCKController::write(const void *buf, size_t len)
     {
+#if defined(SPSOCK_TLS)
+        if (tls)
+        {
+            ssize_t ret = SPTls::Write(tls, buf, len, sendBlocked);
+            if (ret == -1 && (errno == EPIPE || errno == ECONNRESET))
+            {
+                peerClosed = true;
+                return -2;
+            }
+            return ret;
+        }
+#endif
+
     retry:
         ssize_t ret = send(fd, buf, len, MSG_NOSIGNAL);
         if (ret == -1)
@@ -103,7 +345,10 @@ namespace HSLL
             if (errno == EINTR)
                 goto retry;
             else if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                sendBlocked = true;
                 return 0;
+            }
             else if (errno == EPIPE || errno == ECONNRESET)
             {
                 peerClosed = true;
@@ -112,6 +357,9 @@ namespace HSLL
             else
                 return -1;
         }
+
+        if (ret < (ssize_t)len)
+            sendBlocked = true;
         return ret;
     }
 
@@ -120,23 +368,325 @@ namespace HSLL
         return writeBuf.write(buf, len);
     }
 
-    ssize_t SOCKController::commitWrite()
+    ssize_t SOCKController::flushBuffer(unsigned int len)
     {
-        unsigned int len;
+        iovec vec[SPSOCK_MAX_IOVEC];
+        unsigned int num = writeBuf.readVec(vec, SPSOCK_MAX_IOVEC);
+        size_t covered = 0;
 
-        while (len = writeBuf.distanceRead())
+        for (unsigned int i = 0; i < num; i++)
         {
-            ssize_t bytes = writeInner(writeBuf.readPtr(), len);
+            if (covered + vec[i].iov_len >= len)
+            {
+                vec[i].iov_len = len - covered;
+                num = i + 1;
+                break;
+            }
+            covered += vec[i].iov_len;
+        }
 
-            if (bytes > 0)
-                writeBuf.commitRead(bytes);
-            else if (bytes == 0)
-                return writeBuf.bytesRead();
+        ssize_t bytes = writevInner(vec, num);
+        if (bytes > 0)
+            writeBuf.commitRead(bytes);
+        return bytes;
+    }
+
+    ssize_t SOCKController::sendRequest(SPSendRequest *req)
+    {
+        ssize_t ret;
+        int flags = req->zerocopy ? (MSG_NOSIGNAL | MSG_ZEROCOPY) : MSG_NOSIGNAL;
+
+        while (true)
+        {
+#if defined(SPSOCK_TLS)
+            if (tls)
+            {
+                bool blocked = false;
+                ret = (req->fd != -1) ? SPTls::SendFile(tls, req->fd, req->offset, req->len, blocked)
+                                      : SPTls::Write(tls, req->buf, req->len, blocked);
+                if (ret < 0)
+                    return -1;
+
+                if (ret == 0 && blocked)
+                {
+                    sendBlocked = true;
+                    return 0;
+                }
+
+                if (req->fd != -1)
+                    req->offset += ret;
+                break;
+            }
+#endif
+
+            if (req->fd != -1)
+                ret = sendfile(fd, req->fd, &req->offset, req->len);
+            else
+                ret = send(fd, req->buf, req->len, flags);
+
+            if (ret != -1)
+                break;
+
+            if (errno == EINTR)
+                continue;
+            else if (errno == ENOBUFS && (flags & MSG_ZEROCOPY))
+            {
+                flags &= ~MSG_ZEROCOPY;
+                req->zerocopy = false;
+            }
+            else if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                sendBlocked = true;
+                return 0;
+            }
             else
+                return -1;
+        }
+
+        if (ret == 0)
+        {
+            // Only a file request hands nothing to the kernel without blocking: its source ended early
+            sendBytes -= req->len;
+            req->len = 0;
+            req->truncated = true;
+            return 0;
+        }
+
+        if ((size_t)ret < req->len)
+            sendBlocked = true;
+
+        if (req->fd == -1)
+        {
+            if (flags & MSG_ZEROCOPY)
+            {
+                if (req->sends++ == 0)
+                    req->seq = zcSeq;
+                req->pending++;
+                zcSeq++;
+            }
+            req->buf += ret;
+        }
+
+        req->len -= ret;
+        sendBytes -= ret;
+        return ret;
+    }
+
+    bool SOCKController::queueRequest(const char *buf, int fd, off_t offset, size_t len,
+                                      SendCompleteProc proc, void *arg)
+    {
+        if (len == 0)
+            return false;
+
+        SPSendRequest *req = new (std::nothrow) SPSendRequest;
+        if (!req)
+            return false;
+
+        req->next = nullptr;
+        req->buf = buf;
+        req->fd = fd;
+        req->offset = offset;
+        req->len = len;
+        req->gap = writeBuf.bytesRead() - sendGap;
+        req->seq = 0;
+        req->sends = 0;
+        req->pending = 0;
+        req->zerocopy = false;
+        req->truncated = false;
+        req->proc = proc;
+        req->arg = arg;
+
+        if (buf && len >= SPSOCK_ZEROCOPY_MIN_SIZE && !tls)
+        {
+            if (zcState == 0)
+            {
+                int one = 1;
+                zcState = (setsockopt(this->fd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) == 0) ? 1 : -1;
+            }
+            req->zerocopy = (zcState == 1);
+        }
+
+        if (sendTail)
+            sendTail->next = req;
+        else
+            sendHead = req;
+
+        sendTail = req;
+        if (!sendCursor)
+            sendCursor = req;
+
+        sendGap += req->gap;
+        sendBytes += len;
+        return true;
+    }
+
+    bool SOCKController::reapZeroCopy()
+    {
+        char control[128];
+
+        while (true)
+        {
+            msghdr msg = {};
+            msg.msg_control = control;
+            msg.msg_controllen = sizeof(control);
+
+            if (recvmsg(fd, &msg, MSG_ERRQUEUE) == -1)
+            {
+                if (errno == EINTR)
+                    continue;
+                else if (errno == EAGAIN || errno == EWOULDBLOCK)
+                    break;
+                else
+                    return false;
+            }
+
+            for (cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm))
+            {
+                if (!(cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) &&
+                    !(cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR))
+                    continue;
+
+                sock_extended_err *err = (sock_extended_err *)CMSG_DATA(cm);
+                if (err->ee_origin == SO_EE_ORIGIN_ZEROCOPY && err->ee_errno == 0)
+                    completeRange(err->ee_info, err->ee_data);
+            }
+        }
+
+        completeSends();
+        return true;
+    }
+
+    void SOCKController::completeRange(unsigned int first, unsigned int last)
+    {
+        // Requests carry consecutive sequence ranges in queue order; only those up to the cursor were sent
+        for (SPSendRequest *req = sendHead; req; req = req->next)
+        {
+            if (req->sends)
+            {
+                if ((int)(last - req->seq) < 0)
+                    break;
+
+                int from = (int)(first - req->seq);
+                int to = (int)(last - req->seq);
+                int end = (int)req->sends - 1;
+
+                if (from <= end)
+                    req->pending -= (to < end ? to : end) - (from > 0 ? from : 0) + 1;
+            }
+
+            if (req == sendCursor)
+                break;
+        }
+    }
+
+    bool SOCKController::handleError()
+    {
+        if (zcState != 1)
+            return false;
+
+        int error = 0;
+        socklen_t len = sizeof(error);
+        if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &len) != 0 || error != 0)
+            return false;
+
+        return reapZeroCopy();
+    }
+
+    void SOCKController::completeSends()
+    {
+        while (sendHead && sendHead != sendCursor)
+        {
+            SPSendRequest *req = sendHead;
+            if (req->pending)
+                break;
+
+            sendHead = req->next;
+            if (!sendHead)
+                sendTail = nullptr;
+
+            if (req->proc)
+                req->proc(this, req->arg, !req->truncated);
+            delete req;
+        }
+    }
+
+    void SOCKController::releaseSends()
+    {
+        bool sent = true;
+
+        while (sendHead)
+        {
+            SPSendRequest *req = sendHead;
+            sendHead = req->next;
+
+            if (req == sendCursor)
+                sent = false;
+
+            if (req->proc)
+                req->proc(this, req->arg, sent && !req->truncated);
+            delete req;
+        }
+
+        sendTail = sendCursor = nullptr;
+        sendBytes = 0;
+        sendGap = 0;
+    }
+
+    bool SOCKController::sendZeroCopy(const void *buf, size_t len, SendCompleteProc proc, void *arg)
+    {
+        if (!buf)
+            return false;
+
+        return queueRequest((const char *)buf, -1, 0, len, proc, arg);
+    }
+
+    bool SOCKController::sendFile(int fd, off_t offset, size_t len, SendCompleteProc proc, void *arg)
+    {
+        if (fd < 0)
+            return false;
+
+        return queueRequest(nullptr, fd, offset, len, proc, arg);
+    }
+
+    ssize_t SOCKController::commitWrite()
+    {
+        if (zcState == 1 && sendHead != sendCursor)
+            reapZeroCopy();
+
+        while (true)
+        {
+            unsigned int len = sendCursor ? sendCursor->gap : writeBuf.bytesRead();
+
+            if (len)
+            {
+                ssize_t bytes = flushBuffer(len);
+
+                if (bytes < 0)
+                    return bytes;
+
+                if (sendCursor)
+                {
+                    sendCursor->gap -= bytes;
+                    sendGap -= bytes;
+                }
+
+                if (bytes < len)
+                    return writeBuf.bytesRead() + sendBytes;
+            }
+
+            if (!sendCursor)
+                break;
+
+            ssize_t bytes = sendRequest(sendCursor);
+
+            if (bytes < 0)
                 return bytes;
 
-            if (bytes < len)
-                return writeBuf.bytesRead();
+            if (sendCursor->len)
+                return writeBuf.bytesRead() + sendBytes;
+
+            sendCursor = sendCursor->next;
+            completeSends();
         }
         return 0;
     }
@@ -148,7 +698,7 @@ namespace HSLL
 
     size_t SOCKController::getWriteBufferSize()
     {
-        return writeBuf.bytesRead();
+        return writeBuf.bytesRead() + sendBytes;
     }
 
     SPBuffer *SOCKController::getReadBuffer()
@@ -173,30 +723,39 @@ namespace HSLL
 
     ssize_t SOCKController::writeBack()
     {
-        ssize_t writeResult = commitWrite();
+        if (sendHead)
+        {
+            ssize_t writeResult = commitWrite();
 
-        if (writeResult != 0)
-            return writeResult;
+            if (writeResult != 0)
+                return writeResult;
+        }
 
-        while (true)
-        {
-            unsigned int chunk = readBuf.distanceRead();
+        iovec vec[SPSOCK_MAX_IOVEC];
+        unsigned int num = writeBuf.readVec(vec, SPSOCK_MAX_IOVEC - 2);
+        const unsigned int pending = writeBuf.bytesRead();
 
-            if (chunk == 0)
-                break;
+        if (IovecLength(vec, num) == pending)
+            num += readBuf.readVec(vec + num, SPSOCK_MAX_IOVEC - num);
 
-            ssize_t sent = writeInner(readBuf.readPtr(), chunk);
+        if (num == 0)
+            return 0;
 
-            if (sent > 0)
-                readBuf.commitRead(sent);
-            else if (sent == 0)
-                break;
-            else
-                return sent;
+        ssize_t sent = writevInner(vec, num);
 
-            writeResult += sent;
+        if (sent < 0)
+            return sent;
+
+        if (sent < pending)
+        {
+            writeBuf.commitRead(sent);
+            return writeBuf.bytesRead();
         }
-        return writeResult;
+
+        writeBuf.commitRead(pending);
+        readBuf.commitRead(sent - pending);
+
+        return sent - pending;
     }
 
     size_t SOCKController::moveToWriteBuffer()
@@ -221,27 +780,56 @@ namespace HSLL
         return moved;
     }
 
+    bool SOCKController::setTimer(unsigned int ms)
+    {
+        if (!info->wheel)
+            return false;
+
+        timerDeadline.store(SPTimerWheel::Now() + ms, std::memory_order_seq_cst);
+        info->wheel->update(this);
+        return true;
+    }
+
+    void SOCKController::cancelTimer()
+    {
+        if (!info->wheel)
+            return;
+
+        timerDeadline.store(0, std::memory_order_seq_cst);
+        info->wheel->update(this);
+    }
+
+    void SOCKController::setWaterMark(unsigned int readMark, unsigned int writeMark)
+    {
+        this->readMark = readMark;
+        this->writeMark = writeMark;
+    }
+
+    bool SOCKController::setDispatchLatency(unsigned int us)
+    {
+        if (!info->holds)
+            return false;
+
+        maxLatency = us;
+        return true;
+    }
+
     bool SOCKController::enableEvents(bool read, bool write)
     {
-        bool ret = DEFER::funcEvent(this, read, write);
-        events = 0;
-        if (ret)
-        {
-            if (read)
-                events |= EPOLLIN;
+        readBuf.release();
+        writeBuf.release();
 
-            if (write)
-                events |= EPOLLOUT;
-        }
-        return ret;
+        // Recorded before rearming: the controller belongs to the IO loop once funcEvent() succeeds
+        events = (read ? (int)EPOLLIN : 0) | (write ? (int)EPOLLOUT : 0);
+        return DEFER::funcEvent(this, read, write);
     }
 
     bool SOCKController::renableEvents()
     {
-        bool ret = DEFER::funcEvent(this, events & EPOLLIN, events & EPOLLOUT);
-        if (!ret)
-            events = 0;
-        return ret;
+        readBuf.release();
+        writeBuf.release();
+
+        return DEFER::funcEvent(this, events & EPOLLIN, events & EPOLLOUT);
     }
 
     void SOCKController::close()
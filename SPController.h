@@ -4,12 +4,38 @@
 #include <string>
 #include <sys/time.h>
 #include <arpa/inet.h>
+#include <sys/sendfile.h>
 
 #include "SPTypes.h"
 #include "SPBuffer.h"
 
 namespace HSLL
 {
+/**
+ * @brief Minimum payload size sent with MSG_ZEROCOPY
+ * @details Smaller buffers are cheaper to copy than to pin and are sent with a regular send.
+ */
+#define SPSOCK_ZEROCOPY_MIN_SIZE (16 * 1024)
+
+    /**
+     * @brief Zero-copy send request queued on a connection
+     */
+    struct SPSendRequest
+    {
+        SPSendRequest *next;   ///< Next request in submission order
+        const char *buf;       ///< Unsent part of the user buffer (nullptr for file requests)
+        int fd;                ///< Source file descriptor (-1 for buffer requests)
+        off_t offset;          ///< Current offset in the source file
+        size_t len;            ///< Bytes not yet handed to the kernel
+        unsigned int gap;      ///< Write buffer bytes that must be sent before this request
+        unsigned int seq;      ///< MSG_ZEROCOPY sequence number of the first send carrying this request
+        unsigned int sends;    ///< MSG_ZEROCOPY sends carrying this request
+        unsigned int pending;  ///< Zero-copy notifications of this request not yet received
+        bool zerocopy;         ///< Further sends of this request use MSG_ZEROCOPY
+        bool truncated;        ///< The source file ended before the whole range was sent
+        SendCompleteProc proc; ///< Completion callback
+        void *arg;             ///< Completion callback argument
+    };
 
     /**
      * @brief Controller class for socket operations
@@ -20,27 +46,70 @@ namespace HSLL
         template <ADDRESS_FAMILY>
         friend class SPSockTcp;
         friend class DEFER::SPDefered;
+        friend class SPTimerWheel;
+        friend class SPHoldQueue;
 
         int fd;          ///< Socket file descriptor
         int events;      ///< Bitmask of currently active epoll events (EPOLLIN/EPOLLOUT)
         bool peerClosed; ///< Whether the peer (remote endpoint) has closed the connection
+        bool connecting; ///< Whether an outbound connection is still waiting for its handshake
+        bool adopted;    ///< Whether a connection handed over by the predecessor awaits its first read pass
+        bool handedOff;  ///< Whether the connection is released because a successor took it over
 
         void *ctx;                 ///< Context pointer for callback functions
         IOThreadInfo *info;        ///< Context pointer for i/o event loop
-        char ip[INET6_ADDRSTRLEN]; ///< IP address string (IPv4 or IPv6)
-        unsigned short port;       ///< Port number for the socket connection
-        std::string ipPort;        ///< Combined IP:port string for identification
+        const SPListener *listener; ///< Listener that accepted the connection (callbacks and options)
+        SOCKController *next;      ///< Link in the owning loop's pending close list
+        SPPeerAddr peer;           ///< Binary peer address (formatted only when logged)
 
         SPBuffer readBuf{BUFFER_TYPE_READ};   ///< Buffer for incoming data
         SPBuffer writeBuf{BUFFER_TYPE_WRITE}; ///< Buffer for outgoing data
 
+        SPSendRequest *sendHead;   ///< Oldest request not yet completed
+        SPSendRequest *sendTail;   ///< Newest queued request
+        SPSendRequest *sendCursor; ///< First request with unsent bytes
+        size_t sendBytes;          ///< Request bytes not yet handed to the kernel
+        unsigned int sendGap;      ///< Write buffer bytes reserved ahead of unsent requests
+        unsigned int zcSeq;        ///< Sequence number of the next MSG_ZEROCOPY send
+        signed char zcState;       ///< SO_ZEROCOPY state: 0 untried, 1 enabled, -1 unsupported
+
+        int uringFlags;            ///< io_uring state of the connection (URING_FLAG bits)
+        int uringEvents;           ///< Events the connection is armed for on an io_uring loop
+        int uringRequest;          ///< Events requested by a rearm not yet applied by the loop
+        int uringHead;             ///< First parked provided buffer (-1 for none)
+        int uringTail;             ///< Last parked provided buffer (-1 for none)
+        unsigned int uringBytes;   ///< Bytes held in parked provided buffers
+        SOCKController *uringWait; ///< Link in the owning loop's starved list
+
+        int edgeEvents;             ///< Events registered with EPOLLET (EPOLLIN/EPOLLOUT)
+        std::atomic<int> edgeState; ///< Ownership and unconsumed edges (EDGE_FLAG bits)
+        bool sendBlocked;           ///< A send stopped short since the last writable edge
+        SSL *tls;                   ///< TLS session (nullptr for plaintext connections)
+        SOCKController *armNext;    ///< Link in the owning loop's rearm lists
+
+        std::atomic<unsigned long long> timerDeadline;  ///< Monotonic expiry of the timer in milliseconds (0 if disarmed)
+        std::atomic<unsigned long long> timerScheduled; ///< Expiry the timer wheel slot was chosen for (0 if unlinked)
+        std::atomic<bool> timerQueued;                  ///< Waiting on the loop's pending timer stack
+        SOCKController *timerNext;                      ///< Next connection in the timer wheel slot
+        SOCKController **timerPrev;                     ///< Link pointing at this connection (nullptr if unlinked)
+        SOCKController *timerWait;                      ///< Link in the loop's pending timer stack
+
+        unsigned int frameScan; ///< Read buffer bytes already searched for a frame delimiter
+
+        unsigned int readMark;           ///< Minimum buffered bytes dispatched to the read callback
+        unsigned int writeMark;          ///< Maximum pending bytes dispatched to the write callback
+        unsigned int maxLatency;         ///< Microseconds data is held below readMark (0 for no limit)
+        unsigned long long holdDeadline; ///< Monotonic dispatch time of held data in microseconds (0 if not held)
+        size_t holdIndex;                ///< Position in the loop's hold queue plus one (0 if not queued)
+
         /**
          * @brief Initializes the controller with socket parameters
          * @param fd Socket file descriptor
          * @param ctx Context pointer for callbacks
          * @param info Context pointer for i/o event loop
+         * @param listener Listener that accepted the connection
          */
-        bool init(int fd, void *ctx, IOThreadInfo *info);
+        bool init(int fd, void *ctx, IOThreadInfo *info, const SPListener *listener);
 
         /**
          * @brief Reads data from the socket
@@ -60,6 +129,73 @@ namespace HSLL
          */
         ssize_t writeInner(const void *buf, size_t len);
 
+        /**
+         * @brief Scatter-reads data from the socket
+         * @param vec I/O vectors to fill
+         * @param num Number of I/O vectors
+         * @return Number of bytes read, 0 for EAGAIN/EWOULDBLOCK, -1 for errors
+         */
+        ssize_t readvInner(iovec *vec, unsigned int num);
+
+        /**
+         * @brief Gather-writes data to the socket
+         * @param vec I/O vectors to send
+         * @param num Number of I/O vectors
+         * @return Number of bytes sent, 0 for EAGAIN/EWOULDBLOCK, -1 for errors
+         */
+        ssize_t writevInner(iovec *vec, unsigned int num);
+
+        /**
+         * @brief Sends up to len bytes from the front of the write buffer
+         * @param len Maximum number of bytes to send
+         * @return Number of bytes sent, 0 for EAGAIN/EWOULDBLOCK, -1 for errors
+         */
+        ssize_t flushBuffer(unsigned int len);
+
+        /**
+         * @brief Hands the next part of a queued request to the kernel
+         * @param req Request to send
+         * @return Number of bytes sent, 0 for EAGAIN/EWOULDBLOCK, -1 for errors
+         */
+        ssize_t sendRequest(SPSendRequest *req);
+
+        /**
+         * @brief Queues a zero-copy send request
+         * @return false if the request could not be allocated
+         */
+        bool queueRequest(const char *buf, int fd, off_t offset, size_t len,
+                          SendCompleteProc proc, void *arg);
+
+        /**
+         * @brief Drains MSG_ZEROCOPY notifications from the socket error queue
+         * @return false on socket errors
+         */
+        bool reapZeroCopy();
+
+        /**
+         * @brief Accounts a zero-copy notification to the requests it covers
+         * @param first First completed sequence number
+         * @param last Last completed sequence number (inclusive)
+         */
+        void completeRange(unsigned int first, unsigned int last);
+
+        /**
+         * @brief Handles an EPOLLERR event
+         * @return true if the error only signalled zero-copy completions
+         */
+        bool handleError();
+
+        /**
+         * @brief Invokes callbacks of requests the kernel is finished with
+         */
+        void completeSends();
+
+        /**
+         * @brief Invokes callbacks of all remaining requests and frees them
+         * @note Called when the connection is closed
+         */
+        void releaseSends();
+
         /**
          * @brief Reads data from socket into the read buffer
          * @return true if read was successful or would block, false on error
@@ -67,6 +203,26 @@ namespace HSLL
          */
         bool readSocket();
 
+        /**
+         * @brief Copies parked io_uring receive buffers into the read buffer
+         * @return true unless the receive failed with a socket error
+         * @note Buffers that do not fit stay parked for the next read event
+         */
+        bool readRing();
+
+        /**
+         * @brief Decrypts TLS records into the read buffer
+         * @return true unless the session or socket failed
+         * @note Reads until the socket is drained or the buffer lacks room for a whole record
+         */
+        bool readTls();
+
+        /**
+         * @brief Checks whether the read buffer stopped reading from the socket for lack of room
+         * @note With TLS a whole record must fit before the next one is read
+         */
+        bool readFull();
+
         /**
          * @brief Re-enables event monitoring with previously configured events
          * @return true on success, false on failure (requires Close())
@@ -80,6 +236,12 @@ namespace HSLL
          */
         void *getCtx();
 
+        /**
+         * @brief Gets the binary address of the remote endpoint
+         * @return Peer address, format it with SPFormatPeer() when text is needed
+         */
+        const SPPeerAddr *getPeer();
+
         /**
          * @brief Checks if connection is in half-closed state
          * @return true indicates:
@@ -90,6 +252,21 @@ namespace HSLL
          */
         bool isPeerClosed();
 
+        /**
+         * @brief Checks whether the connection was handed over to a successor process
+         * @return true only in the close callback of a connection sent to the successor by the
+         *         handoff of SetHandoff(); the socket stays open there, so the callback should
+         *         release local state such as the context but not treat the peer as gone
+         */
+        bool isHandedOff();
+
+        /**
+         * @brief Checks if the connection is established
+         * @return false only for an outbound connection whose Connect() attempt has not completed,
+         *         such as in the close callback of a failed or timed-out attempt
+         */
+        bool isConnected();
+
         /**
          * @brief Reads data from the read buffer
          * @param buf Buffer to store the read data
@@ -127,12 +304,43 @@ namespace HSLL
          *       - Read buffer may still contain pending data (check getReadBufferSize())
          *       - Subsequent write operations will fail
          *       - Must call Close() after consuming all read buffer data
+         * @note With TLS enabled, after a return of 0 or a short write the unsent bytes
+         *       must be offered again (same content, possibly from another address)
+         *       before any other data on this connection, as OpenSSL requires
          */
         ssize_t write(const void *buf, size_t len);
 
         /**
-         * @brief Commits buffered writes to the socket
-         * @return Number of bytes remaining in write buffer (0 if all sent),
+         * @brief Queues a user buffer to be sent without copying
+         * @param buf Payload buffer, owned by the caller until proc is invoked
+         * @param len Payload size in bytes
+         * @param proc Completion callback (nullptr for none)
+         * @param arg Argument passed to proc
+         * @return true if queued, false on allocation failure or empty payload
+         * @note Data is sent in order with writeTemp() data by commitWrite().
+         *       Payloads of at least SPSOCK_ZEROCOPY_MIN_SIZE use MSG_ZEROCOPY and
+         *       complete once the kernel releases the pages. proc runs on the thread
+         *       currently owning the connection, with sent == false if the connection
+         *       closed before the payload was handed to the kernel.
+         */
+        bool sendZeroCopy(const void *buf, size_t len, SendCompleteProc proc = nullptr, void *arg = nullptr);
+
+        /**
+         * @brief Queues a file range to be sent with sendfile
+         * @param fd Source file descriptor, owned by the caller until proc is invoked
+         * @param offset Start offset in the file
+         * @param len Number of bytes to send
+         * @param proc Completion callback (nullptr for none)
+         * @param arg Argument passed to proc
+         * @return true if queued, false on allocation failure or empty range
+         * @note Same ordering and completion rules as sendZeroCopy(). If the file ends before
+         *       offset + len, proc is invoked with sent == false once the available bytes are sent.
+         */
+        bool sendFile(int fd, off_t offset, size_t len, SendCompleteProc proc = nullptr, void *arg = nullptr);
+
+        /**
+         * @brief Commits buffered writes and queued zero-copy requests to the socket
+         * @return Number of bytes remaining in write buffer and send queue (0 if all sent),
          *        -1 for system errors,
          *        -2 if connection is half-closed by peer
          * @note For return code -2:
@@ -144,6 +352,8 @@ namespace HSLL
 
         /**
          * @brief Direct writeback from read buffer
+         * @details Pending write buffer data and read buffer data are flushed
+         *          together with a single gather write
          * @return Total bytes successfully written (>=0),
          *        -1 for system errors,
          *        -2 if connection reset by peer
@@ -162,7 +372,7 @@ namespace HSLL
 
         /**
          * @brief Get the size of data pending in the write buffer
-         * @return Number of bytes waiting to be sent
+         * @return Number of bytes waiting to be sent, including queued zero-copy requests
          */
         size_t getWriteBufferSize();
 
@@ -200,6 +410,41 @@ namespace HSLL
          */
         size_t moveToWriteBuffer();
 
+        /**
+         * @brief Arms the connection timer
+         * @param ms Milliseconds until expiry, replacing the currently armed expiry
+         * @return false if no timer callback is registered or the loop runs on io_uring
+         * @note Timers fire once with SPSOCK_TIMER_TICK (10 ms) resolution, never early. The timer
+         *       callback is dispatched like a read/write callback: it never runs concurrently
+         *       with another callback of the connection and must end with enableEvents() or close().
+         *       Call only from a callback of this connection.
+         */
+        bool setTimer(unsigned int ms);
+
+        /**
+         * @brief Disarms the connection timer
+         * @note A timer that expired while a callback owned the connection is still delivered
+         */
+        void cancelTimer();
+
+        /**
+         * @brief Overrides the watermarks of this connection
+         * @param readMark Minimum bytes to trigger the read callback (0 for every read)
+         * @param writeMark Maximum buffered bytes to trigger the write callback (0xffffffff for every write event)
+         * @note New connections start with the marks set by SetWaterMark(). Call only from a
+         *       callback of this connection; the marks apply from its next event.
+         */
+        void setWaterMark(unsigned int readMark, unsigned int writeMark);
+
+        /**
+         * @brief Bounds how long data below the read watermark is held
+         * @param us Microseconds after which held data is dispatched anyway (0 waits for the mark)
+         * @return false if the loop runs on io_uring
+         * @note The bound is enforced by the loop's epoll_wait timeout (millisecond granularity,
+         *       never early). Call only from a callback of this connection.
+         */
+        bool setDispatchLatency(unsigned int us);
+
         /**
          * @brief Re-enables event monitoring for the socket
          * @param read Enable read events
@@ -1,3 +1,4 @@
+#include "SPLog.hpp"
 #include "SPDeferred.h"
 
 namespace HSLL::DEFER
@@ -19,5 +20,20 @@ namespace HSLL::DEFER
 
 namespace HSLL
 {
-    SPTcpBufferPool SPTcpBufferPool::pool;
+    std::mutex SPTcpBufferPool::sharedMtx;
+    SPTcpBufferPool SPTcpBufferPool::shared;
+    thread_local SPTcpBufferPool *SPTcpBufferPool::local = nullptr;
+    thread_local SPTimerWheel *SPTimerWheel::local = nullptr;
+
+    thread_local SPLogger::SPLogSlot SPLogger::slot{nullptr};
+    std::atomic<SPLogRing *> SPLogger::rings{nullptr};
+    std::atomic<int> SPLogger::state{0};
+    std::atomic<unsigned long long> SPLogger::dropped{0};
+    std::thread SPLogger::flusher;
+    std::atomic<int> SPLogger::wakefd{-1};
+
+    thread_local SPMetrics::Slot SPMetrics::slot{nullptr};
+    std::atomic<SPMetrics::Block *> SPMetrics::blocks{nullptr};
+    std::atomic<bool> SPMetrics::timing{false};
+    double SPMetrics::nsPerTick = 0;
 }
\ No newline at end of file
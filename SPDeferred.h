@@ -3,6 +3,7 @@
 
 #include "SPTask.hpp"
 #include "SPController.h"
+#include "SPTimer.hpp"
 
 namespace HSLL::DEFER
 {
@@ -0,0 +1,300 @@
+#ifndef HSLL_SPHANDOFF
+#define HSLL_SPHANDOFF
+
+/**
+ * @file SPHandoff.hpp
+ * @brief Passing listening and connected sockets between processes
+ * @details The two processes talk over a SOCK_SEQPACKET Unix socket. Every message is a
+ *          header followed by an optional payload, with descriptors attached as SCM_RIGHTS.
+ *          Paths starting with '@' name a socket in the abstract namespace.
+ */
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+
+/// Marker of every handoff message ("SPHF")
+#define SPSOCK_HANDOFF_MAGIC 0x53504846
+/// Milliseconds a handoff peer may block a send or the initial receive
+#define SPSOCK_HANDOFF_TIMEOUT 5000
+/// Most descriptors attached to one message
+#define SPSOCK_HANDOFF_MAX_FDS 16
+/// Most payload buffers of one message (the header takes one more iovec)
+#define SPSOCK_HANDOFF_MAX_IOV (SPSOCK_HANDOFF_MAX_FDS - 1)
+
+namespace HSLL
+{
+    /**
+     * @brief Types of handoff messages
+     */
+    enum HANDOFF_MESSAGE
+    {
+        HANDOFF_LISTENERS = 1,  ///< Listening sockets of the predecessor (one descriptor each)
+        HANDOFF_CONNECTION = 2, ///< One established connection, payload holds its unread bytes
+        HANDOFF_END = 3         ///< No connections follow
+    };
+
+    /**
+     * @brief Header of a handoff message
+     */
+    struct SPHandoffHeader
+    {
+        unsigned int magic; ///< SPSOCK_HANDOFF_MAGIC
+        unsigned int type;  ///< HANDOFF_MESSAGE value
+        unsigned int count; ///< Descriptors attached to the message
+        unsigned int len;   ///< Payload bytes following the header
+    };
+
+    /**
+     * @brief Unix socket transport of the handoff between an exiting process and its successor
+     * @note Stateless; every function operates on the descriptor it is given
+     */
+    class SPHandoff
+    {
+        /**
+         * @brief Builds the Unix socket address of a path
+         * @return false if the path is empty or too long
+         */
+        static bool Address(const char *path, sockaddr_un &addr, socklen_t &len)
+        {
+            size_t size = strlen(path);
+            if (size == 0 || size >= sizeof(addr.sun_path))
+                return false;
+
+            memset(&addr, 0, sizeof(addr));
+            addr.sun_family = AF_UNIX;
+            memcpy(addr.sun_path, path, size);
+
+            if (path[0] == '@')
+                addr.sun_path[0] = '\0';
+
+            len = (socklen_t)(offsetof(sockaddr_un, sun_path) + size + (path[0] == '@' ? 0 : 1));
+            return true;
+        }
+
+        /**
+         * @brief Bounds how long blocking sends and receives may wait
+         */
+        static bool Timeout(int fd)
+        {
+            timeval tv = {SPSOCK_HANDOFF_TIMEOUT / 1000, (SPSOCK_HANDOFF_TIMEOUT % 1000) * 1000};
+            return setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv)) == 0 &&
+                   setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) == 0;
+        }
+
+    public:
+        /**
+         * @brief Creates the socket a successor connects to
+         * @param path Socket path, replacing any stale socket file, or '@' name
+         * @return Non-blocking listening descriptor, -1 on error (errno set)
+         */
+        static int Serve(const char *path)
+        {
+            sockaddr_un addr;
+            socklen_t len;
+            if (!Address(path, addr, len))
+            {
+                errno = ENAMETOOLONG;
+                return -1;
+            }
+
+            int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (fd == -1)
+                return -1;
+
+            if (path[0] != '@')
+                unlink(path);
+
+            if (bind(fd, (sockaddr *)&addr, len) == -1 || listen(fd, 1) == -1)
+            {
+                int err = errno;
+                close(fd);
+                errno = err;
+                return -1;
+            }
+            return fd;
+        }
+
+        /**
+         * @brief Accepts the connection of a successor
+         * @param fd Descriptor returned by Serve()
+         * @return Blocking descriptor with bounded sends, -1 on error (errno set)
+         */
+        static int Accept(int fd)
+        {
+            int peer = accept4(fd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (peer != -1 && !Timeout(peer))
+            {
+                int err = errno;
+                close(peer);
+                errno = err;
+                return -1;
+            }
+            return peer;
+        }
+
+        /**
+         * @brief Connects to the socket of a running predecessor
+         * @param path Path given to Serve() by the predecessor
+         * @return Blocking descriptor with bounded sends and receives, -1 on error (errno set)
+         */
+        static int Dial(const char *path)
+        {
+            sockaddr_un addr;
+            socklen_t len;
+            if (!Address(path, addr, len))
+            {
+                errno = ENAMETOOLONG;
+                return -1;
+            }
+
+            int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+            if (fd == -1)
+                return -1;
+
+            if (!Timeout(fd) || connect(fd, (sockaddr *)&addr, len) == -1)
+            {
+                int err = errno;
+                close(fd);
+                errno = err;
+                return -1;
+            }
+            return fd;
+        }
+
+        /**
+         * @brief Removes the file of a socket created by Serve()
+         */
+        static void Unlink(const char *path)
+        {
+            if (path[0] != '@')
+                unlink(path);
+        }
+
+        /**
+         * @brief Sends one message
+         * @param fd Connected handoff descriptor
+         * @param type HANDOFF_MESSAGE value
+         * @param fds Descriptors to attach
+         * @param num Number of descriptors (at most SPSOCK_HANDOFF_MAX_FDS)
+         * @param data Payload buffers
+         * @param datanum Number of payload buffers (at most SPSOCK_HANDOFF_MAX_IOV)
+         * @return false on error (errno set)
+         */
+        static bool Send(int fd, unsigned int type, const int *fds, unsigned int num, const iovec *data = nullptr,
+                         unsigned int datanum = 0)
+        {
+            SPHandoffHeader header = {SPSOCK_HANDOFF_MAGIC, type, num, 0};
+            iovec vec[SPSOCK_HANDOFF_MAX_IOV + 1];
+            vec[0] = {&header, sizeof(header)};
+
+            for (unsigned int i = 0; i < datanum && i < SPSOCK_HANDOFF_MAX_IOV; i++)
+            {
+                vec[i + 1] = data[i];
+                header.len += data[i].iov_len;
+            }
+
+            char control[CMSG_SPACE(sizeof(int) * SPSOCK_HANDOFF_MAX_FDS)] = {};
+            msghdr msg = {};
+            msg.msg_iov = vec;
+            msg.msg_iovlen = 1 + (datanum < SPSOCK_HANDOFF_MAX_IOV ? datanum : SPSOCK_HANDOFF_MAX_IOV);
+
+            if (num)
+            {
+                msg.msg_control = control;
+                msg.msg_controllen = CMSG_SPACE(sizeof(int) * num);
+
+                cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+                cmsg->cmsg_level = SOL_SOCKET;
+                cmsg->cmsg_type = SCM_RIGHTS;
+                cmsg->cmsg_len = CMSG_LEN(sizeof(int) * num);
+                memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * num);
+            }
+
+            while (true)
+            {
+                if (sendmsg(fd, &msg, MSG_NOSIGNAL) != -1)
+                    return true;
+
+                if (errno != EINTR)
+                    return false;
+            }
+        }
+
+        /**
+         * @brief Receives one message
+         * @param fd Connected handoff descriptor
+         * @param header Receives the header; count is set to the descriptors actually stored
+         * @param fds Receives the attached descriptors (close-on-exec)
+         * @param max Capacity of fds (at most SPSOCK_HANDOFF_MAX_FDS)
+         * @param buf Receives the payload
+         * @param len Capacity of buf
+         * @param flags recvmsg() flags (MSG_DONTWAIT to poll)
+         * @return 1 for a message, 0 if the peer closed, -1 on error (errno set, EMSGSIZE for an
+         *         oversized payload); descriptors of rejected messages are closed
+         */
+        static int Receive(int fd, SPHandoffHeader &header, int *fds, unsigned int max, void *buf, size_t len,
+                           int flags = 0)
+        {
+            char control[CMSG_SPACE(sizeof(int) * SPSOCK_HANDOFF_MAX_FDS)];
+            iovec vec[2] = {{&header, sizeof(header)}, {buf, len}};
+
+            msghdr msg = {};
+            msg.msg_iov = vec;
+            msg.msg_iovlen = 2;
+            msg.msg_control = control;
+            msg.msg_controllen = sizeof(control);
+
+            ssize_t bytes;
+            while ((bytes = recvmsg(fd, &msg, flags | MSG_CMSG_CLOEXEC)) == -1 && errno == EINTR)
+                ;
+
+            if (bytes <= 0)
+                return (int)bytes;
+
+            unsigned int count = 0;
+            for (cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+            {
+                if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+                    continue;
+
+                unsigned int num = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+                for (unsigned int i = 0; i < num; i++)
+                {
+                    int received;
+                    memcpy(&received, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+
+                    if (count < max)
+                        fds[count++] = received;
+                    else
+                        close(received);
+                }
+            }
+
+            int err = 0;
+            if (bytes < (ssize_t)sizeof(header) || header.magic != SPSOCK_HANDOFF_MAGIC)
+                err = EPROTO;
+            else if (msg.msg_flags & (MSG_TRUNC | MSG_CTRUNC))
+                err = EMSGSIZE;
+            else if (bytes - sizeof(header) != header.len)
+                err = EPROTO;
+
+            if (err)
+            {
+                for (unsigned int i = 0; i < count; i++)
+                    close(fds[i]);
+                errno = err;
+                return -1;
+            }
+
+            header.count = count;
+            return 1;
+        }
+    };
+}
+
+#endif
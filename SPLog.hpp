@@ -1,21 +1,58 @@
 #ifndef HSLL_SPLOG
 #define HSLL_SPLOG
 
+#include <time.h>
+#include <errno.h>
+#include <string.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <atomic>
+#include <thread>
+#include <sstream>
 #include <iostream>
+#include <type_traits>
+#include <netinet/in.h>
 
 #include "SPTypes.h"
+#include "noncopyable.h"
 
 using namespace HSLL::DEFER;
 
+/**
+ * @brief Lowest log level compiled in (LOG_LEVEL enum value)
+ * @details Calls below this level are discarded at compile time together with their arguments,
+ *          before the runtime MIN_LOG_LEVEL check.
+ */
+#ifndef SPSOCK_LOG_MIN_LEVEL
+#define SPSOCK_LOG_MIN_LEVEL 0
+#endif
+
+/**
+ * @brief Bytes of the per-thread log ring (multiple of 8)
+ * @note Messages that do not fit into the free part of the ring are dropped and counted
+ */
+#ifndef SPSOCK_LOG_RING_SIZE
+#define SPSOCK_LOG_RING_SIZE (64 * 1024)
+#endif
+
+/**
+ * @brief Milliseconds the log flusher sleeps unless a ring fills past half
+ */
+#define SPSOCK_LOG_FLUSH_INTERVAL 10
+
 /**
  * @brief Macro for logging information with specified level
  * @param level Log level to use
  * @param ... Variadic arguments to log
  */
-#define HSLL_LOGINFO(level, ...)               \
-    {                                          \
-        if (level >= minLevel)                 \
-            LogInfo(true, level, __VA_ARGS__); \
+#define HSLL_LOGINFO(level, ...)                       \
+    {                                                  \
+        if constexpr ((level) >= SPSOCK_LOG_MIN_LEVEL) \
+        {                                              \
+            if (level >= minLevel)                     \
+                LogInfo(true, level, __VA_ARGS__);     \
+        }                                              \
     }
 
 /**
@@ -23,39 +60,576 @@ using namespace HSLL::DEFER;
  * @param level Log level to use
  * @param ... Variadic arguments to log
  */
-#define HSLL_LOGINFO_NOPREFIX(level, ...)       \
-    {                                           \
-        if (level >= minLevel)                  \
-            LogInfo(false, level, __VA_ARGS__); \
+#define HSLL_LOGINFO_NOPREFIX(level, ...)              \
+    {                                                  \
+        if constexpr ((level) >= SPSOCK_LOG_MIN_LEVEL) \
+        {                                              \
+            if (level >= minLevel)                     \
+                LogInfo(false, level, __VA_ARGS__);    \
+        }                                              \
     }
 
 namespace HSLL
 {
+    /**
+     * @brief Formats an encoded log argument
+     * @param os Stream receiving the text
+     * @param data Encoded argument bytes
+     * @param len Number of encoded bytes
+     */
+    typedef void (*SPLogEmit)(std::ostream &os, const void *data, unsigned int len);
+
+    /**
+     * @brief Log argument captured by the calling thread
+     * @details C strings are copied, trivially copyable values are stored in binary and
+     *          formatted by the flusher. Other types are formatted eagerly into text.
+     */
+    struct SPLogArg
+    {
+        SPLogEmit emit;   ///< Formatter run by the flusher
+        const void *data; ///< Bytes to encode
+        unsigned int len; ///< Number of bytes to encode
+        std::string text; ///< Eagerly formatted text (other types only)
+    };
+
+    /**
+     * @brief Single-producer single-consumer byte ring of one logging thread
+     * @details Records are [SPLogRecord][SPLogField + bytes]... padded to 8 bytes. Records that
+     *          would straddle the end are preceded by a skip record filling the remainder.
+     */
+    class SPLogRing : noncopyable
+    {
+        friend class SPLogger;
+
+        /**
+         * @brief Header of a record
+         */
+        struct SPLogRecord
+        {
+            unsigned long long time; ///< Monotonic time of the call in nanoseconds (merge order)
+            unsigned int size;       ///< Record bytes including the header
+            unsigned char level;     ///< LOG_LEVEL, 0xff for a skip record
+            unsigned char prefix;    ///< Print the level prefix
+            unsigned short num;      ///< Number of fields
+        };
+
+        /**
+         * @brief Header of an encoded argument
+         */
+        struct SPLogField
+        {
+            SPLogEmit emit;   ///< Formatter of the argument
+            unsigned int len; ///< Encoded bytes following the header
+        };
+
+        alignas(8) char data[SPSOCK_LOG_RING_SIZE]; ///< Record storage
+        std::atomic<size_t> head;                   ///< Bytes ever written (producer)
+        std::atomic<size_t> tail;                   ///< Bytes ever consumed (flusher)
+        std::atomic<bool> active;                   ///< Owned by a live thread
+        bool busy;                                  ///< A record is being written (signal re-entry guard)
+        SPLogRing *next;                            ///< Link in the logger's ring list
+        size_t cursor;                              ///< Next record to format (flusher)
+        size_t limit;                               ///< End of the records being formatted (flusher)
+
+        /**
+         * @brief Rounds a size up to the record alignment
+         */
+        static size_t Align(size_t size)
+        {
+            return (size + 7) & ~(size_t)7;
+        }
+
+    public:
+        /**
+         * @brief Constructor initializes an empty ring owned by the calling thread
+         */
+        SPLogRing() : head(0), tail(0), active(true), busy(false), next(nullptr), cursor(0), limit(0) {}
+
+        /**
+         * @brief Appends a record
+         * @param prefix Print the level prefix
+         * @param level Log level of the record
+         * @param args Captured arguments
+         * @param num Number of arguments
+         * @return 1 on success, 2 on success filling the ring past half, 0 if the ring is full,
+         *         -1 if the record can never be queued
+         *         (larger than half the ring or pushed from a signal handler interrupting a push)
+         * @note Owning thread only
+         */
+        int push(bool prefix, LOG_LEVEL level, const SPLogArg *args, unsigned int num)
+        {
+            size_t size = Align(sizeof(SPLogRecord));
+            for (unsigned int i = 0; i < num; i++)
+                size += Align(sizeof(SPLogField) + args[i].len);
+
+            if (size > SPSOCK_LOG_RING_SIZE / 2 || busy)
+                return -1;
+
+            busy = true;
+            std::atomic_signal_fence(std::memory_order_seq_cst);
+
+            size_t pos = head.load(std::memory_order_relaxed);
+            size_t used = pos - tail.load(std::memory_order_acquire);
+            size_t free = SPSOCK_LOG_RING_SIZE - used;
+            size_t offset = pos % SPSOCK_LOG_RING_SIZE;
+            size_t room = SPSOCK_LOG_RING_SIZE - offset;
+
+            if (size + (room < size ? room : 0) > free)
+            {
+                busy = false;
+                return 0;
+            }
+
+            if (room < size)
+            {
+                used += room;
+                SPLogRecord *skip = (SPLogRecord *)(data + offset);
+                skip->size = room;
+                skip->level = 0xff;
+                pos += room;
+                offset = 0;
+            }
+
+            timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+
+            SPLogRecord *record = (SPLogRecord *)(data + offset);
+            record->time = (unsigned long long)ts.tv_sec * 1000000000 + ts.tv_nsec;
+            record->size = size;
+            record->level = level;
+            record->prefix = prefix;
+            record->num = num;
+
+            char *cursor = data + offset + Align(sizeof(SPLogRecord));
+            for (unsigned int i = 0; i < num; i++)
+            {
+                SPLogField *field = (SPLogField *)cursor;
+                field->emit = args[i].emit;
+                field->len = args[i].len;
+                memcpy(cursor + sizeof(SPLogField), args[i].data, args[i].len);
+                cursor += Align(sizeof(SPLogField) + args[i].len);
+            }
+
+            head.store(pos + size, std::memory_order_release);
+            std::atomic_signal_fence(std::memory_order_seq_cst);
+            busy = false;
+            return (used < SPSOCK_LOG_RING_SIZE / 2 && used + size >= SPSOCK_LOG_RING_SIZE / 2) ? 2 : 1;
+        }
+    };
+
+    /**
+     * @brief Asynchronous log backend behind HSLL_LOGINFO
+     * @details Every logging thread owns a lock-free SPLogRing. A background flusher started by
+     *          the first message formats all rings into one batch and writes it to stdout with
+     *          a single write(), so logging threads never take a lock or issue a syscall.
+     *          Rings of exited threads are reused by new threads. At process exit the flusher
+     *          drains the rings and later messages are written synchronously.
+     */
+    class SPLogger
+    {
+        /**
+         * @brief Releases the calling thread's ring when the thread exits
+         */
+        struct SPLogSlot
+        {
+            SPLogRing *ring; ///< Ring owned by this thread
+
+            ~SPLogSlot()
+            {
+                if (ring)
+                    ring->active.store(false, std::memory_order_release);
+            }
+        };
+
+        static thread_local SPLogSlot slot;             ///< Ring of the calling thread
+        static std::atomic<SPLogRing *> rings;          ///< All rings ever created
+        static std::atomic<int> state;                  ///< 0 idle, 1 flusher running, 2 stopped
+        static std::atomic<unsigned long long> dropped; ///< Messages dropped since the last report
+        static std::thread flusher;                     ///< Background flusher thread
+        static std::atomic<int> wakefd;                 ///< Eventfd waking the flusher early (-1 if unavailable)
+
+        /**
+         * @brief Level prefixes indexed by LOG_LEVEL
+         */
+        static const char *Prefix(unsigned int level)
+        {
+            constexpr const char *const LevelStr[] = {
+                "\033[92m[INFO]\033[0m ",
+                "\033[93m[WARNING]\033[0m ",
+                "\033[95m[CRUCIAL]\033[0m ",
+                "\033[91m[ERROR]\033[0m "};
+
+            return level < 4 ? LevelStr[level] : "";
+        }
+
+        /**
+         * @brief Wakes the flusher before its interval elapses
+         */
+        static void Wake()
+        {
+            int fd = wakefd.load(std::memory_order_acquire);
+            if (fd != -1)
+            {
+                uint64_t value = 1;
+                ssize_t bytes = ::write(fd, &value, sizeof(value));
+                (void)bytes;
+            }
+        }
+
+        /**
+         * @brief Writes a whole buffer to stdout
+         */
+        static void Output(const std::string &text)
+        {
+            size_t done = 0;
+            while (done < text.size())
+            {
+                ssize_t bytes = ::write(STDOUT_FILENO, text.data() + done, text.size() - done);
+                if (bytes == -1 && errno == EINTR)
+                    continue;
+                if (bytes <= 0)
+                    break;
+                done += bytes;
+            }
+        }
+
+        /**
+         * @brief Formats one message
+         */
+        static void Format(std::ostream &os, bool prefix, LOG_LEVEL level, const SPLogArg *args, unsigned int num)
+        {
+            if (prefix)
+                os << Prefix(level);
+
+            for (unsigned int i = 0; i < num; i++)
+                args[i].emit(os, args[i].data, args[i].len);
+
+            os << '\n';
+        }
+
+        /**
+         * @brief Gets the next record of a ring being drained
+         * @return Oldest unformatted record, nullptr if the ring is drained
+         */
+        static const SPLogRing::SPLogRecord *Peek(SPLogRing *ring)
+        {
+            while (ring->cursor != ring->limit)
+            {
+                const SPLogRing::SPLogRecord *record =
+                    (const SPLogRing::SPLogRecord *)(ring->data + ring->cursor % SPSOCK_LOG_RING_SIZE);
+
+                if (record->level != 0xff)
+                    return record;
+
+                ring->cursor += record->size;
+            }
+            return nullptr;
+        }
+
+        /**
+         * @brief Formats all complete records of the rings in call order
+         * @param os Stream receiving the batch
+         * @return Number of records consumed
+         * @note Flusher thread only (or after it stopped). Rings are merged by record time.
+         */
+        static size_t Drain(std::ostream &os)
+        {
+            SPLogRing *first = rings.load(std::memory_order_acquire);
+            size_t count = 0;
+
+            for (SPLogRing *ring = first; ring; ring = ring->next)
+            {
+                ring->cursor = ring->tail.load(std::memory_order_relaxed);
+                ring->limit = ring->head.load(std::memory_order_acquire);
+            }
+
+            while (true)
+            {
+                SPLogRing *oldest = nullptr;
+                const SPLogRing::SPLogRecord *record = nullptr;
+
+                for (SPLogRing *ring = first; ring; ring = ring->next)
+                {
+                    const SPLogRing::SPLogRecord *next = Peek(ring);
+                    if (next && (!record || next->time < record->time))
+                    {
+                        oldest = ring;
+                        record = next;
+                    }
+                }
+
+                if (!oldest)
+                    break;
+
+                if (record->prefix)
+                    os << Prefix(record->level);
+
+                const char *cursor = (const char *)record + SPLogRing::Align(sizeof(SPLogRing::SPLogRecord));
+                for (unsigned int i = 0; i < record->num; i++)
+                {
+                    const SPLogRing::SPLogField *field = (const SPLogRing::SPLogField *)cursor;
+                    field->emit(os, cursor + sizeof(SPLogRing::SPLogField), field->len);
+                    cursor += SPLogRing::Align(sizeof(SPLogRing::SPLogField) + field->len);
+                }
+
+                os << '\n';
+                oldest->cursor += record->size;
+                count++;
+            }
+
+            for (SPLogRing *ring = first; ring; ring = ring->next)
+                ring->tail.store(ring->cursor, std::memory_order_release);
+
+            unsigned long long lost = dropped.exchange(0, std::memory_order_relaxed);
+            if (lost)
+                os << Prefix(LOG_LEVEL_WARNING) << lost << " log messages dropped\n";
+
+            return count;
+        }
+
+        /**
+         * @brief Body of the flusher thread
+         */
+        static void Run()
+        {
+            std::ostringstream batch;
+
+            while (true)
+            {
+                bool stop = state.load(std::memory_order_acquire) == 2;
+                size_t count = Drain(batch);
+
+                if (batch.tellp() > 0)
+                {
+                    Output(batch.str());
+                    batch.str(std::string());
+                }
+
+                if (stop)
+                    return;
+
+                int fd = wakefd.load(std::memory_order_acquire);
+                if (count == 0 && fd != -1)
+                {
+                    pollfd pfd = {fd, POLLIN, 0};
+                    if (poll(&pfd, 1, SPSOCK_LOG_FLUSH_INTERVAL) == 1)
+                    {
+                        uint64_t value;
+                        ssize_t bytes = ::read(fd, &value, sizeof(value));
+                        (void)bytes;
+                    }
+                }
+                else if (count == 0)
+                {
+                    timespec ts = {0, SPSOCK_LOG_FLUSH_INTERVAL * 1000000L};
+                    nanosleep(&ts, nullptr);
+                }
+            }
+        }
+
+        /**
+         * @brief Stops the flusher after draining all rings (registered with atexit)
+         */
+        static void Stop()
+        {
+            state.store(2, std::memory_order_release);
+
+            if (flusher.joinable())
+                flusher.join();
+
+            std::ostringstream batch;
+            Drain(batch);
+            Output(batch.str());
+        }
+
+        /**
+         * @brief Gets the ring of the calling thread, creating or reusing one on first use
+         * @return Ring owned by the calling thread, nullptr if allocation failed
+         */
+        static SPLogRing *Local()
+        {
+            if (slot.ring)
+                return slot.ring;
+
+            for (SPLogRing *ring = rings.load(std::memory_order_acquire); ring; ring = ring->next)
+            {
+                if (ring->active.load(std::memory_order_relaxed) ||
+                    ring->tail.load(std::memory_order_acquire) != ring->head.load(std::memory_order_relaxed))
+                    continue;
+
+                bool expected = false;
+                if (ring->active.compare_exchange_strong(expected, true, std::memory_order_acq_rel))
+                    return slot.ring = ring;
+            }
+
+            SPLogRing *ring = new (std::nothrow) SPLogRing;
+            if (!ring)
+                return nullptr;
+
+            SPLogRing *head = rings.load(std::memory_order_relaxed);
+            do
+            {
+                ring->next = head;
+            } while (!rings.compare_exchange_weak(head, ring, std::memory_order_release,
+                                                  std::memory_order_relaxed));
+
+            int expected = 0;
+            if (state.compare_exchange_strong(expected, 1, std::memory_order_acq_rel))
+            {
+                wakefd.store(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC), std::memory_order_release);
+                flusher = std::thread(Run);
+                atexit(Stop);
+            }
+
+            return slot.ring = ring;
+        }
+
+    public:
+        /**
+         * @brief Queues a message for the flusher
+         * @param prefix Print the level prefix
+         * @param level Log level of the message
+         * @param args Captured arguments
+         * @param num Number of arguments
+         * @note Messages below LOG_LEVEL_CRUCIAL are dropped when the ring is full, more severe
+         *       ones wait for the flusher. Messages that cannot be queued, messages logged after
+         *       the flusher stopped and all messages when SPSOCK_LOG_SYNC is defined are written
+         *       synchronously.
+         */
+        static void Log(bool prefix, LOG_LEVEL level, const SPLogArg *args, unsigned int num)
+        {
+#if !defined(SPSOCK_LOG_SYNC)
+            if (state.load(std::memory_order_acquire) != 2)
+            {
+                SPLogRing *ring = Local();
+                if (ring)
+                {
+                    int result;
+                    while ((result = ring->push(prefix, level, args, num)) == 0 && level >= LOG_LEVEL_CRUCIAL &&
+                           state.load(std::memory_order_acquire) != 2)
+                    {
+                        Wake();
+
+                        timespec ts = {0, SPSOCK_LOG_FLUSH_INTERVAL * 100000L};
+                        nanosleep(&ts, nullptr);
+                    }
+
+                    if (result == 2)
+                        Wake();
+
+                    if (result > 0)
+                        return;
+
+                    if (result == 0 && level < LOG_LEVEL_CRUCIAL)
+                    {
+                        dropped.fetch_add(1, std::memory_order_relaxed);
+                        return;
+                    }
+                }
+            }
+#endif
+            std::ostringstream line;
+            Format(line, prefix, level, args, num);
+            Output(line.str());
+        }
+    };
+
+    /**
+     * @brief Flusher side of a text argument
+     */
+    inline void SPLogEmitText(std::ostream &os, const void *data, unsigned int len)
+    {
+        os.write((const char *)data, len);
+    }
+
+    /**
+     * @brief Flusher side of a binary argument
+     * @tparam T Trivially copyable argument type
+     */
+    template <class T>
+    void SPLogEmitValue(std::ostream &os, const void *data, unsigned int)
+    {
+        T value;
+        memcpy(&value, data, sizeof(T));
+        os << value;
+    }
+
+    /**
+     * @brief Captures a log argument
+     * @tparam T Argument type
+     * @param value Argument passed to HSLL_LOGINFO
+     */
+    template <class T>
+    SPLogArg SPLogCapture(const T &value)
+    {
+        typedef typename std::decay<T>::type D;
+
+        if constexpr (std::is_same<D, const char *>::value || std::is_same<D, char *>::value)
+        {
+            const char *text = value;
+            if (text == nullptr)
+                text = "(null)";
+
+            return {SPLogEmitText, text, (unsigned int)strlen(text), {}};
+        }
+        else if constexpr (std::is_same<D, std::string>::value)
+        {
+            return {SPLogEmitText, value.data(), (unsigned int)value.size(), {}};
+        }
+        else if constexpr (std::is_trivially_copyable<D>::value && !std::is_array<T>::value)
+        {
+            return {SPLogEmitValue<D>, &value, sizeof(D), {}};
+        }
+        else
+        {
+            std::ostringstream os;
+            os << value;
+            SPLogArg arg{SPLogEmitText, nullptr, 0, os.str()};
+            return arg;
+        }
+    }
+
     /**
      * @brief Utility method for logging information
      * @tparam TS Variadic template parameters
      * @param level Log level to use
      * @param ts Variadic arguments to log
-     * @note Uses variadic templates to support multiple arguments.
-     *       A thread-safe logging library is recommended instead.
+     * @note Arguments are captured on the calling thread and formatted by the log flusher
      */
     template <class... TS>
-    static void LogInfo(bool prefix, LOG_LEVEL level, TS... ts)
+    static void LogInfo(bool prefix, LOG_LEVEL level, const TS &...ts)
     {
-        constexpr const char *const LevelStr[] = {
-            "\033[92m[INFO]\033[0m ",
-            "\033[93m[WARNING]\033[0m ",
-            "\033[95m[CRUCIAL]\033[0m ",
-            "\033[91m[ERROR]\033[0m "};
-
-        if (sizeof...(TS))
+        if constexpr (sizeof...(TS) > 0)
         {
-            if (prefix)
-                (std::cout << LevelStr[level] << ... << ts) << std::endl;
-            else
-                (std::cout << ... << ts) << std::endl;
+            int saved = errno;
+            SPLogArg args[] = {SPLogCapture(ts)...};
+
+            for (SPLogArg &arg : args)
+            {
+                if (arg.data == nullptr)
+                {
+                    arg.data = arg.text.data();
+                    arg.len = arg.text.size();
+                }
+            }
+
+            SPLogger::Log(prefix, level, args, sizeof...(TS));
+            errno = saved;
         }
     }
+
+    /**
+     * @brief Streams a peer address as "[ip]:port"
+     * @note Log statements pass the binary address, so it is only formatted when the line is emitted
+     */
+    inline std::ostream &operator<<(std::ostream &os, const SPPeerAddr &peer)
+    {
+        char ip[INET6_ADDRSTRLEN];
+        if (SPFormatPeer(&peer, ip, sizeof(ip)) == nullptr)
+            ip[0] = '\0';
+
+        return os << "[" << ip << "]:" << peer.port;
+    }
 }
 
-#endif // HSLL_SPLOG
\ No newline at end of file
+#endif // HSLL_SPLOG
@@ -0,0 +1,247 @@
+#ifndef HSLL_SPMETRICS
+#define HSLL_SPMETRICS
+
+#include <time.h>
+#include <unistd.h>
+#include <atomic>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "SPTypes.h"
+#include "noncopyable.h"
+
+namespace HSLL
+{
+    /**
+     * @brief Kinds of latency recorded by SPMetrics
+     */
+    enum SPMETRICS_KIND
+    {
+        SPMETRICS_QUEUE_WAIT = 0, ///< Time a task spent in a worker queue
+        SPMETRICS_CALLBACK = 1,   ///< Run time of a callback
+    };
+
+    /**
+     * @brief Process-wide latency histograms of the TCP callbacks
+     * @details Every recording thread owns a cache-line aligned block of histograms taken from
+     *          a lock-free list, so recording takes a few relaxed stores and never contends. Blocks of
+     *          exited threads keep their samples and are handed to the next thread needing one.
+     *          Timestamps come from the TSC (clock_gettime on other architectures) and are only
+     *          taken while timing is enabled.
+     */
+    class SPMetrics : noncopyable
+    {
+        /**
+         * @brief Histograms owned by one thread
+         */
+        struct alignas(64) Block
+        {
+            std::atomic<unsigned long long> count[2];                           ///< Samples per kind
+            std::atomic<unsigned long long> sum[2];                             ///< Sum of samples per kind
+            std::atomic<unsigned long long> max[2];                             ///< Largest sample per kind
+            std::atomic<unsigned long long> buckets[2][SPSOCK_METRICS_BUCKETS]; ///< Histogram per kind
+            std::atomic<bool> used;                                             ///< Owned by a live thread
+            Block *next;                                                        ///< Next block of the list
+        };
+
+        /**
+         * @brief Thread-local handle returning the block when the thread exits
+         */
+        struct Slot
+        {
+            Block *block;
+
+            ~Slot()
+            {
+                if (block)
+                    block->used.store(false, std::memory_order_release);
+            }
+        };
+
+        static thread_local Slot slot;      ///< Block of the calling thread
+        static std::atomic<Block *> blocks; ///< All blocks ever allocated
+        static std::atomic<bool> timing;    ///< Whether timestamps are taken
+        static double nsPerTick;            ///< Nanoseconds per timestamp tick
+
+        /**
+         * @brief Gets the block of the calling thread, claiming or allocating one
+         * @return Block, nullptr if out of memory
+         */
+        static Block *Acquire()
+        {
+            if (slot.block)
+                return slot.block;
+
+            for (Block *block = blocks.load(std::memory_order_acquire); block; block = block->next)
+            {
+                bool used = false;
+                if (!block->used.load(std::memory_order_relaxed) &&
+                    block->used.compare_exchange_strong(used, true, std::memory_order_acquire))
+                    return slot.block = block;
+            }
+
+            Block *block = new (std::nothrow) Block();
+            if (!block)
+                return nullptr;
+
+            block->used.store(true, std::memory_order_relaxed);
+            block->next = blocks.load(std::memory_order_relaxed);
+            while (!blocks.compare_exchange_weak(block->next, block, std::memory_order_release,
+                                                 std::memory_order_relaxed))
+                ;
+
+            return slot.block = block;
+        }
+
+        /**
+         * @brief Gets the monotonic clock in nanoseconds
+         */
+        static unsigned long long Clock()
+        {
+            timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            return (unsigned long long)ts.tv_sec * 1000000000 + ts.tv_nsec;
+        }
+
+    public:
+        /**
+         * @brief Adds to a counter that has a single writer
+         * @param counter Counter only the calling thread writes to
+         * @param value Amount to add
+         */
+        static void Add(std::atomic<unsigned long long> &counter, unsigned long long value = 1)
+        {
+            counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Reads the timestamp counter
+         */
+        static unsigned long long Ticks()
+        {
+#if defined(__x86_64__) || defined(__i386__)
+            return __rdtsc();
+#else
+            return Clock();
+#endif
+        }
+
+        /**
+         * @brief Checks whether timestamps are taken
+         */
+        static bool Timing()
+        {
+            return timing.load(std::memory_order_acquire);
+        }
+
+        /**
+         * @brief Enables or disables timestamping
+         * @param enable Whether queue waits and callback durations are recorded
+         * @note Calibrates the timestamp counter against the monotonic clock the first time (~10ms)
+         */
+        static void SetTiming(bool enable)
+        {
+            if (enable && nsPerTick == 0)
+            {
+#if defined(__x86_64__) || defined(__i386__)
+                unsigned long long clock = Clock(), ticks = Ticks();
+                usleep(10000);
+                unsigned long long elapsed = Ticks() - ticks;
+                nsPerTick = elapsed ? (double)(Clock() - clock) / elapsed : 1;
+#else
+                nsPerTick = 1;
+#endif
+            }
+
+            timing.store(enable, std::memory_order_release);
+        }
+
+        /**
+         * @brief Maps a sample to its histogram bucket
+         * @param ns Sample in nanoseconds
+         * @return Bucket index
+         */
+        static unsigned int Bucket(unsigned long long ns)
+        {
+            if (ns < 16)
+                return (unsigned int)ns;
+
+            unsigned int exp = 63 - __builtin_clzll(ns);
+            unsigned int index = 16 + (exp - 4) * 4 + (unsigned int)((ns >> (exp - 2)) & 3);
+            return index < SPSOCK_METRICS_BUCKETS ? index : SPSOCK_METRICS_BUCKETS - 1;
+        }
+
+        /**
+         * @brief Gets the largest value counted by a bucket
+         * @param index Bucket index
+         * @return Inclusive upper bound in nanoseconds
+         */
+        static unsigned long long BucketBound(unsigned int index)
+        {
+            if (index < 16)
+                return index;
+
+            if (index >= SPSOCK_METRICS_BUCKETS - 1)
+                return ~0ULL;
+
+            unsigned int exp = 4 + (index - 16) / 4;
+            return ((5ULL + (index - 16) % 4) << (exp - 2)) - 1;
+        }
+
+        /**
+         * @brief Records the time elapsed between two timestamps
+         * @param kind Latency kind
+         * @param start Earlier timestamp from Ticks()
+         * @param end Later timestamp from Ticks()
+         */
+        static void Record(SPMETRICS_KIND kind, unsigned long long start, unsigned long long end)
+        {
+            Block *block = Acquire();
+            if (!block)
+                return;
+
+            unsigned long long ns = (end > start) ? (unsigned long long)((end - start) * nsPerTick) : 0;
+
+            Add(block->count[kind], 1);
+            Add(block->sum[kind], ns);
+            Add(block->buckets[kind][Bucket(ns)], 1);
+
+            if (ns > block->max[kind].load(std::memory_order_relaxed))
+                block->max[kind].store(ns, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Sums the histograms of all threads
+         * @param queueWait Receives the queue wait histogram
+         * @param callback Receives the callback duration histogram
+         */
+        static void Collect(SPLatencyStats *queueWait, SPLatencyStats *callback)
+        {
+            SPLatencyStats *stats[2] = {queueWait, callback};
+
+            for (int kind = 0; kind < 2; kind++)
+                memset(stats[kind], 0, sizeof(SPLatencyStats));
+
+            for (Block *block = blocks.load(std::memory_order_acquire); block; block = block->next)
+            {
+                for (int kind = 0; kind < 2; kind++)
+                {
+                    SPLatencyStats *out = stats[kind];
+                    unsigned long long max = block->max[kind].load(std::memory_order_relaxed);
+
+                    out->count += block->count[kind].load(std::memory_order_relaxed);
+                    out->sum += block->sum[kind].load(std::memory_order_relaxed);
+                    if (max > out->max)
+                        out->max = max;
+
+                    for (unsigned int i = 0; i < SPSOCK_METRICS_BUCKETS; i++)
+                        out->buckets[i] += block->buckets[kind][i].load(std::memory_order_relaxed);
+                }
+            }
+        }
+    };
+}
+
+#endif
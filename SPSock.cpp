@@ -5,6 +5,7 @@ namespace HSLL
     // SOCKADDR_IN Implementation
     bool SOCKADDR_IN<ADDRESS_FAMILY_INET>::INIT(sockaddr_in &address, const char *ip, unsigned short port)
     {
+        memset(&address, 0, sizeof(address));
         address.sin_family = AF_INET;
         address.sin_port = htons(port);
 
@@ -23,6 +24,7 @@ namespace HSLL
 
     bool SOCKADDR_IN<ADDRESS_FAMILY_INET6>::INIT(sockaddr_in6 &address, const char *ip, unsigned short port)
     {
+        memset(&address, 0, sizeof(address));
         address.sin6_family = AF_INET6;
         address.sin6_port = htons(port);
 
@@ -39,16 +41,91 @@ namespace HSLL
         return true;
     }
 
+    bool SOCKADDR_IN<ADDRESS_FAMILY_INET>::INIT(sockaddr_in &address, const SPPeerAddr &peer)
+    {
+        if (peer.family != ADDRESS_FAMILY_INET)
+            return false;
+
+        memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_port = htons(peer.port);
+        memcpy(&address.sin_addr, peer.addr, sizeof(address.sin_addr));
+        return true;
+    }
+
+    bool SOCKADDR_IN<ADDRESS_FAMILY_INET6>::INIT(sockaddr_in6 &address, const SPPeerAddr &peer)
+    {
+        if (peer.family != ADDRESS_FAMILY_INET6)
+            return false;
+
+        memset(&address, 0, sizeof(address));
+        address.sin6_family = AF_INET6;
+        address.sin6_port = htons(peer.port);
+        memcpy(&address.sin6_addr, peer.addr, sizeof(address.sin6_addr));
+        return true;
+    }
+
+    void SOCKADDR_IN<ADDRESS_FAMILY_INET>::PEER(const sockaddr_in &address, SPPeerAddr &peer)
+    {
+        peer.family = ADDRESS_FAMILY_INET;
+        peer.port = ntohs(address.sin_port);
+        memcpy(peer.addr, &address.sin_addr, sizeof(address.sin_addr));
+        memset(peer.addr + sizeof(address.sin_addr), 0, sizeof(peer.addr) - sizeof(address.sin_addr));
+    }
+
+    void SOCKADDR_IN<ADDRESS_FAMILY_INET6>::PEER(const sockaddr_in6 &address, SPPeerAddr &peer)
+    {
+        peer.family = ADDRESS_FAMILY_INET6;
+        peer.port = ntohs(address.sin6_port);
+        memcpy(peer.addr, &address.sin6_addr, sizeof(address.sin6_addr));
+    }
+
+    const char *SPFormatPeer(const SPPeerAddr *peer, char *ip, size_t size)
+    {
+        if (peer == nullptr || ip == nullptr)
+            return nullptr;
+
+        return inet_ntop(peer->family, peer->addr, ip, size);
+    }
+
+    bool SPResolvePeer(const char *ip, unsigned short port, SPPeerAddr *peer)
+    {
+        if (ip == nullptr || peer == nullptr)
+            return false;
+
+        memset(peer, 0, sizeof(SPPeerAddr));
+        peer->port = port;
+
+        if (inet_pton(AF_INET, ip, peer->addr) == 1)
+        {
+            peer->family = ADDRESS_FAMILY_INET;
+            return true;
+        }
+
+        if (inet_pton(AF_INET6, ip, peer->addr) == 1)
+        {
+            peer->family = ADDRESS_FAMILY_INET6;
+            return true;
+        }
+
+        return false;
+    }
+
+    unsigned long long SPMetricsBucketBound(unsigned int index)
+    {
+        return SPMetrics::BucketBound(index);
+    }
+
     // TCP Implementation
     template <ADDRESS_FAMILY address_family>
-    void SPSockTcp<address_family>::SetLinger(int fd)
+    void SPSockTcp<address_family>::SetLinger(int fd, const linger &lin)
     {
         if (setsockopt(fd, SOL_SOCKET, SO_LINGER, &lin, sizeof(lin)) != 0)
             HSLL_LOGINFO(LOG_LEVEL_WARNING, "setsockopt(SO_LINGER) failed: ", strerror(errno));
     }
 
     template <ADDRESS_FAMILY address_family>
-    void SPSockTcp<address_family>::SetKeepAlive(int fd)
+    void SPSockTcp<address_family>::SetKeepAlive(int fd, const SPSockAlive &alive)
     {
         if (setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &alive.keepAlive, sizeof(alive.keepAlive)) != 0)
             HSLL_LOGINFO(LOG_LEVEL_WARNING, "setsockopt(SO_KEEPALIVE) failed: ", strerror(errno));
@@ -64,391 +141,2195 @@ namespace HSLL
     }
 
     template <ADDRESS_FAMILY address_family>
-    bool SPSockTcp<address_family>::HandleConnect(int idlefd)
+    void SPSockTcp<address_family>::CaptureListener(SPListener &listener)
     {
-        using SOCKADDR = SOCKADDR_IN<address_family>;
-        typename SOCKADDR::TYPE addr;
-        socklen_t addrlen = sizeof(addr);
+        listener.proc = proc;
+        listener.alive = alive;
+        listener.lin = lin;
+        listener.offload = offload;
+        listener.framer = framer;
+        listener.mark = markGlobal;
+        listener.tls = tls;
+    }
 
-        int fd = accept(listenfd, (sockaddr *)&addr, &addrlen);
-        if (fd == -1)
-        {
-            if (errno == EMFILE)
-            {
-                close(idlefd);
-                idlefd = accept(listenfd, NULL, NULL);
-                close(idlefd);
-                idlefd = open("/dev/null", O_RDONLY | O_CLOEXEC);
-            }
-            HSLL_LOGINFO(LOG_LEVEL_ERROR, "accept() failed: ", strerror(errno));
-            return false;
-        }
+    template <ADDRESS_FAMILY address_family>
+    SPListener *SPSockTcp<address_family>::ListenerOf(void *ptr)
+    {
+        if (ptr < (void *)listeners || ptr >= (void *)(listeners + listenerNum))
+            return nullptr;
 
-        if (alive.keepAlive)
-            SetKeepAlive(fd);
+        return (SPListener *)ptr;
+    }
 
-        if (lin.l_onoff)
-            SetLinger(fd);
+    template <ADDRESS_FAMILY address_family>
+    bool SPSockTcp<address_family>::UsesPool()
+    {
+        if (tcpConfig.IO_DISPATCH_MODE != DISPATCH_MODE_INLINE)
+            return true;
 
-        int flags = fcntl(fd, F_GETFL);
-        if (flags == -1)
+        for (unsigned int i = 0; i < listenerNum; i++)
         {
-            HSLL_LOGINFO(LOG_LEVEL_ERROR, "fcntl(F_GETFL) failed: ", strerror(errno));
-            close(fd);
-            return true;
+            if (listeners[i].offload.read || listeners[i].offload.write)
+                return true;
         }
+        return false;
+    }
 
-        if (fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1)
+    template <ADDRESS_FAMILY address_family>
+    bool SPSockTcp<address_family>::UsesTimers()
+    {
+        for (unsigned int i = 0; i < listenerNum; i++)
         {
-            HSLL_LOGINFO(LOG_LEVEL_ERROR, "fcntl(F_SETFL) failed: ", strerror(errno));
-            close(fd);
-            return true;
+            if (listeners[i].proc.tmp)
+                return true;
         }
+        return false;
+    }
 
-        auto [it, success] = connections.emplace(fd, SOCKController{});
-        if (!success)
+    template <ADDRESS_FAMILY address_family>
+    void SPSockTcp<address_family>::CloseLoopListeners(IOThreadInfo &info)
+    {
+        for (unsigned int k = 0; k < listenerNum; k++)
         {
-            HSLL_LOGINFO(LOG_LEVEL_ERROR, "Failed to add connection to map");
-            close(fd);
-            return true;
+            if (info.listenfd[k] != -1 && info.listenfd[k] != listeners[k].fd)
+                close(info.listenfd[k]);
+            info.listenfd[k] = -1;
         }
+    }
 
-        auto &controller = it->second;
-        if constexpr (address_family == ADDRESS_FAMILY_INET)
+    template <ADDRESS_FAMILY address_family>
+    int SPSockTcp<address_family>::CreateListener(int flags, const SPListener &listener)
+    {
+        int fd;
+        if ((fd = socket(address_family, PROTOCOL_TCP | flags, 0)) == -1)
         {
-            inet_ntop(AF_INET, &addr.sin_addr, controller.ip, INET6_ADDRSTRLEN);
-            controller.port = ntohs(addr.sin_port);
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "socket() failed: ", strerror(errno));
+            return -1;
         }
-        else
+
+        int reuse = 1;
+        if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) == -1 ||
+            setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &reuse, sizeof(reuse)) == -1)
         {
-            inet_ntop(AF_INET6, &addr.sin6_addr, controller.ip, INET6_ADDRSTRLEN);
-            controller.port = ntohs(addr.sin6_port);
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "setsockopt(SO_REUSEPORT|SO_REUSEADDR) failed: ", strerror(errno));
+            close(fd);
+            return -1;
         }
 
-        void *ctx = nullptr;
-        if (proc.cnp)
-            ctx = proc.cnp(controller.ip, controller.port);
-
-        IOThreadInfo *info = &loopInfo[0];
+        int busyPoll = tcpConfig.BUSY_POLL_US;
+        if (busyPoll && setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &busyPoll, sizeof(busyPoll)) == -1)
+            HSLL_LOGINFO(LOG_LEVEL_WARNING, "setsockopt(SO_BUSY_POLL) failed: ", strerror(errno));
 
-        for (int i = 1; i < loopInfo.size(); i++)
+        if (bind(fd, (sockaddr *)&listener.addr, sizeof(typename SOCKADDR_IN<address_family>::TYPE)) == -1)
         {
-            if (loopInfo[i].count < info->count)
-                info = &loopInfo[i];
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "bind() failed: ", strerror(errno));
+            close(fd);
+            return -1;
         }
 
-        if (!controller.init(fd, ctx, info))
+        if (listen(fd, SOMAXCONN) == -1)
         {
-            HSLL_LOGINFO(LOG_LEVEL_WARNING, "Insufficient memory space");
-            CloseConnection(&controller);
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "listen() failed: ", strerror(errno));
+            close(fd);
+            return -1;
         }
-        else
+
+        return fd;
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    bool SPSockTcp<address_family>::HandleConnect(const SPListener *listener, int &idlefd)
+    {
+        using SOCKADDR = SOCKADDR_IN<address_family>;
+        typename SOCKADDR::TYPE addr;
+        socklen_t addrlen = sizeof(addr);
+
+        int fd = accept4(listener->fd, (sockaddr *)&addr, &addrlen, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd == -1)
         {
-            epoll_event event;
-            event.events = EPOLLERR | EPOLLHUP | EPOLLRDHUP | EPOLLONESHOT | tcpConfig.EPOLL_DEFAULT_EVENT;
-            event.data.fd = fd;
-            if (epoll_ctl(info->epollfd, EPOLL_CTL_ADD, fd, &event) != 0)
-            {
-                HSLL_LOGINFO(LOG_LEVEL_ERROR, "epoll_ctl(EPOLL_CTL_ADD) failed: ", strerror(errno));
-                CloseConnection(&controller);
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
                 return true;
+
+            if (errno == EMFILE)
+            {
+                close(idlefd);
+                idlefd = accept(listener->fd, NULL, NULL);
+                close(idlefd);
+                idlefd = open("/dev/null", O_RDONLY | O_CLOEXEC);
             }
-            info->count++;
-            HSLL_LOGINFO(LOG_LEVEL_INFO, "Accepted new connection from: ", controller.ipPort);
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "accept() failed: ", strerror(errno));
+            return false;
         }
-        return true;
-    }
 
-    template <ADDRESS_FAMILY address_family>
-    void SPSockTcp<address_family>::HandleExit(int sg)
-    {
-        if (SPSockTcp<address_family>::exitFlag)
+        int node = -1;
+        if (tcpConfig.NUMA_PLACEMENT)
         {
-            SPSockTcp<address_family>::exitFlag.store(false, std::memory_order_release);
-            HSLL_LOGINFO_NOPREFIX(LOG_LEVEL_CRUCIAL, "")
-            HSLL_LOGINFO(LOG_LEVEL_CRUCIAL, "Caught signal ", sg, ", exiting event loop");
+            int cpu;
+            socklen_t len = sizeof(cpu);
+            if (getsockopt(fd, SOL_SOCKET, SO_INCOMING_CPU, &cpu, &len) == 0 && cpu >= 0)
+                node = NodeOfCpu(cpu);
         }
-    }
 
-    template <ADDRESS_FAMILY address_family>
-    void SPSockTcp<address_family>::ActiveClose(SOCKController *controller)
-    {
-        epoll_ctl(controller->info->epollfd, EPOLL_CTL_DEL, controller->fd, nullptr);
-        auto This = GetInstance();
-        std::lock_guard<std::mutex> lock(This->cList.mtx);
-        This->cList.connections.push_back(controller);
+        AddConnection(fd, addr, PickLoop(node), listener);
+        return true;
     }
 
     template <ADDRESS_FAMILY address_family>
-    bool SPSockTcp<address_family>::EnableEvent(SOCKController *controller, bool read, bool write)
+    IOThreadInfo *SPSockTcp<address_family>::PickLoop(int node)
     {
-        epoll_event event;
-        event.data.fd = controller->fd;
-        event.events = EPOLLERR | EPOLLRDHUP | EPOLLHUP | EPOLLONESHOT;
+        IOThreadInfo *info = nullptr;
 
-        if (read)
-            event.events |= EPOLLIN;
+        for (int i = 0; i < loopInfo.size(); i++)
+        {
+            if (node != -1 && loopInfo[i].node != node)
+                continue;
 
-        if (write)
-            event.events |= EPOLLOUT;
+            if (!info || loopInfo[i].count < info->count)
+                info = &loopInfo[i];
+        }
 
-        if (epoll_ctl(controller->info->epollfd, EPOLL_CTL_MOD, controller->fd, &event) != 0)
-            return false;
+        if (!info)
+        {
+            info = &loopInfo[0];
 
-        return true;
+            for (int i = 1; i < loopInfo.size(); i++)
+            {
+                if (loopInfo[i].count < info->count)
+                    info = &loopInfo[i];
+            }
+        }
+        return info;
     }
 
     template <ADDRESS_FAMILY address_family>
-    void SPSockTcp<address_family>::CloseConnection(SOCKController *controller)
+    int SPSockTcp<address_family>::ClaimInherited(const SPListener &listener)
     {
-        if (proc.csp)
-            proc.csp(controller);
+        using SOCKADDR = SOCKADDR_IN<address_family>;
+        SPPeerAddr want = {};
+        SOCKADDR::PEER(*(const typename SOCKADDR::TYPE *)&listener.addr, want);
 
-        close(controller->fd);
-        connections.erase(controller->fd);
+        for (size_t i = 0; i < inherited.size(); i++)
+        {
+            typename SOCKADDR::TYPE bound;
+            socklen_t len = sizeof(bound);
+            if (getsockname(inherited[i], (sockaddr *)&bound, &len) != 0 || len != sizeof(bound) ||
+                ((sockaddr *)&bound)->sa_family != address_family)
+                continue;
+
+            SPPeerAddr have = {};
+            SOCKADDR::PEER(bound, have);
+            if (memcmp(&have, &want, sizeof(want)) != 0)
+                continue;
+
+            int fd = inherited[i];
+            inherited.erase(inherited.begin() + i);
+            return fd;
+        }
+        return -1;
     }
 
     template <ADDRESS_FAMILY address_family>
-    bool SPSockTcp<address_family>::CalculateOptimalThreadCounts(int *ioThreads, int *workerThreads)
+    bool SPSockTcp<address_family>::HandleHandoff()
     {
-        unsigned int hardware_threads = std::thread::hardware_concurrency();
-        if (hardware_threads == 0)
+        int peer = SPHandoff::Accept(handoffListen);
+        if (peer == -1)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                HSLL_LOGINFO(LOG_LEVEL_WARNING, "accept() on handoff socket failed: ", strerror(errno));
             return false;
+        }
 
-        if (hardware_threads <= 2)
+        int fds[SPSOCK_MAX_LISTENERS];
+        for (unsigned int k = 0; k < listenerNum; k++)
+            fds[k] = listeners[k].fd;
+
+        if (!SPHandoff::Send(peer, HANDOFF_LISTENERS, fds, listenerNum))
         {
-            *workerThreads = 1;
-            *ioThreads = 1;
+            HSLL_LOGINFO(LOG_LEVEL_WARNING, "Failed to hand off listeners: ", strerror(errno));
+            close(peer);
+            return false;
         }
-        else
-        {
-            float weight = tcpConfig.WORKER_THREAD_RATIO;
-            *workerThreads = hardware_threads * weight + 0.5;
-            *ioThreads = hardware_threads - *workerThreads;
 
-            if (*workerThreads == 0)
-            {
-                (*workerThreads)++;
-                (*ioThreads)--;
-            }
-            else if (*ioThreads == 0)
-            {
-                (*workerThreads)--;
-                (*ioThreads)++;
-            }
-        }
+        close(handoffListen);
+        handoffListen = -1;
+        successor = peer;
+        exitFlag.store(false, std::memory_order_release);
+        HSLL_LOGINFO(LOG_LEVEL_CRUCIAL, "Listeners handed off to successor, exiting event loop");
         return true;
     }
 
     template <ADDRESS_FAMILY address_family>
-    bool SPSockTcp<address_family>::CreateIOEventLoop(ThreadPool<SockTaskTcp> *pool, int num)
+    void SPSockTcp<address_family>::ReceiveHandoff()
     {
-        for (int i = 0; i < num; i++)
-        {
-            int epollfd, exitfd;
-
-            if ((epollfd = epoll_create1(0)) == -1)
-                break;
-
-            if ((exitfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) == -1)
-            {
-                close(epollfd);
-                break;
-            }
+        SPHandoffHeader header;
+        int fd;
+        std::vector<unsigned char> unread(tcpConfig.READ_BSIZE);
 
-            epoll_event event;
-            event.data.fd = exitfd;
-            event.events = EPOLLIN | EPOLLERR | EPOLLHUP;
-            if (epoll_ctl(epollfd, EPOLL_CTL_ADD, exitfd, &event) != 0)
-            {
-                close(epollfd);
-                close(exitfd);
-                break;
-            }
+        int ret = SPHandoff::Receive(predecessor, header, &fd, 1, unread.data(), unread.size(), MSG_DONTWAIT);
+        if (ret == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return;
 
-            loopInfo.push_back({0, epollfd, exitfd});
+        if (ret == -1 && errno == EMSGSIZE)
+        {
+            HSLL_LOGINFO(LOG_LEVEL_WARNING, "Handed over connection dropped: unread data exceeds READ_BSIZE");
+            return;
         }
 
-        if (loopInfo.size() != num)
+        if (ret == 1 && header.type == HANDOFF_CONNECTION && header.count == 1)
         {
-            for (int i = 0; i < loopInfo.size(); i++)
-            {
-                close(loopInfo.at(i).epollfd);
-                close(loopInfo.at(i).exitfd);
-            }
-            return false;
+            AdoptConnection(fd, unread.data(), header.len);
+            return;
         }
 
-        for (int i = 0; i < num; i++)
-            loops.emplace_back(std::thread{&SPSockTcp<address_family>::IOEventLoop, this, pool, loopInfo.at(i).epollfd, loopInfo.at(i).exitfd});
+        if (ret == 1 && header.count)
+            close(fd);
 
-        return true;
+        if (ret == 1 && header.type == HANDOFF_END)
+        {
+            HSLL_LOGINFO(LOG_LEVEL_CRUCIAL, "Handoff from predecessor completed");
+        }
+        else
+        {
+            HSLL_LOGINFO(LOG_LEVEL_WARNING, "Handoff from predecessor aborted: ",
+                         ret == -1 ? strerror(errno) : (ret == 0 ? "connection closed" : "unexpected message"));
+        }
+
+        close(predecessor);
+        predecessor = -1;
     }
 
     template <ADDRESS_FAMILY address_family>
-    void SPSockTcp<address_family>::ExitIOEventLoop()
+    void SPSockTcp<address_family>::AdoptConnection(int fd, const void *unread, unsigned int len)
     {
-        for (int i = 0; i < loops.size(); i++)
+        using SOCKADDR = SOCKADDR_IN<address_family>;
+        typename SOCKADDR::TYPE addr, local;
+        socklen_t addrlen = sizeof(addr), locallen = sizeof(local);
+
+        if (getpeername(fd, (sockaddr *)&addr, &addrlen) != 0 || getsockname(fd, (sockaddr *)&local, &locallen) != 0 ||
+            addrlen != sizeof(addr) || locallen != sizeof(local))
         {
-            uint64_t value = 1;
-            ssize_t bytes = write(loopInfo.at(i).exitfd, &value, sizeof(value));
+            HSLL_LOGINFO(LOG_LEVEL_WARNING, "Handed over connection dropped: not a connected socket of this address family");
+            close(fd);
+            return;
         }
 
-        for (int i = 0; i < loops.size(); i++)
+        SPPeerAddr bound;
+        SOCKADDR::PEER(local, bound);
+
+        const SPListener *listener = nullptr;
+        for (unsigned int k = 0; k < listenerNum && !listener; k++)
         {
-            loops.at(i).join();
-            close(loopInfo.at(i).epollfd);
-            close(loopInfo.at(i).exitfd);
+            if (listeners[k].port == bound.port)
+                listener = &listeners[k];
         }
-    }
 
-    template <ADDRESS_FAMILY address_family>
-    bool SPSockTcp<address_family>::MainEventLoop()
-    {
-        int idlefd;
-        if ((idlefd = ::open("/dev/null", O_RDONLY | O_CLOEXEC)) == -1)
+        if (!listener || listener->tls)
         {
-            HSLL_LOGINFO(LOG_LEVEL_ERROR, "open \"/dev/null\" error");
-            return false;
+            HSLL_LOGINFO(LOG_LEVEL_WARNING, "Handed over connection dropped: no plaintext listener on port ", bound.port);
+            close(fd);
+            return;
+        }
+
+        int flags = fcntl(fd, F_GETFL);
+        if (flags == -1 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1)
+        {
+            HSLL_LOGINFO(LOG_LEVEL_WARNING, "fcntl(O_NONBLOCK) failed: ", strerror(errno));
+            close(fd);
+            return;
         }
 
-        pollfd fds[1];
-        fds[0].fd = listenfd;
-        fds[0].events = POLLIN;
+        AddConnection(fd, addr, PickLoop(-1), listener, unread, len);
+    }
 
-        auto lastCloseListTime = std::chrono::steady_clock::now();
+    template <ADDRESS_FAMILY address_family>
+    void SPSockTcp<address_family>::HandleAccept(IOThreadInfo *info, const SPListener *listener, int &idlefd)
+    {
+        using SOCKADDR = SOCKADDR_IN<address_family>;
+        typename SOCKADDR::TYPE addr;
+        int listenfd = info->listenfd[listener - listeners];
 
-        while (exitFlag.load(std::memory_order_acquire))
+        while (true)
         {
-            auto now = std::chrono::steady_clock::now();
-            auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - lastCloseListTime);
-
-            int timeout = 50 - elapsed.count();
-            if (timeout < 0)
-                timeout = 0;
+            socklen_t addrlen = sizeof(addr);
+            int fd = accept4(listenfd, (sockaddr *)&addr, &addrlen, SOCK_NONBLOCK | SOCK_CLOEXEC);
 
-            int ret = poll(fds, 1, timeout);
-            if (ret == -1)
+            if (fd == -1)
             {
-                if (errno == EINTR)
+                if (errno == EINTR || errno == ECONNABORTED)
                     continue;
 
-                close(idlefd);
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                    return;
+
+                if (errno == EMFILE)
+                {
+                    close(idlefd);
+                    idlefd = accept(listenfd, NULL, NULL);
+                    close(idlefd);
+                    idlefd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+                }
+                HSLL_LOGINFO(LOG_LEVEL_ERROR, "accept4() failed: ", strerror(errno));
+                return;
+            }
+
+            AddConnection(fd, addr, info, listener);
+        }
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    void SPSockTcp<address_family>::AddConnection(int fd, typename SOCKADDR_IN<address_family>::TYPE &addr, IOThreadInfo *info,
+                                                  const SPListener *listener, const void *unread, unsigned int len)
+    {
+        if (listener->alive.keepAlive)
+            SetKeepAlive(fd, listener->alive);
+
+        if (listener->lin.l_onoff)
+            SetLinger(fd, listener->lin);
+
+        if (fd >= slotNum)
+        {
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "Connection slot table exhausted");
+            close(fd);
+            return;
+        }
+
+        auto &controller = *new (&connections[fd]) SOCKController{};
+        slotUsed[fd] = true;
+        SOCKADDR_IN<address_family>::PEER(addr, controller.peer);
+
+        void *ctx = nullptr;
+        if (listener->proc.cnap)
+        {
+            ctx = listener->proc.cnap(&controller.peer);
+        }
+        else if (listener->proc.cnp)
+        {
+            char ip[INET6_ADDRSTRLEN];
+            SPFormatPeer(&controller.peer, ip, sizeof(ip));
+            ctx = listener->proc.cnp(ip, controller.peer.port);
+        }
+
+        if (!controller.init(fd, ctx, info, listener))
+        {
+            HSLL_LOGINFO(LOG_LEVEL_WARNING, "Insufficient memory space");
+            CloseConnection(&controller);
+        }
+#if defined(SPSOCK_TLS)
+        else if (listener->tls && !(controller.tls = SPTls::Attach(listener->tls, fd)))
+        {
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "Failed to create TLS session: ", SPTls::Error());
+            CloseConnection(&controller);
+        }
+#endif
+        else if (len && controller.readBuf.write(unread, len) != len)
+        {
+            HSLL_LOGINFO(LOG_LEVEL_WARNING, "Unread data of handed over connection exceeds the read buffer");
+            CloseConnection(&controller);
+        }
+        else
+        {
+            bool adopted = unread != nullptr;
+            if (adopted)
+            {
+                controller.adopted = true;
+                if (!info->ring)
+                    controller.edgeState.store(EDGE_FLAG_OWNED, std::memory_order_relaxed);
+            }
+
+            // The acceptor may run on another thread than the owning loop, which can close the connection
+            // and reuse its slot as soon as it is registered: finish every use of the controller before
+            info->count.fetch_add(1, std::memory_order_relaxed);
+            if (adopted)
+            {
+                HSLL_LOGINFO(LOG_LEVEL_INFO, "Adopted connection from: ", controller.peer);
+            }
+            else
+            {
+                HSLL_LOGINFO(LOG_LEVEL_INFO, "Accepted new connection from: ", controller.peer);
+            }
+
+            if (!info->ring)
+            {
+                epoll_event event;
+                event.events = EPOLLERR | EPOLLHUP | EPOLLRDHUP | tcpConfig.EPOLL_DEFAULT_EVENT;
+                event.events |= (tcpConfig.IO_TRIGGER_MODE == TRIGGER_MODE_EDGE) ? EPOLLET : EPOLLONESHOT;
+                event.data.ptr = &controller;
+                if (epoll_ctl(info->epollfd, EPOLL_CTL_ADD, fd, &event) != 0)
+                {
+                    HSLL_LOGINFO(LOG_LEVEL_ERROR, "epoll_ctl(EPOLL_CTL_ADD) failed: ", strerror(errno));
+                    info->count.fetch_sub(1, std::memory_order_relaxed);
+                    CloseConnection(&controller);
+                    return;
+                }
+            }
+
+            // Counters of the loop, not of the connection, so they can follow the registration
+            SPMetrics::Add(adopted ? info->metrics.adopted : info->metrics.accepted);
+
+            if (adopted)
+            {
+                // Still owned (EDGE_FLAG_OWNED or not yet armed on a ring), so handing it to the loop is safe
+                QueueArm(&controller);
+                return;
+            }
+
+#if defined(SPSOCK_URING_SUPPORTED)
+            if (info->ring)
+                URingArm(&controller, tcpConfig.EPOLL_DEFAULT_EVENT & EPOLLIN, tcpConfig.EPOLL_DEFAULT_EVENT & EPOLLOUT);
+#endif
+        }
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    void SPSockTcp<address_family>::StartConnect(SOCKController *controller)
+    {
+        IOThreadInfo *info = controller->info;
+
+#if defined(SPSOCK_URING_SUPPORTED)
+        if (info->ring)
+        {
+            if (!info->ring->prepPollOut(controller->fd, SPUring::Tag(URING_OP_POLL, controller)))
+            {
+                HSLL_LOGINFO(LOG_LEVEL_ERROR, "io_uring submission queue exhausted");
+                ActiveClose(controller);
+                return;
+            }
+            controller->uringFlags |= URING_FLAG_POLL;
+            return;
+        }
+#endif
+
+        epoll_event event;
+        event.events = EPOLLOUT | EPOLLERR | EPOLLHUP | EPOLLONESHOT;
+        event.data.ptr = controller;
+        if (epoll_ctl(info->epollfd, EPOLL_CTL_ADD, controller->fd, &event) != 0)
+        {
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "epoll_ctl(EPOLL_CTL_ADD) failed: ", strerror(errno));
+            ActiveClose(controller);
+            return;
+        }
+
+        if (controller->holdDeadline)
+            info->holds->hold(controller, controller->holdDeadline);
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    void SPSockTcp<address_family>::FinishConnect(SOCKController *controller, bool failed, UtilTaskTcp *utilTask)
+    {
+        IOThreadInfo *info = controller->info;
+        if (info->holds)
+            info->holds->release(controller);
+
+        int error = 0;
+        socklen_t len = sizeof(error);
+        if (getsockopt(controller->fd, SOL_SOCKET, SO_ERROR, &error, &len) != 0)
+            error = errno;
+        else if (!error && failed)
+            error = ECONNRESET;
+
+        if (error)
+        {
+            HSLL_LOGINFO(LOG_LEVEL_WARNING, "Connect to ", controller->peer, " failed: ", strerror(error));
+            ActiveClose(controller);
+            return;
+        }
+
+        controller->connecting = false;
+        SPMetrics::Add(info->metrics.connected);
+        HSLL_LOGINFO(LOG_LEVEL_INFO, "Connected to: ", controller->peer);
+
+        if (info->ring)
+        {
+            int none = 0;
+            if (setsockopt(controller->fd, IPPROTO_TCP, TCP_USER_TIMEOUT, &none, sizeof(none)) != 0)
+                HSLL_LOGINFO(LOG_LEVEL_WARNING, "setsockopt(TCP_USER_TIMEOUT) failed: ", strerror(errno));
+        }
+        else
+        {
+            if (tcpConfig.IO_TRIGGER_MODE == TRIGGER_MODE_EDGE)
+            {
+                epoll_event event;
+                event.events = EPOLLERR | EPOLLRDHUP | EPOLLHUP | EPOLLET | controller->edgeEvents;
+                event.data.ptr = controller;
+                if (epoll_ctl(info->epollfd, EPOLL_CTL_MOD, controller->fd, &event) != 0)
+                {
+                    HSLL_LOGINFO(LOG_LEVEL_ERROR, "epoll_ctl(EPOLL_CTL_MOD) failed: ", strerror(errno));
+                    ActiveClose(controller);
+                    return;
+                }
+            }
+            controller->edgeState.fetch_or(EDGE_FLAG_OWNED, std::memory_order_acq_rel);
+        }
+
+        if (!HandleWrite(controller, utilTask))
+            ActiveClose(controller);
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    void SPSockTcp<address_family>::HandleAdopted(SOCKController *controller, UtilTaskTcp *utilTask)
+    {
+        controller->adopted = false;
+        if (!HandleRead(controller, utilTask))
+            ActiveClose(controller);
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    void SPSockTcp<address_family>::HandleExit(int sg)
+    {
+        if (SPSockTcp<address_family>::exitFlag)
+        {
+            SPSockTcp<address_family>::exitFlag.store(false, std::memory_order_release);
+            HSLL_LOGINFO_NOPREFIX(LOG_LEVEL_CRUCIAL, "")
+            HSLL_LOGINFO(LOG_LEVEL_CRUCIAL, "Caught signal ", sg, ", exiting event loop");
+        }
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    void SPSockTcp<address_family>::ActiveClose(SOCKController *controller)
+    {
+        IOThreadInfo *info = controller->info;
+        if (!info->ring)
+            epoll_ctl(info->epollfd, EPOLL_CTL_DEL, controller->fd, nullptr);
+
+        if (localLoop == info)
+        {
+            GetInstance()->HandleClose(controller);
+            return;
+        }
+
+        SOCKController *head = info->closeList.load(std::memory_order_relaxed);
+        do
+        {
+            controller->next = head;
+        } while (!info->closeList.compare_exchange_weak(head, controller, std::memory_order_release,
+                                                        std::memory_order_relaxed));
+
+        if (head == nullptr)
+        {
+            uint64_t value = 1;
+            ssize_t bytes = write(info->wakefd, &value, sizeof(value));
+            (void)bytes;
+        }
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    bool SPSockTcp<address_family>::EnableEvent(SOCKController *controller, bool read, bool write)
+    {
+#if defined(SPSOCK_URING_SUPPORTED)
+        if (controller->info->ring)
+            return URingArm(controller, read, write);
+#endif
+
+        if (tcpConfig.IO_TRIGGER_MODE == TRIGGER_MODE_EDGE)
+            return EdgeRelease(controller, read, write);
+
+        // Once ownership is dropped the slot may be closed and reused, so nothing is read from it afterwards
+        int fd = controller->fd;
+        int epollfd = controller->info->epollfd;
+
+        int state = controller->edgeState.load(std::memory_order_acquire);
+        do
+        {
+            if (state & (EDGE_FLAG_TIMER | EDGE_FLAG_HOLD))
+            {
+                QueueArm(controller);
+                return true;
+            }
+        } while (!controller->edgeState.compare_exchange_weak(state, state & ~EDGE_FLAG_OWNED, std::memory_order_acq_rel,
+                                                              std::memory_order_acquire));
+
+        epoll_event event;
+        event.data.ptr = controller;
+        event.events = EPOLLERR | EPOLLRDHUP | EPOLLHUP | EPOLLONESHOT;
+
+        if (read)
+            event.events |= EPOLLIN;
+
+        if (write)
+            event.events |= EPOLLOUT;
+
+        if (epoll_ctl(epollfd, EPOLL_CTL_MOD, fd, &event) != 0)
+            return false;
+
+        return true;
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    void SPSockTcp<address_family>::BindWorker(void *pools, unsigned int index)
+    {
+        SPTcpBufferPool::Bind((SPTcpBufferPool *)pools + index);
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    void SPSockTcp<address_family>::QueueArm(SOCKController *controller)
+    {
+        IOThreadInfo *info = controller->info;
+
+        if (localLoop == info)
+        {
+            controller->armNext = info->armLocal;
+            info->armLocal = controller;
+            return;
+        }
+
+        SOCKController *head = info->armList.load(std::memory_order_relaxed);
+        do
+        {
+            controller->armNext = head;
+        } while (!info->armList.compare_exchange_weak(head, controller, std::memory_order_release,
+                                                      std::memory_order_relaxed));
+
+        if (head == nullptr)
+        {
+            uint64_t value = 1;
+            ssize_t bytes = write(info->wakefd, &value, sizeof(value));
+            (void)bytes;
+        }
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    bool SPSockTcp<address_family>::EdgeRelease(SOCKController *controller, bool read, bool write)
+    {
+        int events = (read ? (int)EPOLLIN : 0) | (write ? (int)EPOLLOUT : 0);
+
+        if (events != controller->edgeEvents)
+        {
+            epoll_event event;
+            event.data.ptr = controller;
+            event.events = EPOLLERR | EPOLLRDHUP | EPOLLHUP | EPOLLET | events;
+
+            if (epoll_ctl(controller->info->epollfd, EPOLL_CTL_MOD, controller->fd, &event) != 0)
+                return false;
+
+            controller->edgeEvents = events;
+        }
+        else if (write && !controller->sendBlocked)
+        {
+            controller->edgeState.fetch_or(EPOLLOUT, std::memory_order_relaxed);
+        }
+
+        int mask = EPOLLRDHUP | EPOLLERR | EPOLLHUP | EDGE_FLAG_TIMER | EDGE_FLAG_HOLD | events;
+        int state = controller->edgeState.load(std::memory_order_acquire);
+
+        while (!(state & mask))
+        {
+            if (controller->edgeState.compare_exchange_weak(state, state & ~EDGE_FLAG_OWNED, std::memory_order_acq_rel,
+                                                            std::memory_order_acquire))
+                return true;
+        }
+
+        QueueArm(controller);
+        return true;
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    void SPSockTcp<address_family>::CloseConnection(SOCKController *controller)
+    {
+        controller->releaseSends();
+
+        if (controller->info->wheel)
+        {
+            controller->info->wheel->drain();
+            controller->info->wheel->unlink(controller);
+        }
+
+        if (controller->info->holds)
+            controller->info->holds->release(controller);
+
+        if (controller->listener->proc.csp)
+            controller->listener->proc.csp(controller);
+
+#if defined(SPSOCK_URING_SUPPORTED)
+        if (controller->info->ring && !URingDetach(controller))
+            return;
+#endif
+
+#if defined(SPSOCK_TLS)
+        if (controller->tls)
+            SPTls::Detach(controller->tls);
+#endif
+
+        int fd = controller->fd;
+        slotUsed[fd] = false;
+        controller->~SOCKController();
+        close(fd);
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    bool SPSockTcp<address_family>::CreateConnectionTable()
+    {
+        rlimit limit;
+        if (getrlimit(RLIMIT_NOFILE, &limit) != 0)
+        {
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "getrlimit(RLIMIT_NOFILE) failed: ", strerror(errno));
+            return false;
+        }
+
+        if (limit.rlim_cur == RLIM_INFINITY || limit.rlim_cur > SPSOCK_MAX_SLOT_NUM)
+        {
+            slotNum = SPSOCK_MAX_SLOT_NUM;
+            HSLL_LOGINFO(LOG_LEVEL_WARNING, "RLIMIT_NOFILE exceeds slot table limit, capped to ", slotNum);
+        }
+        else
+        {
+            slotNum = limit.rlim_cur;
+        }
+
+        slotUsed = (bool *)calloc(slotNum, sizeof(bool));
+        connections = (SOCKController *)calloc(slotNum, sizeof(SOCKController));
+
+        if (!slotUsed || !connections)
+        {
+            free(slotUsed);
+            free(connections);
+            slotUsed = nullptr;
+            connections = nullptr;
+            return false;
+        }
+        return true;
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    bool SPSockTcp<address_family>::CalculateOptimalThreadCounts(int *ioThreads, int *workerThreads)
+    {
+        unsigned int hardware_threads = std::thread::hardware_concurrency();
+        if (hardware_threads == 0)
+            return false;
+
+        if (!UsesPool())
+        {
+            *workerThreads = 0;
+            *ioThreads = hardware_threads;
+        }
+        else if (hardware_threads <= 2)
+        {
+            *workerThreads = 1;
+            *ioThreads = 1;
+        }
+        else
+        {
+            float weight = tcpConfig.WORKER_THREAD_RATIO;
+            *workerThreads = hardware_threads * weight + 0.5;
+            *ioThreads = hardware_threads - *workerThreads;
+
+            if (*workerThreads == 0)
+            {
+                (*workerThreads)++;
+                (*ioThreads)--;
+            }
+            else if (*ioThreads == 0)
+            {
+                (*workerThreads)--;
+                (*ioThreads)++;
+            }
+        }
+        return true;
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    bool SPSockTcp<address_family>::PlanPlacement(SPPlacement &placement)
+    {
+        if (!tcpConfig.IO_CPU_LIST && !tcpConfig.WORKER_CPU_LIST && !tcpConfig.NUMA_PLACEMENT)
+        {
+            int ioThreads, workerThreads;
+            if (!CalculateOptimalThreadCounts(&ioThreads, &workerThreads))
+                return false;
+
+            placement.loopCpus.assign(ioThreads, -1);
+            placement.loopNodes.assign(ioThreads, 0);
+            placement.loopGroups.assign(ioThreads, 0);
+            placement.groupCpus.resize(1);
+            placement.groupWorkers.assign(1, workerThreads);
+            return true;
+        }
+
+        std::vector<unsigned int> allowed, ioCpus, workerCpus;
+        if (!SPTopology::AllowedCpus(allowed))
+            return false;
+
+        cpuNodes.assign(allowed.back() + 1, 0);
+        for (unsigned int cpu : allowed)
+            cpuNodes[cpu] = SPTopology::NodeOf(cpu);
+
+        const bool pooled = UsesPool();
+
+        if (tcpConfig.IO_CPU_LIST)
+            SPTopology::ParseCpus(tcpConfig.IO_CPU_LIST, ioCpus);
+
+        if (tcpConfig.WORKER_CPU_LIST && pooled)
+            SPTopology::ParseCpus(tcpConfig.WORKER_CPU_LIST, workerCpus);
+
+        if (!tcpConfig.IO_CPU_LIST && !tcpConfig.WORKER_CPU_LIST)
+        {
+            std::vector<int> splitNodes(cpuNodes);
+            std::sort(splitNodes.begin(), splitNodes.end());
+            splitNodes.erase(std::unique(splitNodes.begin(), splitNodes.end()), splitNodes.end());
+
+            for (int node : splitNodes)
+            {
+                std::vector<unsigned int> local;
+                for (unsigned int cpu : allowed)
+                {
+                    if (cpuNodes[cpu] == node)
+                        local.push_back(cpu);
+                }
+
+                if (local.empty())
+                    continue;
+
+                unsigned int num = local.size();
+                unsigned int workers = 0;
+
+                if (pooled)
+                {
+                    workers = (num <= 2) ? 1 : (unsigned int)(num * tcpConfig.WORKER_THREAD_RATIO + 0.5);
+                    if (workers == 0)
+                        workers = 1;
+                    else if (num > 2 && workers >= num)
+                        workers = num - 1;
+                }
+
+                unsigned int loops = (num <= 2 && pooled) ? 1 : num - workers;
+                ioCpus.insert(ioCpus.end(), local.begin(), local.begin() + loops);
+                workerCpus.insert(workerCpus.end(), local.end() - workers, local.end());
+            }
+        }
+        else
+        {
+            if (!tcpConfig.IO_CPU_LIST)
+            {
+                for (unsigned int cpu : allowed)
+                {
+                    if (std::find(workerCpus.begin(), workerCpus.end(), cpu) == workerCpus.end())
+                        ioCpus.push_back(cpu);
+                }
+
+                if (ioCpus.empty())
+                    ioCpus = allowed;
+            }
+
+            if (!tcpConfig.WORKER_CPU_LIST && pooled)
+            {
+                for (unsigned int cpu : allowed)
+                {
+                    if (std::find(ioCpus.begin(), ioCpus.end(), cpu) == ioCpus.end())
+                        workerCpus.push_back(cpu);
+                }
+
+                if (workerCpus.empty())
+                    workerCpus = ioCpus;
+            }
+        }
+
+        if (pooled && workerCpus.empty())
+            workerCpus = ioCpus;
+
+        std::vector<int> nodes;
+        if (tcpConfig.NUMA_PLACEMENT)
+        {
+            for (unsigned int cpu : ioCpus)
+                nodes.push_back(NodeOfCpu(cpu));
+
+            for (unsigned int cpu : workerCpus)
+                nodes.push_back(NodeOfCpu(cpu));
+
+            std::sort(nodes.begin(), nodes.end());
+            nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+        }
+        else
+        {
+            nodes.push_back(-1);
+        }
+
+        auto group = [&nodes](int node) -> unsigned int
+        {
+            return (nodes.size() == 1) ? 0 : std::lower_bound(nodes.begin(), nodes.end(), node) - nodes.begin();
+        };
+
+        placement.groupCpus.assign(nodes.size(), std::vector<unsigned int>());
+        for (unsigned int cpu : workerCpus)
+            placement.groupCpus[group(NodeOfCpu(cpu))].push_back(cpu);
+
+        unsigned int fallback = 0;
+        placement.groupWorkers.clear();
+        for (unsigned int i = 0; i < nodes.size(); i++)
+        {
+            placement.groupWorkers.push_back(placement.groupCpus[i].size());
+            if (placement.groupCpus[i].size() && !placement.groupCpus[fallback].size())
+                fallback = i;
+        }
+
+        placement.loopCpus.clear();
+        placement.loopNodes.clear();
+        placement.loopGroups.clear();
+        for (unsigned int cpu : ioCpus)
+        {
+            unsigned int index = group(NodeOfCpu(cpu));
+            placement.loopCpus.push_back(cpu);
+            placement.loopNodes.push_back(NodeOfCpu(cpu));
+            placement.loopGroups.push_back(placement.groupWorkers[index] ? index : fallback);
+        }
+
+        for (unsigned int i = 0; i < ioCpus.size(); i++)
+        {
+            HSLL_LOGINFO(LOG_LEVEL_INFO, "IO loop ", i, " on cpu ", placement.loopCpus[i], " node ",
+                         placement.loopNodes[i], " feeds pool ", placement.loopGroups[i]);
+        }
+
+        for (unsigned int i = 0; i < nodes.size(); i++)
+            HSLL_LOGINFO(LOG_LEVEL_INFO, "Worker pool ", i, " holds ", placement.groupWorkers[i], " pinned workers");
+
+        return true;
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    int SPSockTcp<address_family>::NodeOfCpu(unsigned int cpu)
+    {
+        return (cpu < cpuNodes.size()) ? cpuNodes[cpu] : SPTopology::NodeOf(cpu);
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    bool SPSockTcp<address_family>::CreateIOEventLoop(SockTaskPool *pools, const SPPlacement &placement)
+    {
+        const int num = placement.loopCpus.size();
+        bool uring = (tcpConfig.IO_EVENT_ENGINE == IO_ENGINE_URING);
+
+#if defined(SPSOCK_URING_SUPPORTED)
+        if (uring && !SPUring::Supported())
+        {
+            HSLL_LOGINFO(LOG_LEVEL_WARNING, "io_uring is not supported by the kernel, falling back to epoll");
+            uring = false;
+        }
+#else
+        if (uring)
+        {
+            HSLL_LOGINFO(LOG_LEVEL_WARNING, "io_uring support is not compiled in, falling back to epoll");
+            uring = false;
+        }
+#endif
+
+        for (int i = 0; i < num; i++)
+        {
+            int epollfd, exitfd, wakefd;
+
+            if ((epollfd = epoll_create1(0)) == -1)
+                break;
+
+#if defined(EPIOCSPARAMS)
+            if (tcpConfig.BUSY_POLL_US)
+            {
+                epoll_params params = {};
+                params.busy_poll_usecs = tcpConfig.BUSY_POLL_US;
+                params.busy_poll_budget = 8;
+                params.prefer_busy_poll = 1;
+                if (ioctl(epollfd, EPIOCSPARAMS, &params) == -1)
+                    HSLL_LOGINFO(LOG_LEVEL_WARNING, "ioctl(EPIOCSPARAMS) failed: ", strerror(errno));
+            }
+#endif
+
+            if ((exitfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) == -1)
+            {
+                close(epollfd);
+                break;
+            }
+
+            if ((wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) == -1)
+            {
+                close(epollfd);
+                close(exitfd);
+                break;
+            }
+
+            SPTcpBufferPool *bufferPool = new (std::nothrow) SPTcpBufferPool;
+            if (!bufferPool)
+            {
+                close(epollfd);
+                close(exitfd);
+                close(wakefd);
+                break;
+            }
+
+            loopInfo.emplace_back();
+            IOThreadInfo &info = loopInfo.back();
+            info.count = 0;
+            info.epollfd = epollfd;
+            info.exitfd = exitfd;
+            info.wakefd = wakefd;
+            for (unsigned int k = 0; k < SPSOCK_MAX_LISTENERS; k++)
+                info.listenfd[k] = -1;
+            info.cpu = placement.loopCpus[i];
+            info.id = i;
+            info.node = placement.loopNodes[i];
+            info.pool = bufferPool;
+            info.closeList = nullptr;
+            info.ring = nullptr;
+            info.armList = nullptr;
+            info.armLocal = nullptr;
+            info.starved = nullptr;
+            info.closing = 0;
+            info.wheel = nullptr;
+            info.holds = nullptr;
+
+            epoll_event event;
+            event.data.ptr = nullptr;
+            event.events = EPOLLIN | EPOLLERR | EPOLLHUP;
+            if (epoll_ctl(epollfd, EPOLL_CTL_ADD, exitfd, &event) != 0)
+            {
+                close(epollfd);
+                close(exitfd);
+                close(wakefd);
+                delete bufferPool;
+                loopInfo.pop_back();
+                break;
+            }
+
+            event.data.ptr = &info.wakefd;
+            event.events = EPOLLIN;
+            if (epoll_ctl(epollfd, EPOLL_CTL_ADD, wakefd, &event) != 0)
+            {
+                close(epollfd);
+                close(exitfd);
+                close(wakefd);
+                delete bufferPool;
+                loopInfo.pop_back();
+                break;
+            }
+
+            if (tcpConfig.IO_ACCEPT_MODE == ACCEPT_MODE_REUSEPORT)
+            {
+                unsigned int k = 0;
+                for (; k < listenerNum; k++)
+                {
+                    int fd = -1;
+                    if (i == 0)
+                    {
+                        int flags = fcntl(listeners[k].fd, F_GETFL);
+                        if (flags != -1 && fcntl(listeners[k].fd, F_SETFL, flags | O_NONBLOCK) != -1)
+                            fd = listeners[k].fd;
+                    }
+                    else
+                    {
+                        fd = CreateListener(SOCK_NONBLOCK | SOCK_CLOEXEC, listeners[k]);
+                    }
+
+                    if (fd != -1 && info.cpu >= 0 &&
+                        setsockopt(fd, SOL_SOCKET, SO_INCOMING_CPU, &info.cpu, sizeof(info.cpu)) == -1)
+                        HSLL_LOGINFO(LOG_LEVEL_WARNING, "setsockopt(SO_INCOMING_CPU) failed: ", strerror(errno));
+
+                    info.listenfd[k] = fd;
+                    event.data.ptr = &listeners[k];
+                    event.events = EPOLLIN;
+                    if (fd == -1 || epoll_ctl(epollfd, EPOLL_CTL_ADD, fd, &event) != 0)
+                        break;
+                }
+
+                if (k != listenerNum)
+                {
+                    CloseLoopListeners(info);
+                    close(epollfd);
+                    close(exitfd);
+                    close(wakefd);
+                    delete bufferPool;
+                    loopInfo.pop_back();
+                    break;
+                }
+            }
+
+#if defined(SPSOCK_URING_SUPPORTED)
+            if (uring)
+            {
+                unsigned int entries = (tcpConfig.EPOLL_MAX_EVENT_BSIZE > 32768) ? 32768 : tcpConfig.EPOLL_MAX_EVENT_BSIZE;
+
+                info.ring = new (std::nothrow) SPUring;
+                if (!info.ring || !info.ring->init(entries))
+                {
+                    HSLL_LOGINFO(LOG_LEVEL_WARNING, "io_uring setup failed, falling back to epoll: ", strerror(errno));
+                    delete info.ring;
+                    info.ring = nullptr;
+                    uring = false;
+                }
+            }
+#endif
+
+            if ((UsesTimers() && !info.ring && !(info.wheel = new (std::nothrow) SPTimerWheel(wakefd))) ||
+                (!info.ring && !(info.holds = new (std::nothrow) SPHoldQueue)))
+            {
+                delete info.wheel;
+                CloseLoopListeners(info);
+
+                close(epollfd);
+                close(exitfd);
+                close(wakefd);
+                delete bufferPool;
+                loopInfo.pop_back();
+                break;
+            }
+        }
+
+        if (loopInfo.size() != num)
+        {
+            for (int i = 0; i < loopInfo.size(); i++)
+            {
+                close(loopInfo.at(i).epollfd);
+                close(loopInfo.at(i).exitfd);
+                close(loopInfo.at(i).wakefd);
+                CloseLoopListeners(loopInfo.at(i));
+
+#if defined(SPSOCK_URING_SUPPORTED)
+                delete loopInfo.at(i).ring;
+#endif
+                delete loopInfo.at(i).wheel;
+                delete loopInfo.at(i).holds;
+                delete loopInfo.at(i).pool;
+            }
+            loopInfo.clear();
+            return false;
+        }
+
+        for (int i = 0; i < num; i++)
+            loops.emplace_back(std::thread{&SPSockTcp<address_family>::IOEventLoop, this,
+                                           &pools[placement.loopGroups[i]], &loopInfo.at(i)});
+
+        return true;
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    void SPSockTcp<address_family>::ExitIOEventLoop(SockTaskPool *pools, unsigned int num)
+    {
+        for (int i = 0; i < loops.size(); i++)
+        {
+            uint64_t value = 1;
+            ssize_t bytes = write(loopInfo.at(i).exitfd, &value, sizeof(value));
+            (void)bytes;
+        }
+
+        for (int i = 0; i < loops.size(); i++)
+            loops.at(i).join();
+
+        for (unsigned int i = 0; i < num; i++)
+            pools[i].exit();
+
+        for (int i = 0; i < loops.size(); i++)
+        {
+            close(loopInfo.at(i).epollfd);
+            close(loopInfo.at(i).exitfd);
+            close(loopInfo.at(i).wakefd);
+            CloseLoopListeners(loopInfo.at(i));
+
+#if defined(SPSOCK_URING_SUPPORTED)
+            delete loopInfo.at(i).ring;
+            loopInfo.at(i).ring = nullptr;
+#endif
+        }
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    bool SPSockTcp<address_family>::MainEventLoop()
+    {
+        int idlefd;
+        if ((idlefd = ::open("/dev/null", O_RDONLY | O_CLOEXEC)) == -1)
+        {
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "open \"/dev/null\" error");
+            return false;
+        }
+
+        pollfd fds[SPSOCK_MAX_LISTENERS + 2];
+        for (unsigned int k = 0; k < listenerNum; k++)
+        {
+            fds[k].fd = listeners[k].fd;
+            fds[k].events = POLLIN;
+        }
+        nfds_t accepting = (tcpConfig.IO_ACCEPT_MODE == ACCEPT_MODE_MAIN) ? listenerNum : 0;
+
+        while (exitFlag.load(std::memory_order_acquire))
+        {
+            nfds_t nfds = accepting;
+            if (handoffListen != -1)
+                fds[nfds++] = {handoffListen, POLLIN, 0};
+
+            if (predecessor != -1)
+                fds[nfds++] = {predecessor, POLLIN, 0};
+
+            int ret = poll(fds, nfds, 50);
+            if (ret == -1)
+            {
+                if (errno == EINTR)
+                    continue;
+
+                close(idlefd);
                 return false;
             }
 
-            now = std::chrono::steady_clock::now();
-            elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - lastCloseListTime);
+            for (nfds_t k = 0; ret > 0 && k < accepting; k++)
+            {
+                if (!(fds[k].revents & POLLIN))
+                    continue;
+
+                if (!HandleConnect(&listeners[k], idlefd))
+                {
+                    close(idlefd);
+                    return false;
+                }
+            }
+
+            for (nfds_t k = accepting; ret > 0 && k < nfds; k++)
+            {
+                if (!fds[k].revents)
+                    continue;
+
+                if (fds[k].fd == handoffListen)
+                    HandleHandoff();
+                else
+                    ReceiveHandoff();
+            }
+        }
+
+        close(idlefd);
+        return true;
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    void SPSockTcp<address_family>::IOEventLoop(SockTaskPool *pool, IOThreadInfo *info)
+    {
+        if (info->cpu >= 0 && !ThreadBinder::bind_current_thread_to_core(info->cpu))
+            HSLL_LOGINFO(LOG_LEVEL_WARNING, "Failed to pin IO loop to cpu ", info->cpu);
+
+#if defined(SPSOCK_URING_SUPPORTED)
+        if (info->ring)
+        {
+            URingEventLoop(pool, info);
+            return;
+        }
+#endif
+
+        UtilTaskTcp utilTask;
+        if (!utilTask.init(pool, &info->metrics.submitFailures, info->id))
+        {
+            throw std::bad_alloc();
+            return;
+        }
+
+        epoll_event *events = new (std::nothrow) epoll_event[tcpConfig.EPOLL_MAX_EVENT_BSIZE];
+        if (!events)
+        {
+            throw std::bad_alloc();
+            return;
+        }
+
+        int idlefd = -1;
+        if (info->listenfd[0] != -1 && (idlefd = ::open("/dev/null", O_RDONLY | O_CLOEXEC)) == -1)
+            HSLL_LOGINFO(LOG_LEVEL_WARNING, "open \"/dev/null\" error");
+
+        SPTcpBufferPool::Bind(info->pool);
+        SPTimerWheel::Bind(info->wheel);
+        localLoop = info;
+
+        const bool edge = (tcpConfig.IO_TRIGGER_MODE == TRIGGER_MODE_EDGE);
+        SPTimerWheel *wheel = info->wheel;
+        SPHoldQueue *holds = info->holds;
+        TPBusyPoll spinner;
+        spinner.init(tcpConfig.BUSY_POLL_US);
+
+        while (true)
+        {
+            int timeout = -1;
+            if (info->armLocal)
+            {
+                timeout = 0;
+            }
+            else
+            {
+                int hold = holds->timeout();
+                if (wheel)
+                    timeout = wheel->timeout();
+                if (hold != -1 && (timeout == -1 || hold < timeout))
+                    timeout = hold;
+            }
+
+            int nfds = 0;
+            if (timeout != 0)
+                spinner.spin([&]
+                             { return (nfds = epoll_wait(info->epollfd, events, tcpConfig.EPOLL_MAX_EVENT_BSIZE, 0)) != 0; });
+
+            if (nfds == 0 && (nfds = epoll_wait(info->epollfd, events, tcpConfig.EPOLL_MAX_EVENT_BSIZE, timeout)) > 0)
+                spinner.arrived();
+
+            if (nfds == -1)
+            {
+                if (errno == EINTR)
+                    continue;
+
+                if (idlefd != -1)
+                    close(idlefd);
+
+                localLoop = nullptr;
+                SPTimerWheel::Bind(nullptr);
+                SPTcpBufferPool::Bind(nullptr);
+                delete[] events;
+                throw strerror(errno);
+                break;
+            }
+
+            SPMetrics::Add(info->metrics.waits);
+            SPMetrics::Add(info->metrics.events, nfds);
+            bool wake = false;
+
+            for (int i = 0; i < nfds; i++)
+            {
+                void *ptr = events[i].data.ptr;
+
+                if (ptr == nullptr)
+                {
+                    if (idlefd != -1)
+                        close(idlefd);
+
+                    localLoop = nullptr;
+                    SPTimerWheel::Bind(nullptr);
+                    SPTcpBufferPool::Bind(nullptr);
+                    delete[] events;
+                    return;
+                }
+
+                if (SPListener *listener = ListenerOf(ptr))
+                {
+                    HandleAccept(info, listener, idlefd);
+                    continue;
+                }
+
+                if (ptr == &info->wakefd)
+                {
+                    uint64_t value;
+                    ssize_t bytes = read(info->wakefd, &value, sizeof(value));
+                    (void)bytes;
+                    wake = true;
+                    continue;
+                }
+
+                SOCKController *controller = (SOCKController *)ptr;
+                uint32_t ev = events[i].events;
+
+                if (controller->connecting)
+                {
+                    FinishConnect(controller, ev & (EPOLLERR | EPOLLHUP), &utilTask);
+                    continue;
+                }
+
+                if (edge)
+                {
+                    int state = controller->edgeState.fetch_or((ev & EDGE_FLAG_EVENTS) | EDGE_FLAG_OWNED,
+                                                               std::memory_order_acq_rel);
+                    if (!(state & EDGE_FLAG_OWNED))
+                        HandleEdge(controller, &utilTask);
+                    continue;
+                }
+
+                if (controller->edgeState.fetch_or(EDGE_FLAG_OWNED, std::memory_order_acq_rel) & EDGE_FLAG_OWNED)
+                    continue;
+
+                if ((ev & (EPOLLERR | EPOLLHUP)) == EPOLLERR && controller->handleError())
+                {
+                    ev &= ~EPOLLERR;
+                    if (!(ev & (EPOLLIN | EPOLLRDHUP | EPOLLOUT)))
+                    {
+                        if (!controller->renableEvents())
+                            ActiveClose(controller);
+                        continue;
+                    }
+                }
+
+                if (ev & (EPOLLHUP | EPOLLERR))
+                {
+                    ActiveClose(controller);
+                }
+                else if (ev & (EPOLLIN | EPOLLRDHUP))
+                {
+                    if (ev & EPOLLRDHUP)
+                        controller->peerClosed = true;
+
+                    if (!HandleRead(controller, &utilTask))
+                        ActiveClose(controller);
+                }
+                else if (ev & EPOLLOUT)
+                {
+                    if (!HandleWrite(controller, &utilTask))
+                        ActiveClose(controller);
+                }
+            }
+
+            if (wheel)
+            {
+                if (wake)
+                    wheel->drain();
+
+                const std::vector<SOCKController *> &expired = wheel->advance();
+                for (size_t i = 0; i < expired.size(); i++)
+                    HandleExpiry(expired[i], EDGE_FLAG_TIMER, &utilTask);
+            }
+
+            if (!holds->empty())
+            {
+                unsigned long long now = SPHoldQueue::Now();
+                while (SOCKController *held = holds->expire(now))
+                {
+                    if (held->connecting)
+                    {
+                        HSLL_LOGINFO(LOG_LEVEL_WARNING, "Connect to ", held->peer, " timed out");
+                        ActiveClose(held);
+                    }
+                    else
+                    {
+                        HandleExpiry(held, EDGE_FLAG_HOLD, &utilTask);
+                    }
+                }
+            }
+
+            HandleArmList(info, &utilTask);
+
+            if (wake)
+                HandleCloseList(info);
+
+            utilTask.reset();
+            SampleGauges(info);
+        }
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    void SPSockTcp<address_family>::HandleEdge(SOCKController *controller, UtilTaskTcp *utilTask)
+    {
+        int mask = EPOLLRDHUP | EPOLLERR | EPOLLHUP | EDGE_FLAG_TIMER | EDGE_FLAG_HOLD | controller->edgeEvents;
+        int state = controller->edgeState.load(std::memory_order_acquire);
+
+        while (true)
+        {
+            if (!(state & mask))
+            {
+                if (controller->edgeState.compare_exchange_weak(state, state & ~EDGE_FLAG_OWNED, std::memory_order_acq_rel,
+                                                                std::memory_order_acquire))
+                    return;
+                continue;
+            }
+
+            int ev;
+            if (state & (EPOLLERR | EPOLLHUP))
+                ev = state & (EPOLLERR | EPOLLHUP);
+            else if (state & EDGE_FLAG_TIMER)
+                ev = EDGE_FLAG_TIMER;
+            else if (state & EDGE_FLAG_HOLD)
+                ev = EDGE_FLAG_HOLD;
+            else if (state & mask & (EPOLLIN | EPOLLRDHUP))
+                ev = state & mask & (EPOLLIN | EPOLLRDHUP);
+            else
+                ev = EPOLLOUT;
+
+            state = controller->edgeState.fetch_and(~ev, std::memory_order_acq_rel) & ~ev;
+
+            if (ev == EPOLLERR && controller->handleError())
+                continue;
 
-            if (elapsed.count() >= 50)
+            if (ev & (EPOLLERR | EPOLLHUP))
+            {
+                ActiveClose(controller);
+            }
+            else if (ev == EDGE_FLAG_TIMER)
             {
-                HandleCloseList();
-                lastCloseListTime = now;
+                Dispatch(controller, controller->listener->proc.tmp, false, utilTask);
             }
+            else if (ev == EDGE_FLAG_HOLD)
+            {
+                controller->info->holds->release(controller);
+                Dispatch(controller, controller->listener->proc.rdp, controller->listener->offload.read, utilTask);
+            }
+            else if (ev & (EPOLLIN | EPOLLRDHUP))
+            {
+                if (ev & EPOLLRDHUP)
+                    controller->peerClosed = true;
 
-            if (ret > 0 && (!HandleConnect(idlefd)))
+                if (!HandleRead(controller, utilTask))
+                    ActiveClose(controller);
+            }
+            else
             {
-                close(idlefd);
-                return false;
+                controller->sendBlocked = false;
+                if (!HandleWrite(controller, utilTask))
+                    ActiveClose(controller);
             }
+            return;
         }
+    }
 
-        close(idlefd);
+    template <ADDRESS_FAMILY address_family>
+    void SPSockTcp<address_family>::HandleArmList(IOThreadInfo *info, UtilTaskTcp *utilTask)
+    {
+        SOCKController *remote = info->armList.exchange(nullptr, std::memory_order_acquire);
+        SOCKController *local = info->armLocal;
+        info->armLocal = nullptr;
+
+        const bool edge = (tcpConfig.IO_TRIGGER_MODE == TRIGGER_MODE_EDGE);
+
+        while (remote)
+        {
+            SOCKController *next = remote->armNext;
+            if (remote->connecting)
+                StartConnect(remote);
+            else if (remote->adopted)
+                HandleAdopted(remote, utilTask);
+            else if (edge)
+                HandleEdge(remote, utilTask);
+            else
+                HandleDeferred(remote, utilTask);
+            remote = next;
+        }
+
+        while (local)
+        {
+            SOCKController *next = local->armNext;
+            if (local->connecting)
+                StartConnect(local);
+            else if (local->adopted)
+                HandleAdopted(local, utilTask);
+            else if (edge)
+                HandleEdge(local, utilTask);
+            else
+                HandleDeferred(local, utilTask);
+            local = next;
+        }
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    void SPSockTcp<address_family>::HandleExpiry(SOCKController *controller, int flag, UtilTaskTcp *utilTask)
+    {
+        int state = controller->edgeState.fetch_or(flag | EDGE_FLAG_OWNED, std::memory_order_acq_rel);
+        if (state & EDGE_FLAG_OWNED)
+            return;
+
+        if (tcpConfig.IO_TRIGGER_MODE == TRIGGER_MODE_EDGE)
+            HandleEdge(controller, utilTask);
+        else
+            HandleDeferred(controller, utilTask);
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    void SPSockTcp<address_family>::HandleDeferred(SOCKController *controller, UtilTaskTcp *utilTask)
+    {
+        int state = controller->edgeState.load(std::memory_order_acquire);
+
+        if (state & EDGE_FLAG_TIMER)
+        {
+            controller->edgeState.fetch_and(~EDGE_FLAG_TIMER, std::memory_order_acq_rel);
+            Dispatch(controller, controller->listener->proc.tmp, false, utilTask);
+        }
+        else
+        {
+            controller->edgeState.fetch_and(~EDGE_FLAG_HOLD, std::memory_order_acq_rel);
+            controller->info->holds->release(controller);
+            Dispatch(controller, controller->listener->proc.rdp, controller->listener->offload.read, utilTask);
+        }
+    }
+
+#if defined(SPSOCK_URING_SUPPORTED)
+    template <ADDRESS_FAMILY address_family>
+    bool SPSockTcp<address_family>::URingArm(SOCKController *controller, bool read, bool write)
+    {
+        controller->uringRequest = (read ? (int)EPOLLIN : 0) | (write ? (int)EPOLLOUT : 0);
+        QueueArm(controller);
         return true;
     }
 
     template <ADDRESS_FAMILY address_family>
-    void SPSockTcp<address_family>::IOEventLoop(ThreadPool<SockTaskTcp> *pool, int epollfd, int exitfd)
+    void SPSockTcp<address_family>::URingEventLoop(SockTaskPool *pool, IOThreadInfo *info)
     {
         UtilTaskTcp utilTask;
-        if (!utilTask.init(pool))
+        if (!utilTask.init(pool, &info->metrics.submitFailures, info->id))
         {
             throw std::bad_alloc();
             return;
         }
 
-        epoll_event *events = new (std::nothrow) epoll_event[tcpConfig.EPOLL_MAX_EVENT_BSIZE];
-        if (!events)
+        int idlefd = -1;
+        if (info->listenfd[0] != -1 && (idlefd = ::open("/dev/null", O_RDONLY | O_CLOEXEC)) == -1)
+            HSLL_LOGINFO(LOG_LEVEL_WARNING, "open \"/dev/null\" error");
+
+        SPTcpBufferPool::Bind(info->pool);
+        localLoop = info;
+
+        SPUring *ring = info->ring;
+        TPBusyPoll spinner;
+        spinner.init(tcpConfig.BUSY_POLL_US);
+        uint64_t exitValue, wakeValue;
+        unsigned int bufferNum = tcpConfig.URING_BUFFER_NUM ? tcpConfig.URING_BUFFER_NUM : SPSOCK_URING_DEFAULT_BUFFER_NUM;
+
+        bool armed = ring->initBuffers(bufferNum) &&
+                     ring->prepRead(info->exitfd, &exitValue, sizeof(exitValue), SPUring::Tag(URING_OP_EXIT)) &&
+                     ring->prepRead(info->wakefd, &wakeValue, sizeof(wakeValue), SPUring::Tag(URING_OP_WAKE));
+
+        for (unsigned int k = 0; armed && k < listenerNum; k++)
         {
+            if (info->listenfd[k] != -1)
+                armed = ring->prepAccept(info->listenfd[k], SPUring::Tag(URING_OP_ACCEPT, &listeners[k]));
+        }
+
+        if (!armed)
+        {
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "io_uring event loop setup failed: There is not enough memory space");
             throw std::bad_alloc();
             return;
         }
 
         while (true)
         {
-            int nfds = epoll_wait(epollfd, events, tcpConfig.EPOLL_MAX_EVENT_BSIZE, -1);
-            if (nfds == -1)
+            bool busy = info->armLocal || (info->starved && ring->available());
+
+            if (!busy && spinner.enabled() && ring->enter(0))
+                busy = spinner.spin([ring]
+                                    { return ring->ready(); });
+
+            if (!ring->enter(busy ? 0 : 1))
             {
-                if (errno == EINTR)
-                    continue;
+                if (idlefd != -1)
+                    close(idlefd);
+
+                localLoop = nullptr;
+                SPTcpBufferPool::Bind(nullptr);
+                throw strerror(errno);
+                break;
+            }
+
+            if (!busy)
+                spinner.arrived();
+
+            unsigned long long data;
+            unsigned int flags;
+            int res;
+
+            SPMetrics::Add(info->metrics.waits);
+
+            while (ring->pop(data, res, flags))
+            {
+                SPMetrics::Add(info->metrics.events);
+                SOCKController *controller = (SOCKController *)(data & ~(unsigned long long)URING_OP_MASK);
+
+                switch (data & URING_OP_MASK)
+                {
+                case URING_OP_EXIT:
+                    URingDrain(info);
+                    ring->releaseBuffers();
+
+                    if (idlefd != -1)
+                        close(idlefd);
+
+                    localLoop = nullptr;
+                    SPTcpBufferPool::Bind(nullptr);
+                    return;
+
+                case URING_OP_WAKE:
+                    if (!ring->prepRead(info->wakefd, &wakeValue, sizeof(wakeValue), SPUring::Tag(URING_OP_WAKE)))
+                        HSLL_LOGINFO(LOG_LEVEL_ERROR, "io_uring submission queue exhausted");
+                    break;
+
+                case URING_OP_ACCEPT:
+                    URingHandleAccept(info, (SPListener *)controller, res, flags, idlefd);
+                    break;
+
+                case URING_OP_RECV:
+                    URingHandleRecv(controller, res, flags, &utilTask);
+                    break;
+
+                case URING_OP_POLL:
+                    URingHandlePoll(controller, res, &utilTask);
+                    break;
+
+                default:
+                    break;
+                }
+            }
+
+            HandleCloseList(info);
+            URingHandleArm(info, &utilTask);
+            URingHandleStarved(info);
+            utilTask.reset();
+            SampleGauges(info);
+        }
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    void SPSockTcp<address_family>::URingHandleArm(IOThreadInfo *info, UtilTaskTcp *utilTask)
+    {
+        SOCKController *remote = info->armList.exchange(nullptr, std::memory_order_acquire);
+        SOCKController *local = info->armLocal;
+        info->armLocal = nullptr;
+
+        while (remote)
+        {
+            SOCKController *next = remote->armNext;
+            if (remote->connecting)
+                StartConnect(remote);
+            else if (remote->adopted)
+                HandleAdopted(remote, utilTask);
+            else
+                URingRearm(remote, utilTask);
+            remote = next;
+        }
+
+        while (local)
+        {
+            SOCKController *next = local->armNext;
+            if (local->connecting)
+                StartConnect(local);
+            else if (local->adopted)
+                HandleAdopted(local, utilTask);
+            else
+                URingRearm(local, utilTask);
+            local = next;
+        }
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    void SPSockTcp<address_family>::URingRearm(SOCKController *controller, UtilTaskTcp *utilTask)
+    {
+        SPUring *ring = controller->info->ring;
+
+        controller->uringEvents = controller->uringRequest;
+        controller->uringFlags |= URING_FLAG_WAITING;
+        URingRecv(controller);
+
+        if ((controller->uringEvents & EPOLLOUT) && !(controller->uringFlags & URING_FLAG_POLL))
+        {
+            if (!ring->prepPollOut(controller->fd, SPUring::Tag(URING_OP_POLL, controller)))
+            {
+                controller->uringFlags &= ~URING_FLAG_WAITING;
+                ActiveClose(controller);
+                return;
+            }
+            controller->uringFlags |= URING_FLAG_POLL;
+        }
+
+        URingReady(controller, utilTask);
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    void SPSockTcp<address_family>::URingRecv(SOCKController *controller)
+    {
+        const int stopped = URING_FLAG_RECV | URING_FLAG_EOF | URING_FLAG_ERROR | URING_FLAG_STARVED | URING_FLAG_CLOSED;
+
+        if ((controller->uringFlags & stopped) || controller->uringBytes >= (unsigned int)tcpConfig.READ_BSIZE)
+            return;
+
+        if (controller->info->ring->prepRecv(controller->fd, SPUring::Tag(URING_OP_RECV, controller)))
+            controller->uringFlags |= URING_FLAG_RECV;
+        else
+            controller->uringFlags |= URING_FLAG_ERROR;
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    void SPSockTcp<address_family>::URingReady(SOCKController *controller, UtilTaskTcp *utilTask)
+    {
+        int flags = controller->uringFlags;
+
+        if (flags & URING_FLAG_WAITING)
+        {
+            if (flags & URING_FLAG_ERROR)
+            {
+                controller->uringFlags &= ~URING_FLAG_WAITING;
+                ActiveClose(controller);
+                return;
+            }
+
+            if ((flags & URING_FLAG_EOF) || ((controller->uringEvents & EPOLLIN) && controller->uringHead != -1))
+            {
+                controller->uringFlags &= ~URING_FLAG_WAITING;
+                if (!HandleRead(controller, utilTask))
+                    ActiveClose(controller);
+                return;
+            }
+        }
+
+        if ((flags & (URING_FLAG_RECV | URING_FLAG_CANCEL)) == URING_FLAG_RECV &&
+            controller->uringBytes >= (unsigned int)tcpConfig.READ_BSIZE)
+        {
+            if (controller->info->ring->prepCancel(SPUring::Tag(URING_OP_RECV, controller), 0, SPUring::Tag(URING_OP_CANCEL)))
+                controller->uringFlags |= URING_FLAG_CANCEL;
+        }
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    void SPSockTcp<address_family>::URingHandleRecv(SOCKController *controller, int res, unsigned int flags, UtilTaskTcp *utilTask)
+    {
+        IOThreadInfo *info = controller->info;
+        SPUring *ring = info->ring;
+
+        if (res > 0)
+        {
+            unsigned short bid = flags >> IORING_CQE_BUFFER_SHIFT;
+
+            if (controller->uringFlags & URING_FLAG_CLOSED)
+            {
+                ring->restore(bid);
+            }
+            else
+            {
+                ring->park(controller->uringHead, controller->uringTail, bid, res);
+                controller->uringBytes += res;
+            }
+        }
+        else
+        {
+            if (flags & IORING_CQE_F_BUFFER)
+                ring->restore(flags >> IORING_CQE_BUFFER_SHIFT);
+
+            if (res == 0)
+            {
+                controller->uringFlags |= URING_FLAG_EOF;
+            }
+            else if (res != -ENOBUFS && res != -ECANCELED)
+            {
+                controller->uringFlags |= URING_FLAG_ERROR;
+                HSLL_LOGINFO(LOG_LEVEL_INFO, "recv() failed: ", strerror(-res));
+            }
+        }
+
+        if (!(flags & IORING_CQE_F_MORE))
+        {
+            controller->uringFlags &= ~(URING_FLAG_RECV | URING_FLAG_CANCEL);
+
+            if (controller->uringFlags & URING_FLAG_CLOSED)
+            {
+                if (!(controller->uringFlags & URING_FLAG_POLL))
+                    URingRelease(controller);
+                return;
+            }
+
+            if (res == -ENOBUFS)
+            {
+                controller->uringFlags |= URING_FLAG_STARVED;
+                controller->uringWait = info->starved;
+                info->starved = controller;
+            }
+            else
+            {
+                URingRecv(controller);
+            }
+        }
+        else if (controller->uringFlags & URING_FLAG_CLOSED)
+        {
+            return;
+        }
+
+        URingReady(controller, utilTask);
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    void SPSockTcp<address_family>::URingHandlePoll(SOCKController *controller, int res, UtilTaskTcp *utilTask)
+    {
+        controller->uringFlags &= ~URING_FLAG_POLL;
+
+        if (controller->uringFlags & URING_FLAG_CLOSED)
+        {
+            if (!(controller->uringFlags & URING_FLAG_RECV))
+                URingRelease(controller);
+            return;
+        }
+
+        if (controller->connecting)
+        {
+            FinishConnect(controller, res < 0 || (res & (POLLERR | POLLHUP)), utilTask);
+            return;
+        }
+
+        if (res < 0 || !(controller->uringFlags & URING_FLAG_WAITING) || !(controller->uringEvents & EPOLLOUT))
+            return;
+
+        if ((res & (POLLERR | POLLHUP)) == POLLERR && controller->handleError())
+        {
+            res &= ~POLLERR;
+            if (!(res & POLLOUT))
+            {
+                if (controller->info->ring->prepPollOut(controller->fd, SPUring::Tag(URING_OP_POLL, controller)))
+                {
+                    controller->uringFlags |= URING_FLAG_POLL;
+                    return;
+                }
+                res |= POLLERR;
+            }
+        }
+
+        controller->uringFlags &= ~URING_FLAG_WAITING;
+
+        if (res & (POLLERR | POLLHUP))
+            ActiveClose(controller);
+        else if (!HandleWrite(controller, utilTask))
+            ActiveClose(controller);
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    void SPSockTcp<address_family>::URingHandleAccept(IOThreadInfo *info, SPListener *listener, int res, unsigned int flags, int &idlefd)
+    {
+        if (res >= 0)
+        {
+            using SOCKADDR = SOCKADDR_IN<address_family>;
+            typename SOCKADDR::TYPE addr;
+            socklen_t addrlen = sizeof(addr);
+
+            if (getpeername(res, (sockaddr *)&addr, &addrlen) == 0)
+                AddConnection(res, addr, info, listener);
+            else
+                close(res);
+        }
+        else
+        {
+            HandleAccept(info, listener, idlefd);
+        }
+
+        if (!(flags & IORING_CQE_F_MORE) &&
+            !info->ring->prepAccept(info->listenfd[listener - listeners], SPUring::Tag(URING_OP_ACCEPT, listener)))
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "io_uring submission queue exhausted");
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    void SPSockTcp<address_family>::URingHandleStarved(IOThreadInfo *info)
+    {
+        if (!info->starved || !info->ring->available())
+            return;
+
+        SOCKController *controller = info->starved;
+        info->starved = nullptr;
+
+        while (controller)
+        {
+            SOCKController *next = controller->uringWait;
+            controller->uringFlags &= ~URING_FLAG_STARVED;
+            URingRecv(controller);
+            controller = next;
+        }
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    bool SPSockTcp<address_family>::URingDetach(SOCKController *controller)
+    {
+        IOThreadInfo *info = controller->info;
+        SPUring *ring = info->ring;
+
+        if (controller->uringFlags & URING_FLAG_STARVED)
+        {
+            SOCKController **link = &info->starved;
+            while (*link != controller)
+                link = &(*link)->uringWait;
+
+            *link = controller->uringWait;
+            controller->uringFlags &= ~URING_FLAG_STARVED;
+        }
+
+        ring->discard(controller->uringHead, controller->uringTail);
+        controller->uringBytes = 0;
+
+        if (!(controller->uringFlags & (URING_FLAG_RECV | URING_FLAG_POLL)))
+            return true;
+
+        if (controller->uringFlags & URING_FLAG_RECV)
+            ring->prepCancel(SPUring::Tag(URING_OP_RECV, controller), 0, SPUring::Tag(URING_OP_CANCEL));
+
+        if (controller->uringFlags & URING_FLAG_POLL)
+            ring->prepCancel(SPUring::Tag(URING_OP_POLL, controller), 0, SPUring::Tag(URING_OP_CANCEL));
+
+        controller->uringFlags |= URING_FLAG_CLOSED;
+        info->closing++;
+        return false;
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    void SPSockTcp<address_family>::URingRelease(SOCKController *controller)
+    {
+        int fd = controller->fd;
+        controller->info->closing--;
+        slotUsed[fd] = false;
+        controller->~SOCKController();
+        close(fd);
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    void SPSockTcp<address_family>::URingDrain(IOThreadInfo *info)
+    {
+        SPUring *ring = info->ring;
+        bool drained = !ring->prepCancel(0, IORING_ASYNC_CANCEL_ANY | IORING_ASYNC_CANCEL_ALL,
+                                         SPUring::Tag(URING_OP_DRAIN));
 
-                delete[] events;
-                throw strerror(errno);
+        while (!drained || info->closing)
+        {
+            if (!ring->enter(1))
                 break;
-            }
 
-            for (int i = 0; i < nfds; i++)
+            unsigned long long data;
+            unsigned int flags;
+            int res;
+
+            while (ring->pop(data, res, flags))
             {
-                int fd = events[i].data.fd;
+                SOCKController *controller = (SOCKController *)(data & ~(unsigned long long)URING_OP_MASK);
 
-                if (fd == exitfd)
+                switch (data & URING_OP_MASK)
                 {
-                    delete[] events;
-                    return;
+                case URING_OP_DRAIN:
+                    drained = true;
+                    break;
+
+                case URING_OP_ACCEPT:
+                    if (res >= 0)
+                        close(res);
+                    break;
+
+                case URING_OP_RECV:
+                    if (flags & IORING_CQE_F_BUFFER)
+                        ring->restore(flags >> IORING_CQE_BUFFER_SHIFT);
+
+                    if (!(flags & IORING_CQE_F_MORE))
+                    {
+                        controller->uringFlags &= ~(URING_FLAG_RECV | URING_FLAG_CANCEL);
+                        if ((controller->uringFlags & (URING_FLAG_CLOSED | URING_FLAG_POLL)) == URING_FLAG_CLOSED)
+                            URingRelease(controller);
+                    }
+                    break;
+
+                case URING_OP_POLL:
+                    controller->uringFlags &= ~URING_FLAG_POLL;
+                    if ((controller->uringFlags & (URING_FLAG_CLOSED | URING_FLAG_RECV)) == URING_FLAG_CLOSED)
+                        URingRelease(controller);
+                    break;
+
+                default:
+                    break;
                 }
+            }
+        }
+    }
+#endif
 
-                if (events[i].events & (EPOLLHUP | EPOLLERR))
-                {
-                    ActiveClose(&connections.find(fd)->second);
-                }
-                else if (events[i].events & (EPOLLIN | EPOLLRDHUP))
-                {
-                    auto it = connections.find(fd);
+    template <ADDRESS_FAMILY address_family>
+    void SPSockTcp<address_family>::HandoffConnections()
+    {
+        unsigned int num = 0;
+        bool movable = (tcpConfig.IO_EVENT_ENGINE != IO_ENGINE_URING);
 
-                    if (events[i].events & EPOLLRDHUP)
-                        it->second.peerClosed = true;
+        for (unsigned int fd = 0; movable && fd < slotNum; fd++)
+        {
+            if (!slotUsed[fd])
+                continue;
 
-                    if (!HandleRead(&it->second, &utilTask))
-                        ActiveClose(&it->second);
-                }
-                else if (events[i].events & EPOLLOUT)
-                {
-                    auto it = connections.find(fd);
+            SOCKController *controller = &connections[fd];
+            if (controller->connecting || controller->peerClosed || controller->tls ||
+                controller->commitWrite() == -1 || controller->getWriteBufferSize())
+                continue;
 
-                    if (!HandleWrite(&it->second, &utilTask))
-                        ActiveClose(&it->second);
-                }
+            iovec vec[SPSOCK_HANDOFF_MAX_IOV];
+            unsigned int count = controller->readBuf.readVec(vec, SPSOCK_HANDOFF_MAX_IOV);
+
+            size_t len = 0;
+            for (unsigned int i = 0; i < count; i++)
+                len += vec[i].iov_len;
+
+            if (len != controller->getReadBufferSize())
+                continue;
+
+            if (!SPHandoff::Send(successor, HANDOFF_CONNECTION, &controller->fd, 1, vec, count))
+            {
+                int err = errno;
+                HSLL_LOGINFO(LOG_LEVEL_WARNING, "Failed to hand off connection ", controller->peer, ": ", strerror(err));
+                if (err == EMSGSIZE || err == ENOBUFS)
+                    continue;
+                break;
             }
 
-            utilTask.reset();
+            HSLL_LOGINFO(LOG_LEVEL_INFO, "Connection handed off: ", controller->peer);
+            controller->handedOff = true;
+            CloseConnection(controller);
+            num++;
         }
+
+        SPHandoff::Send(successor, HANDOFF_END, nullptr, 0);
+        close(successor);
+        successor = -1;
+        HSLL_LOGINFO(LOG_LEVEL_CRUCIAL, "Handed off ", num, " connections to successor");
     }
 
     template <ADDRESS_FAMILY address_family>
     void SPSockTcp<address_family>::Cleanup()
     {
-        if (connections.size())
-            HSLL_LOGINFO(LOG_LEVEL_WARNING, "Cleaning up unclosed connections");
+        if (!connections)
+            return;
+
+        SPTcpBufferPool::Bind(&acceptPool);
 
-        for (auto &it : connections)
+        if (successor != -1)
+            HandoffConnections();
+
+        bool warned = false;
+        for (unsigned int fd = 0; fd < slotNum; fd++)
         {
-            if (proc.csp)
-                proc.csp(&it.second);
+            if (!slotUsed[fd])
+                continue;
+
+            if (!warned)
+            {
+                HSLL_LOGINFO(LOG_LEVEL_WARNING, "Cleaning up unclosed connections");
+                warned = true;
+            }
 
-            close(it.first);
-            HSLL_LOGINFO(LOG_LEVEL_INFO, "Connection force closed : ", it.second.ipPort);
+            HSLL_LOGINFO(LOG_LEVEL_INFO, "Connection force closed : ", connections[fd].peer);
+            CloseConnection(&connections[fd]);
+        }
+
+        free(slotUsed);
+        free(connections);
+        slotUsed = nullptr;
+        connections = nullptr;
+        slotNum = 0;
+
+        for (int i = 0; i < loopInfo.size(); i++)
+        {
+            delete loopInfo.at(i).wheel;
+            delete loopInfo.at(i).holds;
+            delete loopInfo.at(i).pool;
         }
-        connections.clear();
+
+        delete[] workerBuffers;
+        workerBuffers = nullptr;
+
+        loopInfo.clear();
+        loops.clear();
+        SPTcpBufferPool::Bind(nullptr);
     }
 
     template <ADDRESS_FAMILY address_family>
-    SPSockTcp<address_family>::SPSockTcp() : listenfd(-1), status(0), lin{0, 0}, alive{0, 0, 0, 0} {}
+    SPSockTcp<address_family>::SPSockTcp() : status(0), listenerNum(0), connector{}, lin{0, 0}, proc{}, alive{0, 0, 0, 0}, offload{false, false},
+                                             framer{}, slotNum(0), slotUsed(nullptr), connections(nullptr),
+                                             workerBuffers(nullptr), workerPool(nullptr), workerPoolNum(0), tls(nullptr),
+                                             handoffListen(-1), successor(-1), predecessor(-1) {}
 
     template <ADDRESS_FAMILY address_family>
     SPSockTcp<address_family>::~SPSockTcp()
     {
-        if (listenfd != -1)
-            close(listenfd);
+        Cleanup();
+
+        for (unsigned int i = 0; i < listenerNum; i++)
+            close(listeners[i].fd);
+
+#if defined(SPSOCK_TLS)
+        for (size_t i = 0; i < tlsContexts.size(); i++)
+            SPTls::FreeContext(tlsContexts[i]);
+#endif
+
+        if (handoffListen != -1)
+        {
+            close(handoffListen);
+            SPHandoff::Unlink(handoffPath.c_str());
+        }
+
+        if (successor != -1)
+            close(successor);
+
+        if (predecessor != -1)
+            close(predecessor);
+
+        for (size_t i = 0; i < inherited.size(); i++)
+            close(inherited[i]);
     };
 
     template <ADDRESS_FAMILY address_family>
@@ -464,8 +2345,21 @@ namespace HSLL
         assert(config.THREADPOOL_BATCH_SIZE_SUBMIT > 0 && config.THREADPOOL_BATCH_SIZE_SUBMIT <= config.THREADPOOL_QUEUE_LENGTH);
         assert(config.THREADPOOL_BATCH_SIZE_PROCESS > 0 && config.THREADPOOL_BATCH_SIZE_PROCESS <= 1024);
         assert(config.WORKER_THREAD_RATIO > 0.0 && config.WORKER_THREAD_RATIO < 1.0);
+        assert(config.IO_ACCEPT_MODE == ACCEPT_MODE_MAIN || config.IO_ACCEPT_MODE == ACCEPT_MODE_REUSEPORT);
+        assert(config.IO_DISPATCH_MODE == DISPATCH_MODE_POOL || config.IO_DISPATCH_MODE == DISPATCH_MODE_INLINE);
+        assert(config.IO_EVENT_ENGINE == IO_ENGINE_EPOLL || config.IO_EVENT_ENGINE == IO_ENGINE_URING);
+        assert(config.IO_TRIGGER_MODE == TRIGGER_MODE_ONESHOT || config.IO_TRIGGER_MODE == TRIGGER_MODE_EDGE);
+        assert(config.URING_BUFFER_NUM <= 32768 && (config.URING_BUFFER_NUM & (config.URING_BUFFER_NUM - 1)) == 0);
+        assert(config.BUFFER_POOL_MAX_BLOCK_NUM == 0 || config.BUFFER_POOL_MAX_BLOCK_NUM >= config.BUFFER_POOL_PEER_ALLOC_NUM);
+        assert(config.BUFFER_CHUNK_SIZE == 0 ||
+               ((config.BUFFER_CHUNK_SIZE % 1024) == 0 && config.BUFFER_CHUNK_SIZE <= config.READ_BSIZE &&
+                config.BUFFER_CHUNK_SIZE <= config.WRITE_BSIZE));
+        assert(SPTopology::Valid(config.IO_CPU_LIST) && SPTopology::Valid(config.WORKER_CPU_LIST));
+        assert(config.NUMA_PLACEMENT == 0 || config.NUMA_PLACEMENT == 1);
+        assert(config.THREADPOOL_AFFINITY == AFFINITY_MODE_NONE || config.THREADPOOL_AFFINITY == AFFINITY_MODE_CONNECTION ||
+               config.THREADPOOL_AFFINITY == AFFINITY_MODE_LOOP);
         minLevel = config.MIN_LOG_LEVEL;
-        markGlobal = {0, 0};
+        markGlobal = {0, 0, 0};
         renableProc = SPDefered::REnableFunc;
         funcClose = ActiveClose;
         funcEvent = EnableEvent;
@@ -484,106 +2378,256 @@ namespace HSLL
     template <ADDRESS_FAMILY address_family>
     bool SPSockTcp<address_family>::Listen(unsigned short port, const char *ip)
     {
-        if ((status & 0x1) == 0x1)
+        if ((status & 0x8) == 0x8)
+        {
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "Listen() cannot be called after EventLoop()");
+            return false;
+        }
+
+        if (listenerNum == SPSOCK_MAX_LISTENERS)
         {
-            HSLL_LOGINFO(LOG_LEVEL_ERROR, "Listen() cannot be called multiple times");
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "Listen() called more than SPSOCK_MAX_LISTENERS times");
             return false;
         }
 
         using SOCKADDR = SOCKADDR_IN<address_family>;
-        typename SOCKADDR::TYPE addr;
+        SPListener &listener = listeners[listenerNum];
 
-        if (!SOCKADDR::INIT(addr, ip, port))
+        if (!SOCKADDR::INIT(*(typename SOCKADDR::TYPE *)&listener.addr, ip, port))
         {
             HSLL_LOGINFO(LOG_LEVEL_ERROR, "Invalid ipv4 address");
             return false;
         }
 
-        if ((listenfd = socket(address_family, PROTOCOL_TCP, 0)) == -1)
+        bool reused = (listener.fd = ClaimInherited(listener)) != -1;
+        if (!reused && (listener.fd = CreateListener(SOCK_CLOEXEC, listener)) == -1)
+            return false;
+
+        listener.port = port;
+        CaptureListener(listener);
+        listenerNum++;
+        status |= 0x1;
+        HSLL_LOGINFO(LOG_LEVEL_INFO, reused ? "Took over listening socket on port: " : "Started listening on port: ", port);
+        return true;
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    bool SPSockTcp<address_family>::TakeOver(const char *path)
+    {
+        if (listenerNum)
+        {
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "TakeOver() must be called before Listen()");
+            return false;
+        }
+
+        if (predecessor != -1 || !inherited.empty())
         {
-            HSLL_LOGINFO(LOG_LEVEL_ERROR, "socket() failed: ", strerror(errno));
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "TakeOver() cannot be called multiple times");
             return false;
         }
 
-        int reuse = 1;
-        if (setsockopt(listenfd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) == -1 ||
-            setsockopt(listenfd, SOL_SOCKET, SO_REUSEPORT, &reuse, sizeof(reuse)) == -1)
+        if (!path)
         {
-            HSLL_LOGINFO(LOG_LEVEL_ERROR, "setsockopt(SO_REUSEPORT|SO_REUSEADDR) failed: ", strerror(errno));
-            close(listenfd);
-            listenfd = -1;
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "Invalid parameter: path is nullptr");
             return false;
         }
 
-        if (bind(listenfd, (sockaddr *)&addr, sizeof(addr)) == -1)
+        int fd = SPHandoff::Dial(path);
+        if (fd == -1)
         {
-            HSLL_LOGINFO(LOG_LEVEL_ERROR, "bind() failed: ", strerror(errno));
-            close(listenfd);
-            listenfd = -1;
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "Failed to connect to predecessor at ", path, ": ", strerror(errno));
             return false;
         }
 
-        if (listen(listenfd, SOMAXCONN) == -1)
+        SPHandoffHeader header;
+        int fds[SPSOCK_HANDOFF_MAX_FDS];
+
+        int ret = SPHandoff::Receive(fd, header, fds, SPSOCK_HANDOFF_MAX_FDS, nullptr, 0);
+        if (ret != 1 || header.type != HANDOFF_LISTENERS)
         {
-            HSLL_LOGINFO(LOG_LEVEL_ERROR, "listen() failed: ", strerror(errno));
-            close(listenfd);
-            listenfd = -1;
+            if (ret == 1)
+            {
+                for (unsigned int i = 0; i < header.count; i++)
+                    close(fds[i]);
+            }
+
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "Predecessor did not hand off its listeners: ",
+                         ret == -1 ? strerror(errno) : "unexpected message");
+            close(fd);
             return false;
         }
 
-        status |= 0x1;
-        HSLL_LOGINFO(LOG_LEVEL_INFO, "Started listening on port: ", port);
+        inherited.assign(fds, fds + header.count);
+        predecessor = fd;
+        HSLL_LOGINFO(LOG_LEVEL_CRUCIAL, "Took over ", header.count, " listening sockets from predecessor at ", path);
         return true;
     }
 
     template <ADDRESS_FAMILY address_family>
-    void SPSockTcp<address_family>::HandleCloseList()
+    bool SPSockTcp<address_family>::SetHandoff(const char *path)
     {
-        std::unique_lock<std::mutex> lock(cList.mtx);
-        if (cList.connections.size() > 10)
+        if ((status & 0x8) == 0x8 || workerPool.load(std::memory_order_acquire))
         {
-            auto connections = std::move(cList.connections);
-            lock.unlock();
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "SetHandoff() must be called before EventLoop()");
+            return false;
+        }
 
-            for (auto &&controller : connections)
-            {
-                HSLL_LOGINFO(LOG_LEVEL_INFO, "Connection closed: ", controller->ipPort);
-                CloseConnection(controller);
-                controller->info->count--;
-            }
+        if (handoffListen != -1)
+        {
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "SetHandoff() cannot be called multiple times");
+            return false;
         }
-        else
+
+        if (!path)
         {
-            for (auto &&controller : cList.connections)
-            {
-                HSLL_LOGINFO(LOG_LEVEL_INFO, "Connection closed: ", controller->ipPort);
-                CloseConnection(controller);
-                controller->info->count--;
-            }
-            cList.connections.clear();
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "Invalid parameter: path is nullptr");
+            return false;
+        }
+
+        if ((handoffListen = SPHandoff::Serve(path)) == -1)
+        {
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "Failed to create handoff socket at ", path, ": ", strerror(errno));
+            return false;
+        }
+
+        handoffPath = path;
+        HSLL_LOGINFO(LOG_LEVEL_INFO, "Handoff socket listening at: ", path);
+        return true;
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    bool SPSockTcp<address_family>::Connect(const char *ip, unsigned short port, void *ctx, unsigned int timeout)
+    {
+        if (!workerPool.load(std::memory_order_acquire))
+        {
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "Connect() requires a running EventLoop()");
+            return false;
+        }
+
+        using SOCKADDR = SOCKADDR_IN<address_family>;
+        typename SOCKADDR::TYPE addr;
+
+        if (!ip || !SOCKADDR::INIT(addr, ip, port))
+        {
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "Invalid peer address");
+            return false;
+        }
+
+        int fd = socket(address_family, PROTOCOL_TCP | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd == -1)
+        {
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "socket() failed: ", strerror(errno));
+            return false;
+        }
+
+        if (fd >= slotNum)
+        {
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "Connection slot table exhausted");
+            close(fd);
+            return false;
+        }
+
+        if (connector.alive.keepAlive)
+            SetKeepAlive(fd, connector.alive);
+
+        if (connector.lin.l_onoff)
+            SetLinger(fd, connector.lin);
+
+        IOThreadInfo *info = localLoop ? localLoop : PickLoop(-1);
+
+        if (info->ring && timeout && setsockopt(fd, IPPROTO_TCP, TCP_USER_TIMEOUT, &timeout, sizeof(timeout)) != 0)
+            HSLL_LOGINFO(LOG_LEVEL_WARNING, "setsockopt(TCP_USER_TIMEOUT) failed: ", strerror(errno));
+
+        if (connect(fd, (sockaddr *)&addr, sizeof(addr)) == -1 && errno != EINPROGRESS)
+        {
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "connect() failed: ", strerror(errno));
+            close(fd);
+            return false;
+        }
+
+        auto &controller = *new (&connections[fd]) SOCKController{};
+        if (!controller.init(fd, ctx, info, &connector))
+        {
+            HSLL_LOGINFO(LOG_LEVEL_WARNING, "Insufficient memory space");
+            controller.~SOCKController();
+            close(fd);
+            return false;
+        }
+
+        slotUsed[fd] = true;
+        SOCKADDR::PEER(addr, controller.peer);
+        controller.connecting = true;
+        if (!info->ring && timeout)
+            controller.holdDeadline = SPHoldQueue::Now() + (unsigned long long)timeout * 1000;
+
+        info->count.fetch_add(1, std::memory_order_relaxed);
+        QueueArm(&controller);
+        return true;
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    void SPSockTcp<address_family>::HandleClose(SOCKController *controller)
+    {
+        IOThreadInfo *info = controller->info;
+        HSLL_LOGINFO(LOG_LEVEL_INFO, "Connection closed: ", controller->peer);
+        CloseConnection(controller);
+        info->count.fetch_sub(1, std::memory_order_relaxed);
+        SPMetrics::Add(info->metrics.closed);
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    void SPSockTcp<address_family>::HandleCloseList(IOThreadInfo *info)
+    {
+        SOCKController *controller = info->closeList.exchange(nullptr, std::memory_order_acquire);
+        unsigned int num = 0;
+
+        while (controller)
+        {
+            SOCKController *next = controller->next;
+            HandleClose(controller);
+            controller = next;
+            num++;
+        }
+
+        if (num)
+        {
+            SPMetrics::Add(info->metrics.closeListed, num);
+            if (num > info->metrics.closeListMax.load(std::memory_order_relaxed))
+                info->metrics.closeListMax.store(num, std::memory_order_relaxed);
         }
     }
 
     template <ADDRESS_FAMILY address_family>
     bool SPSockTcp<address_family>::HandleRead(SOCKController *controller, UtilTaskTcp *utilTask)
     {
-        if (proc.rdp)
+        const SPListener *listener = controller->listener;
+
+#if defined(SPSOCK_TLS)
+        if (controller->tls && !SPTls::Ready(controller->tls))
+            return HandleHandshake(controller, utilTask);
+#endif
+
+        if (listener->proc.frp)
+            return HandleFrames(controller, utilTask);
+
+        if (listener->proc.rdp)
         {
             if (!controller->readSocket())
                 return false;
 
+            if (tcpConfig.IO_TRIGGER_MODE == TRIGGER_MODE_EDGE && !controller->info->ring &&
+                controller->readFull())
+                controller->edgeState.fetch_or(EPOLLIN, std::memory_order_relaxed);
+
             if (controller->isPeerClosed() && controller->getReadBufferSize() == 0)
                 return false;
 
-            if (markGlobal.readMark == 0)
+            if (controller->getReadBufferSize() >= controller->readMark || HoldExpired(controller))
             {
-                utilTask->append(controller, proc.rdp);
-                return true;
-            }
+                if (controller->holdDeadline)
+                    controller->info->holds->release(controller);
 
-            if (controller->getReadBufferSize() >= markGlobal.readMark)
-            {
-                utilTask->append(controller, proc.rdp);
+                Dispatch(controller, listener->proc.rdp, listener->offload.read, utilTask);
                 return true;
             }
             else if (!controller->renableEvents())
@@ -591,9 +2635,9 @@ namespace HSLL
                 return false;
             }
         }
-        else if (proc.wtp)
+        else if (listener->proc.wtp)
         {
-            if (controller->enableEvents(false, true))
+            if (!controller->enableEvents(false, true))
                 return false;
         }
         else
@@ -603,26 +2647,85 @@ namespace HSLL
         return true;
     }
 
+    template <ADDRESS_FAMILY address_family>
+    bool SPSockTcp<address_family>::HandleHandshake(SOCKController *controller, UtilTaskTcp *utilTask)
+    {
+#if defined(SPSOCK_TLS)
+        switch (SPTls::Handshake(controller->tls))
+        {
+        case 1:
+            HSLL_LOGINFO(LOG_LEVEL_INFO, "TLS established with: ", controller->peer, " (kernel TLS send ",
+                         SPTls::KernelSend(controller->tls) ? "on" : "off", ", receive ",
+                         SPTls::KernelRecv(controller->tls) ? "on" : "off", ")");
+
+            if (tcpConfig.IO_TRIGGER_MODE == TRIGGER_MODE_EDGE)
+                controller->edgeState.fetch_or(EPOLLIN, std::memory_order_relaxed);
+
+            // Continue as the first event of a plain connection would; records that arrived with
+            // the last handshake flight are already buffered by OpenSSL and drained by the read path
+            if ((tcpConfig.EPOLL_DEFAULT_EVENT & EPOLLIN) && (controller->listener->proc.rdp || controller->listener->proc.frp))
+                return HandleRead(controller, utilTask);
+
+            return HandleWrite(controller, utilTask);
+        case 0:
+            return EnableEvent(controller, true, false);
+        case 2:
+            controller->sendBlocked = true;
+            return EnableEvent(controller, true, true);
+        default:
+            HSLL_LOGINFO(LOG_LEVEL_WARNING, "TLS handshake with ", controller->peer, " failed: ", SPTls::Error());
+            return false;
+        }
+#else
+        (void)controller;
+        (void)utilTask;
+        return false;
+#endif
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    bool SPSockTcp<address_family>::HoldExpired(SOCKController *controller)
+    {
+        SPHoldQueue *holds = controller->info->holds;
+        if (!holds || controller->maxLatency == 0 || controller->getReadBufferSize() == 0)
+            return false;
+
+        unsigned long long now = SPHoldQueue::Now();
+        if (controller->holdDeadline == 0)
+        {
+            holds->hold(controller, now + controller->maxLatency);
+            return false;
+        }
+        return now >= controller->holdDeadline;
+    }
+
     template <ADDRESS_FAMILY address_family>
     bool SPSockTcp<address_family>::HandleWrite(SOCKController *controller, UtilTaskTcp *utilTask)
     {
-        if (proc.wtp)
+        const SPListener *listener = controller->listener;
+
+#if defined(SPSOCK_TLS)
+        if (controller->tls && !SPTls::Ready(controller->tls))
+            return HandleHandshake(controller, utilTask);
+#endif
+
+        if (listener->proc.wtp)
         {
             if (controller->isPeerClosed() && controller->getReadBufferSize() == 0)
                 return false;
 
-            if (markGlobal.writeMark == 0xffffffff)
+            if (controller->writeMark == 0xffffffff)
             {
-                utilTask->append(controller, proc.wtp);
+                Dispatch(controller, listener->proc.wtp, listener->offload.write, utilTask);
                 return true;
             }
 
             if (controller->commitWrite() == -1)
                 return false;
 
-            if (controller->getWriteBufferSize() <= markGlobal.writeMark)
+            if (controller->getWriteBufferSize() <= controller->writeMark)
             {
-                utilTask->append(controller, proc.wtp);
+                Dispatch(controller, listener->proc.wtp, listener->offload.write, utilTask);
                 return true;
             }
             else if (!controller->renableEvents())
@@ -630,16 +2733,178 @@ namespace HSLL
                 return false;
             }
         }
-        else if (proc.rdp)
+        else if (listener->proc.frp)
+        {
+            ssize_t pending = controller->commitWrite();
+            if (pending < 0 || !controller->enableEvents(true, pending > 0))
+                return false;
+        }
+        else if (listener->proc.rdp)
+        {
+            if (!controller->enableEvents(true, false))
+                return false;
+        }
+        else
+        {
+            return false;
+        }
+        return true;
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    bool SPSockTcp<address_family>::HandleFrames(SOCKController *controller, UtilTaskTcp *utilTask)
+    {
+        const SPListener *listener = controller->listener;
+
+        if (!controller->readSocket())
+            return false;
+
+        if (tcpConfig.IO_TRIGGER_MODE == TRIGGER_MODE_EDGE && !controller->info->ring &&
+            controller->readFull())
+            controller->edgeState.fetch_or(EPOLLIN, std::memory_order_relaxed);
+
+        unsigned int offset, len, total;
+        int ret = ParseFrame(controller, &offset, &len, &total);
+
+        if (ret == 1)
+        {
+            Dispatch(controller, FrameTask, listener->offload.read, utilTask);
+            return true;
+        }
+
+        if (ret == -1)
+        {
+            HSLL_LOGINFO(LOG_LEVEL_WARNING, "Invalid or oversized frame from: ", controller->peer);
+            return false;
+        }
+
+        if (controller->isPeerClosed())
+            return false;
+
+        return controller->renableEvents();
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    int SPSockTcp<address_family>::ParseFrame(SOCKController *controller, unsigned int *offset, unsigned int *len, unsigned int *total)
+    {
+        const SPFrameConfig &framer = controller->listener->framer;
+        SPBuffer *buffer = &controller->readBuf;
+        unsigned int size = buffer->bytesRead();
+
+        if (framer.MODE == FRAME_MODE_LENGTH)
+        {
+            unsigned int hsize = framer.HEADER_SIZE;
+            if (size < hsize)
+                return 0;
+
+            unsigned char header[8];
+            buffer->peek(header, hsize);
+
+            unsigned long long value = 0;
+            for (unsigned int i = 0; i < hsize; i++)
+                value |= (unsigned long long)header[framer.HEADER_BIG_ENDIAN ? hsize - 1 - i : i] << (8 * i);
+
+            if (!framer.LENGTH_INCLUDES_HEADER)
+                value += hsize;
+
+            if (value < hsize || value > framer.MAX_FRAME_SIZE)
+                return -1;
+
+            if (size < value)
+                return 0;
+
+            *offset = hsize;
+            *len = value - hsize;
+            *total = value;
+            return 1;
+        }
+
+        unsigned int dsize = framer.DELIMITER_SIZE;
+        long pos = buffer->find(framer.DELIMITER, dsize, controller->frameScan);
+
+        if (pos == -1)
+        {
+            if (size >= framer.MAX_FRAME_SIZE)
+                return -1;
+
+            controller->frameScan = (size < dsize) ? 0 : size - dsize + 1;
+            return 0;
+        }
+
+        if (pos + dsize > framer.MAX_FRAME_SIZE)
+            return -1;
+
+        controller->frameScan = 0;
+        *offset = 0;
+        *len = pos;
+        *total = pos + dsize;
+        return 1;
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    void SPSockTcp<address_family>::FrameTask(SOCKController *controller)
+    {
+        SPSockTcp<address_family> *self = GetInstance();
+        iovec vec[SPSOCK_MAX_FRAME_IOVEC];
+        unsigned int offset, len, total;
+        int ret;
+
+        while ((ret = self->ParseFrame(controller, &offset, &len, &total)) == 1)
+        {
+            unsigned int num = controller->readBuf.viewVec(vec, SPSOCK_MAX_FRAME_IOVEC, offset, len);
+
+            if (!controller->listener->proc.frp(controller, vec, num))
+            {
+                controller->close();
+                return;
+            }
+            controller->readBuf.commitRead(total);
+        }
+
+        if (ret == -1 || controller->isPeerClosed())
+        {
+            controller->close();
+            return;
+        }
+
+        ssize_t pending = controller->commitWrite();
+        if (pending < 0 || !controller->enableEvents(true, pending > 0))
+            controller->close();
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    void SPSockTcp<address_family>::Dispatch(SOCKController *controller, ReadWriteProc func, bool offloaded, UtilTaskTcp *utilTask)
+    {
+        SPLoopMetrics &metrics = controller->info->metrics;
+
+        if (tcpConfig.IO_DISPATCH_MODE != DISPATCH_MODE_INLINE || offloaded)
+        {
+            SPMetrics::Add(metrics.pooledCalls);
+            utilTask->append(controller, func);
+            return;
+        }
+
+        SPMetrics::Add(metrics.inlineCalls);
+
+        if (!SPMetrics::Timing())
         {
-            if (controller->enableEvents(true, false))
-                return false;
+            func(controller);
+            return;
         }
-        else
+
+        unsigned long long start = SPMetrics::Ticks();
+        func(controller);
+        SPMetrics::Record(SPMETRICS_CALLBACK, start, SPMetrics::Ticks());
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    void SPSockTcp<address_family>::SampleGauges(IOThreadInfo *info)
+    {
+        for (int type = BUFFER_TYPE_READ; type <= BUFFER_TYPE_CHUNK; type++)
         {
-            return false;
+            info->metrics.freeBuffers[type].store(info->pool->available((BUFFER_TYPE)type), std::memory_order_relaxed);
+            info->metrics.totalBuffers[type].store(info->pool->allocated((BUFFER_TYPE)type), std::memory_order_relaxed);
         }
-        return true;
     }
 
     template <ADDRESS_FAMILY address_family>
@@ -666,41 +2931,145 @@ namespace HSLL
         if ((status & 0x4) != 0x4)
             HSLL_LOGINFO(LOG_LEVEL_WARNING, "Exit signal handler not configured");
 
-        int ioThreads, workerThreads;
-        if (!CalculateOptimalThreadCounts(&ioThreads, &workerThreads))
+        CaptureListener(listeners[listenerNum - 1]);
+        CaptureListener(connector);
+        connector.tls = nullptr;
+
+        if (!inherited.empty())
+        {
+            HSLL_LOGINFO(LOG_LEVEL_WARNING, "Closing ", (unsigned int)inherited.size(), " inherited listening sockets not claimed by Listen()");
+            for (size_t i = 0; i < inherited.size(); i++)
+                close(inherited[i]);
+            inherited.clear();
+        }
+
+        SPPlacement placement;
+        if (!PlanPlacement(placement))
         {
             HSLL_LOGINFO(LOG_LEVEL_ERROR, "Failed to get the number of CPU cores");
             return false;
         }
 
-        ThreadPool<SockTaskTcp> pool;
+        if (!CreateConnectionTable())
+        {
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "Failed to allocate connection slot table");
+            return false;
+        }
+
+        unsigned int poolNum = placement.groupWorkers.size();
+        unsigned int workerNum = 0;
+        for (unsigned int i = 0; i < poolNum; i++)
+            workerNum += placement.groupWorkers[i];
 
-        if (!pool.init(tcpConfig.THREADPOOL_QUEUE_LENGTH, workerThreads,
-                       tcpConfig.THREADPOOL_BATCH_SIZE_PROCESS))
+        delete[] workerBuffers;
+        workerBuffers = new (std::nothrow) SPTcpBufferPool[workerNum];
+        SockTaskPool *pools = workerBuffers ? new (std::nothrow) SockTaskPool[poolNum] : nullptr;
+        if (!pools)
         {
             HSLL_LOGINFO(LOG_LEVEL_ERROR, "Failed to initialize thread pool: There is not enough memory space");
             return false;
         }
 
-        if (!CreateIOEventLoop(&pool, ioThreads))
+        for (unsigned int i = 0, first = 0; i < poolNum; first += placement.groupWorkers[i++])
+        {
+            if (!placement.groupWorkers[i])
+                continue;
+
+            pools[i].set_steal_threshold(tcpConfig.THREADPOOL_STEAL_THRESHOLD);
+            pools[i].set_spin_window(tcpConfig.BUSY_POLL_US);
+            pools[i].set_thread_init(BindWorker, workerBuffers + first);
+
+            bool ok = placement.groupCpus[i].empty()
+                          ? pools[i].init(tcpConfig.THREADPOOL_QUEUE_LENGTH, placement.groupWorkers[i],
+                                          tcpConfig.THREADPOOL_BATCH_SIZE_PROCESS)
+                          : pools[i].init(tcpConfig.THREADPOOL_QUEUE_LENGTH, placement.groupCpus[i],
+                                          tcpConfig.THREADPOOL_BATCH_SIZE_PROCESS);
+            if (!ok)
+            {
+                HSLL_LOGINFO(LOG_LEVEL_ERROR, "Failed to initialize thread pool: There is not enough memory space");
+                delete[] pools;
+                return false;
+            }
+        }
+
+        if (!CreateIOEventLoop(pools, placement))
         {
             HSLL_LOGINFO(LOG_LEVEL_ERROR, "CreateIOEventLoop() failed");
+            delete[] pools;
             return false;
         }
 
+        workerPoolNum = poolNum;
+        workerPool.store(pools, std::memory_order_release);
+
         HSLL_LOGINFO(LOG_LEVEL_CRUCIAL, "Event loop start");
 
+        SPTcpBufferPool::Bind(&acceptPool);
+
         if (!MainEventLoop())
             HSLL_LOGINFO(LOG_LEVEL_ERROR, "MainEventLoop() failed");
 
-        pool.exit();
-        ExitIOEventLoop();
+        workerPool.store(nullptr, std::memory_order_release);
+        ExitIOEventLoop(pools, poolNum);
+        delete[] pools;
+
+        for (int i = 0; i < loopInfo.size(); i++)
+            HandleCloseList(&loopInfo.at(i));
+
+        Cleanup();
 
         status |= 0x8;
         HSLL_LOGINFO(LOG_LEVEL_CRUCIAL, "Event loop exited");
         return true;
     }
 
+    template <ADDRESS_FAMILY address_family>
+    bool SPSockTcp<address_family>::EnableTls(const char *certFile, const char *keyFile)
+    {
+        if (!certFile)
+        {
+            tls = nullptr;
+            return true;
+        }
+
+#if defined(SPSOCK_TLS)
+        if (tcpConfig.IO_EVENT_ENGINE == IO_ENGINE_URING)
+        {
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "TLS is not supported with IO_ENGINE_URING");
+            return false;
+        }
+
+        if (tcpConfig.READ_BSIZE < SPSOCK_TLS_RECORD_SIZE)
+        {
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "TLS requires READ_BSIZE of at least ", SPSOCK_TLS_RECORD_SIZE);
+            return false;
+        }
+
+        if (!keyFile)
+        {
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "Invalid parameter: keyFile is nullptr");
+            return false;
+        }
+
+        SSL_CTX *ctx = SPTls::CreateContext(certFile, keyFile);
+        if (!ctx)
+        {
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "Failed to load TLS certificate: ", SPTls::Error());
+            return false;
+        }
+
+        tlsContexts.push_back(ctx);
+        tls = ctx;
+        signal(SIGPIPE, SIG_IGN);
+        HSLL_LOGINFO(LOG_LEVEL_INFO, "TLS enabled with certificate ", certFile);
+        return true;
+#else
+        (void)keyFile;
+        HSLL_LOGINFO(LOG_LEVEL_ERROR, "TLS support not compiled (define SPSOCK_TLS)");
+        return false;
+#endif
+    }
+
     template <ADDRESS_FAMILY address_family>
     bool SPSockTcp<address_family>::EnableLinger(bool enable, int waitSeconds)
     {
@@ -749,19 +3118,241 @@ namespace HSLL
             HSLL_LOGINFO(LOG_LEVEL_ERROR, "Invalid parameter: Parameters cannot be nullptr at the same time");
             return false;
         }
-        proc = {rdp, wtp, cnp, csp};
+        proc = {rdp, wtp, cnp, csp, cnp ? nullptr : proc.cnap, proc.tmp, proc.frp};
         status |= 0x2;
         HSLL_LOGINFO(LOG_LEVEL_INFO, "Callbacks configured successfully");
         return true;
     }
 
     template <ADDRESS_FAMILY address_family>
-    void SPSockTcp<address_family>::SetWaterMark(unsigned int readMark, unsigned int writeMark)
+    bool SPSockTcp<address_family>::SetConnectCallback(ConnectAddrProc cnap)
+    {
+        if (cnap == nullptr)
+        {
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "Invalid parameter: ConnectAddrProc cannot be nullptr");
+            return false;
+        }
+
+        proc.cnp = nullptr;
+        proc.cnap = cnap;
+        status |= 0x2;
+        HSLL_LOGINFO(LOG_LEVEL_INFO, "Connect callback configured successfully");
+        return true;
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    bool SPSockTcp<address_family>::SetTimerCallback(TimerProc tmp)
+    {
+        if (tmp == nullptr)
+        {
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "Invalid parameter: TimerProc cannot be nullptr");
+            return false;
+        }
+
+        proc.tmp = tmp;
+        HSLL_LOGINFO(LOG_LEVEL_INFO, "Timer callback configured successfully");
+        return true;
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    bool SPSockTcp<address_family>::SetFramer(const SPFrameConfig &config, FrameProc frp)
+    {
+        if (frp == nullptr)
+        {
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "Invalid parameter: FrameProc cannot be nullptr");
+            return false;
+        }
+
+        unsigned int maxFrame = config.MAX_FRAME_SIZE ? config.MAX_FRAME_SIZE : tcpConfig.READ_BSIZE;
+        if (maxFrame > (unsigned int)tcpConfig.READ_BSIZE)
+        {
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "Invalid parameter: MAX_FRAME_SIZE exceeds READ_BSIZE");
+            return false;
+        }
+
+        if (tcpConfig.BUFFER_CHUNK_SIZE && maxFrame / tcpConfig.BUFFER_CHUNK_SIZE + 2 > SPSOCK_MAX_FRAME_IOVEC)
+        {
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "Invalid parameter: MAX_FRAME_SIZE spans too many buffer chunks");
+            return false;
+        }
+
+        if (config.MODE == FRAME_MODE_LENGTH)
+        {
+            unsigned int hsize = config.HEADER_SIZE;
+            if ((hsize != 1 && hsize != 2 && hsize != 4 && hsize != 8) || maxFrame < hsize)
+            {
+                HSLL_LOGINFO(LOG_LEVEL_ERROR, "Invalid parameter: HEADER_SIZE must be 1, 2, 4 or 8");
+                return false;
+            }
+        }
+        else if (config.MODE == FRAME_MODE_DELIMITER)
+        {
+            if (config.DELIMITER_SIZE == 0 || config.DELIMITER_SIZE > sizeof(config.DELIMITER) ||
+                maxFrame < config.DELIMITER_SIZE)
+            {
+                HSLL_LOGINFO(LOG_LEVEL_ERROR, "Invalid parameter: DELIMITER_SIZE must be 1-8");
+                return false;
+            }
+        }
+        else
+        {
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "Invalid parameter: Unknown FRAME_MODE");
+            return false;
+        }
+
+        framer = config;
+        framer.MAX_FRAME_SIZE = maxFrame;
+        proc.frp = frp;
+        status |= 0x2;
+        HSLL_LOGINFO(LOG_LEVEL_INFO, "Framer configured successfully");
+        return true;
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    void SPSockTcp<address_family>::SetWaterMark(unsigned int readMark, unsigned int writeMark, unsigned int maxLatency)
     {
-        markGlobal = {readMark, writeMark};
+        markGlobal = {readMark, writeMark, maxLatency};
         HSLL_LOGINFO(LOG_LEVEL_INFO, "Low water mark configured successfully");
     }
 
+    template <ADDRESS_FAMILY address_family>
+    void SPSockTcp<address_family>::SetOffload(bool read, bool write)
+    {
+        offload = {read, write};
+        HSLL_LOGINFO(LOG_LEVEL_INFO, "Callback offload configured successfully");
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    void SPSockTcp<address_family>::EnableTimingMetrics(bool enable)
+    {
+        SPMetrics::SetTiming(enable);
+        HSLL_LOGINFO(LOG_LEVEL_INFO, "Timing metrics ", enable ? "enabled" : "disabled");
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    SPTcpMetrics SPSockTcp<address_family>::GetMetrics()
+    {
+        SPTcpMetrics snapshot = {};
+
+        for (size_t i = 0; i < loopInfo.size(); i++)
+        {
+            IOThreadInfo &info = loopInfo[i];
+            SPLoopMetrics &metrics = info.metrics;
+
+            snapshot.waits += metrics.waits.load(std::memory_order_relaxed);
+            snapshot.events += metrics.events.load(std::memory_order_relaxed);
+            snapshot.accepted += metrics.accepted.load(std::memory_order_relaxed);
+            snapshot.connected += metrics.connected.load(std::memory_order_relaxed);
+            snapshot.adopted += metrics.adopted.load(std::memory_order_relaxed);
+            snapshot.closed += metrics.closed.load(std::memory_order_relaxed);
+            snapshot.inlineCalls += metrics.inlineCalls.load(std::memory_order_relaxed);
+            snapshot.pooledCalls += metrics.pooledCalls.load(std::memory_order_relaxed);
+            snapshot.submitFailures += metrics.submitFailures.load(std::memory_order_relaxed);
+            snapshot.closeListed += metrics.closeListed.load(std::memory_order_relaxed);
+            snapshot.connections += info.count.load(std::memory_order_relaxed);
+
+            unsigned int closeListMax = metrics.closeListMax.load(std::memory_order_relaxed);
+            if (closeListMax > snapshot.closeListMax)
+                snapshot.closeListMax = closeListMax;
+
+            for (int type = BUFFER_TYPE_READ; type <= BUFFER_TYPE_CHUNK; type++)
+            {
+                snapshot.freeBuffers[type] += metrics.freeBuffers[type].load(std::memory_order_relaxed);
+                snapshot.totalBuffers[type] += metrics.totalBuffers[type].load(std::memory_order_relaxed);
+            }
+        }
+
+        SockTaskPool *pools = workerPool.load(std::memory_order_acquire);
+        if (pools)
+        {
+            for (unsigned int i = 0; i < workerPoolNum; i++)
+            {
+                snapshot.queued += pools[i].queued();
+                snapshot.steals += pools[i].steals();
+            }
+        }
+
+        SPMetrics::Collect(&snapshot.queueWait, &snapshot.callback);
+        return snapshot;
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    std::string SPSockTcp<address_family>::DumpMetrics()
+    {
+        static const char *buffers[3] = {"read", "write", "chunk"};
+
+        SPTcpMetrics metrics = GetMetrics();
+        std::ostringstream out;
+
+        const std::pair<const char *, unsigned long long> counters[] = {
+            {"epoll_waits", metrics.waits},
+            {"events", metrics.events},
+            {"accepted", metrics.accepted},
+            {"connected", metrics.connected},
+            {"adopted", metrics.adopted},
+            {"closed", metrics.closed},
+            {"inline_calls", metrics.inlineCalls},
+            {"pooled_calls", metrics.pooledCalls},
+            {"submit_failures", metrics.submitFailures},
+            {"close_listed", metrics.closeListed},
+            {"steals", metrics.steals},
+        };
+
+        for (auto &counter : counters)
+        {
+            out << "# TYPE spsock_tcp_" << counter.first << "_total counter\n";
+            out << "spsock_tcp_" << counter.first << "_total " << counter.second << "\n";
+        }
+
+        const std::pair<const char *, unsigned long long> gauges[] = {
+            {"close_list_max", metrics.closeListMax},
+            {"queued_tasks", metrics.queued},
+            {"connections", metrics.connections},
+        };
+
+        for (auto &gauge : gauges)
+        {
+            out << "# TYPE spsock_tcp_" << gauge.first << " gauge\n";
+            out << "spsock_tcp_" << gauge.first << " " << gauge.second << "\n";
+        }
+
+        out << "# TYPE spsock_tcp_free_buffers gauge\n";
+        for (int type = 0; type < 3; type++)
+            out << "spsock_tcp_free_buffers{type=\"" << buffers[type] << "\"} " << metrics.freeBuffers[type] << "\n";
+
+        out << "# TYPE spsock_tcp_total_buffers gauge\n";
+        for (int type = 0; type < 3; type++)
+            out << "spsock_tcp_total_buffers{type=\"" << buffers[type] << "\"} " << metrics.totalBuffers[type] << "\n";
+
+        const std::pair<const char *, SPLatencyStats *> histograms[] = {
+            {"queue_wait_seconds", &metrics.queueWait},
+            {"callback_seconds", &metrics.callback},
+        };
+
+        for (auto &histogram : histograms)
+        {
+            const SPLatencyStats *stats = histogram.second;
+            unsigned long long cumulative = 0;
+
+            out << "# TYPE spsock_tcp_" << histogram.first << " histogram\n";
+
+            // Power-of-two boundaries keep the bucket set stable between scrapes
+            for (unsigned int i = 0; i < SPSOCK_METRICS_BUCKETS - 1; i++)
+            {
+                cumulative += stats->buckets[i];
+                if (i % 4 == 3)
+                    out << "spsock_tcp_" << histogram.first << "_bucket{le=\""
+                        << (SPMetrics::BucketBound(i) + 1) / 1e9 << "\"} " << cumulative << "\n";
+            }
+
+            out << "spsock_tcp_" << histogram.first << "_bucket{le=\"+Inf\"} " << stats->count << "\n";
+            out << "spsock_tcp_" << histogram.first << "_sum " << stats->sum / 1e9 << "\n";
+            out << "spsock_tcp_" << histogram.first << "_count " << stats->count << "\n";
+        }
+
+        return out.str();
+    }
+
     template <ADDRESS_FAMILY address_family>
     bool SPSockTcp<address_family>::SetSignalExit(int sg)
     {
@@ -813,61 +3404,256 @@ namespace HSLL
         {
             HSLL_LOGINFO_NOPREFIX(LOG_LEVEL_CRUCIAL, "")
             HSLL_LOGINFO(LOG_LEVEL_CRUCIAL, "Caught signal ", sg, ", exiting event loop");
-            SPSockUdp<address_family>::exitFlag.store(false, std::memory_order_release);
+            SetExitFlag();
         }
     }
 
     template <ADDRESS_FAMILY address_family>
-    void SPSockUdp<address_family>::MainEventLoop(int sockfd)
+    void SPSockUdp<address_family>::MainEventLoop(int epollfd)
     {
-        int maxSize = udpConfig.MAX_PAYLOAD_SIZE + 48;
+#if defined(UDP_GRO)
+        const unsigned int controlSize = CMSG_SPACE(sizeof(int));
+#else
+        const unsigned int controlSize = 0;
+#endif
+        const unsigned int batch = udpConfig.RECV_BATCH_SIZE ? udpConfig.RECV_BATCH_SIZE : SPSOCK_UDP_DEFAULT_BATCH;
+        const size_t slotSize = gro ? SPSOCK_UDP_GRO_BSIZE : udpConfig.MAX_PAYLOAD_SIZE + 48;
+
+        std::vector<char> buf(batch * slotSize);
+        std::vector<char> control(batch * controlSize);
+        std::vector<mmsghdr> msgs(batch);
+        std::vector<iovec> vecs(batch);
+        std::vector<typename SOCKADDR_IN<address_family>::TYPE> addrs(batch);
+        std::vector<SPUdpDatagram> datagrams(batch);
+
+        UtilTaskUdp utilTask;
+        if (workers)
+        {
+            utilTask.workers = workers;
+            utilTask.batch = batch;
+            utilTask.bsize = udpConfig.MAX_PAYLOAD_SIZE + 48;
+            utilTask.pools = pools;
+            utilTask.buffers = &buffers;
+            utilTask.dispatched = &dispatched;
+            utilTask.dropped = &dropped;
+
+            if (!utilTask.init())
+            {
+                HSLL_LOGINFO(LOG_LEVEL_ERROR, "Insufficient memory space");
+                return;
+            }
+        }
 
-        char *buf = new (std::nothrow) char[maxSize];
-        if (!buf)
+        for (unsigned int i = 0; i < batch; i++)
         {
-            throw std::bad_alloc();
-            return;
+            vecs[i].iov_base = buf.data() + i * slotSize;
+            vecs[i].iov_len = slotSize;
+            msgs[i].msg_hdr = {};
+            msgs[i].msg_hdr.msg_iov = &vecs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            msgs[i].msg_hdr.msg_name = &addrs[i];
         }
 
-        typename SOCKADDR_IN<address_family>::TYPE addr;
-        socklen_t addrlen = sizeof(addr);
+        epoll_event events[SPSOCK_UDP_MAX_EVENTS];
 
         while (exitFlag.load(std::memory_order_acquire))
         {
-            ssize_t bytes = recvfrom(sockfd, buf, maxSize, 0, (sockaddr *)&addr, &addrlen);
+            int nfds = epoll_wait(epollfd, events, SPSOCK_UDP_MAX_EVENTS, -1);
 
-            if (bytes == -1)
+            if (nfds == -1)
             {
-                if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)
+                if (errno == EINTR)
                     continue;
 
-                delete[] buf;
+                HSLL_LOGINFO(LOG_LEVEL_ERROR, "epoll_wait() failed: ", strerror(errno));
                 return;
             }
 
-            char ip[INET6_ADDRSTRLEN];
-            unsigned short port = 0;
-
-            if constexpr (address_family == ADDRESS_FAMILY_INET)
+            for (int j = 0; j < nfds; j++)
             {
-                inet_ntop(AF_INET, &addr.sin_addr, ip, INET6_ADDRSTRLEN);
-                port = ntohs(addr.sin_port);
+                int sockfd = events[j].data.fd;
+                if (sockfd == exitfd)
+                    return;
+
+                for (unsigned int i = 0; i < batch; i++)
+                {
+                    msgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+                    msgs[i].msg_hdr.msg_control = gro ? control.data() + i * controlSize : nullptr;
+                    msgs[i].msg_hdr.msg_controllen = gro ? controlSize : 0;
+                }
+
+                int num = recvmmsg(sockfd, msgs.data(), batch, MSG_DONTWAIT, nullptr);
+
+                if (num == -1)
+                {
+                    if (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK)
+                        HSLL_LOGINFO(LOG_LEVEL_WARNING, "recvmmsg() failed: ", strerror(errno));
+
+                    continue;
+                }
+
+                unsigned int count = 0;
+
+                for (int i = 0; i < num; i++)
+                {
+                    const char *data = (const char *)vecs[i].iov_base;
+                    size_t size = msgs[i].msg_len;
+                    size_t segment = size;
+                    char ip[INET6_ADDRSTRLEN];
+                    SPPeerAddr peer;
+
+                    SOCKADDR_IN<address_family>::PEER(addrs[i], peer);
+                    if (rcp && !workers)
+                        SPFormatPeer(&peer, ip, sizeof(ip));
+
+#if defined(UDP_GRO)
+                    for (cmsghdr *cm = CMSG_FIRSTHDR(&msgs[i].msg_hdr); cm; cm = CMSG_NXTHDR(&msgs[i].msg_hdr, cm))
+                    {
+                        if (cm->cmsg_level == SOL_UDP && cm->cmsg_type == UDP_GRO)
+                        {
+                            int gso;
+                            memcpy(&gso, CMSG_DATA(cm), sizeof(gso));
+                            if (gso > 0)
+                                segment = gso;
+                        }
+                    }
+#endif
+
+                    size_t offset = 0;
+                    do
+                    {
+                        size_t len = (size - offset < segment) ? size - offset : segment;
+
+                        if (workers)
+                        {
+                            utilTask.append(HandleTask, this, sockfd, data + offset, len, peer);
+                        }
+                        else if (rcp)
+                        {
+                            rcp(ctx, sockfd, data + offset, len, ip, peer.port);
+                        }
+                        else if (rap)
+                        {
+                            rap(ctx, sockfd, data + offset, len, &peer);
+                        }
+                        else
+                        {
+                            datagrams[count++] = {data + offset, len, nullptr, 0, peer};
+
+                            if (count == batch)
+                            {
+                                rbp(ctx, sockfd, datagrams.data(), count);
+                                count = 0;
+                            }
+                        }
+
+                        offset += len;
+                    } while (offset < size);
+                }
+
+                if (count)
+                    rbp(ctx, sockfd, datagrams.data(), count);
+
+                if (workers)
+                    utilTask.commit();
             }
-            else
+        }
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    void SPSockUdp<address_family>::HandleTask(SockTaskUdp *task)
+    {
+        auto self = (SPSockUdp<address_family> *)task->owner;
+
+        if (self->rcp)
+        {
+            char ip[INET6_ADDRSTRLEN];
+            SPFormatPeer(&task->peer, ip, sizeof(ip));
+            self->rcp(self->ctx, task->fd, task->buf, task->size, ip, task->peer.port);
+        }
+        else if (self->rap)
+        {
+            self->rap(self->ctx, task->fd, task->buf, task->size, &task->peer);
+        }
+        else
+        {
+            SPUdpDatagram datagram{task->buf, task->size, nullptr, 0, task->peer};
+            self->rbp(self->ctx, task->fd, &datagram, 1);
+        }
+
+        self->buffers.push(task->buf);
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    bool SPSockUdp<address_family>::CreateWorkers()
+    {
+        if (udpConfig.THREADPOOL_THREADS == 0)
+            return true;
+
+        const unsigned int num = udpConfig.THREADPOOL_THREADS;
+        const unsigned int length = udpConfig.THREADPOOL_QUEUE_LENGTH ? udpConfig.THREADPOOL_QUEUE_LENGTH : 1024;
+        const unsigned int batch = udpConfig.RECV_BATCH_SIZE ? udpConfig.RECV_BATCH_SIZE : SPSOCK_UDP_DEFAULT_BATCH;
+        const unsigned int process = length < SPSOCK_UDP_PROCESS_BATCH ? length : SPSOCK_UDP_PROCESS_BATCH;
+        const size_t bsize = udpConfig.MAX_PAYLOAD_SIZE + 48;
+
+        // Buffers held by full queues, by batches being processed and by every loop's staging area
+        const size_t total = (size_t)num * (length + process) + (size_t)bound * num * batch;
+
+        if (!buffers.init(total) || (slab = (char *)malloc(total * bsize)) == nullptr)
+        {
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "Insufficient memory space");
+            return false;
+        }
+
+        for (size_t i = 0; i < total; i++)
+            buffers.push(slab + i * bsize);
+
+        if ((pools = new (std::nothrow) SockTaskPoolUdp[num]) == nullptr)
+        {
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "Insufficient memory space");
+            return false;
+        }
+
+        for (unsigned int i = 0; i < num; i++)
+        {
+            if (!pools[i].init(length, 1, process, i))
             {
-                inet_ntop(AF_INET6, &addr.sin6_addr, ip, INET6_ADDRSTRLEN);
-                port = ntohs(addr.sin6_port);
+                HSLL_LOGINFO(LOG_LEVEL_ERROR, "Failed to initialize thread pool: There is not enough memory space");
+                ExitWorkers();
+                return false;
             }
+        }
+
+        workers = num;
+        return true;
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    void SPSockUdp<address_family>::ExitWorkers()
+    {
+        if (pools)
+        {
+            for (unsigned int i = 0; i < udpConfig.THREADPOOL_THREADS; i++)
+                pools[i].exit();
 
-            rcp(ctx, sockfd, buf, bytes, ip, port);
+            delete[] pools;
+            pools = nullptr;
         }
 
-        delete[] buf;
-        return;
+        workers = 0;
+        free(slab);
+        slab = nullptr;
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    SPUdpOffloadStats SPSockUdp<address_family>::GetOffloadStats()
+    {
+        return {dispatched.load(std::memory_order_relaxed), dropped.load(std::memory_order_relaxed)};
     }
 
     template <ADDRESS_FAMILY address_family>
-    SPSockUdp<address_family>::SPSockUdp() : status(0) {}
+    SPSockUdp<address_family>::SPSockUdp() : ctx(nullptr), rcp(nullptr), rbp(nullptr), rap(nullptr), gro(false), status(0), bound(0),
+                                             workers(0), pools(nullptr), slab(nullptr), dispatched(0), dropped(0) {}
 
     template <ADDRESS_FAMILY address_family>
     SPSockUdp<address_family>::~SPSockUdp()
@@ -883,6 +3669,10 @@ namespace HSLL
     {
         assert(config.RECV_BSIZE >= 200 * 1024 && (config.RECV_BSIZE % 1024) == 0);
         assert(config.MAX_PAYLOAD_SIZE >= 1452 && config.MAX_PAYLOAD_SIZE <= 65507);
+        assert(config.RECV_BATCH_SIZE <= 1024);
+        assert(config.RECV_GRO == 0 || config.RECV_GRO == 1);
+        assert(config.THREADPOOL_QUEUE_LENGTH == 0 ||
+               config.THREADPOOL_QUEUE_LENGTH >= (config.RECV_BATCH_SIZE ? config.RECV_BATCH_SIZE : SPSOCK_UDP_DEFAULT_BATCH));
         minLevel = config.MIN_LOG_LEVEL;
         udpConfig = config;
     };
@@ -893,7 +3683,73 @@ namespace HSLL
         if (instance == nullptr)
             instance = new (std::nothrow) SPSockUdp;
 
-        return instance;
+        return instance;
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    int SPSockUdp<address_family>::CreateSocket(bool first)
+    {
+        int sockfd = socket(address_family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+
+        if (sockfd == -1)
+        {
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "socket() failed: ", strerror(errno));
+            return -1;
+        }
+
+        int opt = 1;
+        if (setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) == -1)
+        {
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "setsockopt(SO_REUSEADDR) failed: ", strerror(errno));
+            close(sockfd);
+            return -1;
+        }
+
+        if (setsockopt(sockfd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)))
+        {
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "setsockopt(SO_REUSEPORT) failed: ", strerror(errno));
+            close(sockfd);
+            return -1;
+        }
+
+        if (setsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, &udpConfig.RECV_BSIZE, sizeof(udpConfig.RECV_BSIZE)))
+        {
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "setsockopt(SO_RCVBUF) failed: ", strerror(errno));
+            close(sockfd);
+            return -1;
+        }
+
+#if defined(UDP_GRO)
+        if (udpConfig.RECV_GRO && (first || gro))
+        {
+            bool enabled = (setsockopt(sockfd, SOL_UDP, UDP_GRO, &opt, sizeof(opt)) == 0);
+
+            if (first)
+            {
+                gro = enabled;
+                if (!gro)
+                    HSLL_LOGINFO(LOG_LEVEL_WARNING, "setsockopt(UDP_GRO) failed, receiving without GRO: ", strerror(errno));
+            }
+            else if (!enabled)
+            {
+                HSLL_LOGINFO(LOG_LEVEL_ERROR, "setsockopt(UDP_GRO) failed: ", strerror(errno));
+                close(sockfd);
+                return -1;
+            }
+        }
+#else
+        if (udpConfig.RECV_GRO && first)
+            HSLL_LOGINFO(LOG_LEVEL_WARNING, "UDP_GRO is not supported by this build, receiving without GRO");
+#endif
+
+        if (bind(sockfd, (sockaddr *)&addr, sizeof(addr)) == -1)
+        {
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "bind() failed: ", strerror(errno));
+            close(sockfd);
+            return -1;
+        }
+
+        return sockfd;
     }
 
     template <ADDRESS_FAMILY address_family>
@@ -906,7 +3762,6 @@ namespace HSLL
         }
 
         using SOCKADDR = SOCKADDR_IN<address_family>;
-        typename SOCKADDR::TYPE addr;
 
         if (!SOCKADDR::INIT(addr, ip, port))
         {
@@ -923,64 +3778,97 @@ namespace HSLL
 
         for (unsigned int i = 0; i < hardware; ++i)
         {
-            int sockfd = socket(address_family, SOCK_DGRAM, 0);
-
+            int sockfd = CreateSocket(i == 0);
             if (sockfd == -1)
-            {
-                HSLL_LOGINFO(LOG_LEVEL_ERROR, "socket() failed: ", strerror(errno));
                 break;
-            }
 
-            int opt = 1;
-            if (setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) == -1)
-            {
-                HSLL_LOGINFO(LOG_LEVEL_ERROR, "setsockopt(SO_REUSEADDR) failed: ", strerror(errno));
-                close(sockfd);
-                break;
-            }
+            fds.push_back(sockfd);
+        }
 
-            if (setsockopt(sockfd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)))
-            {
-                HSLL_LOGINFO(LOG_LEVEL_ERROR, "setsockopt(SO_REUSEPORT) failed: ", strerror(errno));
-                close(sockfd);
-                break;
-            }
+        if (fds.size() != hardware)
+        {
+            for (auto fd : fds)
+                close(fd);
+
+            fds.clear();
+            return false;
+        }
+
+        bound = fds.size();
+        status |= 0x1;
+        return true;
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    bool SPSockUdp<address_family>::WatchSocket(int epollfd, int sockfd)
+    {
+        epoll_event event;
+        event.events = EPOLLIN;
+        event.data.fd = sockfd;
 
-            if (setsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, &udpConfig.RECV_BSIZE, sizeof(udpConfig.RECV_BSIZE)))
+        if (epoll_ctl(epollfd, EPOLL_CTL_ADD, sockfd, &event) != 0)
+        {
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "epoll_ctl(EPOLL_CTL_ADD) failed: ", strerror(errno));
+            return false;
+        }
+        return true;
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    bool SPSockUdp<address_family>::CreateEventLoops()
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+
+        if ((exitfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) == -1)
+        {
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "eventfd() failed: ", strerror(errno));
+            return false;
+        }
+
+        for (int i = 0; i < fds.size(); i++)
+        {
+            int epollfd = i < bound ? epoll_create1(EPOLL_CLOEXEC) : epollfds[i % bound];
+            if (epollfd == -1)
             {
-                HSLL_LOGINFO(LOG_LEVEL_ERROR, "setsockopt(SO_RCVBUF) failed: ", strerror(errno));
-                close(sockfd);
-                break;
+                HSLL_LOGINFO(LOG_LEVEL_ERROR, "epoll_create1() failed: ", strerror(errno));
+                ExitEventLoops();
+                return false;
             }
 
-            timeval tv{0, 50 * 1000};
-            if (setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)))
+            if (i < bound)
             {
-                HSLL_LOGINFO(LOG_LEVEL_ERROR, "setsockopt(SO_RCVTIMEO) failed: ", strerror(errno));
-                close(sockfd);
-                break;
+                epollfds.push_back(epollfd);
+                if (!WatchSocket(epollfd, exitfd))
+                {
+                    ExitEventLoops();
+                    return false;
+                }
             }
 
-            if (bind(sockfd, (sockaddr *)&addr, sizeof(addr)) == -1)
+            if (!WatchSocket(epollfd, fds[i]))
             {
-                HSLL_LOGINFO(LOG_LEVEL_ERROR, "bind() failed: ", strerror(errno));
-                close(sockfd);
-                break;
+                ExitEventLoops();
+                return false;
             }
-
-            fds.push_back(sockfd);
         }
 
-        if (fds.size() != hardware)
-        {
-            for (auto fd : fds)
-                close(fd);
+        status |= 0x8;
+        return true;
+    }
 
-            fds.clear();
-        }
+    template <ADDRESS_FAMILY address_family>
+    void SPSockUdp<address_family>::ExitEventLoops()
+    {
+        for (auto epollfd : epollfds)
+            close(epollfd);
 
-        status |= 0x1;
-        return true;
+        epollfds.clear();
+
+        if (exitfd != -1)
+        {
+            close(exitfd);
+            exitfd = -1;
+        }
     }
 
     template <ADDRESS_FAMILY address_family>
@@ -1007,17 +3895,35 @@ namespace HSLL
         if ((status & 0x4) != 0x4)
             HSLL_LOGINFO(LOG_LEVEL_WARNING, "Exit signal handler not configured");
 
+        if (!CreateWorkers())
+        {
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "CreateWorkers() failed");
+            ExitWorkers();
+            return false;
+        }
+
+        if (!CreateEventLoops())
+        {
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "CreateEventLoops() failed");
+            ExitWorkers();
+            return false;
+        }
+
         HSLL_LOGINFO(LOG_LEVEL_CRUCIAL, "Event loop started");
 
-        for (int i = 1; i < fds.size(); i++)
-            threads.emplace_back(std::thread{&SPSockUdp<address_family>::MainEventLoop, this, fds[i]});
+        for (int i = 1; i < epollfds.size(); i++)
+            threads.emplace_back(std::thread{&SPSockUdp<address_family>::MainEventLoop, this, epollfds[i]});
 
-        MainEventLoop(fds[0]);
+        MainEventLoop(epollfds[0]);
 
         for (auto &thread : threads)
             thread.join();
 
         threads.clear();
+        ExitWorkers();
+
+        std::lock_guard<std::mutex> lock(mtx);
+        ExitEventLoops();
 
         for (auto fd : fds)
             close(fd);
@@ -1075,6 +3981,250 @@ namespace HSLL
         return true;
     }
 
+    template <ADDRESS_FAMILY address_family>
+    bool SPSockUdp<address_family>::SendTo(int sockfd, const void *data, size_t size, const SPPeerAddr *peer)
+    {
+        if ((status & 0x1) != 0x1)
+        {
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "Bind() not called");
+            return false;
+        }
+
+        using SOCKADDR = SOCKADDR_IN<address_family>;
+        typename SOCKADDR::TYPE addr;
+
+        if (data == nullptr || peer == nullptr || size == 0 || peer->port == 0 || !SOCKADDR::INIT(addr, *peer))
+        {
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "Invalid parameter");
+            return false;
+        }
+
+        if (sendto(sockfd, data, size, 0, (sockaddr *)&addr, sizeof(addr)) != size)
+        {
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "sendto() failed: ", strerror(errno));
+            return false;
+        }
+        return true;
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    bool SPSockUdp<address_family>::Send(int sockfd, const void *data, size_t size)
+    {
+        if (data == nullptr || size == 0)
+        {
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "Invalid parameter");
+            return false;
+        }
+
+        if (send(sockfd, data, size, 0) != size)
+        {
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "send() failed: ", strerror(errno));
+            return false;
+        }
+        return true;
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    int SPSockUdp<address_family>::Connect(const SPPeerAddr *peer)
+    {
+        if ((status & 0x1) != 0x1)
+        {
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "Bind() not called");
+            return -1;
+        }
+
+        using SOCKADDR = SOCKADDR_IN<address_family>;
+        typename SOCKADDR::TYPE remote;
+
+        if (peer == nullptr || peer->port == 0 || !SOCKADDR::INIT(remote, *peer))
+        {
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "Invalid parameter");
+            return -1;
+        }
+
+        std::lock_guard<std::mutex> lock(mtx);
+
+        if (!exitFlag.load(std::memory_order_acquire))
+        {
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "Event loop is exiting");
+            return -1;
+        }
+
+        int sockfd = CreateSocket(false);
+        if (sockfd == -1)
+            return -1;
+
+        if (connect(sockfd, (sockaddr *)&remote, sizeof(remote)) == -1)
+        {
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "connect() failed: ", strerror(errno));
+            close(sockfd);
+            return -1;
+        }
+
+        if ((status & 0x8) && !WatchSocket(epollfds[fds.size() % bound], sockfd))
+        {
+            close(sockfd);
+            return -1;
+        }
+
+        fds.push_back(sockfd);
+
+        HSLL_LOGINFO(LOG_LEVEL_INFO, "Connected UDP socket to: ", *peer);
+        return sockfd;
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    int SPSockUdp<address_family>::SendToBatch(int sockfd, const SPUdpDatagram *datagrams, unsigned int num)
+    {
+        if ((status & 0x1) != 0x1)
+        {
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "Bind() not called");
+            return -1;
+        }
+
+        if (datagrams == nullptr)
+        {
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "Invalid parameter");
+            return -1;
+        }
+
+        using SOCKADDR = SOCKADDR_IN<address_family>;
+        typename SOCKADDR::TYPE addrs[SPSOCK_UDP_SEND_BATCH];
+        mmsghdr msgs[SPSOCK_UDP_SEND_BATCH];
+        iovec vecs[SPSOCK_UDP_SEND_BATCH];
+        unsigned int sent = 0;
+
+        while (sent < num)
+        {
+            unsigned int count = (num - sent > SPSOCK_UDP_SEND_BATCH) ? SPSOCK_UDP_SEND_BATCH : num - sent;
+
+            for (unsigned int i = 0; i < count; i++)
+            {
+                const SPUdpDatagram &datagram = datagrams[sent + i];
+
+                bool valid = datagram.ip ? (datagram.port != 0 && SOCKADDR::INIT(addrs[i], datagram.ip, datagram.port))
+                                         : (datagram.peer.port != 0 && SOCKADDR::INIT(addrs[i], datagram.peer));
+
+                if (datagram.data == nullptr || !valid)
+                {
+                    HSLL_LOGINFO(LOG_LEVEL_ERROR, "Invalid parameter");
+                    return sent ? sent : -1;
+                }
+
+                vecs[i].iov_base = (void *)datagram.data;
+                vecs[i].iov_len = datagram.size;
+                msgs[i].msg_hdr = {};
+                msgs[i].msg_hdr.msg_name = &addrs[i];
+                msgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+                msgs[i].msg_hdr.msg_iov = &vecs[i];
+                msgs[i].msg_hdr.msg_iovlen = 1;
+            }
+
+            int ret = sendmmsg(sockfd, msgs, count, 0);
+            if (ret == -1)
+            {
+                if (errno == EINTR)
+                    continue;
+
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                    return sent;
+
+                HSLL_LOGINFO(LOG_LEVEL_ERROR, "sendmmsg() failed: ", strerror(errno));
+                return sent ? sent : -1;
+            }
+
+            sent += ret;
+            if ((unsigned int)ret < count)
+                break;
+        }
+        return sent;
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    bool SPSockUdp<address_family>::SendToSegments(int sockfd, const void *data, size_t size, unsigned short segment,
+                                                   const char *ip, unsigned short port)
+    {
+        if ((status & 0x1) != 0x1)
+        {
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "Bind() not called");
+            return false;
+        }
+
+        if (data == nullptr || ip == nullptr || size == 0 || segment == 0 || port == 0)
+        {
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "Invalid parameter");
+            return false;
+        }
+
+        if (size <= segment)
+            return SendTo(sockfd, data, size, ip, port);
+
+#if defined(UDP_SEGMENT)
+        using SOCKADDR = SOCKADDR_IN<address_family>;
+        typename SOCKADDR::TYPE addr;
+
+        if (!SOCKADDR::INIT(addr, ip, port))
+        {
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "inet_pton() failed: invalid address");
+            return false;
+        }
+
+        if (size <= 65507 && (size + segment - 1) / segment <= 64)
+        {
+            char control[CMSG_SPACE(sizeof(uint16_t))] = {};
+            iovec vec{(void *)data, size};
+            msghdr msg = {};
+            msg.msg_name = &addr;
+            msg.msg_namelen = sizeof(addr);
+            msg.msg_iov = &vec;
+            msg.msg_iovlen = 1;
+            msg.msg_control = control;
+            msg.msg_controllen = sizeof(control);
+
+            cmsghdr *cm = CMSG_FIRSTHDR(&msg);
+            cm->cmsg_level = SOL_UDP;
+            cm->cmsg_type = UDP_SEGMENT;
+            cm->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+            uint16_t gso = segment;
+            memcpy(CMSG_DATA(cm), &gso, sizeof(gso));
+
+            ssize_t ret;
+            do
+            {
+                ret = sendmsg(sockfd, &msg, 0);
+            } while (ret == -1 && errno == EINTR);
+
+            if (ret == (ssize_t)size)
+                return true;
+
+            if (ret != -1 || (errno != EIO && errno != EINVAL && errno != ENOPROTOOPT && errno != EOPNOTSUPP))
+            {
+                HSLL_LOGINFO(LOG_LEVEL_ERROR, "sendmsg(UDP_SEGMENT) failed: ", strerror(errno));
+                return false;
+            }
+        }
+#endif
+
+        SPUdpDatagram datagrams[SPSOCK_UDP_SEND_BATCH];
+        size_t offset = 0;
+
+        while (offset < size)
+        {
+            unsigned int count = 0;
+
+            while (offset < size && count < SPSOCK_UDP_SEND_BATCH)
+            {
+                size_t len = (size - offset < segment) ? size - offset : segment;
+                datagrams[count++] = {(const char *)data + offset, len, ip, port};
+                offset += len;
+            }
+
+            if (SendToBatch(sockfd, datagrams, count) != (int)count)
+                return false;
+        }
+        return true;
+    }
+
     template <ADDRESS_FAMILY address_family>
     bool SPSockUdp<address_family>::SetSignalExit(int sg)
     {
@@ -1105,6 +4255,44 @@ namespace HSLL
 
         this->ctx = ctx;
         this->rcp = rcp;
+        this->rbp = nullptr;
+        this->rap = nullptr;
+        status |= 0x2;
+        HSLL_LOGINFO(LOG_LEVEL_INFO, "Callback configured successfully");
+        return true;
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    bool SPSockUdp<address_family>::SetCallback(RecvBatchProc rbp, void *ctx)
+    {
+        if (rbp == nullptr)
+        {
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "Invalid parameter: RecvBatchProc cannot be nullptr");
+            return false;
+        }
+
+        this->ctx = ctx;
+        this->rcp = nullptr;
+        this->rbp = rbp;
+        this->rap = nullptr;
+        status |= 0x2;
+        HSLL_LOGINFO(LOG_LEVEL_INFO, "Batch callback configured successfully");
+        return true;
+    }
+
+    template <ADDRESS_FAMILY address_family>
+    bool SPSockUdp<address_family>::SetCallback(RecvAddrProc rap, void *ctx)
+    {
+        if (rap == nullptr)
+        {
+            HSLL_LOGINFO(LOG_LEVEL_ERROR, "Invalid parameter: RecvAddrProc cannot be nullptr");
+            return false;
+        }
+
+        this->ctx = ctx;
+        this->rcp = nullptr;
+        this->rbp = nullptr;
+        this->rap = rap;
         status |= 0x2;
         HSLL_LOGINFO(LOG_LEVEL_INFO, "Callback configured successfully");
         return true;
@@ -1114,6 +4302,13 @@ namespace HSLL
     void SPSockUdp<address_family>::SetExitFlag()
     {
         exitFlag.store(false, std::memory_order_release);
+
+        if (exitfd != -1)
+        {
+            uint64_t value = 1;
+            ssize_t bytes = write(exitfd, &value, sizeof(value));
+            (void)bytes;
+        }
     }
 
     template <ADDRESS_FAMILY address_family>
@@ -1135,12 +4330,18 @@ namespace HSLL
     template <ADDRESS_FAMILY address_family>
     std::atomic<bool> SPSockUdp<address_family>::exitFlag = true;
 
+    template <ADDRESS_FAMILY address_family>
+    int SPSockUdp<address_family>::exitfd = -1;
+
     template <ADDRESS_FAMILY address_family>
     SPSockTcp<address_family> *SPSockTcp<address_family>::instance = nullptr;
 
     template <ADDRESS_FAMILY address_family>
     SPSockUdp<address_family> *SPSockUdp<address_family>::instance = nullptr;
 
+    template <ADDRESS_FAMILY address_family>
+    thread_local IOThreadInfo *SPSockTcp<address_family>::localLoop = nullptr;
+
     // Explicit template instantiation
     template class SPSockTcp<ADDRESS_FAMILY_INET>;
     template class SPSockTcp<ADDRESS_FAMILY_INET6>;
@@ -7,14 +7,57 @@
 #include <assert.h>
 #include <poll.h>
 #include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
 #include <netinet/tcp.h>
-#include <unordered_map>
+#include <netinet/udp.h>
+#include <deque>
 
 #include "SPLog.hpp"
 #include "SPDeferred.h"
+#include "SPUring.hpp"
+#include "SPTopology.hpp"
+#include "SPTls.hpp"
+#include "SPHandoff.hpp"
 
 namespace HSLL
 {
+/**
+ * @brief Upper bound of the fd-indexed connection slot table
+ * @details The table is sized to RLIMIT_NOFILE but never exceeds this many slots.
+ */
+#define SPSOCK_MAX_SLOT_NUM (1 << 20)
+
+/**
+ * @brief Maximum number of I/O vectors describing one frame passed to a FrameProc
+ */
+#define SPSOCK_MAX_FRAME_IOVEC 64
+
+/**
+ * @brief Datagrams received per recvmmsg call when RECV_BATCH_SIZE is 0
+ */
+#define SPSOCK_UDP_DEFAULT_BATCH 32
+
+/**
+ * @brief Receive slot size used when UDP_GRO coalescing is enabled
+ */
+#define SPSOCK_UDP_GRO_BSIZE 65536
+
+/**
+ * @brief Maximum datagrams handed to one sendmmsg call
+ */
+#define SPSOCK_UDP_SEND_BATCH 64
+
+/**
+ * @brief Maximum number of epoll events handled per UDP loop iteration
+ */
+#define SPSOCK_UDP_MAX_EVENTS 64
+
+/**
+ * @brief Offloaded datagrams a UDP worker takes from its queue at once
+ */
+#define SPSOCK_UDP_PROCESS_BATCH 32
+
     /**
      * @brief Template structure for socket address initialization
      * @tparam address_family IP version specification (IPv4/IPv6)
@@ -38,6 +81,21 @@ namespace HSLL
          * @return false if ip format incorrect
          */
         static bool INIT(sockaddr_in &address, const char *ip, unsigned short port);
+
+        /**
+         * @brief Initializes IPv4 socket address structure from a binary peer address
+         * @param address Reference to sockaddr_in structure to initialize
+         * @param peer Binary peer address
+         * @return false if the address family does not match
+         */
+        static bool INIT(sockaddr_in &address, const SPPeerAddr &peer);
+
+        /**
+         * @brief Extracts the binary peer address of an IPv4 socket address
+         * @param address Socket address filled by accept/recvmsg
+         * @param peer Binary peer address to fill
+         */
+        static void PEER(const sockaddr_in &address, SPPeerAddr &peer);
     };
 
     /**
@@ -56,6 +114,21 @@ namespace HSLL
          * @return false if ip format incorrect
          */
         static bool INIT(sockaddr_in6 &address, const char *ip, unsigned short port);
+
+        /**
+         * @brief Initializes IPv6 socket address structure from a binary peer address
+         * @param address Reference to sockaddr_in6 structure to initialize
+         * @param peer Binary peer address
+         * @return false if the address family does not match
+         */
+        static bool INIT(sockaddr_in6 &address, const SPPeerAddr &peer);
+
+        /**
+         * @brief Extracts the binary peer address of an IPv6 socket address
+         * @param address Socket address filled by accept/recvmsg
+         * @param peer Binary peer address to fill
+         */
+        static void PEER(const sockaddr_in6 &address, SPPeerAddr &peer);
     };
 
     /**
@@ -66,36 +139,88 @@ namespace HSLL
     class SPSockTcp : noncopyable
     {
     private:
-        int status;   ///< Internal state flags
-        int listenfd; ///< Listening socket descriptor
+        int status; ///< Internal state flags
+
+        SPListener listeners[SPSOCK_MAX_LISTENERS];          ///< Listening sockets with the settings of their connections
+        unsigned int listenerNum;                            ///< Number of listeners created by Listen()
+        SPListener connector;                                ///< Settings of outbound connections (copied by EventLoop())
 
-        linger lin;                                          ///< Linger options configuration
-        SPSockProc proc;                                     ///< User-defined callback functions
-        SPSockAlive alive;                                   ///< Keep-alive parameters
-        CloseList cList;                                     ///< Connections pending closure
+        linger lin;                                          ///< Linger options configuration (copied by Listen())
+        SPSockProc proc;                                     ///< User-defined callback functions (copied by Listen())
+        SPSockAlive alive;                                   ///< Keep-alive parameters (copied by Listen())
+        SPSockOffload offload;                               ///< Callbacks offloaded to the pool in inline dispatch (copied by Listen())
+        SPFrameConfig framer;                                ///< Message framing of the read callback (copied by Listen(), used when proc.frp is set)
         std::vector<std::thread> loops;                      ///< IO event loop threads
-        std::vector<IOThreadInfo> loopInfo;                  ///< IO thread metadata
-        std::unordered_map<int, SOCKController> connections; ///< Active connections map
+        std::deque<IOThreadInfo> loopInfo;                   ///< IO thread metadata (stable addresses)
+        unsigned int slotNum;                                ///< Capacity of the connection slot table
+        bool *slotUsed;                                      ///< Whether the controller slot of an fd is constructed
+        SOCKController *connections;                         ///< Active connections indexed by socket descriptor
+        SPTcpBufferPool acceptPool;                          ///< Buffer pool of the acceptor thread
+        SPTcpBufferPool *workerBuffers;                      ///< Buffer pools of the worker threads (one per worker)
+        std::atomic<SockTaskPool *> workerPool;              ///< Worker thread pools while the event loop runs
+        unsigned int workerPoolNum;                          ///< Number of worker thread pools (one per placement group)
+        std::vector<int> cpuNodes;                           ///< NUMA node of each CPU (used with NUMA_PLACEMENT)
+        SSL_CTX *tls;                                        ///< TLS context of later listeners (copied by Listen())
+        std::vector<SSL_CTX *> tlsContexts;                  ///< Contexts created by EnableTls(), freed with the instance
+        int handoffListen;                                   ///< Unix socket successors connect to (-1 without SetHandoff())
+        int successor;                                       ///< Connection to the successor holding the listeners (-1 for none)
+        int predecessor;                                     ///< Connection to the predecessor handing over connections (-1 for none)
+        std::string handoffPath;                             ///< Path of handoffListen, removed unless a successor took over
+        std::vector<int> inherited;                          ///< Listening sockets from TakeOver() not claimed by Listen()
 
-        static std::atomic<bool> exitFlag;          ///< Event loop termination control
-        static SPSockTcp<address_family> *instance; ///< Singleton instance pointer
+        static std::atomic<bool> exitFlag;            ///< Event loop termination control
+        static SPSockTcp<address_family> *instance;   ///< Singleton instance pointer
+        static thread_local IOThreadInfo *localLoop; ///< IO loop running on the calling thread
 
         /**
          * @brief Configures SO_LINGER socket option
          * @param fd Socket descriptor to configure
+         * @param lin Linger options of the accepting listener
          */
-        void SetLinger(int fd);
+        static void SetLinger(int fd, const linger &lin);
 
         /**
          * @brief Configures TCP keep-alive parameters
          * @param fd Socket descriptor to configure
+         * @param alive Keep-alive parameters of the accepting listener
+         */
+        static void SetKeepAlive(int fd, const SPSockAlive &alive);
+
+        /**
+         * @brief Copies the current callbacks and connection options into a listener
+         * @param listener Listener receiving the settings
+         */
+        void CaptureListener(SPListener &listener);
+
+        /**
+         * @brief Gets the listener an epoll event or io_uring tag refers to
+         * @param ptr Event data pointer
+         * @return Listener, nullptr if the pointer is not a listener
+         */
+        SPListener *ListenerOf(void *ptr);
+
+        /**
+         * @brief Checks whether any listener dispatches callbacks to the worker thread pool
+         */
+        bool UsesPool();
+
+        /**
+         * @brief Checks whether any listener has a timer callback
          */
-        void SetKeepAlive(int fd);
+        bool UsesTimers();
+
+        /**
+         * @brief Closes the SO_REUSEPORT listening sockets created for an IO thread
+         * @param info IO thread owning the sockets
+         * @note Sockets shared with the listeners themselves are left open
+         */
+        void CloseLoopListeners(IOThreadInfo &info);
 
         /**
          * @brief Initiates controlled connection closure
-         * @param controller Connection controller to schedule for closure
-         * @note Adds connection to thread-safe closure list
+         * @param controller Connection controller to close
+         * @note Closes immediately on the owning IO loop, otherwise pushes the
+         *       connection onto the loop's lock-free close list and wakes it
          */
         static void ActiveClose(SOCKController *controller);
 
@@ -114,18 +239,130 @@ namespace HSLL
          */
         static void HandleExit(int sg);
 
+        /**
+         * @brief Creates a socket bound to a listener's address
+         * @param flags Extra socket type flags (e.g., SOCK_NONBLOCK | SOCK_CLOEXEC)
+         * @param listener Listener providing the address
+         * @return Listening socket descriptor, -1 on error
+         */
+        int CreateListener(int flags, const SPListener &listener);
+
         /**
          * @brief Accepts new connections and initializes controllers
+         * @param listener Listener with a pending connection
          * @param idlefd Reserved file descriptor for EMFILE handling
          * @return true if connection processed successfully, false if critical error occurred
          */
-        bool HandleConnect(int idlefd);
+        bool HandleConnect(const SPListener *listener, int &idlefd);
+
+        /**
+         * @brief Picks the IO loop for a new connection
+         * @param node Preferred NUMA node (-1 for any)
+         * @return Least loaded loop on the node, or on any node if none runs there
+         */
+        IOThreadInfo *PickLoop(int node);
+
+        /**
+         * @brief Finds a socket received by TakeOver() bound to the address of a listener
+         * @param listener Listener whose address is set
+         * @return Listening descriptor removed from the inherited list, -1 if none matches
+         */
+        int ClaimInherited(const SPListener &listener);
+
+        /**
+         * @brief Sends the listening sockets to a successor connecting to the handoff socket
+         * @return true if they were handed off and the event loop is exiting
+         */
+        bool HandleHandoff();
+
+        /**
+         * @brief Receives one message from the predecessor and adopts the connection it carries
+         * @note Closes the predecessor connection after its last connection
+         */
+        void ReceiveHandoff();
+
+        /**
+         * @brief Creates a controller for a connection handed over by the predecessor
+         * @param fd Received socket descriptor
+         * @param unread Bytes the predecessor had read but not consumed
+         * @param len Length of unread
+         * @note Uses the listener bound to the local port of the connection
+         */
+        void AdoptConnection(int fd, const void *unread, unsigned int len);
+
+        /**
+         * @brief Sends the open connections to the successor after the event loop exited
+         * @note Connections handed off are closed locally, the rest are left to Cleanup()
+         */
+        void HandoffConnections();
+
+        /**
+         * @brief Runs the first read pass of a connection handed over by the predecessor
+         * @param controller Adopted controller, on its IO thread
+         * @param utilTask Task batch of the IO thread
+         */
+        void HandleAdopted(SOCKController *controller, UtilTaskTcp *utilTask);
+
+        /**
+         * @brief Drains the accept queue of an IO thread's SO_REUSEPORT listener
+         * @param info IO thread owning the listener
+         * @param listener Listener whose socket of this thread is readable
+         * @param idlefd Reserved file descriptor for EMFILE handling
+         * @note Accepts until EAGAIN, registering connections in the caller's epoll instance
+         */
+        void HandleAccept(IOThreadInfo *info, const SPListener *listener, int &idlefd);
+
+        /**
+         * @brief Advances the TLS handshake of a connection
+         * @param controller Connection whose session is not established yet
+         * @param utilTask Task batch of the IO thread
+         * @return false if the connection must be closed
+         * @note Once established the connection is handled as a write event, like a new outbound one
+         */
+        bool HandleHandshake(SOCKController *controller, UtilTaskTcp *utilTask);
 
         /**
-         * @brief Processes connections in close list
+         * @brief Starts waiting for the handshake of a connection queued by Connect()
+         * @param controller Connecting controller, on its IO thread
+         */
+        void StartConnect(SOCKController *controller);
+
+        /**
+         * @brief Completes an outbound connection once its socket is writable or failed
+         * @param controller Connecting controller
+         * @param failed Whether the wait reported an error or hang-up
+         * @param utilTask Task batch of the IO thread
+         */
+        void FinishConnect(SOCKController *controller, bool failed, UtilTaskTcp *utilTask);
+
+        /**
+         * @brief Creates a controller for an accepted socket and starts monitoring it
+         * @param fd Accepted non-blocking socket descriptor
+         * @param addr Peer address filled by accept
+         * @param info IO thread that will monitor the connection
+         * @param listener Listener that accepted the connection
+         * @param unread Unread bytes of a connection handed over by the predecessor (nullptr for accepted ones)
+         * @param len Length of unread
+         * @note Runs on the thread that accepted the socket, which is not the owning loop in
+         *       ACCEPT_MODE_MAIN. The controller is finished with before it is registered with
+         *       the loop and is only handed over through QueueArm() afterwards, since the loop
+         *       may close it and reuse the slot as soon as it sees the first event.
+         */
+        void AddConnection(int fd, typename SOCKADDR_IN<address_family>::TYPE &addr, IOThreadInfo *info,
+                           const SPListener *listener, const void *unread = nullptr, unsigned int len = 0);
+
+        /**
+         * @brief Processes connections in an IO loop's close list
+         * @param info IO thread owning the close list
          * @note Performs batch closure and resource cleanup
          */
-        void HandleCloseList();
+        void HandleCloseList(IOThreadInfo *info);
+
+        /**
+         * @brief Closes an established connection and updates its loop counter
+         * @param controller Connection controller to destroy
+         */
+        void HandleClose(SOCKController *controller);
 
         /**
          * @brief Processes read-ready events
@@ -143,12 +380,126 @@ namespace HSLL
          */
         bool HandleWrite(SOCKController *controller, UtilTaskTcp *utilTask);
 
+        /**
+         * @brief Holds a connection whose buffered data is below its read watermark
+         * @param controller Connection controller owned by the loop
+         * @return true if the data has been held for the connection's dispatch latency
+         * @note Starts the hold on the first call with buffered data
+         */
+        bool HoldExpired(SOCKController *controller);
+
+        /**
+         * @brief Processes read-ready events of a connection with a framer
+         * @param controller Connection controller with pending data
+         * @param utilTask Task dispatcher for worker threads
+         * @return true to keep connection alive, false to schedule closure
+         * @note Dispatches FrameTask() only once a complete frame is buffered
+         */
+        bool HandleFrames(SOCKController *controller, UtilTaskTcp *utilTask);
+
+        /**
+         * @brief Locates the first frame in the read buffer
+         * @param controller Connection controller owned by the caller
+         * @param offset Receives the payload offset in the read buffer
+         * @param len Receives the payload length
+         * @param total Receives the frame length including header or delimiter
+         * @return 1 if a complete frame is buffered, 0 if more data is needed, -1 for invalid or oversized frames
+         */
+        int ParseFrame(SOCKController *controller, unsigned int *offset, unsigned int *len, unsigned int *total);
+
+        /**
+         * @brief Delivers all complete frames of a connection to the frame callback
+         * @param controller Connection controller owned by the caller
+         * @note Consumes every delivered frame, flushes the write buffer and rearms the connection
+         */
+        static void FrameTask(SOCKController *controller);
+
+        /**
+         * @brief Runs a read/write callback according to the dispatch mode
+         * @param controller Connection controller the callback operates on
+         * @param func Read or write callback to run
+         * @param offloaded Whether the callback is kept on the worker thread pool
+         * @param utilTask Task submission utility of the calling IO loop
+         * @note Inline callbacks may close the connection, so the controller must not be touched afterwards
+         */
+        void Dispatch(SOCKController *controller, ReadWriteProc func, bool offloaded, UtilTaskTcp *utilTask);
+
+        /**
+         * @brief Publishes the buffer pool gauges of an IO loop to its metrics
+         * @param info IO thread running the calling loop
+         */
+        static void SampleGauges(IOThreadInfo *info);
+
+        /**
+         * @brief Binds the buffer pool of a worker thread
+         * @param pools Buffer pools of the workers of one thread pool
+         * @param index Index of the calling worker in its thread pool
+         * @note Runs on every worker before it takes tasks, so callbacks allocate without a lock
+         */
+        static void BindWorker(void *pools, unsigned int index);
+
+        /**
+         * @brief Pushes a connection onto its loop's rearm list
+         * @param controller Connection controller to queue
+         * @note Wakes the loop through its wake eventfd when called from another thread
+         */
+        static void QueueArm(SOCKController *controller);
+
+        /**
+         * @brief Releases a connection registered with EPOLLET after a callback
+         * @param controller Connection controller owned by the caller
+         * @param read Enable read events
+         * @param write Enable write events
+         * @return true on success, false if epoll_ctl failed
+         * @note Calls epoll_ctl only when the interest changes. Edges that arrived while the
+         *       connection was owned send it back to its loop instead of releasing it.
+         */
+        static bool EdgeRelease(SOCKController *controller, bool read, bool write);
+
+        /**
+         * @brief Processes the unconsumed edges of a connection owned by the loop
+         * @param controller Connection controller registered with EPOLLET
+         * @param utilTask Task dispatcher for worker threads
+         */
+        void HandleEdge(SOCKController *controller, UtilTaskTcp *utilTask);
+
+        /**
+         * @brief Processes connections sent back to an epoll loop by EnableEvent()
+         * @param info IO thread owning the rearm lists
+         * @param utilTask Task dispatcher for worker threads
+         */
+        void HandleArmList(IOThreadInfo *info, UtilTaskTcp *utilTask);
+
+        /**
+         * @brief Delivers an expired connection timer or dispatch latency
+         * @param controller Connection controller whose deadline passed
+         * @param flag EDGE_FLAG_TIMER or EDGE_FLAG_HOLD
+         * @param utilTask Task dispatcher for worker threads
+         * @note Takes ownership of the connection; if a callback owns it, the expiry is
+         *       delivered when that callback releases the connection
+         */
+        void HandleExpiry(SOCKController *controller, int flag, UtilTaskTcp *utilTask);
+
+        /**
+         * @brief Dispatches the timer or held read callback of a one-shot connection owned by the loop
+         * @param controller Connection controller with an undelivered expiry
+         * @param utilTask Task dispatcher for worker threads
+         */
+        void HandleDeferred(SOCKController *controller, UtilTaskTcp *utilTask);
+
         /**
          * @brief Closes connection and cleans resources
          * @param controller Connection controller to destroy
          */
         void CloseConnection(SOCKController *controller);
 
+        /**
+         * @brief Allocates the fd-indexed connection slot table
+         * @return true if allocation succeeded
+         * @note Slots are raw storage; controllers are constructed in place on accept
+         */
+        bool CreateConnectionTable();
+
         /**
          * @brief Calculates optimal IO/worker thread distribution
          * @param ioThreads Receives calculated IO thread count
@@ -157,19 +508,37 @@ namespace HSLL
          */
         bool CalculateOptimalThreadCounts(int *ioThreads, int *workerThreads);
 
+        /**
+         * @brief Plans the CPUs, NUMA nodes and worker pools of the IO loops and workers
+         * @param placement Receives the placement
+         * @return true if planning succeeded, false on error
+         * @note Without IO_CPU_LIST, WORKER_CPU_LIST and NUMA_PLACEMENT the thread counts of
+         *       CalculateOptimalThreadCounts are used with unpinned loops and a single pool
+         */
+        bool PlanPlacement(SPPlacement &placement);
+
+        /**
+         * @brief Gets the NUMA node of a CPU from the table built by PlanPlacement
+         * @param cpu CPU number
+         * @return Node number, 0 if unknown
+         */
+        int NodeOfCpu(unsigned int cpu);
+
         /**
          * @brief Initializes epoll instances and IO threads
-         * @param pool Worker thread pool reference
-         * @param num Number of IO threads to create
+         * @param pools Worker thread pools (indexed by placement group)
+         * @param placement CPU, node and group of each IO thread to create
          * @return true if all resources initialized successfully
          */
-        bool CreateIOEventLoop(ThreadPool<SockTaskTcp> *pool, int num);
+        bool CreateIOEventLoop(SockTaskPool *pools, const SPPlacement &placement);
 
         /**
          * @brief Make the io thread exit and close the corresponding file descriptor
-         * @return true if exited normally
+         * @param pools Worker thread pools, stopped once no loop can submit to them anymore
+         * @param num Number of worker thread pools
+         * @note Descriptors are closed after the workers finished, as their callbacks may still rearm
          */
-        void ExitIOEventLoop();
+        void ExitIOEventLoop(SockTaskPool *pools, unsigned int num);
 
         /**
          * @brief Main acceptor thread event loop
@@ -181,14 +550,98 @@ namespace HSLL
         /**
          * @brief IO worker thread event processing loop
          * @param pool Worker thread pool reference
-         * @param epollfd Epoll instance descriptor
-         * @param exitfd Eventfd descriptor for shutdown signaling
+         * @param info IO thread metadata (epoll, exit and listening descriptors)
+         */
+        void IOEventLoop(SockTaskPool *pool, IOThreadInfo *info);
+
+        /**
+         * @brief Queues a rearm request for a connection owned by an io_uring loop
+         * @param controller Connection controller to rearm
+         * @param read Enable read events
+         * @param write Enable write events
+         * @return Always true; the loop applies the request after its current batch
+         */
+        static bool URingArm(SOCKController *controller, bool read, bool write);
+
+        /**
+         * @brief io_uring variant of the IO worker thread event loop
+         * @param pool Worker thread pool reference
+         * @param info IO thread metadata (ring, exit and listening descriptors)
+         * @note Batches accepts, receives and rearms into one io_uring_enter per iteration
+         */
+        void URingEventLoop(SockTaskPool *pool, IOThreadInfo *info);
+
+        /**
+         * @brief Applies the rearm requests queued on an io_uring loop
+         * @param info IO thread metadata
+         * @param utilTask Task submission utility of the loop
+         */
+        void URingHandleArm(IOThreadInfo *info, UtilTaskTcp *utilTask);
+
+        /**
+         * @brief Arms a connection for the events of its last rearm request
+         * @param controller Connection controller to arm
+         * @param utilTask Task submission utility of the loop
+         */
+        void URingRearm(SOCKController *controller, UtilTaskTcp *utilTask);
+
+        /**
+         * @brief Submits a multishot receive unless one is in flight or the connection is backlogged
+         * @param controller Connection controller to receive for
+         */
+        void URingRecv(SOCKController *controller);
+
+        /**
+         * @brief Dispatches the read callback if an armed connection has data, EOF or an error pending
+         * @param controller Connection controller to check
+         * @param utilTask Task submission utility of the loop
+         * @note The controller must not be touched afterwards: it may have been closed
+         */
+        void URingReady(SOCKController *controller, UtilTaskTcp *utilTask);
+
+        /**
+         * @brief Handles a multishot receive completion
+         */
+        void URingHandleRecv(SOCKController *controller, int res, unsigned int flags, UtilTaskTcp *utilTask);
+
+        /**
+         * @brief Handles a POLLOUT completion
+         */
+        void URingHandlePoll(SOCKController *controller, int res, UtilTaskTcp *utilTask);
+
+        /**
+         * @brief Handles a multishot accept completion
+         */
+        void URingHandleAccept(IOThreadInfo *info, SPListener *listener, int res, unsigned int flags, int &idlefd);
+
+        /**
+         * @brief Resubmits receives of connections that ran out of provided buffers
+         * @param info IO thread metadata
+         */
+        void URingHandleStarved(IOThreadInfo *info);
+
+        /**
+         * @brief Detaches a closing connection from its io_uring loop
+         * @param controller Connection controller being closed
+         * @return true if the descriptor can be released now, false if requests are still in flight
+         */
+        bool URingDetach(SOCKController *controller);
+
+        /**
+         * @brief Releases the slot and descriptor of a detached connection
+         * @param controller Connection controller whose last request completed
          */
-        void IOEventLoop(ThreadPool<SockTaskTcp> *pool, int epollfd, int exitfd);
+        void URingRelease(SOCKController *controller);
+
+        /**
+         * @brief Cancels all requests of an exiting io_uring loop and waits for them
+         * @param info IO thread metadata
+         */
+        void URingDrain(IOThreadInfo *info);
 
         /**
          * @brief Releases all network resources
-         * @note Closes sockets and clears connection maps
+         * @note Closes sockets and releases the connection slot table
          */
         void Cleanup();
 
@@ -208,7 +661,7 @@ namespace HSLL
          * @param config Configuration structure with tuning parameters
          * @note Must be called before instance creation
          */
-        static void Config(SPTcpConfig config = {16 * 1024, 32 * 1024, 16, 64, 5000, EPOLLIN, 10000, 10, 5, 0.6, LOG_LEVEL_WARNING});
+        static void Config(SPTcpConfig config = {16 * 1024, 32 * 1024, 16, 64, 5000, EPOLLIN, 10000, 10, 5, 0.6, LOG_LEVEL_WARNING, ACCEPT_MODE_MAIN, 0, 0, DISPATCH_MODE_POOL, IO_ENGINE_EPOLL, 0, TRIGGER_MODE_ONESHOT, nullptr, nullptr, 0, AFFINITY_MODE_NONE, 32, 0});
 
         /**
          * @brief Gets singleton instance reference
@@ -222,9 +675,53 @@ namespace HSLL
          * @param port Network port to bind
          * @param ip Null-terminated string representing IPv4/IPv6 address
          * @return true if listen succeeded, false on error
-         * @note One-time call during initialization
+         * @note May be called up to SPSOCK_MAX_LISTENERS times. Each listener keeps the callbacks,
+         *       keep-alive, linger, offload, framer and watermark settings made before its call;
+         *       the last one also takes settings made after it. All listeners share the IO loops,
+         *       worker thread pool and buffer pools.
+         */
+        bool Listen(unsigned short port, const char *ip = nullptr);
+
+        /**
+         * @brief Takes over the listening sockets and connections of a running predecessor
+         * @param path Unix socket path the predecessor passed to SetHandoff()
+         * @return true if the listening sockets were received
+         * @note Must be called before Listen(). Listen() then reuses the received socket bound to
+         *       the same address, so connections queued on it are not lost. Connections the
+         *       predecessor hands over while exiting are adopted by the event loop: they pass
+         *       through the connect callback of the listener with their port, and their unread
+         *       bytes are delivered to the first read callback.
+         */
+        bool TakeOver(const char *path);
+
+        /**
+         * @brief Hands the listening sockets and open connections to a successor on request
+         * @param path Unix socket path for TakeOver() ('@' prefix for the abstract namespace)
+         * @return true if the handoff socket was created
+         * @note Must be called before EventLoop(). Once a successor connects, its listeners are
+         *       sent and the event loop exits as if signalled, after the worker queues drained.
+         *       Open connections are then sent with their unread bytes, except TLS, connecting or
+         *       half-closed ones, those with unsent data and those of io_uring loops, which are
+         *       closed. The close callback runs for every connection in this process; for the
+         *       ones sent to the successor SOCKController::isHandedOff() returns true in it.
+         */
+        bool SetHandoff(const char *path);
+
+        /**
+         * @brief Opens an outbound connection monitored by one of the IO loops
+         * @param ip Null-terminated string representing IPv4/IPv6 address of the peer
+         * @param port Peer port
+         * @param ctx Context pointer of the connection (see SOCKController::getCtx())
+         * @param timeout Connect timeout in milliseconds (0 leaves it to the kernel's SYN retries)
+         * @return true if the attempt started, false on error
+         * @note Callable from any thread while EventLoop() runs; called on an IO thread (inline
+         *       callbacks) the connection stays on that thread, otherwise it goes to the least
+         *       loaded one. The connection uses the callbacks and options in effect when
+         *       EventLoop() started; once established it is handled as a write event (write
+         *       callback first when set). A failed or timed-out attempt runs the close callback,
+         *       where SOCKController::isConnected() returns false.
          */
-        bool Listen(unsigned short port, const char *ip = nullptr) SPSOCK_ONE_TIME_CALL;
+        bool Connect(const char *ip, unsigned short port, void *ctx = nullptr, unsigned int timeout = 0);
 
         /**
          * @brief Enters main event processing loop
@@ -233,6 +730,17 @@ namespace HSLL
          */
         bool EventLoop() SPSOCK_ONE_TIME_CALL;
 
+        /**
+         * @brief Enables TLS on the listeners created afterwards
+         * @param certFile PEM certificate chain file (nullptr makes later listeners plaintext again)
+         * @param keyFile PEM private key file
+         * @return true if the context was created, false on error or without TLS support
+         * @note Requires a build with SPSOCK_TLS (OpenSSL), the epoll engine and a READ_BSIZE of at
+         *       least 16KB. Callbacks see plaintext through the usual read/write API. Ignores
+         *       SIGPIPE for the process, since OpenSSL writes to the socket without MSG_NOSIGNAL.
+         */
+        bool EnableTls(const char *certFile, const char *keyFile);
+
         /**
          * @brief Configures socket linger options
          * @param enable Enable/disable lingering
@@ -261,12 +769,70 @@ namespace HSLL
          */
         bool SetCallback(ConnectProc cnp = nullptr, CloseProc csp = nullptr, ReadProc rdp = nullptr, WriteProc wtp = nullptr);
 
+        /**
+         * @brief Registers a connection callback taking the binary peer address
+         * @param cnap New connection callback, called without formatting the address
+         * @return false if null callback, true otherwise
+         * @note Replaces the ConnectProc registered with SetCallback() (and vice versa)
+         */
+        bool SetConnectCallback(ConnectAddrProc cnap);
+
+        /**
+         * @brief Registers the callback of expired connection timers
+         * @param tmp Timer callback, dispatched like a read/write callback
+         * @return false if null callback, true otherwise
+         * @note Enables SOCKController::setTimer() on epoll event loops. Must be called before EventLoop().
+         */
+        bool SetTimerCallback(TimerProc tmp);
+
+        /**
+         * @brief Registers a framer replacing the read callback
+         * @param config Framing configuration (length-prefixed or delimiter-based)
+         * @param frp Callback invoked once per complete frame with I/O vectors pointing into the read buffer
+         * @return false if the configuration is invalid or the callback is null, true otherwise
+         * @note Frames are consumed after frp returns. frp must not call enableEvents() or close():
+         *       return false to close the connection. Buffered writes are flushed after the last frame.
+         */
+        bool SetFramer(const SPFrameConfig &config, FrameProc frp);
+
         /**
          * @brief Sets buffer thresholds for event triggering
          * @param readMark Minimum bytes to trigger read callback
          * @param writeMark Maximum buffered bytes to trigger write callback
+         * @param maxLatency Microseconds after which data below readMark is dispatched anyway (0 to wait)
+         * @note Defaults of connections accepted afterwards, see SOCKController::setWaterMark()
+         */
+        void SetWaterMark(unsigned int readMark = 0, unsigned int writeMark = 0xffffffff, unsigned int maxLatency = 0);
+
+        /**
+         * @brief Keeps selected callbacks on the worker thread pool in DISPATCH_MODE_INLINE
+         * @param read Submit read callbacks to the worker thread pool
+         * @param write Submit write callbacks to the worker thread pool
+         * @note Intended for slow or blocking handlers; ignored in DISPATCH_MODE_POOL
          */
-        void SetWaterMark(unsigned int readMark = 0, unsigned int writeMark = 0xffffffff);
+        void SetOffload(bool read = false, bool write = false);
+
+        /**
+         * @brief Enables timestamping of queue waits and callback durations
+         * @param enable Record the latency histograms reported by GetMetrics()
+         * @note Counters are always maintained; timing adds two TSC reads per callback.
+         *       The first call calibrates the TSC for about 10ms.
+         */
+        void EnableTimingMetrics(bool enable = true);
+
+        /**
+         * @brief Takes a snapshot of the event loop metrics
+         * @return Counters and gauges summed over all IO loops, latency histograms of all threads
+         * @note May be called from any thread (including callbacks) while EventLoop() runs
+         */
+        SPTcpMetrics GetMetrics();
+
+        /**
+         * @brief Formats a metrics snapshot in the Prometheus text exposition format
+         * @return Metrics named spsock_tcp_*, latencies as histograms in seconds
+         * @note Same calling rules as GetMetrics()
+         */
+        std::string DumpMetrics();
 
         /**
          * @brief Registers signal handler for graceful shutdown
@@ -298,10 +864,26 @@ namespace HSLL
     private:
         void *ctx;                        ///< User context for receive callback
         RecvProc rcp;                     ///< recv processor
+        RecvBatchProc rbp;                ///< Batched recv processor
+        RecvAddrProc rap;                 ///< recv processor taking the binary peer address
+        bool gro;                         ///< UDP_GRO enabled on the bound sockets
         unsigned int status;              ///< Internal state flags
+        unsigned int bound;               ///< Number of sockets created by Bind() (one loop each)
         std::vector<int> fds;             ///<  Bound socket descriptors
+        std::vector<int> epollfds;        ///< Epoll instance of each event loop
         std::vector<std::thread> threads; /// <Eventloop threads
+        std::mutex mtx;                   ///< Guards fds/epollfds against Connect() from callbacks
+
+        unsigned int workers;                      ///< Number of offload workers (0 = inline callbacks)
+        SockTaskPoolUdp *pools;                    ///< Single-worker pools, one per flow partition
+        SPSOCK_TASK_QUEUE<char *> buffers;         ///< Free pooled datagram buffers
+        char *slab;                                ///< Memory backing the pooled buffers
+        std::atomic<unsigned long long> dispatched; ///< Datagrams handed to a worker
+        std::atomic<unsigned long long> dropped;    ///< Datagrams dropped by the offload
 
+        typename SOCKADDR_IN<address_family>::TYPE addr; ///< Bound local address
+
+        static int exitfd;                          ///< Eventfd watched by every loop, written on exit
         static std::atomic<bool> exitFlag;          ///< Event loop control
         static SPSockUdp<address_family> *instance; ///< Singleton instance
 
@@ -315,6 +897,13 @@ namespace HSLL
          */
         ~SPSockUdp();
 
+        /**
+         * @brief Creates a socket bound to the local address with the configured options
+         * @param first Whether this is the first socket (probes optional features)
+         * @return Socket descriptor, -1 on error
+         */
+        int CreateSocket(bool first);
+
         /**
          * @brief Signal handler for shutdown requests
          * @param sg Received signal number
@@ -322,10 +911,47 @@ namespace HSLL
         static void HandleExit(int sg);
 
         /**
-         * @brief Enters datagram processing loop for a specific socket
-         * @param sockfd Socket descriptor to process events on
+         * @brief Registers a socket for read events on an event loop
+         * @param epollfd Epoll instance of the loop
+         * @param sockfd Socket descriptor to watch
+         * @return true on success, false on error
+         */
+        bool WatchSocket(int epollfd, int sockfd);
+
+        /**
+         * @brief Creates the exit eventfd and one epoll instance per bound socket
+         * @return true on success, false on error
+         * @note Sockets opened by Connect() are spread over the loops round robin
          */
-        void MainEventLoop(int sockfd);
+        bool CreateEventLoops();
+
+        /**
+         * @brief Closes the epoll instances and the exit eventfd
+         */
+        void ExitEventLoops();
+
+        /**
+         * @brief Starts the offload workers and the pooled datagram buffers
+         * @return true on success (or when offloading is disabled), false on error
+         */
+        bool CreateWorkers();
+
+        /**
+         * @brief Drains and stops the offload workers and releases the pooled buffers
+         */
+        void ExitWorkers();
+
+        /**
+         * @brief Delivers an offloaded datagram on a worker thread
+         * @param task Offloaded datagram
+         */
+        static void HandleTask(SockTaskUdp *task);
+
+        /**
+         * @brief Enters datagram processing loop until the exit eventfd fires
+         * @param epollfd Epoll instance watching the loop's sockets
+         */
+        void MainEventLoop(int epollfd);
 
     public:
         /**
@@ -333,7 +959,7 @@ namespace HSLL
          * @param config Configuration structure with tuning parameters
          * @note Must be called before instance creation
          */
-        static void Config(SPUdpConfig config = {4 * 1024 * 1024, 1452, LOG_LEVEL_WARNING});
+        static void Config(SPUdpConfig config = {4 * 1024 * 1024, 1452, LOG_LEVEL_WARNING, 0, 0, 0, 0});
 
         /**
          * @brief Gets singleton instance reference
@@ -368,6 +994,65 @@ namespace HSLL
          */
         bool SendTo(int sockfd, const void *data, size_t size, const char *ip, unsigned short port);
 
+        /**
+         * @brief Sends data to a pre-resolved destination
+         * @param sockfd Socket descriptor to use for sending
+         * @param data Pointer to data buffer to send
+         * @param size Size of data to send in bytes
+         * @param peer Destination from a receive callback or SPResolvePeer()
+         * @return true if send operation succeeded, false on error
+         */
+        bool SendTo(int sockfd, const void *data, size_t size, const SPPeerAddr *peer);
+
+        /**
+         * @brief Sends data on a socket returned by Connect()
+         * @param sockfd Connected socket descriptor
+         * @param data Pointer to data buffer to send
+         * @param size Size of data to send in bytes
+         * @return true if send operation succeeded, false on error
+         */
+        bool Send(int sockfd, const void *data, size_t size);
+
+        /**
+         * @brief Opens a connected socket on the bound port for a hot peer
+         * @param peer Remote endpoint the socket is connected to
+         * @return Socket descriptor, -1 on error
+         * @note The kernel skips the route lookup on sends and delivers the peer's datagrams
+         *       to this socket, which joins one of the event loops. The socket stays
+         *       open until the event loop exits. May be called from receive callbacks.
+         */
+        int Connect(const SPPeerAddr *peer);
+
+        /**
+         * @brief Gets the counters of the worker offload
+         * @return Dispatched and dropped datagram counts since the event loop started
+         * @note Drops happen when a worker queue or the buffer pool is exhausted (backpressure)
+         */
+        SPUdpOffloadStats GetOffloadStats();
+
+        /**
+         * @brief Sends a batch of datagrams with sendmmsg
+         * @param sockfd Socket descriptor to use for sending
+         * @param datagrams Datagrams to send, each with its own destination
+         * @param num Number of datagrams
+         * @return Number of datagrams sent (less than num if the socket buffer filled up), -1 on error
+         */
+        int SendToBatch(int sockfd, const SPUdpDatagram *datagrams, unsigned int num);
+
+        /**
+         * @brief Sends a buffer as consecutive datagrams of a fixed segment size
+         * @param sockfd Socket descriptor to use for sending
+         * @param data Buffer containing the payloads back to back
+         * @param size Buffer size in bytes (at most 64 segments and 65507 bytes with UDP_SEGMENT)
+         * @param segment Payload size of every datagram but the last
+         * @param ip Destination IP address
+         * @param port Destination port number
+         * @return true if all datagrams were sent, false on error
+         * @note Uses a single UDP_SEGMENT (GSO) send where supported, otherwise SendToBatch()
+         */
+        bool SendToSegments(int sockfd, const void *data, size_t size, unsigned short segment,
+                            const char *ip, unsigned short port);
+
         /**
          * @brief Registers signal handler for shutdown
          * @param sg Signal number to handle
@@ -383,6 +1068,24 @@ namespace HSLL
          */
         bool SetCallback(RecvProc rcp, void *ctx = nullptr);
 
+        /**
+         * @brief Registers batched receive callback
+         * @param rbp Handler receiving every datagram of a recvmmsg call at once
+         * @param ctx User context pointer (optional)
+         * @return false if null callback, true otherwise
+         * @note Replaces a callback registered with SetCallback(RecvProc)
+         */
+        bool SetCallback(RecvBatchProc rbp, void *ctx = nullptr);
+
+        /**
+         * @brief Registers receive callback taking the binary peer address
+         * @param rap Datagram receive handler, called without formatting the address
+         * @param ctx User context pointer (optional)
+         * @return false if null callback, true otherwise
+         * @note Replaces a callback registered with the other SetCallback() overloads
+         */
+        bool SetCallback(RecvAddrProc rap, void *ctx = nullptr);
+
         /**
          * @brief Signals event loop to terminate
          */
@@ -3,6 +3,7 @@
 
 #include "base/ThreadPool.hpp"
 #include "SPTypes.h"
+#include "SPMetrics.hpp"
 #include "noncopyable.h"
 
 using namespace HSLL::DEFER;
@@ -15,8 +16,9 @@ namespace HSLL
      */
     struct SockTaskTcp
     {
-        ReadWriteProc proc;  ///< Callback function for read/write operations
-        SOCKController *ctx; ///< Socket controller context containing connection state
+        ReadWriteProc proc;        ///< Callback function for read/write operations
+        SOCKController *ctx;       ///< Socket controller context containing connection state
+        unsigned long long queued; ///< Submission timestamp (0 while timing metrics are disabled)
 
     public:
         ~SockTaskTcp() = default;
@@ -27,7 +29,8 @@ namespace HSLL
          * @param ctx Pointer to socket controller context
          * @param proc Callback function to handle I/O operations
          */
-        SockTaskTcp(SOCKController *ctx, ReadWriteProc proc) : ctx(ctx), proc(proc) {};
+        SockTaskTcp(SOCKController *ctx, ReadWriteProc proc)
+            : ctx(ctx), proc(proc), queued(SPMetrics::Timing() ? SPMetrics::Ticks() : 0) {};
 
         /**
          * @brief Execute the registered callback function
@@ -35,7 +38,172 @@ namespace HSLL
          */
         void execute()
         {
+            if (!queued)
+            {
+                proc(ctx);
+                return;
+            }
+
+            unsigned long long start = SPMetrics::Ticks();
+            SPMetrics::Record(SPMETRICS_QUEUE_WAIT, queued, start);
             proc(ctx);
+            SPMetrics::Record(SPMETRICS_CALLBACK, start, SPMetrics::Ticks());
+        }
+    };
+
+/**
+ * @brief Queue type used by the worker pool of SPSockTcp
+ * @details Lock-free by default; define SPSOCK_BLOCKING_TASK_QUEUE to fall back to
+ *          the mutex/condition-variable TPBlockQueue.
+ */
+#if defined(SPSOCK_BLOCKING_TASK_QUEUE)
+#define SPSOCK_TASK_QUEUE TPBlockQueue
+#else
+#define SPSOCK_TASK_QUEUE TPLockFreeQueue
+#endif
+
+    /// Worker pool executing socket read/write callbacks
+    typedef ThreadPool<SockTaskTcp, SPSOCK_TASK_QUEUE> SockTaskPool;
+
+    struct SockTaskUdp;
+
+    /// Worker-side handler of an offloaded datagram (delivers it and recycles the buffer)
+    typedef void (*UdpTaskProc)(SockTaskUdp *task);
+
+    /**
+     * @brief Offloaded datagram task structure for the UDP worker pool
+     * @details The payload lives in a pooled buffer that the handler returns after delivery
+     */
+    struct SockTaskUdp
+    {
+        UdpTaskProc proc; ///< Handler executing the task
+        void *owner;      ///< Socket manager the datagram was received by
+        char *buf;        ///< Pooled buffer holding the payload
+        size_t size;      ///< Payload size in bytes
+        int fd;           ///< Socket the datagram was received on
+        SPPeerAddr peer;  ///< Sender address
+
+        /**
+         * @brief Execute the registered handler
+         */
+        void execute()
+        {
+            proc(this);
+        }
+    };
+
+    /// Single-worker pool serving one flow partition of the UDP offload
+    typedef ThreadPool<SockTaskUdp, SPSOCK_TASK_QUEUE> SockTaskPoolUdp;
+
+    /**
+     * @brief Per-loop batch submission utility of the UDP offload
+     * @details Datagrams are copied into pooled buffers and staged per worker, the worker being
+     *          chosen by hashing the sender address so every flow is processed in order.
+     *          Datagrams that find no free buffer or queue slot are dropped and counted.
+     */
+    struct UtilTaskUdp : noncopyable
+    {
+        unsigned int workers = 0;                          ///< Number of single-worker pools
+        unsigned int batch = 0;                            ///< Staged datagrams per worker before submission
+        size_t bsize = 0;                                  ///< Size of a pooled buffer
+        SockTaskPoolUdp *pools = nullptr;                  ///< Worker pools (one per flow partition)
+        SPSOCK_TASK_QUEUE<char *> *buffers = nullptr;      ///< Free pooled buffers
+        std::atomic<unsigned long long> *dispatched;       ///< Counter of submitted datagrams
+        std::atomic<unsigned long long> *dropped;          ///< Counter of dropped datagrams
+        SockTaskUdp *tasks = nullptr;                      ///< Staging storage (batch entries per worker)
+        unsigned int *sizes = nullptr;                     ///< Staged entries per worker
+
+        ~UtilTaskUdp()
+        {
+            delete[] tasks;
+            delete[] sizes;
+        }
+
+        /**
+         * @brief Allocate the staging storage
+         * @return true on success, false if out of memory
+         */
+        bool init()
+        {
+            tasks = new (std::nothrow) SockTaskUdp[workers * batch];
+            sizes = new (std::nothrow) unsigned int[workers]();
+            return tasks && sizes;
+        }
+
+        /**
+         * @brief Map a sender address to its worker
+         * @param peer Sender address
+         * @return Worker index
+         */
+        unsigned int partition(const SPPeerAddr &peer)
+        {
+            unsigned int len = (peer.family == ADDRESS_FAMILY_INET) ? 4 : 16;
+            unsigned int hash = 2166136261u ^ peer.port;
+
+            for (unsigned int i = 0; i < len; i++)
+                hash = (hash ^ peer.addr[i]) * 16777619u;
+
+            return hash % workers;
+        }
+
+        /**
+         * @brief Copy a datagram into a pooled buffer and stage it for its worker
+         * @param proc Worker-side handler
+         * @param owner Socket manager receiving the datagram
+         * @param fd Socket the datagram was received on
+         * @param data Payload
+         * @param size Payload size in bytes
+         * @param peer Sender address
+         */
+        void append(UdpTaskProc proc, void *owner, int fd, const char *data, size_t size, const SPPeerAddr &peer)
+        {
+            char *buf;
+            if (size > bsize || !buffers->pop(buf))
+            {
+                dropped->fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+
+            memcpy(buf, data, size);
+
+            unsigned int worker = partition(peer);
+            tasks[worker * batch + sizes[worker]++] = {proc, owner, buf, size, fd, peer};
+
+            if (sizes[worker] == batch)
+                commit(worker);
+        }
+
+        /**
+         * @brief Submit the datagrams staged for one worker
+         * @param worker Worker index
+         * @note Datagrams rejected by a full queue are dropped and their buffers recycled
+         */
+        void commit(unsigned int worker)
+        {
+            unsigned int num = sizes[worker];
+            if (num == 0)
+                return;
+
+            SockTaskUdp *staged = tasks + worker * batch;
+            unsigned int submitted = pools[worker].append_bulk(staged, num);
+
+            for (unsigned int i = submitted; i < num; i++)
+                buffers->push(staged[i].buf);
+
+            dispatched->fetch_add(submitted, std::memory_order_relaxed);
+            if (submitted != num)
+                dropped->fetch_add(num - submitted, std::memory_order_relaxed);
+
+            sizes[worker] = 0;
+        }
+
+        /**
+         * @brief Submit the datagrams staged for every worker
+         */
+        void commit()
+        {
+            for (unsigned int i = 0; i < workers; i++)
+                commit(i);
         }
     };
 
@@ -45,8 +213,9 @@ namespace HSLL
      */
     struct UtilTaskTcp_Single : noncopyable
     {
-        bool flag = true;              ///< Submission availability flag
-        ThreadPool<SockTaskTcp> *pool; ///< Associated thread pool instance
+        bool flag = true;                           ///< Submission availability flag
+        SockTaskPool *pool;                         ///< Associated thread pool instance
+        std::atomic<unsigned long long> *failures; ///< Counter of rejected submissions
 
         /**
          * @brief Add a new task to the thread pool
@@ -57,11 +226,16 @@ namespace HSLL
         void append(SOCKController *ctx, ReadWriteProc proc)
         {
             if (!flag)
+            {
+                SPMetrics::Add(*failures);
                 renableProc(ctx);
+                return;
+            }
 
             if (!pool->emplace(ctx,proc))
             {
                 flag = false;
+                SPMetrics::Add(*failures);
                 renableProc(ctx);
             }
         }
@@ -77,8 +251,9 @@ namespace HSLL
         unsigned int back = 0;         ///< Circular buffer tail position
         unsigned int front = 0;        ///< Circular buffer head position
         unsigned int size = 0;         ///< Current tasks in buffer
-        SockTaskTcp *tasks = nullptr;  ///< Circular buffer storage
-        ThreadPool<SockTaskTcp> *pool; ///< Associated thread pool instance
+        SockTaskTcp *tasks = nullptr;               ///< Circular buffer storage
+        SockTaskPool *pool;                         ///< Associated thread pool instance
+        std::atomic<unsigned long long> *failures; ///< Counter of rejected submissions
 
         ~UtilTaskTcp_Multipe()
         {
@@ -94,7 +269,11 @@ namespace HSLL
         void append(SOCKController *ctx, ReadWriteProc proc)
         {
             if (!flag)
+            {
+                SPMetrics::Add(*failures);
                 renableProc(ctx);
+                return;
+            }
 
             new (&tasks[front]) SockTaskTcp(ctx, proc);
 
@@ -129,7 +308,8 @@ namespace HSLL
 
             if (submitted != num)
             {
-                unsigned int remaining = num - submitted;
+                unsigned int remaining = size - submitted;
+                SPMetrics::Add(*failures, remaining);
                 for (unsigned int i = 0; i < remaining; ++i)
                 {
                     unsigned int index = (back + submitted + i) % tcpConfig.THREADPOOL_BATCH_SIZE_SUBMIT;
@@ -149,6 +329,116 @@ namespace HSLL
         }
     };
 
+    /**
+     * @brief Affine task submission utility with per-worker staging
+     * @details Tasks are staged for the worker selected by hashing the controller
+     *          (AFFINITY_MODE_CONNECTION) or by the IO loop (AFFINITY_MODE_LOOP), so the
+     *          callbacks of a connection keep running on the core holding its buffers.
+     */
+    struct UtilTaskTcp_Affine : noncopyable
+    {
+        bool flag = true;                           ///< Submission availability flag
+        unsigned int workers = 0;                   ///< Number of worker queues of the pool
+        unsigned int batch = 0;                     ///< Staged tasks per worker before submission
+        unsigned int loop = 0;                      ///< Index of the submitting IO loop
+        SockTaskTcp *tasks = nullptr;               ///< Staging storage (batch entries per worker)
+        unsigned int *sizes = nullptr;              ///< Staged entries per worker
+        SockTaskPool *pool;                         ///< Associated thread pool instance
+        std::atomic<unsigned long long> *failures; ///< Counter of rejected submissions
+
+        ~UtilTaskTcp_Affine()
+        {
+            delete[] tasks;
+            delete[] sizes;
+        }
+
+        /**
+         * @brief Allocate the staging storage
+         * @return true on success, false if out of memory
+         */
+        bool init()
+        {
+            workers = pool->threads();
+            if (workers == 0)
+                return true;
+
+            tasks = new (std::nothrow) SockTaskTcp[workers * batch];
+            sizes = new (std::nothrow) unsigned int[workers]();
+            return tasks && sizes;
+        }
+
+        /**
+         * @brief Map a connection to its worker
+         * @param ctx Socket controller context
+         * @return Worker index
+         * @note Controllers live in a table indexed by descriptor, so the hash spreads by fd
+         */
+        unsigned int partition(SOCKController *ctx)
+        {
+            if (tcpConfig.THREADPOOL_AFFINITY == AFFINITY_MODE_LOOP)
+                return loop % workers;
+
+            unsigned long long key = (unsigned long long)(uintptr_t)ctx;
+            return (unsigned int)((key * 0x9E3779B97F4A7C15ull) >> 32) % workers;
+        }
+
+        /**
+         * @brief Stage a task for its worker and submit the batch when full
+         * @param ctx Socket controller context
+         * @param proc Callback function
+         */
+        void append(SOCKController *ctx, ReadWriteProc proc)
+        {
+            if (!flag)
+            {
+                SPMetrics::Add(*failures);
+                renableProc(ctx);
+                return;
+            }
+
+            unsigned int worker = partition(ctx);
+            new (&tasks[worker * batch + sizes[worker]++]) SockTaskTcp(ctx, proc);
+
+            if (sizes[worker] == batch)
+                commit(worker);
+        }
+
+        /**
+         * @brief Submit the tasks staged for one worker
+         * @param worker Worker index
+         * @note Tasks rejected by a full queue are reactivated through renableProc()
+         */
+        void commit(unsigned int worker)
+        {
+            unsigned int num = sizes[worker];
+            if (num == 0)
+                return;
+
+            SockTaskTcp *staged = tasks + worker * batch;
+            unsigned int submitted = (num == 1) ? (pool->append_to(worker, staged[0]) ? 1 : 0)
+                                                : pool->append_bulk_to(worker, staged, num);
+
+            if (submitted != num)
+            {
+                SPMetrics::Add(*failures, num - submitted);
+                for (unsigned int i = submitted; i < num; i++)
+                    renableProc(staged[i].ctx);
+                flag = false;
+            }
+
+            sizes[worker] = 0;
+        }
+
+        /**
+         * @brief Submit the tasks staged for every worker
+         */
+        void commit()
+        {
+            for (unsigned int i = 0; i < workers; i++)
+                commit(i);
+        }
+    };
+
     /**
      * @brief Unified task submission interface
      * @details Automatically selects between single and batch submission modes
@@ -158,6 +448,7 @@ namespace HSLL
     {
         UtilTaskTcp_Single ts;  ///< Single task handler
         UtilTaskTcp_Multipe tm; ///< Batch task handler
+        UtilTaskTcp_Affine ta;  ///< Affine task handler (THREADPOOL_AFFINITY other than AFFINITY_MODE_NONE)
 
     public:
         UtilTaskTcp() = default;
@@ -165,17 +456,29 @@ namespace HSLL
         /**
          * @brief Initialize task submission system
          * @param pool Thread pool to use for task execution
+         * @param failures Counter of submissions rejected by a full queue
+         * @param loop Index of the submitting IO loop (selects the worker with AFFINITY_MODE_LOOP)
          * @note Allocates batch buffer if configured for bulk operations
          */
-        bool init(ThreadPool<SockTaskTcp> *pool)
+        bool init(SockTaskPool *pool, std::atomic<unsigned long long> *failures, unsigned int loop = 0)
         {
-            if (tcpConfig.THREADPOOL_BATCH_SIZE_SUBMIT == 1)
+            if (tcpConfig.THREADPOOL_AFFINITY != AFFINITY_MODE_NONE)
+            {
+                ta.pool = pool;
+                ta.failures = failures;
+                ta.batch = tcpConfig.THREADPOOL_BATCH_SIZE_SUBMIT;
+                ta.loop = loop;
+                return ta.init();
+            }
+            else if (tcpConfig.THREADPOOL_BATCH_SIZE_SUBMIT == 1)
             {
                 ts.pool = pool;
+                ts.failures = failures;
             }
             else
             {
                 tm.pool = pool;
+                tm.failures = failures;
                 tm.tasks = new (std::nothrow) SockTaskTcp[tcpConfig.THREADPOOL_BATCH_SIZE_SUBMIT];
                 if (tm.tasks == nullptr)
                     return false;
@@ -190,7 +493,9 @@ namespace HSLL
          */
         void append(SOCKController *ctx, ReadWriteProc proc)
         {
-            if (tcpConfig.THREADPOOL_BATCH_SIZE_SUBMIT == 1)
+            if (tcpConfig.THREADPOOL_AFFINITY != AFFINITY_MODE_NONE)
+                ta.append(ctx, proc);
+            else if (tcpConfig.THREADPOOL_BATCH_SIZE_SUBMIT == 1)
                 ts.append(ctx, proc);
             else
                 tm.append(ctx, proc);
@@ -202,7 +507,12 @@ namespace HSLL
          */
         void reset()
         {
-            if (tcpConfig.THREADPOOL_BATCH_SIZE_SUBMIT == 1)
+            if (tcpConfig.THREADPOOL_AFFINITY != AFFINITY_MODE_NONE)
+            {
+                ta.commit();
+                ta.flag = true;
+            }
+            else if (tcpConfig.THREADPOOL_BATCH_SIZE_SUBMIT == 1)
             {
                 ts.flag = true;
             }
@@ -0,0 +1,508 @@
+#ifndef HSLL_SPTIMER
+#define HSLL_SPTIMER
+
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+#include "SPController.h"
+#include "noncopyable.h"
+
+namespace HSLL
+{
+/**
+ * @brief Resolution of connection timers in milliseconds
+ */
+#define SPSOCK_TIMER_TICK 10
+
+/**
+ * @brief Number of slots of each timer wheel level (power of two)
+ * @details The inner level holds the timers due within one revolution of SPSOCK_TIMER_TICK slots,
+ *          the outer level the later ones in slots of one inner revolution (about 2.9 hours in
+ *          total). Timers further away than that stay in their outer slot for several rounds.
+ */
+#define SPSOCK_TIMER_WHEEL_SLOTS 1024
+
+/**
+ * @brief log2 of SPSOCK_TIMER_WHEEL_SLOTS
+ */
+#define SPSOCK_TIMER_WHEEL_BITS 10
+
+    /**
+     * @brief Hierarchical timer wheel of an epoll IO loop
+     * @details Armed connections are linked into the slot of their expiry tick through
+     *          intrusive links in SOCKController, so arming and cancelling are O(1). Outer
+     *          slots are moved into the inner level when the inner level reaches them, and
+     *          occupancy bitmaps let the loop sleep until the nearest non-empty slot.
+     *          The wheel itself is only touched by its loop thread; other threads store
+     *          the new expiry in the controller and push it onto a lock-free pending stack.
+     *          Expiries that only moved later are picked up lazily when the old slot is due.
+     */
+    class SPTimerWheel : noncopyable
+    {
+        static thread_local SPTimerWheel *local; ///< Wheel of the loop running on the calling thread
+
+        SOCKController *slots[2][SPSOCK_TIMER_WHEEL_SLOTS];          ///< Heads of the slot lists (inner, outer)
+        unsigned long long occupied[2][SPSOCK_TIMER_WHEEL_SLOTS / 64]; ///< Slots linked into since their bit was last cleared
+        unsigned long long tick;                         ///< Next tick to process
+        unsigned int count;                              ///< Connections linked into the wheel
+        int wakefd;                                      ///< Wake eventfd of the owning loop
+        std::atomic<SOCKController *> pending;           ///< Lock-free stack of connections armed by other threads
+        std::vector<SOCKController *> expired;           ///< Connections expired by the current advance()
+
+        /**
+         * @brief Links a connection into the slot of its current expiry
+         * @param controller Connection not linked into the wheel
+         */
+        void link(SOCKController *controller)
+        {
+            unsigned long long deadline = controller->timerDeadline.load(std::memory_order_seq_cst);
+            if (deadline == 0)
+                return;
+
+            if (count == 0)
+                tick = Now() / SPSOCK_TIMER_TICK;
+
+            unsigned long long when = deadline / SPSOCK_TIMER_TICK;
+            if (when < tick)
+                when = tick;
+
+            int level = 0;
+            if (when - tick >= SPSOCK_TIMER_WHEEL_SLOTS)
+            {
+                when >>= SPSOCK_TIMER_WHEEL_BITS;
+                level = 1;
+            }
+
+            unsigned int index = when & (SPSOCK_TIMER_WHEEL_SLOTS - 1);
+            occupied[level][index / 64] |= 1ULL << (index % 64);
+
+            SOCKController **head = &slots[level][index];
+            controller->timerNext = *head;
+            controller->timerPrev = head;
+            if (*head)
+                (*head)->timerPrev = &controller->timerNext;
+            *head = controller;
+
+            count++;
+            controller->timerScheduled.store(deadline, std::memory_order_seq_cst);
+        }
+
+        /**
+         * @brief Processes a connection whose slot is due
+         * @param controller Connection removed from its slot
+         * @param now Current time in milliseconds
+         */
+        void visit(SOCKController *controller, unsigned long long now)
+        {
+            unsigned long long deadline = controller->timerDeadline.load(std::memory_order_seq_cst);
+
+            while (deadline != 0 && deadline <= now)
+            {
+                if (controller->timerDeadline.compare_exchange_weak(deadline, 0, std::memory_order_seq_cst))
+                {
+                    expired.push_back(controller);
+                    break;
+                }
+            }
+
+            controller->timerScheduled.store(0, std::memory_order_seq_cst);
+            link(controller);
+        }
+
+        /**
+         * @brief Visits every connection of a slot
+         * @param head Slot list head
+         * @param now Current time in milliseconds
+         */
+        void empty(SOCKController **head, unsigned long long now)
+        {
+            SOCKController *controller = *head;
+            *head = nullptr;
+
+            while (controller)
+            {
+                SOCKController *next = controller->timerNext;
+                controller->timerPrev = nullptr;
+                controller->timerNext = nullptr;
+                count--;
+                visit(controller, now);
+                controller = next;
+            }
+        }
+
+        /**
+         * @brief Finds the nearest non-empty slot of a level
+         * @param level Wheel level (0 inner, 1 outer)
+         * @param start Slot index the search starts at
+         * @return Slots from start to the nearest non-empty one, -1 if the level is empty
+         * @note Clears the bits of slots emptied since they were set
+         */
+        int nearest(int level, unsigned int start)
+        {
+            unsigned long long *bits = occupied[level];
+            unsigned int distance = 0;
+
+            while (distance < SPSOCK_TIMER_WHEEL_SLOTS)
+            {
+                unsigned int index = (start + distance) & (SPSOCK_TIMER_WHEEL_SLOTS - 1);
+                unsigned long long word = bits[index / 64] >> (index % 64);
+
+                if (word == 0)
+                {
+                    distance += 64 - index % 64;
+                    continue;
+                }
+
+                unsigned int skip = __builtin_ctzll(word);
+                index += skip;
+                distance += skip;
+                if (distance >= SPSOCK_TIMER_WHEEL_SLOTS)
+                    break;
+
+                if (slots[level][index])
+                    return (int)distance;
+
+                bits[index / 64] &= ~(1ULL << (index % 64));
+                distance++;
+            }
+            return -1;
+        }
+
+    public:
+        /**
+         * @brief Constructor initializes an empty wheel
+         * @param wakefd Wake eventfd of the owning loop
+         */
+        SPTimerWheel(int wakefd) : slots{}, occupied{}, tick(0), count(0), wakefd(wakefd), pending(nullptr) {}
+
+        /**
+         * @brief Binds a wheel to the calling thread
+         * @param wheel Wheel of the loop running on this thread (nullptr to unbind)
+         */
+        static void Bind(SPTimerWheel *wheel)
+        {
+            local = wheel;
+        }
+
+        /**
+         * @brief Gets the monotonic clock in milliseconds
+         */
+        static unsigned long long Now()
+        {
+            timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            return (unsigned long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+        }
+
+        /**
+         * @brief Removes a connection from the wheel
+         * @param controller Connection controller (linked or not)
+         * @note Loop thread only
+         */
+        void unlink(SOCKController *controller)
+        {
+            if (controller->timerPrev == nullptr)
+                return;
+
+            *controller->timerPrev = controller->timerNext;
+            if (controller->timerNext)
+                controller->timerNext->timerPrev = controller->timerPrev;
+
+            controller->timerPrev = nullptr;
+            controller->timerNext = nullptr;
+            count--;
+            controller->timerScheduled.store(0, std::memory_order_seq_cst);
+        }
+
+        /**
+         * @brief Applies the expiry stored in a controller
+         * @param controller Connection controller owned by the caller
+         * @note Called after storing the new expiry (0 for cancel) in the controller. From other
+         *       threads only expiries earlier than the linked one are sent to the loop.
+         */
+        void update(SOCKController *controller)
+        {
+            if (local == this)
+            {
+                unlink(controller);
+                link(controller);
+                return;
+            }
+
+            unsigned long long deadline = controller->timerDeadline.load(std::memory_order_seq_cst);
+            unsigned long long scheduled = controller->timerScheduled.load(std::memory_order_seq_cst);
+
+            if (deadline == 0 || (scheduled != 0 && scheduled <= deadline))
+                return;
+
+            if (controller->timerQueued.exchange(true, std::memory_order_seq_cst))
+                return;
+
+            SOCKController *head = pending.load(std::memory_order_relaxed);
+            do
+            {
+                controller->timerWait = head;
+            } while (!pending.compare_exchange_weak(head, controller, std::memory_order_release,
+                                                    std::memory_order_relaxed));
+
+            if (head == nullptr)
+            {
+                uint64_t value = 1;
+                ssize_t bytes = ::write(wakefd, &value, sizeof(value));
+                (void)bytes;
+            }
+        }
+
+        /**
+         * @brief Links the connections armed by other threads
+         * @note Loop thread only
+         */
+        void drain()
+        {
+            SOCKController *controller = pending.exchange(nullptr, std::memory_order_acquire);
+
+            while (controller)
+            {
+                SOCKController *next = controller->timerWait;
+                controller->timerQueued.store(false, std::memory_order_seq_cst);
+                unlink(controller);
+                link(controller);
+                controller = next;
+            }
+        }
+
+        /**
+         * @brief Gets the epoll_wait timeout until the next due slot
+         * @return Milliseconds to wait, -1 if no timer is linked
+         * @note Loop thread only
+         */
+        int timeout()
+        {
+            if (count == 0)
+                return -1;
+
+            const unsigned long long mask = SPSOCK_TIMER_WHEEL_SLOTS - 1;
+            unsigned long long due = ~0ULL;
+
+            int distance = nearest(0, tick & mask);
+            if (distance >= 0)
+                due = tick + distance;
+
+            unsigned long long outer = (tick & mask) ? (tick >> SPSOCK_TIMER_WHEEL_BITS) + 1 : tick >> SPSOCK_TIMER_WHEEL_BITS;
+            distance = nearest(1, outer & mask);
+            if (distance >= 0 && ((outer + distance) << SPSOCK_TIMER_WHEEL_BITS) < due)
+                due = (outer + distance) << SPSOCK_TIMER_WHEEL_BITS;
+
+            if (due == ~0ULL)
+                return 0;
+
+            unsigned long long now = Now();
+            due = (due + 1) * SPSOCK_TIMER_TICK;
+            return (due > now) ? (int)(due - now) : 0;
+        }
+
+        /**
+         * @brief Processes all slots whose tick has elapsed
+         * @return Connections whose timer expired, valid until the next call
+         * @note Loop thread only. Expired timers are already disarmed and unlinked.
+         */
+        const std::vector<SOCKController *> &advance()
+        {
+            expired.clear();
+
+            if (count == 0)
+                return expired;
+
+            const unsigned long long mask = SPSOCK_TIMER_WHEEL_SLOTS - 1;
+            unsigned long long now = Now();
+            unsigned long long current = now / SPSOCK_TIMER_TICK;
+
+            while (tick < current)
+            {
+                if ((tick & mask) == 0)
+                    empty(&slots[1][(tick >> SPSOCK_TIMER_WHEEL_BITS) & mask], now);
+
+                // Skip empty inner slots, stopping at the next outer slot boundary
+                unsigned long long boundary = (tick | mask) + 1;
+                unsigned long long limit = boundary < current ? boundary : current;
+
+                int distance = nearest(0, tick & mask);
+                if (distance < 0 || tick + distance >= limit)
+                {
+                    tick = limit;
+                    continue;
+                }
+
+                // Timers relinked by the visit land in later slots
+                tick += distance + 1;
+                empty(&slots[0][(tick - 1) & mask], now);
+            }
+            return expired;
+        }
+    };
+
+    /**
+     * @brief Deadlines of the connections an epoll IO loop holds below their read watermark
+     * @details Binary min-heap of controllers keyed by SOCKController::holdDeadline. Each
+     *          controller stores its heap position, so releasing a hold that was dispatched
+     *          early or closed is O(log n) and the heap never refers to a reused slot.
+     * @note Loop thread only
+     */
+    class SPHoldQueue : noncopyable
+    {
+        std::vector<SOCKController *> heap; ///< Held connections ordered by deadline
+
+        /**
+         * @brief Stores a connection at a heap position
+         * @param index Heap position
+         * @param controller Held connection
+         */
+        void place(size_t index, SOCKController *controller)
+        {
+            heap[index] = controller;
+            controller->holdIndex = index + 1;
+        }
+
+        /**
+         * @brief Moves a connection towards the root until the heap order holds
+         * @param index Heap position of the connection
+         */
+        void siftUp(size_t index)
+        {
+            SOCKController *controller = heap[index];
+
+            while (index > 0)
+            {
+                size_t parent = (index - 1) / 2;
+                if (heap[parent]->holdDeadline <= controller->holdDeadline)
+                    break;
+
+                place(index, heap[parent]);
+                index = parent;
+            }
+            place(index, controller);
+        }
+
+        /**
+         * @brief Moves a connection towards the leaves until the heap order holds
+         * @param index Heap position of the connection
+         */
+        void siftDown(size_t index)
+        {
+            SOCKController *controller = heap[index];
+            size_t size = heap.size();
+
+            while (true)
+            {
+                size_t child = index * 2 + 1;
+                if (child >= size)
+                    break;
+
+                if (child + 1 < size && heap[child + 1]->holdDeadline < heap[child]->holdDeadline)
+                    child++;
+
+                if (controller->holdDeadline <= heap[child]->holdDeadline)
+                    break;
+
+                place(index, heap[child]);
+                index = child;
+            }
+            place(index, controller);
+        }
+
+        /**
+         * @brief Removes the connection at a heap position
+         * @param index Heap position
+         */
+        void remove(size_t index)
+        {
+            heap[index]->holdIndex = 0;
+
+            SOCKController *last = heap.back();
+            heap.pop_back();
+
+            if (index < heap.size())
+            {
+                place(index, last);
+                siftUp(index);
+                siftDown(last->holdIndex - 1);
+            }
+        }
+
+    public:
+        /**
+         * @brief Gets the monotonic clock in microseconds
+         */
+        static unsigned long long Now()
+        {
+            timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            return (unsigned long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+        }
+
+        /**
+         * @brief Checks whether no connection is queued
+         */
+        bool empty() const
+        {
+            return heap.empty();
+        }
+
+        /**
+         * @brief Starts holding a connection
+         * @param controller Connection not currently held
+         * @param deadline Monotonic time in microseconds at which the read callback is due
+         */
+        void hold(SOCKController *controller, unsigned long long deadline)
+        {
+            controller->holdDeadline = deadline;
+            heap.push_back(controller);
+            siftUp(heap.size() - 1);
+        }
+
+        /**
+         * @brief Stops holding a connection
+         * @param controller Connection controller (held or not)
+         */
+        void release(SOCKController *controller)
+        {
+            controller->holdDeadline = 0;
+
+            if (controller->holdIndex)
+                remove(controller->holdIndex - 1);
+        }
+
+        /**
+         * @brief Removes the earliest hold if it is due
+         * @param now Current time in microseconds
+         * @return Connection whose deadline passed, nullptr if none is due
+         * @note The connection keeps its deadline until it is released
+         */
+        SOCKController *expire(unsigned long long now)
+        {
+            if (heap.empty() || heap.front()->holdDeadline > now)
+                return nullptr;
+
+            SOCKController *controller = heap.front();
+            remove(0);
+            return controller;
+        }
+
+        /**
+         * @brief Gets the epoll_wait timeout until the earliest deadline
+         * @return Milliseconds to wait (rounded up), -1 if no connection is held
+         */
+        int timeout()
+        {
+            if (heap.empty())
+                return -1;
+
+            unsigned long long now = Now();
+            unsigned long long due = heap.front()->holdDeadline;
+            return (due > now) ? (int)((due - now + 999) / 1000) : 0;
+        }
+    };
+}
+
+#endif
@@ -0,0 +1,386 @@
+#ifndef HSLL_SPTLS
+#define HSLL_SPTLS
+
+/**
+ * @file SPTls.hpp
+ * @brief TLS sessions of TCP connections on top of OpenSSL
+ * @details Compiled only when SPSOCK_TLS is defined (link with -lssl -lcrypto). Sessions read
+ *          and write the connection socket directly, so records are decrypted straight into
+ *          the read buffer and encrypted from the write buffer. Kernel TLS is requested for
+ *          every context; after the handshake OpenSSL moves the session keys into the socket
+ *          ("tls" ULP) when the kernel and cipher allow it.
+ */
+#if defined(SPSOCK_TLS)
+
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <limits.h>
+#include <errno.h>
+
+/// Largest plaintext of one TLS record; a read needs this much room unless the session has pending data
+#define SPSOCK_TLS_RECORD_SIZE 16384
+
+namespace HSLL
+{
+    /**
+     * @brief Progress of a TLS read
+     */
+    enum TLS_READ_STATUS
+    {
+        TLS_READ_MORE,    ///< Stopped for lack of buffer room, the socket may hold more records
+        TLS_READ_DRAINED, ///< The socket has no complete record left
+        TLS_READ_CLOSED   ///< The peer sent close_notify
+    };
+
+    /**
+     * @brief OpenSSL glue of TLS connections
+     * @note Stateless; every function operates on the session or context it is given
+     */
+    class SPTls
+    {
+        /**
+         * @brief Maps a failed SSL_write() to the socket write conventions
+         * @param ssl TLS session
+         * @param ret Value returned by SSL_write()
+         * @param blocked Set when the socket cannot take more data
+         * @return 0 if the write should be retried later, -1 on error (errno set)
+         */
+        static ssize_t WriteFailed(SSL *ssl, int ret, bool &blocked)
+        {
+            int err = SSL_get_error(ssl, ret);
+            if (err == SSL_ERROR_WANT_WRITE || err == SSL_ERROR_WANT_READ)
+            {
+                blocked = true;
+                return 0;
+            }
+
+            if (err != SSL_ERROR_SYSCALL || errno == 0)
+                errno = EPROTO;
+            return -1;
+        }
+
+    public:
+        /**
+         * @brief Creates a server context from PEM files
+         * @param certFile Certificate chain file
+         * @param keyFile Private key file
+         * @return Context, nullptr on error (see Error())
+         */
+        static SSL_CTX *CreateContext(const char *certFile, const char *keyFile)
+        {
+            ERR_clear_error();
+
+            SSL_CTX *ctx = SSL_CTX_new(TLS_server_method());
+            if (!ctx)
+                return nullptr;
+
+            SSL_CTX_set_min_proto_version(ctx, TLS1_2_VERSION);
+            SSL_CTX_set_mode(ctx, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER |
+                                      SSL_MODE_RELEASE_BUFFERS);
+#if defined(SSL_OP_IGNORE_UNEXPECTED_EOF)
+            SSL_CTX_set_options(ctx, SSL_OP_IGNORE_UNEXPECTED_EOF);
+#endif
+#if defined(SSL_OP_ENABLE_KTLS) && !defined(OPENSSL_NO_KTLS)
+            SSL_CTX_set_options(ctx, SSL_OP_ENABLE_KTLS);
+#endif
+
+            if (SSL_CTX_use_certificate_chain_file(ctx, certFile) != 1 ||
+                SSL_CTX_use_PrivateKey_file(ctx, keyFile, SSL_FILETYPE_PEM) != 1 ||
+                SSL_CTX_check_private_key(ctx) != 1)
+            {
+                SSL_CTX_free(ctx);
+                return nullptr;
+            }
+            return ctx;
+        }
+
+        /**
+         * @brief Releases a context
+         */
+        static void FreeContext(SSL_CTX *ctx)
+        {
+            SSL_CTX_free(ctx);
+        }
+
+        /**
+         * @brief Gets the description of the calling thread's last OpenSSL error
+         */
+        static const char *Error()
+        {
+            unsigned long err = ERR_peek_last_error();
+            return err ? ERR_reason_error_string(err) : "unknown error";
+        }
+
+        /**
+         * @brief Creates the server session of an accepted socket
+         * @param ctx Context of the accepting listener
+         * @param fd Non-blocking socket descriptor
+         * @return Session waiting for the client hello, nullptr on error
+         */
+        static SSL *Attach(SSL_CTX *ctx, int fd)
+        {
+            SSL *ssl = SSL_new(ctx);
+            if (!ssl)
+                return nullptr;
+
+            if (SSL_set_fd(ssl, fd) != 1)
+            {
+                SSL_free(ssl);
+                return nullptr;
+            }
+
+            SSL_set_accept_state(ssl);
+            return ssl;
+        }
+
+        /**
+         * @brief Sends close_notify without waiting for the peer and frees a session
+         * @param ssl TLS session
+         */
+        static void Detach(SSL *ssl)
+        {
+            if (SSL_is_init_finished(ssl))
+            {
+                ERR_clear_error();
+                SSL_shutdown(ssl);
+            }
+            SSL_free(ssl);
+            ERR_clear_error();
+        }
+
+        /**
+         * @brief Checks whether the handshake has completed
+         */
+        static bool Ready(SSL *ssl)
+        {
+            return SSL_is_init_finished(ssl);
+        }
+
+        /**
+         * @brief Advances the handshake
+         * @param ssl TLS session
+         * @return 1 when complete, 0 when waiting for input, 2 when waiting to send, -1 on failure
+         */
+        static int Handshake(SSL *ssl)
+        {
+            ERR_clear_error();
+
+            int ret = SSL_do_handshake(ssl);
+            if (ret == 1)
+                return 1;
+
+            int err = SSL_get_error(ssl, ret);
+            if (err == SSL_ERROR_WANT_READ)
+                return 0;
+
+            if (err == SSL_ERROR_WANT_WRITE)
+                return 2;
+
+            return -1;
+        }
+
+        /**
+         * @brief Checks whether the session sends through kernel TLS
+         */
+        static bool KernelSend(SSL *ssl)
+        {
+#if defined(SSL_OP_ENABLE_KTLS) && !defined(OPENSSL_NO_KTLS)
+            return BIO_get_ktls_send(SSL_get_wbio(ssl));
+#else
+            return false;
+#endif
+        }
+
+        /**
+         * @brief Checks whether the session receives through kernel TLS
+         */
+        static bool KernelRecv(SSL *ssl)
+        {
+#if defined(SSL_OP_ENABLE_KTLS) && !defined(OPENSSL_NO_KTLS)
+            return BIO_get_ktls_recv(SSL_get_rbio(ssl));
+#else
+            return false;
+#endif
+        }
+
+        /**
+         * @brief Checks whether decrypted data is waiting inside the session
+         */
+        static bool Pending(SSL *ssl)
+        {
+            return SSL_pending(ssl) > 0;
+        }
+
+        /**
+         * @brief Decrypts records into a vector of buffers
+         * @param ssl TLS session
+         * @param vec Destination buffers
+         * @param num Number of buffers
+         * @param room Free space of the whole destination, including space beyond vec
+         * @param status Receives why the read stopped
+         * @return Plaintext bytes stored, -1 on error if nothing was stored
+         * @note A record is only started with at least SPSOCK_TLS_RECORD_SIZE bytes of room,
+         *       so no plaintext is left behind in the session when reading stops for room
+         */
+        static ssize_t Readv(SSL *ssl, iovec *vec, unsigned int num, size_t room, TLS_READ_STATUS &status)
+        {
+            ssize_t total = 0;
+            status = TLS_READ_MORE;
+
+            for (unsigned int i = 0; i < num; i++)
+            {
+                char *base = (char *)vec[i].iov_base;
+                size_t left = vec[i].iov_len;
+
+                while (left)
+                {
+                    if (room < SPSOCK_TLS_RECORD_SIZE && SSL_pending(ssl) == 0)
+                        return total;
+
+                    ERR_clear_error();
+                    int ret = SSL_read(ssl, base, left > INT_MAX ? INT_MAX : (int)left);
+
+                    if (ret <= 0)
+                    {
+                        int err = SSL_get_error(ssl, ret);
+                        if (err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE)
+                        {
+                            status = TLS_READ_DRAINED;
+                            return total;
+                        }
+
+                        if (err == SSL_ERROR_ZERO_RETURN)
+                        {
+                            status = TLS_READ_CLOSED;
+                            return total;
+                        }
+
+                        if (err == SSL_ERROR_SYSCALL && errno == EINTR)
+                            continue;
+
+                        status = TLS_READ_DRAINED;
+                        return total ? total : -1;
+                    }
+
+                    base += ret;
+                    left -= ret;
+                    room -= ret;
+                    total += ret;
+                }
+            }
+            return total;
+        }
+
+        /**
+         * @brief Encrypts and sends data
+         * @param ssl TLS session
+         * @param buf Plaintext
+         * @param len Plaintext length
+         * @param blocked Set when the socket cannot take more data
+         * @return Plaintext bytes sent, -1 on error (errno set)
+         * @note After a short write the same bytes must be offered again first
+         */
+        static ssize_t Write(SSL *ssl, const void *buf, size_t len, bool &blocked)
+        {
+            size_t total = 0;
+
+            while (total < len)
+            {
+                size_t chunk = len - total;
+                ERR_clear_error();
+
+                int ret = SSL_write(ssl, (const char *)buf + total, chunk > INT_MAX ? INT_MAX : (int)chunk);
+                if (ret <= 0)
+                {
+                    ssize_t result = WriteFailed(ssl, ret, blocked);
+                    return (result < 0 && total == 0) ? -1 : (ssize_t)total;
+                }
+                total += ret;
+            }
+            return total;
+        }
+
+        /**
+         * @brief Encrypts and sends a vector of buffers
+         * @param ssl TLS session
+         * @param vec Plaintext buffers
+         * @param num Number of buffers
+         * @param blocked Set when the socket cannot take more data
+         * @return Plaintext bytes sent, -1 on error (errno set)
+         */
+        static ssize_t Writev(SSL *ssl, const iovec *vec, unsigned int num, bool &blocked)
+        {
+            ssize_t total = 0;
+
+            for (unsigned int i = 0; i < num; i++)
+            {
+                if (vec[i].iov_len == 0)
+                    continue;
+
+                bool stop = false;
+                ssize_t ret = Write(ssl, vec[i].iov_base, vec[i].iov_len, stop);
+
+                if (ret < 0)
+                    return total ? total : -1;
+
+                total += ret;
+                if (stop || (size_t)ret < vec[i].iov_len)
+                {
+                    blocked = true;
+                    break;
+                }
+            }
+            return total;
+        }
+
+        /**
+         * @brief Sends part of a file through the session
+         * @param ssl TLS session
+         * @param fd File descriptor
+         * @param offset File offset
+         * @param len Bytes to send
+         * @param blocked Set when the socket cannot take more data
+         * @return Bytes sent (0 without blocked at the end of the file), -1 on error (errno set)
+         * @note Uses SSL_sendfile() (kernel encryption, no copy) under kernel TLS, otherwise
+         *       encrypts record sized chunks read with pread()
+         */
+        static ssize_t SendFile(SSL *ssl, int fd, off_t offset, size_t len, bool &blocked)
+        {
+#if defined(SSL_OP_ENABLE_KTLS) && !defined(OPENSSL_NO_KTLS)
+            if (KernelSend(ssl))
+            {
+                ERR_clear_error();
+                ossl_ssize_t ret = SSL_sendfile(ssl, fd, offset, len, 0);
+                if (ret >= 0)
+                {
+                    if (ret > 0 && (size_t)ret < len)
+                        blocked = true;
+                    return ret;
+                }
+
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                {
+                    blocked = true;
+                    return 0;
+                }
+                return -1;
+            }
+#endif
+
+            char chunk[SPSOCK_TLS_RECORD_SIZE];
+            size_t size = len < sizeof(chunk) ? len : sizeof(chunk);
+
+            ssize_t bytes = pread(fd, chunk, size, offset);
+            if (bytes <= 0)
+                return bytes;
+
+            return Write(ssl, chunk, bytes, blocked);
+        }
+    };
+}
+
+#endif // SPSOCK_TLS
+
+#endif
@@ -0,0 +1,139 @@
+#ifndef HSLL_SPTOPOLOGY
+#define HSLL_SPTOPOLOGY
+
+#include <sched.h>
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+
+namespace HSLL
+{
+    /**
+     * @brief Thread placement of a TCP event loop
+     * @details Loops and workers are divided into groups; each group owns one worker thread pool
+     *          fed only by the loops of the group (one group per NUMA node with NUMA_PLACEMENT).
+     */
+    struct SPPlacement
+    {
+        std::vector<int> loopCpus;                        ///< CPU of each IO loop (-1 for unpinned)
+        std::vector<int> loopNodes;                       ///< NUMA node of each IO loop
+        std::vector<unsigned int> loopGroups;             ///< Group of each IO loop
+        std::vector<std::vector<unsigned int>> groupCpus; ///< Worker CPUs of each group (empty for legacy pinning)
+        std::vector<unsigned int> groupWorkers;           ///< Worker count of each group
+    };
+
+    /**
+     * @brief CPU and NUMA topology queries used for thread placement
+     * @note Reads sysfs, so nodes are unknown (all CPUs on node 0) where it is not mounted
+     */
+    class SPTopology
+    {
+    public:
+        /**
+         * @brief Parses a CPU list such as "0-3,8,10-11"
+         * @param list CPU list (comma separated numbers and ranges)
+         * @param cpus Receives the CPUs in ascending order without duplicates
+         * @return false if the list is malformed or empty
+         */
+        static bool ParseCpus(const char *list, std::vector<unsigned int> &cpus)
+        {
+            cpus.clear();
+
+            while (*list)
+            {
+                char *end;
+                unsigned long first = strtoul(list, &end, 10);
+                if (end == list || first >= CPU_SETSIZE)
+                    return false;
+
+                unsigned long last = first;
+                list = end;
+
+                if (*list == '-')
+                {
+                    last = strtoul(++list, &end, 10);
+                    if (end == list || last < first || last >= CPU_SETSIZE)
+                        return false;
+                    list = end;
+                }
+
+                for (unsigned long cpu = first; cpu <= last; cpu++)
+                    cpus.push_back((unsigned int)cpu);
+
+                if (*list == ',')
+                    list++;
+                else if (*list)
+                    return false;
+            }
+
+            std::sort(cpus.begin(), cpus.end());
+            cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+            return !cpus.empty();
+        }
+
+        /**
+         * @brief Checks whether an optional CPU list is well formed
+         * @param list CPU list (nullptr for none)
+         * @return true if the list is nullptr or parseable
+         */
+        static bool Valid(const char *list)
+        {
+            std::vector<unsigned int> cpus;
+            return !list || ParseCpus(list, cpus);
+        }
+
+        /**
+         * @brief Gets the CPUs the process may run on
+         * @param cpus Receives the CPUs in ascending order
+         * @return false if the affinity mask could not be read
+         */
+        static bool AllowedCpus(std::vector<unsigned int> &cpus)
+        {
+            cpu_set_t set;
+            cpus.clear();
+
+            if (sched_getaffinity(0, sizeof(set), &set) != 0)
+                return false;
+
+            for (unsigned int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+            {
+                if (CPU_ISSET(cpu, &set))
+                    cpus.push_back(cpu);
+            }
+            return !cpus.empty();
+        }
+
+        /**
+         * @brief Gets the NUMA node of a CPU
+         * @param cpu CPU number
+         * @return Node number, 0 if unknown
+         */
+        static int NodeOf(unsigned int cpu)
+        {
+            char path[64];
+            snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u", cpu);
+
+            DIR *dir = opendir(path);
+            if (!dir)
+                return 0;
+
+            int node = 0;
+            while (dirent *entry = readdir(dir))
+            {
+                if (strncmp(entry->d_name, "node", 4) == 0 && entry->d_name[4] >= '0' && entry->d_name[4] <= '9')
+                {
+                    node = atoi(entry->d_name + 4);
+                    break;
+                }
+            }
+
+            closedir(dir);
+            return node;
+        }
+    };
+}
+
+#endif
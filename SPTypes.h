@@ -1,15 +1,20 @@
 #ifndef HSLL_SPTYPES
 #define HSLL_SPTYPES
 
-#include <list>
 #include <mutex>
+#include <atomic>
 #include <string.h>
 #include <thread>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <sys/epoll.h>
 #include <sys/socket.h>
 #include <unordered_set>
 
+// OpenSSL session types, defined by <openssl/ssl.h> in SPSOCK_TLS builds
+typedef struct ssl_st SSL;
+typedef struct ssl_ctx_st SSL_CTX;
+
 namespace HSLL
 {
 /**
@@ -19,8 +24,20 @@ namespace HSLL
  */
 #define SPSOCK_ONE_TIME_CALL
 
+/**
+ * @brief Maximum number of listening sockets of one TCP event loop (Listen() calls)
+ */
+#define SPSOCK_MAX_LISTENERS 8
+
     // Forward declaration
     class SOCKController;
+    class SPTcpBufferPool;
+    class SPUring;
+    class SPTimerWheel;
+    class SPHoldQueue;
+    struct SPUdpDatagram;
+    struct SPPeerAddr;
+    struct SPListener;
 
     /// Callback function type for read events
     typedef void (*ReadProc)(SOCKController *controller);
@@ -30,10 +47,22 @@ namespace HSLL
     typedef void (*ReadWriteProc)(SOCKController *controller);
     ///< Connection callback type
     typedef void *(*ConnectProc)(const char *ip, unsigned short port);
+    /// Connection callback type receiving the binary peer address
+    typedef void *(*ConnectAddrProc)(const SPPeerAddr *peer);
     /// Callback function type for connection close events
     typedef void (*CloseProc)(SOCKController *controller);
+    /// Callback function type for expired connection timers
+    typedef void (*TimerProc)(SOCKController *controller);
+    /// Frame callback type (frame: payload in place in the read buffer; return false to close the connection)
+    typedef bool (*FrameProc)(SOCKController *controller, const iovec *frame, unsigned int num);
     ///< Recieve event callback type
     typedef void (*RecvProc)(void *ctx, int fd, const char *data, size_t size, const char *ip, unsigned short port);
+    /// Receive event callback type receiving the binary peer address
+    typedef void (*RecvAddrProc)(void *ctx, int fd, const char *data, size_t size, const SPPeerAddr *peer);
+    /// Batched datagram receive callback type (entries stay valid until the callback returns)
+    typedef void (*RecvBatchProc)(void *ctx, int fd, SPUdpDatagram *datagrams, unsigned int num);
+    /// Completion callback type for zero-copy sends (sent: whole payload handed to the kernel)
+    typedef void (*SendCompleteProc)(SOCKController *controller, void *arg, bool sent);
     /// Task processing function type for thread pool
     typedef void (*TaskProc)(SOCKController *ctx, ReadWriteProc proc);
     ///< Re-listen for the event function pointer
@@ -73,6 +102,61 @@ namespace HSLL
         LOG_LEVEL_NONE = 10,   ///< No messages
     };
 
+    /**
+     * @brief Enumeration for TCP connection acceptance strategies
+     */
+    enum ACCEPT_MODE
+    {
+        ACCEPT_MODE_MAIN = 0,     ///< Single acceptor thread polls one listening socket and distributes connections
+        ACCEPT_MODE_REUSEPORT = 1 ///< Every IO event loop accepts on its own SO_REUSEPORT listening socket
+    };
+
+    /**
+     * @brief Enumeration for TCP read/write callback dispatch strategies
+     */
+    enum DISPATCH_MODE
+    {
+        DISPATCH_MODE_POOL = 0,  ///< Read/write callbacks are submitted to the worker thread pool
+        DISPATCH_MODE_INLINE = 1 ///< Read/write callbacks run to completion on the IO event loop thread
+    };
+
+    /**
+     * @brief Enumeration for worker queue selection of pooled TCP callbacks
+     */
+    enum AFFINITY_MODE
+    {
+        AFFINITY_MODE_NONE = 0,       ///< Tasks are distributed round-robin over the worker queues
+        AFFINITY_MODE_CONNECTION = 1, ///< Tasks of a connection always go to the queue selected by hashing its controller
+        AFFINITY_MODE_LOOP = 2        ///< Tasks of an IO event loop always go to the queue selected by the loop
+    };
+
+    /**
+     * @brief Enumeration for TCP IO event engines
+     */
+    enum IO_ENGINE
+    {
+        IO_ENGINE_EPOLL = 0, ///< epoll readiness notifications (rearming according to TRIGGER_MODE)
+        IO_ENGINE_URING = 1  ///< io_uring multishot accept/receive (falls back to epoll if unavailable)
+    };
+
+    /**
+     * @brief Enumeration for epoll readiness trigger strategies
+     */
+    enum TRIGGER_MODE
+    {
+        TRIGGER_MODE_ONESHOT = 0, ///< Level-triggered EPOLLONESHOT, rearmed with epoll_ctl after every callback
+        TRIGGER_MODE_EDGE = 1     ///< Edge-triggered EPOLLET, rearmed with epoll_ctl only when the interest changes
+    };
+
+    /**
+     * @brief Enumeration for message framing strategies
+     */
+    enum FRAME_MODE
+    {
+        FRAME_MODE_LENGTH = 0,   ///< Frames start with a fixed-width length header
+        FRAME_MODE_DELIMITER = 1 ///< Frames end with a delimiter byte sequence
+    };
+
     /**
      * @brief Enumeration for buffer operation types
      */
@@ -80,6 +164,20 @@ namespace HSLL
     {
         BUFFER_TYPE_READ,  ///< Buffer used for incoming data operations
         BUFFER_TYPE_WRITE, ///< Buffer used for outgoing data operations
+        BUFFER_TYPE_CHUNK, ///< Chunk of a chained read/write buffer
+    };
+
+    /**
+     * @brief Edge-triggered readiness state of a connection (SOCKController::edgeState)
+     * @details Unconsumed edges keep their epoll event bits. One-shot epoll loops use the
+     *          ownership, timer and hold bits so that expiries never overlap a callback.
+     */
+    enum EDGE_FLAG
+    {
+        EDGE_FLAG_EVENTS = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLERR | EPOLLHUP, ///< Mask of unconsumed edges
+        EDGE_FLAG_OWNED = 0x10000,                                                ///< The loop or a callback owns the connection
+        EDGE_FLAG_TIMER = 0x20000,                                                ///< The connection timer expired and is not yet delivered
+        EDGE_FLAG_HOLD = 0x40000                                                  ///< Held read data reached its dispatch latency and is not yet delivered
     };
 
     /**
@@ -87,11 +185,14 @@ namespace HSLL
      * @details Used to manage event triggering in network I/O operations based on buffer occupancy levels.
      * @note Read events are triggered when the read buffer contains at least readMark bytes of data.
      * Write events are triggered when pending data in the write buffer falls below or equals writeMark.
+     * With maxLatency set, data held below readMark is dispatched anyway once it waited that long.
+     * These are the defaults of new connections, which may override them (SOCKController::setWaterMark()).
      */
     struct SPWaterMark
     {
-        unsigned int readMark;  ///< High watermark for read buffer (triggers when data >= this value)
-        unsigned int writeMark; ///< Low watermark for write buffer (triggers when pending data <= this value)
+        unsigned int readMark;   ///< High watermark for read buffer (triggers when data >= this value)
+        unsigned int writeMark;  ///< Low watermark for write buffer (triggers when pending data <= this value)
+        unsigned int maxLatency; ///< Microseconds held read data waits for readMark (0 waits indefinitely)
     };
 
     /**
@@ -99,10 +200,13 @@ namespace HSLL
      */
     struct SPSockProc
     {
-        ReadProc rdp;    ///< Callback for read events (data available to read)
-        WriteProc wtp;   ///< Callback for write events (ready to send data)
-        ConnectProc cnp; ///< Callback for new connections
-        CloseProc csp;   ///< Callback for connection closure events
+        ReadProc rdp;         ///< Callback for read events (data available to read)
+        WriteProc wtp;        ///< Callback for write events (ready to send data)
+        ConnectProc cnp;      ///< Callback for new connections
+        CloseProc csp;        ///< Callback for connection closure events
+        ConnectAddrProc cnap; ///< Callback for new connections taking the binary peer address
+        TimerProc tmp;        ///< Callback for expired connection timers
+        FrameProc frp;        ///< Callback for complete frames (replaces rdp when set)
     };
 
     /**
@@ -117,23 +221,61 @@ namespace HSLL
     };
 
     /**
-     * @brief Structure containing information for I/O event loop threads
+     * @brief Callbacks kept on the worker thread pool in DISPATCH_MODE_INLINE
      */
-    struct IOThreadInfo
+    struct SPSockOffload
+    {
+        bool read;  ///< Submit read callbacks to the worker thread pool
+        bool write; ///< Submit write callbacks to the worker thread pool
+    };
+
+    /**
+     * @brief Counters and gauges of one IO loop
+     * @details Aligned to a cache line of its own; every field has a single writer (the loop,
+     *          or the acceptor thread for accepted and adopted), so updates are plain relaxed stores.
+     */
+    struct alignas(64) SPLoopMetrics
     {
-        int count;   ///< Number of active connections being handled by this thread
-        int epollfd; ///< File descriptor for the epoll instance monitoring connections
-        int exitfd;  ///< Event file descriptor used for thread termination signaling
+        std::atomic<unsigned long long> waits{0};          ///< Returns of the loop's wait call
+        std::atomic<unsigned long long> events{0};         ///< Events or completions processed
+        std::atomic<unsigned long long> accepted{0};       ///< Connections accepted into the loop
+        std::atomic<unsigned long long> connected{0};      ///< Outbound connections established by the loop
+        std::atomic<unsigned long long> adopted{0};        ///< Connections handed over by the predecessor process
+        std::atomic<unsigned long long> closed{0};         ///< Connections closed by the loop
+        std::atomic<unsigned long long> inlineCalls{0};    ///< Callbacks run on the loop thread
+        std::atomic<unsigned long long> pooledCalls{0};    ///< Callbacks submitted to the worker thread pool
+        std::atomic<unsigned long long> submitFailures{0}; ///< Submissions rejected by a full pool queue
+        std::atomic<unsigned long long> closeListed{0};    ///< Connections taken from the close list
+        std::atomic<unsigned int> closeListMax{0};         ///< Longest close list drained at once
+        std::atomic<unsigned int> freeBuffers[3]{};        ///< Free buffers of the loop's pool
+        std::atomic<unsigned int> totalBuffers[3]{};       ///< Buffers carved from the loop's pool blocks
     };
 
     /**
-     * @brief Thread-safe connection close list
-     * @details Used to safely manage connection closures across multiple threads
+     * @brief Structure containing information for I/O event loop threads
      */
-    struct CloseList
+    struct IOThreadInfo
     {
-        std::mutex mtx;
-        std::list<SOCKController *> connections;
+        std::atomic<int> count; ///< Number of active connections being handled by this thread
+        int epollfd;            ///< File descriptor for the epoll instance monitoring connections
+        int exitfd;             ///< Event file descriptor used for thread termination signaling
+        int wakefd;             ///< Event file descriptor used to wake the loop for pending closes
+        int listenfd[SPSOCK_MAX_LISTENERS]; ///< SO_REUSEPORT listening sockets accepted by this thread, one per listener (-1 if unused)
+        int cpu;                ///< CPU the thread is pinned to (-1 if unpinned)
+        unsigned int id;        ///< Index of the loop (selects its worker queue with AFFINITY_MODE_LOOP)
+        int node;               ///< NUMA node of the thread's CPU (0 if unpinned)
+
+        SPTcpBufferPool *pool;                   ///< Buffer pool bound to this thread
+        std::atomic<SOCKController *> closeList; ///< Lock-free stack of connections closed by other threads
+
+        SPUring *ring;                         ///< io_uring instance of the loop (nullptr for epoll)
+        std::atomic<SOCKController *> armList; ///< Lock-free stack of connections rearmed by other threads
+        SOCKController *armLocal;              ///< Connections rearmed on the loop thread itself
+        SOCKController *starved;               ///< Connections waiting for free provided buffers (io_uring)
+        int closing;                           ///< Closed connections waiting for in-flight requests (io_uring)
+        SPTimerWheel *wheel;                   ///< Connection timers (nullptr for io_uring or without a timer callback)
+        SPHoldQueue *holds;                    ///< Connections held below their read watermark (nullptr for io_uring)
+        SPLoopMetrics metrics;                 ///< Counters of the loop
     };
 
     /**
@@ -174,6 +316,45 @@ namespace HSLL
 
         ///< Minimum log printing level (valid LOG_LEVEL enum values)
         LOG_LEVEL MIN_LOG_LEVEL;
+
+        ///< Connection acceptance strategy (valid ACCEPT_MODE enum values)
+        ACCEPT_MODE IO_ACCEPT_MODE;
+
+        ///< Maximum number of blocks of each type a single thread's buffer pool may hold (0 for unlimited, otherwise ≥ BUFFER_POOL_PEER_ALLOC_NUM)
+        int BUFFER_POOL_MAX_BLOCK_NUM;
+
+        ///< Chunk size of chained read/write buffers (0 for fixed ring buffers, otherwise a multiple of 1024 ≤ READ_BSIZE and WRITE_BSIZE)
+        unsigned int BUFFER_CHUNK_SIZE;
+
+        ///< Read/write callback dispatch strategy (valid DISPATCH_MODE enum values)
+        DISPATCH_MODE IO_DISPATCH_MODE;
+
+        ///< IO event engine of the event loops (valid IO_ENGINE enum values)
+        IO_ENGINE IO_EVENT_ENGINE;
+
+        ///< Provided receive buffers per io_uring event loop (0 for 256, otherwise a power of two ≤ 32768)
+        unsigned int URING_BUFFER_NUM;
+
+        ///< Readiness trigger strategy of the epoll engine (valid TRIGGER_MODE enum values)
+        TRIGGER_MODE IO_TRIGGER_MODE;
+
+        ///< CPUs the IO loops are pinned to, one loop per CPU, e.g. "0-3,8" (nullptr for unpinned loops sized by WORKER_THREAD_RATIO)
+        const char *IO_CPU_LIST;
+
+        ///< CPUs the worker threads are pinned to, one worker per CPU (nullptr for the allowed CPUs not used by IO loops)
+        const char *WORKER_CPU_LIST;
+
+        ///< NUMA-aware placement (0 = disable, 1 = one worker pool per node, connections steered to loops on the node of their SO_INCOMING_CPU)
+        int NUMA_PLACEMENT;
+
+        ///< Worker queue selection of pooled read/write callbacks (valid AFFINITY_MODE enum values)
+        AFFINITY_MODE THREADPOOL_AFFINITY;
+
+        ///< Tasks a worker queue must hold before idle workers steal from it (32 by default, 0 for THREADPOOL_BATCH_SIZE_PROCESS times the other workers, capped at the queue length)
+        unsigned int THREADPOOL_STEAL_THRESHOLD;
+
+        ///< Maximum microseconds idle IO loops and workers spin before sleeping, adapted to the arrival rate (0 by default, sleeping at once)
+        unsigned int BUSY_POLL_US;
     };
 
     /**
@@ -190,6 +371,169 @@ namespace HSLL
 
         ///< Minimum log printing level (valid LOG_LEVEL enum values)
         LOG_LEVEL MIN_LOG_LEVEL;
+
+        ///< Datagrams received per recvmmsg call (0 for 32, otherwise 1-1024)
+        unsigned int RECV_BATCH_SIZE;
+
+        ///< Receive UDP_GRO coalesced datagrams on kernels that support it (0 = disable, 1 = enable)
+        int RECV_GRO;
+
+        ///< Worker threads running the receive callback (0 = run it on the receiving thread)
+        unsigned int THREADPOOL_THREADS;
+
+        ///< Queued datagrams per worker when offloading (0 for 1024)
+        unsigned int THREADPOOL_QUEUE_LENGTH;
+    };
+
+    /**
+     * @brief Message framing configuration of SPSockTcp::SetFramer()
+     */
+    struct SPFrameConfig
+    {
+        ///< Framing strategy (valid FRAME_MODE enum values)
+        FRAME_MODE MODE;
+
+        ///< Length header width in bytes (FRAME_MODE_LENGTH: 1, 2, 4 or 8)
+        unsigned int HEADER_SIZE;
+
+        ///< Length header byte order (FRAME_MODE_LENGTH: true for big endian/network order)
+        bool HEADER_BIG_ENDIAN;
+
+        ///< Whether the length header value counts the header itself (FRAME_MODE_LENGTH)
+        bool LENGTH_INCLUDES_HEADER;
+
+        ///< Delimiter ending every frame (FRAME_MODE_DELIMITER)
+        char DELIMITER[8];
+
+        ///< Delimiter length in bytes (FRAME_MODE_DELIMITER: 1-8)
+        unsigned int DELIMITER_SIZE;
+
+        ///< Maximum frame size including header or delimiter (0 for READ_BSIZE, otherwise ≤ READ_BSIZE); larger frames close the connection
+        unsigned int MAX_FRAME_SIZE;
+    };
+
+    /**
+     * @brief Listening socket of the TCP event loop with the settings of its connections
+     * @details Listen() copies the current callbacks, keep-alive, linger, offload, framer and
+     *          watermark settings; the last listener copies them again when the event loop starts.
+     */
+    struct SPListener
+    {
+        int fd;                  ///< Listening socket descriptor
+        unsigned short port;     ///< Bound port
+        sockaddr_storage addr;   ///< Bound address
+        SPSockProc proc;         ///< Callbacks of accepted connections
+        SPSockAlive alive;       ///< Keep-alive parameters of accepted connections
+        linger lin;              ///< Linger options of accepted connections
+        SPSockOffload offload;   ///< Callbacks offloaded to the pool in inline dispatch
+        SPFrameConfig framer;    ///< Message framing (used when proc.frp is set)
+        SPWaterMark mark;        ///< Initial watermarks of accepted connections
+        SSL_CTX *tls;            ///< TLS context of accepted connections (nullptr for plaintext)
+    };
+
+    /**
+     * @brief Counters of datagrams offloaded to the UDP worker pool
+     */
+    struct SPUdpOffloadStats
+    {
+        unsigned long long dispatched; ///< Datagrams handed to a worker
+        unsigned long long dropped;    ///< Datagrams dropped because no buffer or queue slot was free
+    };
+
+/**
+ * @brief Number of buckets of a latency histogram
+ * @details Values below 16ns get one bucket each, larger values four buckets per power of two
+ *          (at most 25% relative error). The last bucket also counts everything above ~16 minutes.
+ */
+#define SPSOCK_METRICS_BUCKETS 160
+
+    /**
+     * @brief Latency histogram in nanoseconds
+     */
+    struct SPLatencyStats
+    {
+        unsigned long long count;                            ///< Number of samples
+        unsigned long long sum;                              ///< Sum of all samples
+        unsigned long long max;                              ///< Largest sample
+        unsigned long long buckets[SPSOCK_METRICS_BUCKETS]; ///< Samples per bucket, see SPMetricsBucketBound()
+    };
+
+    /**
+     * @brief Snapshot of the TCP event loop metrics
+     * @details Counters accumulate since the event loop started; gauges are sampled by
+     *          the IO loops after each wait and summed over all loops.
+     */
+    struct SPTcpMetrics
+    {
+        unsigned long long waits;          ///< Returns of epoll_wait()/io_uring_enter()
+        unsigned long long events;         ///< Events (or completions) processed
+        unsigned long long accepted;       ///< Connections accepted
+        unsigned long long connected;      ///< Outbound connections established (Connect())
+        unsigned long long adopted;        ///< Connections handed over by the predecessor (TakeOver())
+        unsigned long long closed;         ///< Connections closed
+        unsigned long long inlineCalls;    ///< Callbacks run on the IO loops
+        unsigned long long pooledCalls;    ///< Callbacks submitted to the worker thread pool
+        unsigned long long submitFailures; ///< Submissions rejected by a full pool queue (connection rearmed instead)
+        unsigned long long closeListed;    ///< Connections closed through a loop's close list
+        unsigned long long steals;         ///< Tasks stolen between worker queues
+        unsigned int closeListMax;         ///< Longest close list drained at once
+        unsigned int queued;               ///< Tasks waiting in the worker queues
+        unsigned int connections;          ///< Active connections
+        unsigned int freeBuffers[3];       ///< Free pooled buffers (read, write, chunk)
+        unsigned int totalBuffers[3];      ///< Buffers carved from live pool blocks (read, write, chunk)
+        SPLatencyStats queueWait;          ///< Time tasks spent in the worker queues (with timing enabled)
+        SPLatencyStats callback;           ///< Run time of read/write/timer callbacks (with timing enabled)
+    };
+
+    /**
+     * @brief Gets the largest value counted by a latency histogram bucket
+     * @param index Bucket index (below SPSOCK_METRICS_BUCKETS)
+     * @return Inclusive upper bound in nanoseconds (ULLONG_MAX for the last bucket)
+     */
+    unsigned long long SPMetricsBucketBound(unsigned int index);
+
+    /**
+     * @brief Binary peer address handed to callbacks in place of a formatted string
+     * @details Also serves as a pre-resolved destination for SPSockUdp::SendTo()/Connect()
+     */
+    struct SPPeerAddr
+    {
+        unsigned short family;  ///< ADDRESS_FAMILY_INET or ADDRESS_FAMILY_INET6
+        unsigned short port;    ///< Port number (host byte order)
+        unsigned char addr[16]; ///< Address in network byte order (IPv4 uses the first 4 bytes)
+    };
+
+    /**
+     * @brief Formats the address part of a binary peer address
+     * @param peer Peer address to format
+     * @param ip Output buffer, at least INET6_ADDRSTRLEN bytes
+     * @param size Size of the output buffer
+     * @return ip, or nullptr if the address could not be formatted
+     */
+    const char *SPFormatPeer(const SPPeerAddr *peer, char *ip, size_t size);
+
+    /**
+     * @brief Parses an address string into a binary peer address
+     * @param ip IPv4 or IPv6 address string (use "::ffff:a.b.c.d" for IPv4 peers of an IPv6 socket)
+     * @param port Port number (host byte order)
+     * @param peer Binary peer address to fill
+     * @return false if ip format incorrect
+     * @note Resolve once and reuse the result with SendTo()/Connect() to skip inet_pton per send
+     */
+    bool SPResolvePeer(const char *ip, unsigned short port, SPPeerAddr *peer);
+
+    /**
+     * @brief Datagram entry of a batched receive or send
+     * @note Received datagrams carry the binary peer only (ip is nullptr).
+     *       Sending uses ip/port when ip is set, otherwise peer.
+     */
+    struct SPUdpDatagram
+    {
+        const char *data;    ///< Payload
+        size_t size;         ///< Payload size in bytes
+        const char *ip;      ///< Peer IP address (nullptr to use peer)
+        unsigned short port; ///< Peer port number (used with ip)
+        SPPeerAddr peer;     ///< Binary peer address
     };
 
     /**
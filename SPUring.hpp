@@ -0,0 +1,587 @@
+#ifndef HSLL_SPURING
+#define HSLL_SPURING
+
+#include <poll.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#endif
+#endif
+
+#include "SPBufferPool.hpp"
+
+/**
+ * @brief Defined when the io_uring event engine can be compiled
+ * @details Requires kernel headers with multishot accept/recv and provided buffer rings.
+ *          Define SPSOCK_DISABLE_URING to build the epoll engine only.
+ */
+#if defined(IORING_RECV_MULTISHOT) && defined(IORING_ACCEPT_MULTISHOT) && \
+    defined(__NR_io_uring_setup) && !defined(SPSOCK_DISABLE_URING)
+#define SPSOCK_URING_SUPPORTED
+#endif
+
+#if defined(SPSOCK_URING_SUPPORTED)
+
+namespace HSLL
+{
+/**
+ * @brief Provided buffer group used by multishot receives
+ */
+#define SPSOCK_URING_BUFFER_GROUP 0
+
+/**
+ * @brief Number of provided receive buffers per IO loop when URING_BUFFER_NUM is 0
+ */
+#define SPSOCK_URING_DEFAULT_BUFFER_NUM 256
+
+    /**
+     * @brief Operation tags carried in the low bits of io_uring user_data
+     * @details Connection operations combine the tag with the SOCKController address.
+     */
+    enum URING_OP
+    {
+        URING_OP_EXIT = 0,   ///< Read of the loop's exit eventfd
+        URING_OP_WAKE = 1,   ///< Read of the loop's wake eventfd
+        URING_OP_ACCEPT = 2, ///< Multishot accept on the loop's listening socket
+        URING_OP_RECV = 3,   ///< Multishot receive of a connection
+        URING_OP_POLL = 4,   ///< One-shot POLLOUT wait of a connection
+        URING_OP_CANCEL = 5, ///< Cancellation of a connection request
+        URING_OP_DRAIN = 6,  ///< Cancellation of all requests on loop exit
+        URING_OP_MASK = 7    ///< Mask extracting the tag
+    };
+
+    /**
+     * @brief io_uring state flags of a connection (SOCKController::uringFlags)
+     */
+    enum URING_FLAG
+    {
+        URING_FLAG_RECV = 0x1,    ///< Multishot receive in flight
+        URING_FLAG_POLL = 0x2,    ///< POLLOUT wait in flight
+        URING_FLAG_CANCEL = 0x4,  ///< Cancellation of the receive already requested
+        URING_FLAG_EOF = 0x8,     ///< Peer shut down its sending side
+        URING_FLAG_ERROR = 0x10,  ///< Receive failed with a socket error
+        URING_FLAG_STARVED = 0x20, ///< Receive stopped for lack of provided buffers
+        URING_FLAG_WAITING = 0x40, ///< Armed and waiting for an event (EPOLLONESHOT equivalent)
+        URING_FLAG_CLOSED = 0x80   ///< Closed, waiting for in-flight requests before releasing the fd
+    };
+
+    /**
+     * @brief Provided receive buffer of an io_uring loop
+     * @details Buffers completed by the kernel are parked on their connection until the
+     *          data is copied into its read buffer, then recycled into the buffer ring.
+     */
+    struct SPUringBuffer
+    {
+        unsigned char *data; ///< Buffer memory taken from SPTcpBufferPool
+        int next;            ///< Next parked buffer of the same connection (-1 for none)
+        unsigned int begin;  ///< Offset of the first byte not yet copied out
+        unsigned int end;    ///< Number of bytes received into the buffer
+    };
+
+    /**
+     * @brief Minimal io_uring instance driven through raw system calls
+     * @details Owns the submission/completion rings and the provided buffer ring of one
+     *          IO event loop. Only the owning loop thread may submit or reap.
+     */
+    class SPUring : noncopyable
+    {
+        int ringfd; ///< io_uring file descriptor
+
+        unsigned int *sqHead;  ///< Kernel-owned submission queue head
+        unsigned int *sqTail;  ///< Submission queue tail
+        unsigned int *sqMask;  ///< Submission queue index mask
+        unsigned int *sqArray; ///< Submission queue index array
+        unsigned int sqEntries; ///< Number of submission queue entries
+        unsigned int sqLocal;  ///< Local copy of the submission queue tail
+        unsigned int toSubmit; ///< Entries queued since the last io_uring_enter
+        io_uring_sqe *sqes;    ///< Submission queue entries
+
+        unsigned int *cqHead; ///< Completion queue head
+        unsigned int *cqTail; ///< Kernel-owned completion queue tail
+        unsigned int *cqMask; ///< Completion queue index mask
+        io_uring_cqe *cqes;   ///< Completion queue entries
+
+        void *sqRing;      ///< Mapping of the submission ring
+        size_t sqRingSize; ///< Size of the submission ring mapping
+        void *cqRing;      ///< Mapping of the completion ring (may alias sqRing)
+        size_t cqRingSize; ///< Size of the completion ring mapping
+        size_t sqesSize;   ///< Size of the submission entry mapping
+
+        io_uring_buf_ring *bufRing; ///< Provided buffer ring shared with the kernel
+        size_t bufRingSize;         ///< Size of the provided buffer ring mapping
+        SPUringBuffer *bufs;        ///< Provided buffers indexed by buffer id
+        unsigned int bufNum;        ///< Number of buffers handed to the kernel
+        unsigned int bufEntries;    ///< Entries of the provided buffer ring (power of two)
+        unsigned int bufParked;     ///< Buffers completed and not yet recycled
+        unsigned short bufTail;     ///< Local copy of the provided buffer ring tail
+
+        /**
+         * @brief Publish a buffer in the provided buffer ring
+         * @param bid Buffer id
+         * @note Entries are addressed from the ring base: in C++ the kernel header's flexible
+         *       array member is preceded by an empty struct and lands at the wrong offset
+         */
+        void provide(unsigned short bid)
+        {
+            io_uring_buf *entry = (io_uring_buf *)bufRing + (bufTail & (bufEntries - 1));
+            entry->addr = (unsigned long long)bufs[bid].data;
+            entry->len = tcpConfig.READ_BSIZE;
+            entry->bid = bid;
+            bufTail++;
+            __atomic_store_n(&bufRing->tail, bufTail, __ATOMIC_RELEASE);
+        }
+
+    public:
+        /**
+         * @brief Constructor initializes an unset ring
+         */
+        SPUring() : ringfd(-1), sqHead(nullptr), sqTail(nullptr), sqMask(nullptr), sqArray(nullptr),
+                    sqEntries(0), sqLocal(0), toSubmit(0), sqes(nullptr), cqHead(nullptr), cqTail(nullptr),
+                    cqMask(nullptr), cqes(nullptr), sqRing(MAP_FAILED), sqRingSize(0), cqRing(MAP_FAILED),
+                    cqRingSize(0), sqesSize(0), bufRing(nullptr), bufRingSize(0), bufs(nullptr),
+                    bufNum(0), bufEntries(0), bufParked(0), bufTail(0) {}
+
+        /**
+         * @brief Destructor unmaps the rings and closes the instance
+         * @note releaseBuffers() must have been called on the loop thread before
+         */
+        ~SPUring()
+        {
+            if (sqes && sqes != MAP_FAILED)
+                munmap(sqes, sqesSize);
+
+            if (cqRing != MAP_FAILED && cqRing != sqRing)
+                munmap(cqRing, cqRingSize);
+
+            if (sqRing != MAP_FAILED)
+                munmap(sqRing, sqRingSize);
+
+            if (ringfd != -1)
+                close(ringfd);
+        }
+
+        /**
+         * @brief Create the io_uring instance and map its rings
+         * @param entries Requested number of submission queue entries
+         * @return true on success, false if io_uring is unavailable
+         */
+        bool init(unsigned int entries)
+        {
+            io_uring_params params;
+            memset(&params, 0, sizeof(params));
+            params.flags = IORING_SETUP_COOP_TASKRUN;
+
+            if ((ringfd = syscall(__NR_io_uring_setup, entries, &params)) == -1 && errno == EINVAL)
+            {
+                memset(&params, 0, sizeof(params));
+                ringfd = syscall(__NR_io_uring_setup, entries, &params);
+            }
+
+            if (ringfd == -1)
+                return false;
+
+            if (!(params.features & IORING_FEAT_NODROP))
+                return false;
+
+            sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+            cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+            if (params.features & IORING_FEAT_SINGLE_MMAP)
+            {
+                if (cqRingSize > sqRingSize)
+                    sqRingSize = cqRingSize;
+                cqRingSize = sqRingSize;
+            }
+
+            sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                          ringfd, IORING_OFF_SQ_RING);
+            if (sqRing == MAP_FAILED)
+                return false;
+
+            if (params.features & IORING_FEAT_SINGLE_MMAP)
+            {
+                cqRing = sqRing;
+            }
+            else
+            {
+                cqRing = mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                              ringfd, IORING_OFF_CQ_RING);
+                if (cqRing == MAP_FAILED)
+                    return false;
+            }
+
+            sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+            sqes = (io_uring_sqe *)mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                        ringfd, IORING_OFF_SQES);
+            if (sqes == MAP_FAILED)
+                return false;
+
+            sqHead = (unsigned int *)((char *)sqRing + params.sq_off.head);
+            sqTail = (unsigned int *)((char *)sqRing + params.sq_off.tail);
+            sqMask = (unsigned int *)((char *)sqRing + params.sq_off.ring_mask);
+            sqArray = (unsigned int *)((char *)sqRing + params.sq_off.array);
+            sqEntries = params.sq_entries;
+            sqLocal = *sqTail;
+
+            cqHead = (unsigned int *)((char *)cqRing + params.cq_off.head);
+            cqTail = (unsigned int *)((char *)cqRing + params.cq_off.tail);
+            cqMask = (unsigned int *)((char *)cqRing + params.cq_off.ring_mask);
+            cqes = (io_uring_cqe *)((char *)cqRing + params.cq_off.cqes);
+            return true;
+        }
+
+        /**
+         * @brief Register the provided receive buffer ring
+         * @param num Number of ring entries (power of two)
+         * @return true if at least one buffer was handed to the kernel
+         * @note Must run on the loop thread: buffers come from its bound SPTcpBufferPool
+         */
+        bool initBuffers(unsigned int num)
+        {
+            bufEntries = num;
+            bufRingSize = (num * sizeof(io_uring_buf) + 4095) & ~(size_t)4095;
+            void *mem = mmap(nullptr, bufRingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (mem == MAP_FAILED)
+                return false;
+
+            bufRing = (io_uring_buf_ring *)mem;
+            bufs = new (std::nothrow) SPUringBuffer[num];
+            if (!bufs)
+            {
+                releaseBuffers();
+                return false;
+            }
+
+            io_uring_buf_reg reg;
+            memset(&reg, 0, sizeof(reg));
+            reg.ring_addr = (unsigned long long)mem;
+            reg.ring_entries = num;
+            reg.bgid = SPSOCK_URING_BUFFER_GROUP;
+
+            if (syscall(__NR_io_uring_register, ringfd, IORING_REGISTER_PBUF_RING, &reg, 1) != 0)
+            {
+                releaseBuffers();
+                return false;
+            }
+
+            for (bufNum = 0; bufNum < num; bufNum++)
+            {
+                bufs[bufNum].data = (unsigned char *)SPTcpBufferPool::GetBuffer(BUFFER_TYPE_READ);
+                if (!bufs[bufNum].data)
+                    break;
+
+                provide(bufNum);
+            }
+            return bufNum != 0;
+        }
+
+        /**
+         * @brief Unregister the provided buffer ring and return its buffers to the pool
+         * @note All receives must be finished or cancelled before calling this
+         */
+        void releaseBuffers()
+        {
+            if (!bufRing)
+                return;
+
+            io_uring_buf_reg reg;
+            memset(&reg, 0, sizeof(reg));
+            reg.bgid = SPSOCK_URING_BUFFER_GROUP;
+            syscall(__NR_io_uring_register, ringfd, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+
+            for (unsigned int i = 0; i < bufNum; i++)
+                SPTcpBufferPool::FreeBuffer(bufs[i].data, BUFFER_TYPE_READ);
+
+            delete[] bufs;
+            munmap(bufRing, bufRingSize);
+            bufs = nullptr;
+            bufRing = nullptr;
+            bufNum = 0;
+            bufParked = 0;
+        }
+
+        /**
+         * @brief Submit queued entries and optionally wait for completions
+         * @param wait Minimum number of completions to wait for (0 to only submit)
+         * @return true on success, false on a system error other than EINTR
+         */
+        bool enter(unsigned int wait)
+        {
+            while (true)
+            {
+                int ret = syscall(__NR_io_uring_enter, ringfd, toSubmit, wait,
+                                  wait ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+                if (ret >= 0)
+                {
+                    toSubmit -= (ret > (int)toSubmit) ? toSubmit : ret;
+                    return true;
+                }
+
+                if (errno == EINTR)
+                {
+                    if (wait)
+                        return true;
+                    continue;
+                }
+
+                return errno == EBUSY || errno == EAGAIN;
+            }
+        }
+
+        /**
+         * @brief Check whether completions are waiting to be popped
+         * @note Reads the completion ring only (no system call)
+         */
+        bool ready()
+        {
+            return __atomic_load_n(cqTail, __ATOMIC_ACQUIRE) != *cqHead;
+        }
+
+        /**
+         * @brief Check whether submissions are waiting for io_uring_enter
+         */
+        bool pending()
+        {
+            return toSubmit != 0;
+        }
+
+        /**
+         * @brief Get a zeroed submission queue entry
+         * @return Entry to fill, nullptr if the queue stays full
+         * @note Submits queued entries when the submission queue is full
+         */
+        io_uring_sqe *getSqe()
+        {
+            if (sqLocal - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) >= sqEntries)
+            {
+                if (!enter(0) || sqLocal - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) >= sqEntries)
+                    return nullptr;
+            }
+
+            unsigned int index = sqLocal & *sqMask;
+            io_uring_sqe *sqe = &sqes[index];
+            memset(sqe, 0, sizeof(io_uring_sqe));
+            sqArray[index] = index;
+            sqLocal++;
+            toSubmit++;
+            __atomic_store_n(sqTail, sqLocal, __ATOMIC_RELEASE);
+            return sqe;
+        }
+
+        /**
+         * @brief Pop the next completion
+         * @param data Receives the user_data of the request
+         * @param res Receives the result of the request
+         * @param flags Receives the completion flags
+         * @return false if the completion queue is empty
+         */
+        bool pop(unsigned long long &data, int &res, unsigned int &flags)
+        {
+            unsigned int head = *cqHead;
+            if (head == __atomic_load_n(cqTail, __ATOMIC_ACQUIRE))
+                return false;
+
+            io_uring_cqe *cqe = &cqes[head & *cqMask];
+            data = cqe->user_data;
+            res = cqe->res;
+            flags = cqe->flags;
+            __atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+            return true;
+        }
+
+        /**
+         * @brief Queue a read of an eventfd
+         */
+        bool prepRead(int fd, void *buf, unsigned int len, unsigned long long data)
+        {
+            io_uring_sqe *sqe = getSqe();
+            if (!sqe)
+                return false;
+
+            sqe->opcode = IORING_OP_READ;
+            sqe->fd = fd;
+            sqe->addr = (unsigned long long)buf;
+            sqe->len = len;
+            sqe->user_data = data;
+            return true;
+        }
+
+        /**
+         * @brief Queue a multishot accept on a listening socket
+         */
+        bool prepAccept(int fd, unsigned long long data)
+        {
+            io_uring_sqe *sqe = getSqe();
+            if (!sqe)
+                return false;
+
+            sqe->opcode = IORING_OP_ACCEPT;
+            sqe->fd = fd;
+            sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+            sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+            sqe->user_data = data;
+            return true;
+        }
+
+        /**
+         * @brief Queue a multishot receive selecting provided buffers
+         */
+        bool prepRecv(int fd, unsigned long long data)
+        {
+            io_uring_sqe *sqe = getSqe();
+            if (!sqe)
+                return false;
+
+            sqe->opcode = IORING_OP_RECV;
+            sqe->fd = fd;
+            sqe->ioprio = IORING_RECV_MULTISHOT;
+            sqe->flags = IOSQE_BUFFER_SELECT;
+            sqe->buf_group = SPSOCK_URING_BUFFER_GROUP;
+            sqe->user_data = data;
+            return true;
+        }
+
+        /**
+         * @brief Queue a one-shot poll for writability
+         */
+        bool prepPollOut(int fd, unsigned long long data)
+        {
+            io_uring_sqe *sqe = getSqe();
+            if (!sqe)
+                return false;
+
+            sqe->opcode = IORING_OP_POLL_ADD;
+            sqe->fd = fd;
+            sqe->poll32_events = POLLOUT | POLLERR | POLLHUP;
+            sqe->user_data = data;
+            return true;
+        }
+
+        /**
+         * @brief Queue a cancellation
+         * @param target user_data of the request to cancel (ignored with IORING_ASYNC_CANCEL_ANY)
+         * @param flags IORING_ASYNC_CANCEL_* flags
+         */
+        bool prepCancel(unsigned long long target, unsigned int flags, unsigned long long data)
+        {
+            io_uring_sqe *sqe = getSqe();
+            if (!sqe)
+                return false;
+
+            sqe->opcode = IORING_OP_ASYNC_CANCEL;
+            sqe->fd = -1;
+            sqe->addr = target;
+            sqe->cancel_flags = flags;
+            sqe->user_data = data;
+            return true;
+        }
+
+        /**
+         * @brief Get a provided buffer by id
+         */
+        SPUringBuffer *buffer(unsigned short bid)
+        {
+            return &bufs[bid];
+        }
+
+        /**
+         * @brief Append a completed buffer to a connection's parked list
+         * @param head Head of the parked list (-1 if empty)
+         * @param tail Tail of the parked list (-1 if empty)
+         * @param bid Buffer id reported by the completion
+         * @param len Bytes received into the buffer
+         */
+        void park(int &head, int &tail, unsigned short bid, unsigned int len)
+        {
+            bufs[bid].next = -1;
+            bufs[bid].begin = 0;
+            bufs[bid].end = len;
+
+            if (tail == -1)
+                head = bid;
+            else
+                bufs[tail].next = bid;
+
+            tail = bid;
+            bufParked++;
+        }
+
+        /**
+         * @brief Return a parked buffer to the kernel
+         */
+        void recycle(unsigned short bid)
+        {
+            bufParked--;
+            provide(bid);
+        }
+
+        /**
+         * @brief Return a buffer the kernel completed without data
+         */
+        void restore(unsigned short bid)
+        {
+            provide(bid);
+        }
+
+        /**
+         * @brief Recycle every buffer of a parked list
+         */
+        void discard(int &head, int &tail)
+        {
+            while (head != -1)
+            {
+                int next = bufs[head].next;
+                recycle(head);
+                head = next;
+            }
+            tail = -1;
+        }
+
+        /**
+         * @brief Check whether the kernel still owns provided buffers
+         */
+        bool available()
+        {
+            return bufParked < bufNum;
+        }
+
+        /**
+         * @brief Build the user_data of a request
+         * @param op Operation tag
+         * @param ptr Connection the request belongs to (nullptr for loop requests)
+         */
+        static unsigned long long Tag(URING_OP op, void *ptr = nullptr)
+        {
+            return (unsigned long long)ptr | op;
+        }
+
+        /**
+         * @brief Check whether the running kernel supports the io_uring engine
+         */
+        static bool Supported()
+        {
+            SPUring ring;
+            if (!ring.init(4))
+                return false;
+
+            io_uring_probe *probe = (io_uring_probe *)calloc(1, sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op));
+            if (!probe)
+                return false;
+
+            bool ret = syscall(__NR_io_uring_register, ring.ringfd, IORING_REGISTER_PROBE, probe, 256) == 0 &&
+                       probe->last_op >= IORING_OP_SEND_ZC;
+            free(probe);
+            return ret;
+        }
+    };
+}
+
+#endif // SPSOCK_URING_SUPPORTED
+
+#endif // HSLL_SPURING
@@ -220,14 +220,35 @@ namespace HSLL
 		std::mutex dataMutex;				  ///< Mutex protecting all queue operations
 		std::condition_variable notEmptyCond; ///< Signaled when data becomes available
 
-		template <class T>
-		friend class ThreadPool;
-
 	public:
 		TPBlockQueue() : memoryBlock(nullptr), isStopped(0) {}
 
 		~TPBlockQueue() { release(); }
 
+		/**
+		 * @brief Approximate number of queued elements (read without locking)
+		 */
+		unsigned int length() const noexcept
+		{
+			return size;
+		}
+
+		/**
+		 * @brief Capacity of the queue
+		 */
+		unsigned int capacity() const noexcept
+		{
+			return maxSize;
+		}
+
+		/**
+		 * @brief Whether stopWait() has been called (read without locking)
+		 */
+		bool stopped() const noexcept
+		{
+			return isStopped;
+		}
+
 		/**
 		 * @brief Initializes queue with fixed capacity
 		 * @param capacity Maximum number of elements the queue can hold
@@ -0,0 +1,120 @@
+#ifndef HSLL_TPBUSYPOLL
+#define HSLL_TPBUSYPOLL
+
+#include <chrono>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace HSLL
+{
+	/**
+	 * @brief Adaptive spin window used before a thread parks
+	 * @details Tracks an exponential moving average of the idle gap between running out of
+	 *          work and the next arrival. The window is twice the average gap, kept within
+	 *          [limit / 16, limit], and closes entirely once the average exceeds the limit,
+	 *          so an idle thread parks immediately and spinning resumes when traffic returns.
+	 *          Every window that expires without work halves the next one.
+	 * @note Single-threaded; every spinning thread owns its instance
+	 */
+	class TPBusyPoll
+	{
+		long long limit;	 ///< Maximum spin window in nanoseconds (0 disables spinning)
+		long long window;	 ///< Current spin window in nanoseconds
+		long long gap;		 ///< Moving average of idle gaps in nanoseconds
+		long long idleSince; ///< Start of the current idle period (-1 while busy)
+
+		static long long now() noexcept
+		{
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(
+					   std::chrono::steady_clock::now().time_since_epoch())
+				.count();
+		}
+
+		static void relax() noexcept
+		{
+#if defined(__x86_64__) || defined(__i386__)
+			_mm_pause();
+#endif
+		}
+
+	public:
+		TPBusyPoll() : limit(0), window(0), gap(0), idleSince(-1) {}
+
+		/**
+		 * @brief Sets the maximum spin window
+		 * @param us Window in microseconds (0 disables spinning)
+		 */
+		void init(unsigned int us) noexcept
+		{
+			limit = (long long)us * 1000;
+			window = limit;
+			gap = limit / 2;
+			idleSince = -1;
+		}
+
+		/**
+		 * @brief Whether spinning is configured
+		 */
+		bool enabled() const noexcept
+		{
+			return limit != 0;
+		}
+
+		/**
+		 * @brief Polls for work until it arrives or the current window expires
+		 * @tparam F Callable returning true once work is available
+		 * @param poll Non-blocking poll for work
+		 * @return true if poll succeeded within the window, false if the caller should park
+		 */
+		template <class F>
+		bool spin(F &&poll)
+		{
+			if (!limit)
+				return false;
+
+			long long start = now();
+			if (idleSince < 0)
+				idleSince = start;
+
+			if (!window)
+				return false;
+
+			do
+			{
+				if (poll())
+				{
+					arrived();
+					return true;
+				}
+				relax();
+			} while (now() - start < window);
+
+			window = (window / 2 < limit / 16) ? 0 : window / 2;
+			return false;
+		}
+
+		/**
+		 * @brief Records the arrival of work that ended an idle period
+		 * @note Called by spin() itself and by the caller after a parked wait returned work
+		 */
+		void arrived() noexcept
+		{
+			if (!limit || idleSince < 0)
+				return;
+
+			gap += (now() - idleSince - gap) / 8;
+			idleSince = -1;
+
+			if (gap > limit)
+				window = 0;
+			else if (gap * 2 > limit)
+				window = limit;
+			else
+				window = (gap * 2 > limit / 16) ? gap * 2 : limit / 16;
+		}
+	};
+}
+
+#endif
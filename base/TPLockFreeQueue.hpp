@@ -0,0 +1,493 @@
+#ifndef HSLL_TPLOCKFREEQUEUE
+#define HSLL_TPLOCKFREEQUEUE
+
+#include <atomic>
+#include <climits>
+#include <thread>
+
+#if defined(__linux__)
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
+
+#include "TPBlockQueue.hpp"
+
+namespace HSLL
+{
+	/**
+	 * @brief Eventcount used to park idle consumers without holding a lock
+	 * @details Consumers announce themselves with prepare_wait(), re-check their
+	 *          condition and then call wait(). Producers call notify() after
+	 *          publishing data; it is a single atomic load unless someone is waiting.
+	 *          Parking uses futex on Linux and a short sleep elsewhere.
+	 */
+	class TPEventCount
+	{
+		std::atomic<unsigned int> epoch;   ///< Incremented on every notification
+		std::atomic<unsigned int> waiters; ///< Number of consumers between prepare_wait() and wake-up
+
+	public:
+		TPEventCount() : epoch(0), waiters(0) {}
+
+		/**
+		 * @brief Registers the caller as a waiter
+		 * @return Key to pass to wait()
+		 */
+		unsigned int prepare_wait() noexcept
+		{
+			waiters.fetch_add(1, std::memory_order_seq_cst);
+			return epoch.load(std::memory_order_seq_cst);
+		}
+
+		/**
+		 * @brief Unregisters a waiter whose condition became true
+		 */
+		void cancel_wait() noexcept
+		{
+			waiters.fetch_sub(1, std::memory_order_relaxed);
+		}
+
+		/**
+		 * @brief Parks the caller until notified or the timeout expires
+		 * @param key Key returned by prepare_wait()
+		 * @param timeoutMs Timeout in milliseconds (negative for infinite)
+		 */
+		void wait(unsigned int key, long timeoutMs) noexcept
+		{
+			if (epoch.load(std::memory_order_seq_cst) == key)
+			{
+#if defined(__linux__)
+				timespec ts;
+				timespec *pts = nullptr;
+
+				if (timeoutMs >= 0)
+				{
+					ts.tv_sec = timeoutMs / 1000;
+					ts.tv_nsec = (timeoutMs % 1000) * 1000000;
+					pts = &ts;
+				}
+
+				syscall(SYS_futex, (unsigned int *)&epoch, FUTEX_WAIT_PRIVATE, key, pts, nullptr, 0);
+#else
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+#endif
+			}
+			waiters.fetch_sub(1, std::memory_order_relaxed);
+		}
+
+		/**
+		 * @brief Wakes parked consumers
+		 * @param all Wake every waiter instead of a single one
+		 */
+		void notify(bool all = false) noexcept
+		{
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+
+			if (LIKELY(waiters.load(std::memory_order_relaxed) == 0))
+				return;
+
+			epoch.fetch_add(1, std::memory_order_seq_cst);
+#if defined(__linux__)
+			syscall(SYS_futex, (unsigned int *)&epoch, FUTEX_WAKE_PRIVATE, all ? INT_MAX : 1, nullptr, nullptr, 0);
+#endif
+		}
+	};
+
+	static_assert(sizeof(std::atomic<unsigned int>) == sizeof(unsigned int), "futex requires a plain 32-bit word");
+
+	/**
+	 * @brief Bounded lock-free multi-producer/multi-consumer queue
+	 * @tparam TYPE Element type stored in the queue
+	 * @details Drop-in alternative to TPBlockQueue for ThreadPool:
+	 *          - Vyukov ring: every cell carries a sequence number, producers and
+	 *            consumers claim cells with a single CAS on their position counter
+	 *          - Capacity is rounded up to a power of two
+	 *          - Bulk operations claim cells one by one and notify once
+	 *          - Blocking pops park on a TPEventCount instead of a condition variable
+	 */
+	template <class TYPE>
+	class TPLockFreeQueue
+	{
+	private:
+		struct Cell
+		{
+			std::atomic<unsigned int> sequence; ///< Ticket of the operation allowed on this cell
+			TYPE data;							///< Storage for element data
+		};
+
+		alignas(64) std::atomic<unsigned int> enqueuePos; ///< Next ticket handed to producers
+		alignas(64) std::atomic<unsigned int> dequeuePos; ///< Next ticket handed to consumers
+		alignas(64) TPEventCount notEmpty;				   ///< Parks consumers while the queue is empty
+
+		Cell *cells;					///< Ring storage
+		unsigned int mask;				///< Capacity - 1
+		unsigned int maxSize;			///< Capacity of the ring
+		std::atomic<bool> isStopped;	///< Flag for stopping all blocking operations
+
+		/**
+		 * @brief Claims a free cell for writing
+		 * @return Claimed cell, nullptr if the queue is full
+		 */
+		Cell *claim_enqueue(unsigned int &pos) noexcept
+		{
+			pos = enqueuePos.load(std::memory_order_relaxed);
+
+			while (true)
+			{
+				Cell *cell = &cells[pos & mask];
+				unsigned int seq = cell->sequence.load(std::memory_order_acquire);
+				int dif = (int)(seq - pos);
+
+				if (dif == 0)
+				{
+					if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+						return cell;
+				}
+				else if (dif < 0)
+				{
+					return nullptr;
+				}
+				else
+				{
+					pos = enqueuePos.load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+		/**
+		 * @brief Claims a filled cell for reading
+		 * @return Claimed cell, nullptr if the queue is empty
+		 */
+		Cell *claim_dequeue(unsigned int &pos) noexcept
+		{
+			pos = dequeuePos.load(std::memory_order_relaxed);
+
+			while (true)
+			{
+				Cell *cell = &cells[pos & mask];
+				unsigned int seq = cell->sequence.load(std::memory_order_acquire);
+				int dif = (int)(seq - (pos + 1));
+
+				if (dif == 0)
+				{
+					if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+						return cell;
+				}
+				else if (dif < 0)
+				{
+					return nullptr;
+				}
+				else
+				{
+					pos = dequeuePos.load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+		/**
+		 * @brief Moves an element out of a claimed cell and releases the cell
+		 */
+		template <POP_METHOD M>
+		void take(Cell *cell, unsigned int pos, TYPE &element) noexcept
+		{
+			pop_extract<M>(element, cell->data);
+			conditional_destroy(cell->data);
+			cell->sequence.store(pos + mask + 1, std::memory_order_release);
+		}
+
+		/**
+		 * @brief Publishes a constructed cell to consumers
+		 */
+		void publish(Cell *cell, unsigned int pos) noexcept
+		{
+			cell->sequence.store(pos + 1, std::memory_order_release);
+		}
+
+		/**
+		 * @brief Parks until data may be available, the queue stops or the timeout expires
+		 * @return false if the queue is stopped
+		 */
+		bool park(long timeoutMs) noexcept
+		{
+			unsigned int key = notEmpty.prepare_wait();
+
+			if (length() || isStopped.load(std::memory_order_acquire))
+			{
+				notEmpty.cancel_wait();
+				return !isStopped.load(std::memory_order_relaxed);
+			}
+
+			notEmpty.wait(key, timeoutMs);
+			return true;
+		}
+
+	public:
+		TPLockFreeQueue() : enqueuePos(0), dequeuePos(0), cells(nullptr), mask(0), maxSize(0), isStopped(false) {}
+
+		~TPLockFreeQueue() { release(); }
+
+		/**
+		 * @brief Initializes queue with fixed capacity
+		 * @param capacity Minimum number of elements the queue can hold (rounded up to a power of two)
+		 * @return true if initialization succeeded, false otherwise
+		 */
+		bool init(unsigned int capacity)
+		{
+			if (cells || capacity == 0 || capacity > (1u << 30))
+				return false;
+
+			unsigned int size = 1;
+			while (size < capacity)
+				size <<= 1;
+
+			size_t totalSize = sizeof(Cell) * size;
+			totalSize = (totalSize + 64 - 1) & ~(size_t)(64 - 1);
+			cells = (Cell *)ALIGNED_MALLOC(totalSize, 64);
+
+			if (!cells)
+				return false;
+
+			for (unsigned int i = 0; i < size; ++i)
+				new (&cells[i].sequence) std::atomic<unsigned int>(i);
+
+			mask = size - 1;
+			maxSize = size;
+			enqueuePos.store(0, std::memory_order_relaxed);
+			dequeuePos.store(0, std::memory_order_relaxed);
+			return true;
+		}
+
+		/**
+		 * @brief Approximate number of queued elements
+		 */
+		unsigned int length() const noexcept
+		{
+			unsigned int tail = enqueuePos.load(std::memory_order_relaxed);
+			unsigned int head = dequeuePos.load(std::memory_order_relaxed);
+			int count = (int)(tail - head);
+			return count > 0 ? (unsigned int)count : 0;
+		}
+
+		/**
+		 * @brief Capacity of the queue
+		 */
+		unsigned int capacity() const noexcept
+		{
+			return maxSize;
+		}
+
+		/**
+		 * @brief Whether stopWait() has been called
+		 */
+		bool stopped() const noexcept
+		{
+			return isStopped.load(std::memory_order_acquire);
+		}
+
+		/**
+		 * @brief Non-blocking element emplacement with perfect forwarding
+		 * @return true if element was emplaced, false if queue was full
+		 */
+		template <typename... Args>
+		bool emplace(Args &&...args)
+		{
+			unsigned int pos;
+			Cell *cell = claim_enqueue(pos);
+
+			if (UNLIKELY(!cell))
+				return false;
+
+			new (&cell->data) TYPE(std::forward<Args>(args)...);
+			publish(cell, pos);
+			notEmpty.notify();
+			return true;
+		}
+
+		/**
+		 * @brief Non-blocking element push
+		 * @return true if element was added, false if queue was full
+		 */
+		template <class T>
+		bool push(T &&element)
+		{
+			unsigned int pos;
+			Cell *cell = claim_enqueue(pos);
+
+			if (UNLIKELY(!cell))
+				return false;
+
+			new (&cell->data) TYPE(std::forward<T>(element));
+			publish(cell, pos);
+			notEmpty.notify();
+			return true;
+		}
+
+		/**
+		 * @brief Bulk push for multiple elements using specified construction method
+		 * @return Actual number of elements pushed
+		 */
+		template <BULK_CMETHOD METHOD = COPY>
+		unsigned int pushBulk(TYPE *elements, unsigned int count)
+		{
+			unsigned int pushed = 0;
+
+			while (pushed < count)
+			{
+				unsigned int pos;
+				Cell *cell = claim_enqueue(pos);
+
+				if (UNLIKELY(!cell))
+					break;
+
+				bulk_construct<METHOD>(cell->data, elements[pushed]);
+				publish(cell, pos);
+				pushed++;
+			}
+
+			if (LIKELY(pushed))
+				notEmpty.notify(pushed > 1);
+
+			return pushed;
+		}
+
+		/**
+		 * @brief Non-blocking element removal
+		 * @return true if element was retrieved, false if queue was empty
+		 */
+		template <POP_METHOD M = ASSIGN>
+		bool pop(TYPE &element)
+		{
+			unsigned int pos;
+			Cell *cell = claim_dequeue(pos);
+
+			if (!cell)
+				return false;
+
+			take<M>(cell, pos, element);
+			return true;
+		}
+
+		/**
+		 * @brief Blocking element removal with indefinite wait
+		 * @return true if element was retrieved, false if queue was stopped
+		 */
+		template <POP_METHOD M = ASSIGN>
+		bool wait_pop(TYPE &element)
+		{
+			while (true)
+			{
+				if (pop<M>(element))
+					return true;
+
+				if (!park(-1))
+					return pop<M>(element);
+			}
+		}
+
+		/**
+		 * @brief Blocking element removal with timeout
+		 * @return true if element was retrieved, false on timeout or stop
+		 */
+		template <POP_METHOD M = ASSIGN, class Rep, class Period>
+		bool wait_pop(TYPE &element, const std::chrono::duration<Rep, Period> &timeout)
+		{
+			if (pop<M>(element))
+				return true;
+
+			park(std::chrono::duration_cast<std::chrono::milliseconds>(timeout).count());
+			return pop<M>(element);
+		}
+
+		/**
+		 * @brief Bulk element retrieval
+		 * @return Actual number of elements retrieved
+		 */
+		template <POP_METHOD M = ASSIGN>
+		unsigned int popBulk(TYPE *elements, unsigned int count)
+		{
+			unsigned int popped = 0;
+
+			while (popped < count)
+			{
+				unsigned int pos;
+				Cell *cell = claim_dequeue(pos);
+
+				if (!cell)
+					break;
+
+				take<M>(cell, pos, elements[popped]);
+				popped++;
+			}
+			return popped;
+		}
+
+		/**
+		 * @brief Blocking bulk retrieval with indefinite wait
+		 * @return Actual number of elements retrieved before stop
+		 */
+		template <POP_METHOD M = ASSIGN>
+		unsigned int wait_popBulk(TYPE *elements, unsigned int count)
+		{
+			while (true)
+			{
+				unsigned int popped = popBulk<M>(elements, count);
+				if (popped)
+					return popped;
+
+				if (!park(-1))
+					return popBulk<M>(elements, count);
+			}
+		}
+
+		/**
+		 * @brief Blocking bulk retrieval with timeout
+		 * @return Actual number of elements retrieved
+		 */
+		template <POP_METHOD M = ASSIGN, class Rep, class Period>
+		unsigned int wait_popBulk(TYPE *elements, unsigned int count, const std::chrono::duration<Rep, Period> &timeout)
+		{
+			unsigned int popped = popBulk<M>(elements, count);
+			if (popped)
+				return popped;
+
+			park(std::chrono::duration_cast<std::chrono::milliseconds>(timeout).count());
+			return popBulk<M>(elements, count);
+		}
+
+		/**
+		 * @brief Signals all waiting threads to stop blocking
+		 */
+		void stopWait()
+		{
+			isStopped.store(true, std::memory_order_release);
+			notEmpty.notify(true);
+		}
+
+		/**
+		 * @brief Releases all resources and resets queue state
+		 * @note Must not race with producers or consumers
+		 */
+		void release()
+		{
+			if (cells)
+			{
+				unsigned int pos = dequeuePos.load(std::memory_order_relaxed);
+				unsigned int end = enqueuePos.load(std::memory_order_relaxed);
+
+				for (; pos != end; ++pos)
+					conditional_destroy(cells[pos & mask].data);
+
+				ALIGNED_FREE(cells);
+				cells = nullptr;
+				isStopped.store(false, std::memory_order_relaxed);
+			}
+		}
+
+		// Disable copying
+		TPLockFreeQueue(const TPLockFreeQueue &) = delete;
+		TPLockFreeQueue &operator=(const TPLockFreeQueue &) = delete;
+	};
+}
+#endif // HSLL_TPLOCKFREEQUEUE
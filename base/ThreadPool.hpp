@@ -47,7 +47,9 @@ namespace HSLL
 #include <assert.h>
 
 #include "TPTask.h"
+#include "TPBusyPoll.hpp"
 #include "TPBlockQueue.hpp"
+#include "TPLockFreeQueue.hpp"
 
 namespace HSLL
 {
@@ -57,71 +59,89 @@ namespace HSLL
 	/**
 	 * @brief Thread pool implementation with multiple queues for task distribution
 	 * @tparam T Type of task objects to be processed, must implement execute() method
+	 * @tparam QUEUE Per-worker queue type (TPBlockQueue or TPLockFreeQueue)
 	 */
-	template <class T = TaskStack<>>
+	template <class T = TaskStack<>, template <class> class QUEUE = TPBlockQueue>
 	class ThreadPool
 	{
 	private:
 		bool shutdownPolicy;			  ///< Thread pool shutdown policy: true for graceful shutdown
 		unsigned int threadNum;			  ///< Number of worker threads/queues to create
 		unsigned int queueLength;		  ///< Capacity of each internal queue
-		TPBlockQueue<T>* queues;		  ///< Per-worker task queues
+		QUEUE<T>* queues;		  ///< Per-worker task queues
 		std::vector<std::thread> workers; ///< Worker thread collection
 		std::atomic<unsigned int> index;  ///< Atomic counter for round-robin task distribution to worker queues
+		std::atomic<unsigned long long> stolen; ///< Tasks taken from another worker's queue
+		unsigned int stealThreshold;	  ///< Tasks a queue must hold before idle workers steal from it (0 for default)
+		unsigned int spinWindow;		  ///< Maximum microseconds an idle worker spins before parking (0 to park at once)
+		void (*threadInit)(void*, unsigned int); ///< Run by every worker before it takes tasks (nullptr for none)
+		void* threadArg;				  ///< Argument passed to threadInit
 
 	public:
 		/**
 		 * @brief Constructs an uninitialized thread pool
 		 */
-		ThreadPool() : queues(nullptr), threadNum(0), queueLength(0), shutdownPolicy(true) {}
+		ThreadPool() : queues(nullptr), threadNum(0), queueLength(0), shutdownPolicy(true), stolen(0), stealThreshold(0), spinWindow(0), threadInit(nullptr), threadArg(nullptr) {}
+
+		/**
+		 * @brief Sets the backlog a queue must reach before idle workers steal from it
+		 * @param threshold Tasks in the victim queue (0 for the batch size times the number of other workers)
+		 * @note Must be called before init(); values above the queue length are clamped to it
+		 */
+		void set_steal_threshold(unsigned int threshold) noexcept
+		{
+			stealThreshold = threshold;
+		}
+
+		/**
+		 * @brief Sets how long an idle worker may spin on its queue before parking
+		 * @param us Maximum spin window in microseconds (0 to park at once)
+		 * @note Must be called before init(); the window adapts to the recent arrival rate (see TPBusyPoll)
+		 */
+		void set_spin_window(unsigned int us) noexcept
+		{
+			spinWindow = us;
+		}
+
+		/**
+		 * @brief Sets a function every worker thread runs before it takes tasks
+		 * @param proc Called with arg and the index of the worker (nullptr for none)
+		 * @param arg Argument passed to proc
+		 * @note Must be called before init()
+		 */
+		void set_thread_init(void (*proc)(void*, unsigned int), void* arg) noexcept
+		{
+			threadInit = proc;
+			threadArg = arg;
+		}
 
 		/**
 		 * @brief Initializes thread pool resources
 		 * @param queueLength Capacity of each internal queue
 		 * @param threadNum Number of worker threads/queues to create
 		 * @param batchSize Maximum tasks to process per batch (min 1)
+		 * @param firstCore Core the first worker is bound to (the others follow consecutively)
 		 * @return true if initialization succeeded, false otherwise
 		 */
-		bool init(unsigned int queueLength, unsigned int threadNum, unsigned int batchSize = 1)
+		bool init(unsigned int queueLength, unsigned int threadNum, unsigned int batchSize = 1, unsigned int firstCore = 0)
 		{
 			if (batchSize == 0 || threadNum == 0 || batchSize > queueLength)
 				return false;
 
-			queues = new (std::nothrow) TPBlockQueue<T>[threadNum];
-
-			if (!queues)
-				return false;
-
-			for (unsigned i = 0; i < threadNum; ++i)
-			{
-				if (!queues[i].init(queueLength))
-				{
-					delete[] queues;
-					queues = nullptr;
-					return false;
-				}
-			}
-
 			unsigned cores = std::thread::hardware_concurrency();
 
-			if (!cores)
-			{
-				delete[] queues;
-				queues = nullptr;
+			if (!cores || !create_queues(queueLength, threadNum))
 				return false;
-			}
 
-			this->threadNum = threadNum;
-			this->queueLength = queueLength;
 			workers.reserve(threadNum);
 
 			for (unsigned i = 0; i < threadNum; ++i)
 			{
-				workers.emplace_back([this, i, cores, batchSize]
+				workers.emplace_back([this, i, cores, batchSize, firstCore]
 					{
 						if (cores > 0)
 						{
-							unsigned id = i % cores;
+							unsigned id = (firstCore + i) % cores;
 							ThreadBinder::bind_current_thread_to_core(id);
 						}
 						worker(i, batchSize); });
@@ -130,6 +150,35 @@ namespace HSLL
 			return true;
 		}
 
+		/**
+		 * @brief Initializes thread pool resources with one worker pinned to each given CPU
+		 * @param queueLength Capacity of each internal queue
+		 * @param cpus CPUs of the workers (worker i is bound to cpus[i])
+		 * @param batchSize Maximum tasks to process per batch (min 1)
+		 * @return true if initialization succeeded, false otherwise
+		 */
+		bool init(unsigned int queueLength, const std::vector<unsigned int>& cpus, unsigned int batchSize = 1)
+		{
+			if (batchSize == 0 || cpus.empty() || batchSize > queueLength)
+				return false;
+
+			if (!create_queues(queueLength, cpus.size()))
+				return false;
+
+			workers.reserve(cpus.size());
+
+			for (unsigned i = 0; i < cpus.size(); ++i)
+			{
+				unsigned id = cpus[i];
+				workers.emplace_back([this, i, id, batchSize]
+					{
+						ThreadBinder::bind_current_thread_to_core(id);
+						worker(i, batchSize); });
+			}
+
+			return true;
+		}
+
 		/**
 		 * @brief Enqueues a task using perfect forwarding
 		 * @tparam Args Constructor argument types for task type T
@@ -141,7 +190,7 @@ namespace HSLL
 		{
 			unsigned int index = next_index();
 
-			if (queues[index].size < queueLength)
+			if (queues[index].length() < queueLength)
 			{
 				return queues[index].emplace(std::forward<Args>(args)...);
 			}
@@ -162,7 +211,7 @@ namespace HSLL
 			assert(count <= queueLength);
 			unsigned int index = next_index();
 
-			if (queues[index].size + count / 2 <= queueLength)
+			if (queues[index].length() + count / 2 <= queueLength)
 			{
 				return queues[index].template emplaceBulk(count);
 			}
@@ -187,7 +236,7 @@ namespace HSLL
 			assert(count <= queueLength);
 			unsigned int index = next_index();
 
-			if (queues[index].size + count / 2 <= queueLength)
+			if (queues[index].length() + count / 2 <= queueLength)
 			{
 				return queues[index].template emplaceBulk<METHOD>(packages, count);
 			}
@@ -209,7 +258,7 @@ namespace HSLL
 		{
 			unsigned int index = next_index();
 
-			if (queues[index].size < queueLength)
+			if (queues[index].length() < queueLength)
 			{
 				return queues[index].push(std::forward<U>(task));
 			}
@@ -220,6 +269,62 @@ namespace HSLL
 			}
 		}
 
+		/**
+		 * @brief Enqueues a single preconstructed task to a chosen worker
+		 * @param target Worker queue index (taken modulo the number of workers)
+		 * @param task Task object to enqueue
+		 * @return true if task was enqueued successfully
+		 * @note Falls back to the opposite queue only when the chosen queue is full
+		 */
+		template <typename U>
+		bool append_to(unsigned int target, U&& task)
+		{
+			unsigned int index = target % threadNum;
+
+			if (queues[index].length() < queueLength)
+			{
+				return queues[index].push(std::forward<U>(task));
+			}
+			else
+			{
+				unsigned int half = threadNum / 2;
+				return queues[(index + half) % threadNum].push(std::forward<U>(task));
+			}
+		}
+
+		/**
+		 * @brief Enqueues multiple preconstructed tasks to a chosen worker
+		 * @tparam METHOD Bulk insertion method (COPY/MOVE)
+		 * @param target Worker queue index (taken modulo the number of workers)
+		 * @param tasks Task object array
+		 * @param count Number of tasks in array (Required: count <= queueLength)
+		 * @return Actual number of tasks enqueued
+		 */
+		template <BULK_CMETHOD METHOD = COPY>
+		unsigned int append_bulk_to(unsigned int target, T* tasks, unsigned int count)
+		{
+			assert(count <= queueLength);
+			unsigned int index = target % threadNum;
+
+			if (queues[index].length() + count / 2 <= queueLength)
+			{
+				return queues[index].template pushBulk<METHOD>(tasks, count);
+			}
+			else
+			{
+				unsigned int half = threadNum / 2;
+				return queues[(index + half) % threadNum].template pushBulk<METHOD>(tasks, count);
+			}
+		}
+
+		/**
+		 * @brief Gets the number of worker queues
+		 */
+		unsigned int threads() const noexcept
+		{
+			return threadNum;
+		}
+
 		/**
 		 * @brief Enqueues multiple preconstructed tasks
 		 * @tparam METHOD Bulk insertion method (COPY/MOVE)
@@ -233,7 +338,7 @@ namespace HSLL
 			assert(count <= queueLength);
 			unsigned int index = next_index();
 
-			if (queues[index].size + count / 2 <= queueLength)
+			if (queues[index].length() + count / 2 <= queueLength)
 			{
 				return queues[index].template pushBulk<METHOD>(tasks, count);
 			}
@@ -244,6 +349,28 @@ namespace HSLL
 			}
 		}
 
+		/**
+		 * @brief Gets the number of tasks waiting in all queues
+		 * @note Approximate while tasks are being enqueued or processed
+		 */
+		unsigned int queued() noexcept
+		{
+			unsigned int total = 0;
+
+			for (unsigned i = 0; i < threadNum; ++i)
+				total += queues[i].length();
+
+			return total;
+		}
+
+		/**
+		 * @brief Gets the number of tasks stolen between worker queues
+		 */
+		unsigned long long steals() noexcept
+		{
+			return stolen.load(std::memory_order_relaxed);
+		}
+
 		/**
 		 * @brief Stops all workers and releases resources
 		 * @param shutdownPolicy true for graceful shutdown (waiting for tasks to complete), false for immediate shutdown
@@ -287,6 +414,32 @@ namespace HSLL
 		ThreadPool& operator=(const ThreadPool&) = delete;
 
 	private:
+		/**
+		 * @brief Allocates and initializes the per-worker queues
+		 * @return true if all queues were created, false otherwise
+		 */
+		bool create_queues(unsigned int queueLength, unsigned int threadNum)
+		{
+			queues = new (std::nothrow) QUEUE<T>[threadNum];
+
+			if (!queues)
+				return false;
+
+			for (unsigned i = 0; i < threadNum; ++i)
+			{
+				if (!queues[i].init(queueLength))
+				{
+					delete[] queues;
+					queues = nullptr;
+					return false;
+				}
+			}
+
+			this->threadNum = threadNum;
+			this->queueLength = queueLength;
+			return true;
+		}
+
 		/**
 		 * @brief Gets next queue index using round-robin
 		 */
@@ -300,7 +453,10 @@ namespace HSLL
 		 */
 		void worker(unsigned int index, unsigned batchSize) noexcept
 		{
-			std::vector<TPBlockQueue<T>*> other;
+			if (threadInit)
+				threadInit(threadArg, index);
+
+			std::vector<QUEUE<T>*> other;
 			other.reserve(threadNum - 1);
 
 			for (unsigned i = 0; i < threadNum; ++i)
@@ -311,36 +467,36 @@ namespace HSLL
 
 			if (batchSize == 1)
 			{
-				process_single(std::ref(queues[index]), std::ref(other), shutdownPolicy);
+				process_single(std::ref(queues[index]), std::ref(other), stealThreshold, spinWindow, shutdownPolicy, stolen);
 			}
 			else
 			{
-				process_bulk(std::ref(queues[index]), std::ref(other), batchSize, shutdownPolicy);
+				process_bulk(std::ref(queues[index]), std::ref(other), batchSize, stealThreshold, spinWindow, shutdownPolicy, stolen);
 			}
 		}
 
 		/**
 		 * @brief  Processes single task at a time
 		 */
-		static void process_single(TPBlockQueue<T>& queue, std::vector<TPBlockQueue<T>*>& other, bool& safeExit)
+		static void process_single(QUEUE<T>& queue, std::vector<QUEUE<T>*>& other, unsigned int stealThreshold, unsigned int spinWindow, bool& safeExit, std::atomic<unsigned long long>& stolen)
 		{
 			struct Stealer
 			{
 				unsigned int index;
 				unsigned int total;
 				unsigned int threshold;
-				std::vector<TPBlockQueue<T>*>& other;
+				std::vector<QUEUE<T>*>& other;
 
-				Stealer(std::vector<TPBlockQueue<T>*>& other, unsigned int maxLength)
+				Stealer(std::vector<QUEUE<T>*>& other, unsigned int stealThreshold, unsigned int maxLength)
 					: other(other), index(0), total(other.size()),
-					threshold(std::min(total, maxLength)) {}
+					threshold(std::min(stealThreshold ? stealThreshold : total, maxLength)) {}
 
 				bool steal(T& element)
 				{
 					for (int i = 0; i < total; ++i)
 					{
 						unsigned int now = (index + i) % total;
-						if (other[now]->size >= threshold)
+						if (other[now]->length() >= threshold)
 						{
 							if (other[now]->template pop<PLACE>(element))
 							{
@@ -355,12 +511,23 @@ namespace HSLL
 
 			char storage[sizeof(T)];
 			T* task = (T*)(&storage);
-			Stealer stealer(other, queue.maxSize);
+			Stealer stealer(other, stealThreshold, queue.capacity());
+			TPBusyPoll spinner;
+			spinner.init(spinWindow);
+
+			auto poll = [&queue, task]() { return queue.template pop<PLACE>(*task); };
 
 			if (!other.size())
 			{
-				while (queue.template wait_pop<PLACE>(*task))
+				while (true)
 				{
+					if (!spinner.spin(poll))
+					{
+						if (!queue.template wait_pop<PLACE>(*task))
+							break;
+						spinner.arrived();
+					}
+
 					task->execute();
 					task->~T();
 				}
@@ -377,6 +544,12 @@ namespace HSLL
 					}
 
 					if (stealer.steal(*task))
+					{
+						stolen.fetch_add(1, std::memory_order_relaxed);
+						task->execute();
+						task->~T();
+					}
+					else if (spinner.spin(poll))
 					{
 						task->execute();
 						task->~T();
@@ -385,10 +558,11 @@ namespace HSLL
 					{
 						if (queue.template wait_pop<PLACE>(*task, std::chrono::milliseconds(HSLL_THREADPOOL_TIMEOUT)))
 						{
+							spinner.arrived();
 							task->execute();
 							task->~T();
 						}
-						else if (queue.isStopped)
+						else if (queue.stopped())
 						{
 							return;
 						}
@@ -418,7 +592,7 @@ namespace HSLL
 		/**
 		 * @brief  Processes multiple tasks at a time
 		 */
-		static void process_bulk(TPBlockQueue<T>& queue, std::vector<TPBlockQueue<T>*>& other, unsigned batchSize, bool& safeExit)
+		static void process_bulk(QUEUE<T>& queue, std::vector<QUEUE<T>*>& other, unsigned batchSize, unsigned int stealThreshold, unsigned int spinWindow, bool& safeExit, std::atomic<unsigned long long>& stolen)
 		{
 			struct Stealer
 			{
@@ -426,18 +600,18 @@ namespace HSLL
 				unsigned int total;
 				unsigned int batchSize;
 				unsigned int threshold;
-				std::vector<TPBlockQueue<T>*>& other;
+				std::vector<QUEUE<T>*>& other;
 
-				Stealer(std::vector<TPBlockQueue<T>*>& other, unsigned int batchSize, unsigned int maxLength)
+				Stealer(std::vector<QUEUE<T>*>& other, unsigned int batchSize, unsigned int stealThreshold, unsigned int maxLength)
 					: other(other), index(0), total(other.size()), batchSize(batchSize),
-					threshold(std::min(batchSize* total, maxLength)) {}
+					threshold(std::min(stealThreshold ? stealThreshold : batchSize* total, maxLength)) {}
 
 				unsigned int steal(T* elements)
 				{
 					for (int i = 0; i < total; ++i)
 					{
 						unsigned int now = (index + i) % total;
-						if (other[now]->size >= threshold)
+						if (other[now]->length() >= threshold)
 						{
 							unsigned int count = other[now]->template popBulk<PLACE>(elements, batchSize);
 							if (count)
@@ -454,12 +628,25 @@ namespace HSLL
 			T* tasks = (T*)((void*)operator new[](batchSize * sizeof(T)));
 			assert(tasks && "Failed to allocate task buffer");
 			unsigned int count;
-			Stealer stealer(other, batchSize, queue.maxSize);
+			Stealer stealer(other, batchSize, stealThreshold, queue.capacity());
+			TPBusyPoll spinner;
+			spinner.init(spinWindow);
+
+			auto poll = [&queue, tasks, batchSize, &count]() { return (count = queue.template popBulk<PLACE>(tasks, batchSize)) != 0; };
 
 			if (!other.size())
 			{
-				while (count = queue.template wait_popBulk<PLACE>(tasks, batchSize))
+				while (true)
+				{
+					if (!spinner.spin(poll))
+					{
+						if (!(count = queue.template wait_popBulk<PLACE>(tasks, batchSize)))
+							break;
+						spinner.arrived();
+					}
+
 					execute_tasks(tasks, count);
+				}
 			}
 			else
 			{
@@ -470,6 +657,11 @@ namespace HSLL
 
 					count = stealer.steal(tasks);
 					if (count)
+					{
+						stolen.fetch_add(count, std::memory_order_relaxed);
+						execute_tasks(tasks, count);
+					}
+					else if (spinner.spin(poll))
 					{
 						execute_tasks(tasks, count);
 					}
@@ -478,8 +670,11 @@ namespace HSLL
 						count = queue.template wait_popBulk<PLACE>(tasks, batchSize, std::chrono::milliseconds(HSLL_THREADPOOL_TIMEOUT));
 
 						if (count)
+						{
+							spinner.arrived();
 							execute_tasks(tasks, count);
-						else if (queue.isStopped)
+						}
+						else if (queue.stopped())
 							break;
 					}
 				}
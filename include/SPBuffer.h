@@ -1,12 +1,17 @@
 #ifndef HSLL_BUFFER
 #define HSLL_BUFFER
 
+#include <sys/uio.h>
+
 namespace HSLL
 {
     /**
      * @brief Circular buffer implementation for efficient I/O operations
      * This class provides a thread-unsafe circular buffer with separate
-     * read and write pointers, optimized for network I/O operations
+     * read and write pointers, optimized for network I/O operations.
+     * When BUFFER_CHUNK_SIZE is configured the buffer is instead a chain of pool
+     * chunks that grows on demand up to the configured capacity and returns its
+     * chunks to the pool once they are drained.
      */
     class SPBuffer
     {
@@ -37,6 +42,50 @@ namespace HSLL
          */
         unsigned int distanceRead();
 
+        /**
+         * @brief Get the free space of the buffer as I/O vectors
+         * @param vec Destination array
+         * @param max Number of entries available in vec (at least two)
+         * @return Number of entries filled, two when the ring free space wraps around
+         * @note In chained mode spare chunks are allocated to fill the vectors,
+         *       call release() if they end up unused
+         */
+        unsigned int writeVec(iovec *vec, unsigned int max);
+
+        /**
+         * @brief Get the stored data of the buffer as I/O vectors
+         * @param vec Destination array
+         * @param max Number of entries available in vec (at least two)
+         * @return Number of entries filled, two when the ring data wraps around
+         */
+        unsigned int readVec(iovec *vec, unsigned int max);
+
+        /**
+         * @brief Get a range of the stored data as I/O vectors without copying
+         * @param vec Destination array
+         * @param max Number of entries available in vec
+         * @param offset Bytes to skip from the front of the stored data
+         * @param len Length of the range in bytes
+         * @return Number of entries filled, 0 if the range is empty, not stored or needs more than max entries
+         */
+        unsigned int viewVec(iovec *vec, unsigned int max, unsigned int offset, unsigned int len);
+
+        /**
+         * @brief Search the stored data for a byte sequence
+         * @param pattern Byte sequence to search for
+         * @param len Length of the sequence
+         * @param from Offset in the stored data to start searching at
+         * @return Offset of the first match at or after from, -1 if not found
+         * @note Candidates are located with memchr, matches may span ring or chunk boundaries
+         */
+        long find(const void *pattern, unsigned int len, unsigned int from);
+
+        /**
+         * @brief Return storage holding no data to the pool
+         * @note Releases spare chunks in chained mode and the ring itself once it is empty
+         */
+        void release();
+
         /**
          * @brief Commit read operations (advance read pointer)
          * @param len Number of bytes to advance read pointer
@@ -52,7 +101,7 @@ namespace HSLL
         /**
          * @brief Get direct write pointer
          * @return Pointer to current write position
-         * @warning Must check bytesWrite() before using
+         * @warning Must check distanceWrite() before using
          */
         unsigned char *writePtr();
 
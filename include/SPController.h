@@ -1,6 +1,8 @@
 #ifndef HSLL_SPCONTROLLER
 #define HSLL_SPCONTROLLER
 
+#include <sys/types.h>
+
 #include "SPTypes.h"
 #include "SPBuffer.h"
 
@@ -19,6 +21,12 @@ namespace HSLL
          */
         void *getCtx();
 
+        /**
+         * @brief Gets the binary address of the remote endpoint
+         * @return Peer address, format it with SPFormatPeer() when text is needed
+         */
+        const SPPeerAddr *getPeer();
+
         /**
          * @brief Checks if connection is in half-closed state
          * @return true indicates:
@@ -29,6 +37,21 @@ namespace HSLL
          */
         bool isPeerClosed();
 
+        /**
+         * @brief Checks whether the connection was handed over to a successor process
+         * @return true only in the close callback of a connection sent to the successor by the
+         *         handoff of SetHandoff(); the socket stays open there, so the callback should
+         *         release local state such as the context but not treat the peer as gone
+         */
+        bool isHandedOff();
+
+        /**
+         * @brief Checks if the connection is established
+         * @return false only for an outbound connection whose Connect() attempt has not completed,
+         *         such as in the close callback of a failed or timed-out attempt
+         */
+        bool isConnected();
+
         /**
          * @brief Reads data from the read buffer
          * @param buf Buffer to store the read data
@@ -66,12 +89,42 @@ namespace HSLL
          *       - Read buffer may still contain pending data (check getReadBufferSize())
          *       - Subsequent write operations will fail
          *       - Must call Close() after consuming all read buffer data
+         * @note With TLS enabled, after a return of 0 or a short write the unsent bytes
+         *       must be offered again (same content, possibly from another address)
+         *       before any other data on this connection, as OpenSSL requires
          */
         ssize_t write(const void *buf, size_t len);
 
         /**
-         * @brief Commits buffered writes to the socket
-         * @return Number of bytes remaining in write buffer (0 if all sent),
+         * @brief Queues a user buffer to be sent without copying
+         * @param buf Payload buffer, owned by the caller until proc is invoked
+         * @param len Payload size in bytes
+         * @param proc Completion callback (nullptr for none)
+         * @param arg Argument passed to proc
+         * @return true if queued, false on allocation failure or empty payload
+         * @note Data is sent in order with writeTemp() data by commitWrite().
+         *       Payloads of at least 16KB use MSG_ZEROCOPY and
+         *       complete once the kernel releases the pages. proc runs on the thread
+         *       currently owning the connection, with sent == false if the connection
+         *       closed before the payload was handed to the kernel.
+         */
+        bool sendZeroCopy(const void *buf, size_t len, SendCompleteProc proc = nullptr, void *arg = nullptr);
+
+        /**
+         * @brief Queues a file range to be sent with sendfile
+         * @param fd Source file descriptor, owned by the caller until proc is invoked
+         * @param offset Start offset in the file
+         * @param len Number of bytes to send
+         * @param proc Completion callback (nullptr for none)
+         * @param arg Argument passed to proc
+         * @return true if queued, false on allocation failure or empty range
+         * @note Same ordering and completion rules as sendZeroCopy()
+         */
+        bool sendFile(int fd, off_t offset, size_t len, SendCompleteProc proc = nullptr, void *arg = nullptr);
+
+        /**
+         * @brief Commits buffered writes and queued zero-copy requests to the socket
+         * @return Number of bytes remaining in write buffer and send queue (0 if all sent),
          *        -1 for system errors,
          *        -2 if connection is half-closed by peer
          * @note For return code -2:
@@ -83,6 +136,8 @@ namespace HSLL
 
         /**
          * @brief Direct writeback from read buffer
+         * @details Pending write buffer data and read buffer data are flushed
+         *          together with a single gather write
          * @return Total bytes successfully written (>=0),
          *        -1 for system errors,
          *        -2 if connection reset by peer
@@ -101,7 +156,7 @@ namespace HSLL
 
         /**
          * @brief Get the size of data pending in the write buffer
-         * @return Number of bytes waiting to be sent
+         * @return Number of bytes waiting to be sent, including queued zero-copy requests
          */
         size_t getWriteBufferSize();
 
@@ -139,6 +194,41 @@ namespace HSLL
          */
         size_t moveToWriteBuffer();
 
+        /**
+         * @brief Arms the connection timer
+         * @param ms Milliseconds until expiry, replacing the currently armed expiry
+         * @return false if no timer callback is registered or the loop runs on io_uring
+         * @note Timers fire once with SPSOCK_TIMER_TICK (10 ms) resolution, never early. The timer
+         *       callback is dispatched like a read/write callback: it never runs concurrently
+         *       with another callback of the connection and must end with enableEvents() or close().
+         *       Call only from a callback of this connection.
+         */
+        bool setTimer(unsigned int ms);
+
+        /**
+         * @brief Disarms the connection timer
+         * @note A timer that expired while a callback owned the connection is still delivered
+         */
+        void cancelTimer();
+
+        /**
+         * @brief Overrides the watermarks of this connection
+         * @param readMark Minimum bytes to trigger the read callback (0 for every read)
+         * @param writeMark Maximum buffered bytes to trigger the write callback (0xffffffff for every write event)
+         * @note New connections start with the marks set by SetWaterMark(). Call only from a
+         *       callback of this connection; the marks apply from its next event.
+         */
+        void setWaterMark(unsigned int readMark, unsigned int writeMark);
+
+        /**
+         * @brief Bounds how long data below the read watermark is held
+         * @param us Microseconds after which held data is dispatched anyway (0 waits for the mark)
+         * @return false if the loop runs on io_uring
+         * @note The bound is enforced by the loop's epoll_wait timeout (millisecond granularity,
+         *       never early). Call only from a callback of this connection.
+         */
+        bool setDispatchLatency(unsigned int us);
+
         /**
          * @brief Re-enables event monitoring for the socket
          * @param read Enable read events
@@ -4,6 +4,7 @@
 
 #include <signal.h>
 #include <sys/epoll.h>
+#include <string>
 
 #include "noncopyable.h"
 #include "SPController.h"
@@ -23,7 +24,7 @@ namespace HSLL
          * @param config Configuration structure with tuning parameters
          * @note Must be called before instance creation
          */
-        static void Config(SPTcpConfig config = {16 * 1024, 32 * 1024, 16, 64, 5000, EPOLLIN, 10000, 10, 5, 0.6, LOG_LEVEL_WARNING});
+        static void Config(SPTcpConfig config = {16 * 1024, 32 * 1024, 16, 64, 5000, EPOLLIN, 10000, 10, 5, 0.6, LOG_LEVEL_WARNING, ACCEPT_MODE_MAIN, 0, 0, DISPATCH_MODE_POOL, IO_ENGINE_EPOLL, 0, TRIGGER_MODE_ONESHOT, nullptr, nullptr, 0, AFFINITY_MODE_NONE, 32, 0});
 
         /**
          * @brief Gets singleton instance reference
@@ -37,9 +38,53 @@ namespace HSLL
          * @param port Network port to bind
          * @param ip Null-terminated string representing IPv4/IPv6 address
          * @return true if listen succeeded, false on error
-         * @note One-time call during initialization
+         * @note May be called up to SPSOCK_MAX_LISTENERS times. Each listener keeps the callbacks,
+         *       keep-alive, linger, offload, framer and watermark settings made before its call;
+         *       the last one also takes settings made after it. All listeners share the IO loops,
+         *       worker thread pool and buffer pools.
+         */
+        bool Listen(unsigned short port, const char *ip = nullptr);
+
+        /**
+         * @brief Takes over the listening sockets and connections of a running predecessor
+         * @param path Unix socket path the predecessor passed to SetHandoff()
+         * @return true if the listening sockets were received
+         * @note Must be called before Listen(). Listen() then reuses the received socket bound to
+         *       the same address, so connections queued on it are not lost. Connections the
+         *       predecessor hands over while exiting are adopted by the event loop: they pass
+         *       through the connect callback of the listener with their port, and their unread
+         *       bytes are delivered to the first read callback.
+         */
+        bool TakeOver(const char *path);
+
+        /**
+         * @brief Hands the listening sockets and open connections to a successor on request
+         * @param path Unix socket path for TakeOver() ('@' prefix for the abstract namespace)
+         * @return true if the handoff socket was created
+         * @note Must be called before EventLoop(). Once a successor connects, its listeners are
+         *       sent and the event loop exits as if signalled, after the worker queues drained.
+         *       Open connections are then sent with their unread bytes, except TLS, connecting or
+         *       half-closed ones, those with unsent data and those of io_uring loops, which are
+         *       closed. The close callback runs for every connection in this process; for the
+         *       ones sent to the successor SOCKController::isHandedOff() returns true in it.
+         */
+        bool SetHandoff(const char *path);
+
+        /**
+         * @brief Opens an outbound connection monitored by one of the IO loops
+         * @param ip Null-terminated string representing IPv4/IPv6 address of the peer
+         * @param port Peer port
+         * @param ctx Context pointer of the connection (see SOCKController::getCtx())
+         * @param timeout Connect timeout in milliseconds (0 leaves it to the kernel's SYN retries)
+         * @return true if the attempt started, false on error
+         * @note Callable from any thread while EventLoop() runs; called on an IO thread (inline
+         *       callbacks) the connection stays on that thread, otherwise it goes to the least
+         *       loaded one. The connection uses the callbacks and options in effect when
+         *       EventLoop() started; once established it is handled as a write event (write
+         *       callback first when set). A failed or timed-out attempt runs the close callback,
+         *       where SOCKController::isConnected() returns false.
          */
-        bool Listen(unsigned short port, const char *ip = nullptr) SPSOCK_ONE_TIME_CALL;
+        bool Connect(const char *ip, unsigned short port, void *ctx = nullptr, unsigned int timeout = 0);
 
         /**
          * @brief Enters main event processing loop
@@ -48,6 +93,17 @@ namespace HSLL
          */
         bool EventLoop() SPSOCK_ONE_TIME_CALL;
 
+        /**
+         * @brief Enables TLS on the listeners created afterwards
+         * @param certFile PEM certificate chain file (nullptr makes later listeners plaintext again)
+         * @param keyFile PEM private key file
+         * @return true if the context was created, false on error or without TLS support
+         * @note Requires a build with SPSOCK_TLS (OpenSSL), the epoll engine and a READ_BSIZE of at
+         *       least 16KB. Callbacks see plaintext through the usual read/write API. Ignores
+         *       SIGPIPE for the process, since OpenSSL writes to the socket without MSG_NOSIGNAL.
+         */
+        bool EnableTls(const char *certFile, const char *keyFile);
+
         /**
          * @brief Configures socket linger options
          * @param enable Enable/disable lingering
@@ -76,12 +132,70 @@ namespace HSLL
          */
         bool SetCallback(ConnectProc cnp = nullptr, CloseProc csp = nullptr, ReadProc rdp = nullptr, WriteProc wtp = nullptr);
 
+        /**
+         * @brief Registers a connection callback taking the binary peer address
+         * @param cnap New connection callback, called without formatting the address
+         * @return false if null callback, true otherwise
+         * @note Replaces the ConnectProc registered with SetCallback() (and vice versa)
+         */
+        bool SetConnectCallback(ConnectAddrProc cnap);
+
+        /**
+         * @brief Registers the callback of expired connection timers
+         * @param tmp Timer callback, dispatched like a read/write callback
+         * @return false if null callback, true otherwise
+         * @note Enables SOCKController::setTimer() on epoll event loops. Must be called before EventLoop().
+         */
+        bool SetTimerCallback(TimerProc tmp);
+
+        /**
+         * @brief Registers a framer replacing the read callback
+         * @param config Framing configuration (length-prefixed or delimiter-based)
+         * @param frp Callback invoked once per complete frame with I/O vectors pointing into the read buffer
+         * @return false if the configuration is invalid or the callback is null, true otherwise
+         * @note Frames are consumed after frp returns. frp must not call enableEvents() or close():
+         *       return false to close the connection. Buffered writes are flushed after the last frame.
+         */
+        bool SetFramer(const SPFrameConfig &config, FrameProc frp);
+
         /**
          * @brief Sets buffer thresholds for event triggering
          * @param readMark Minimum bytes to trigger read callback
          * @param writeMark Maximum buffered bytes to trigger write callback
+         * @param maxLatency Microseconds after which data below readMark is dispatched anyway (0 to wait)
+         * @note Defaults of connections accepted afterwards, see SOCKController::setWaterMark()
+         */
+        void SetWaterMark(unsigned int readMark = 0, unsigned int writeMark = 0xffffffff, unsigned int maxLatency = 0);
+
+        /**
+         * @brief Keeps selected callbacks on the worker thread pool in DISPATCH_MODE_INLINE
+         * @param read Submit read callbacks to the worker thread pool
+         * @param write Submit write callbacks to the worker thread pool
+         * @note Intended for slow or blocking handlers; ignored in DISPATCH_MODE_POOL
+         */
+        void SetOffload(bool read = false, bool write = false);
+
+        /**
+         * @brief Enables timestamping of queue waits and callback durations
+         * @param enable Record the latency histograms reported by GetMetrics()
+         * @note Counters are always maintained; timing adds two TSC reads per callback.
+         *       The first call calibrates the TSC for about 10ms.
+         */
+        void EnableTimingMetrics(bool enable = true);
+
+        /**
+         * @brief Takes a snapshot of the event loop metrics
+         * @return Counters and gauges summed over all IO loops, latency histograms of all threads
+         * @note May be called from any thread (including callbacks) while EventLoop() runs
+         */
+        SPTcpMetrics GetMetrics();
+
+        /**
+         * @brief Formats a metrics snapshot in the Prometheus text exposition format
+         * @return Metrics named spsock_tcp_*, latencies as histograms in seconds
+         * @note Same calling rules as GetMetrics()
          */
-        void SetWaterMark(unsigned int readMark = 0, unsigned int writeMark = 0xffffffff);
+        std::string DumpMetrics();
 
         /**
          * @brief Registers signal handler for graceful shutdown
@@ -116,7 +230,7 @@ namespace HSLL
          * @param config Configuration structure with tuning parameters
          * @note Must be called before instance creation
          */
-        static void Config(SPUdpConfig config = {4 * 1024 * 1024, 1452, LOG_LEVEL_WARNING});
+        static void Config(SPUdpConfig config = {4 * 1024 * 1024, 1452, LOG_LEVEL_WARNING, 0, 0, 0, 0});
 
         /**
          * @brief Gets singleton instance reference
@@ -151,6 +265,65 @@ namespace HSLL
          */
         bool SendTo(int sockfd, const void *data, size_t size, const char *ip, unsigned short port);
 
+        /**
+         * @brief Sends data to a pre-resolved destination
+         * @param sockfd Socket descriptor to use for sending
+         * @param data Pointer to data buffer to send
+         * @param size Size of data to send in bytes
+         * @param peer Destination from a receive callback or SPResolvePeer()
+         * @return true if send operation succeeded, false on error
+         */
+        bool SendTo(int sockfd, const void *data, size_t size, const SPPeerAddr *peer);
+
+        /**
+         * @brief Sends data on a socket returned by Connect()
+         * @param sockfd Connected socket descriptor
+         * @param data Pointer to data buffer to send
+         * @param size Size of data to send in bytes
+         * @return true if send operation succeeded, false on error
+         */
+        bool Send(int sockfd, const void *data, size_t size);
+
+        /**
+         * @brief Opens a connected socket on the bound port for a hot peer
+         * @param peer Remote endpoint the socket is connected to
+         * @return Socket descriptor, -1 on error
+         * @note The kernel skips the route lookup on sends and delivers the peer's datagrams
+         *       to this socket, which joins one of the event loops. The socket stays
+         *       open until the event loop exits. May be called from receive callbacks.
+         */
+        int Connect(const SPPeerAddr *peer);
+
+        /**
+         * @brief Gets the counters of the worker offload
+         * @return Dispatched and dropped datagram counts since the event loop started
+         * @note Drops happen when a worker queue or the buffer pool is exhausted (backpressure)
+         */
+        SPUdpOffloadStats GetOffloadStats();
+
+        /**
+         * @brief Sends a batch of datagrams with sendmmsg
+         * @param sockfd Socket descriptor to use for sending
+         * @param datagrams Datagrams to send, each with its own destination
+         * @param num Number of datagrams
+         * @return Number of datagrams sent (less than num if the socket buffer filled up), -1 on error
+         */
+        int SendToBatch(int sockfd, const SPUdpDatagram *datagrams, unsigned int num);
+
+        /**
+         * @brief Sends a buffer as consecutive datagrams of a fixed segment size
+         * @param sockfd Socket descriptor to use for sending
+         * @param data Buffer containing the payloads back to back
+         * @param size Buffer size in bytes (at most 64 segments and 65507 bytes with UDP_SEGMENT)
+         * @param segment Payload size of every datagram but the last
+         * @param ip Destination IP address
+         * @param port Destination port number
+         * @return true if all datagrams were sent, false on error
+         * @note Uses a single UDP_SEGMENT (GSO) send where supported, otherwise SendToBatch()
+         */
+        bool SendToSegments(int sockfd, const void *data, size_t size, unsigned short segment,
+                            const char *ip, unsigned short port);
+
         /**
          * @brief Registers signal handler for shutdown
          * @param sg Signal number to handle
@@ -166,6 +339,24 @@ namespace HSLL
          */
         bool SetCallback(RecvProc rcp, void *ctx = nullptr);
 
+        /**
+         * @brief Registers batched receive callback
+         * @param rbp Handler receiving every datagram of a recvmmsg call at once
+         * @param ctx User context pointer (optional)
+         * @return false if null callback, true otherwise
+         * @note Replaces a callback registered with SetCallback(RecvProc)
+         */
+        bool SetCallback(RecvBatchProc rbp, void *ctx = nullptr);
+
+        /**
+         * @brief Registers receive callback taking the binary peer address
+         * @param rap Datagram receive handler, called without formatting the address
+         * @param ctx User context pointer (optional)
+         * @return false if null callback, true otherwise
+         * @note Replaces a callback registered with the other SetCallback() overloads
+         */
+        bool SetCallback(RecvAddrProc rap, void *ctx = nullptr);
+
         /**
          * @brief Signals event loop to terminate
          */
@@ -3,6 +3,7 @@
 
 #include <netinet/in.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 
 namespace HSLL
 {
@@ -10,8 +11,13 @@ namespace HSLL
 /// Marks functions that should only be called once
 #define SPSOCK_ONE_TIME_CALL
 
+/// Maximum number of listening sockets of one TCP event loop (Listen() calls)
+#define SPSOCK_MAX_LISTENERS 8
+
     // Forward declaration of SOCKController class
     class SOCKController;
+    struct SPUdpDatagram;
+    struct SPPeerAddr;
 
     /// Callback function type for read events
     typedef void (*ReadProc)(SOCKController *controller);
@@ -21,10 +27,22 @@ namespace HSLL
     typedef void (*ReadWriteProc)(SOCKController *controller);
     ///< Connection callback type
     typedef void *(*ConnectProc)(const char *ip, unsigned short port);
+    /// Connection callback type receiving the binary peer address
+    typedef void *(*ConnectAddrProc)(const SPPeerAddr *peer);
     /// Callback function type for connection close events
     typedef void (*CloseProc)(SOCKController *controller);
+    /// Callback function type for expired connection timers
+    typedef void (*TimerProc)(SOCKController *controller);
+    /// Frame callback type (frame: payload in place in the read buffer; return false to close the connection)
+    typedef bool (*FrameProc)(SOCKController *controller, const iovec *frame, unsigned int num);
     /// Callback function type for event loop exit events
     typedef void (*RecvProc)(void *ctx, int fd, const char *data, size_t size, const char *ip, unsigned short port);
+    /// Receive event callback type receiving the binary peer address
+    typedef void (*RecvAddrProc)(void *ctx, int fd, const char *data, size_t size, const SPPeerAddr *peer);
+    /// Batched datagram receive callback type (entries stay valid until the callback returns)
+    typedef void (*RecvBatchProc)(void *ctx, int fd, SPUdpDatagram *datagrams, unsigned int num);
+    /// Completion callback type for zero-copy sends (sent: whole payload handed to the kernel)
+    typedef void (*SendCompleteProc)(SOCKController *controller, void *arg, bool sent);
 
     /**
      * @brief Address family types for socket operations
@@ -47,6 +65,61 @@ namespace HSLL
         LOG_LEVEL_NONE = 10    ///< No messages
     };
 
+    /**
+     * @brief Enumeration for TCP connection acceptance strategies
+     */
+    enum ACCEPT_MODE
+    {
+        ACCEPT_MODE_MAIN = 0,     ///< Single acceptor thread polls one listening socket and distributes connections
+        ACCEPT_MODE_REUSEPORT = 1 ///< Every IO event loop accepts on its own SO_REUSEPORT listening socket
+    };
+
+    /**
+     * @brief Enumeration for TCP read/write callback dispatch strategies
+     */
+    enum DISPATCH_MODE
+    {
+        DISPATCH_MODE_POOL = 0,  ///< Read/write callbacks are submitted to the worker thread pool
+        DISPATCH_MODE_INLINE = 1 ///< Read/write callbacks run to completion on the IO event loop thread
+    };
+
+    /**
+     * @brief Enumeration for worker queue selection of pooled TCP callbacks
+     */
+    enum AFFINITY_MODE
+    {
+        AFFINITY_MODE_NONE = 0,       ///< Tasks are distributed round-robin over the worker queues
+        AFFINITY_MODE_CONNECTION = 1, ///< Tasks of a connection always go to the queue selected by hashing its controller
+        AFFINITY_MODE_LOOP = 2        ///< Tasks of an IO event loop always go to the queue selected by the loop
+    };
+
+    /**
+     * @brief Enumeration for TCP IO event engines
+     */
+    enum IO_ENGINE
+    {
+        IO_ENGINE_EPOLL = 0, ///< epoll readiness notifications (rearming according to TRIGGER_MODE)
+        IO_ENGINE_URING = 1  ///< io_uring multishot accept/receive (falls back to epoll if unavailable)
+    };
+
+    /**
+     * @brief Enumeration for epoll readiness trigger strategies
+     */
+    enum TRIGGER_MODE
+    {
+        TRIGGER_MODE_ONESHOT = 0, ///< Level-triggered EPOLLONESHOT, rearmed with epoll_ctl after every callback
+        TRIGGER_MODE_EDGE = 1     ///< Edge-triggered EPOLLET, rearmed with epoll_ctl only when the interest changes
+    };
+
+    /**
+     * @brief Enumeration for message framing strategies
+     */
+    enum FRAME_MODE
+    {
+        FRAME_MODE_LENGTH = 0,   ///< Frames start with a fixed-width length header
+        FRAME_MODE_DELIMITER = 1 ///< Frames end with a delimiter byte sequence
+    };
+
     /**
      * @brief Main socket configuration structure
      * @details Contains all tunable parameters for socket performance and behavior
@@ -85,6 +158,45 @@ namespace HSLL
 
         ///< Minimum log printing level (valid LOG_LEVEL enum values)
         LOG_LEVEL MIN_LOG_LEVEL;
+
+        ///< Connection acceptance strategy (valid ACCEPT_MODE enum values)
+        ACCEPT_MODE IO_ACCEPT_MODE;
+
+        ///< Maximum number of blocks of each type a single thread's buffer pool may hold (0 for unlimited, otherwise ≥ BUFFER_POOL_PEER_ALLOC_NUM)
+        int BUFFER_POOL_MAX_BLOCK_NUM;
+
+        ///< Chunk size of chained read/write buffers (0 for fixed ring buffers, otherwise a multiple of 1024 ≤ READ_BSIZE and WRITE_BSIZE)
+        unsigned int BUFFER_CHUNK_SIZE;
+
+        ///< Read/write callback dispatch strategy (valid DISPATCH_MODE enum values)
+        DISPATCH_MODE IO_DISPATCH_MODE;
+
+        ///< IO event engine of the event loops (valid IO_ENGINE enum values)
+        IO_ENGINE IO_EVENT_ENGINE;
+
+        ///< Provided receive buffers per io_uring event loop (0 for 256, otherwise a power of two ≤ 32768)
+        unsigned int URING_BUFFER_NUM;
+
+        ///< Readiness trigger strategy of the epoll engine (valid TRIGGER_MODE enum values)
+        TRIGGER_MODE IO_TRIGGER_MODE;
+
+        ///< CPUs the IO loops are pinned to, one loop per CPU, e.g. "0-3,8" (nullptr for unpinned loops sized by WORKER_THREAD_RATIO)
+        const char *IO_CPU_LIST;
+
+        ///< CPUs the worker threads are pinned to, one worker per CPU (nullptr for the allowed CPUs not used by IO loops)
+        const char *WORKER_CPU_LIST;
+
+        ///< NUMA-aware placement (0 = disable, 1 = one worker pool per node, connections steered to loops on the node of their SO_INCOMING_CPU)
+        int NUMA_PLACEMENT;
+
+        ///< Worker queue selection of pooled read/write callbacks (valid AFFINITY_MODE enum values)
+        AFFINITY_MODE THREADPOOL_AFFINITY;
+
+        ///< Tasks a worker queue must hold before idle workers steal from it (32 by default, 0 for THREADPOOL_BATCH_SIZE_PROCESS times the other workers, capped at the queue length)
+        unsigned int THREADPOOL_STEAL_THRESHOLD;
+
+        ///< Maximum microseconds idle IO loops and workers spin before sleeping, adapted to the arrival rate (0 by default, sleeping at once)
+        unsigned int BUSY_POLL_US;
     };
 
     /**
@@ -101,6 +213,150 @@ namespace HSLL
 
         ///< Minimum log printing level (valid LOG_LEVEL enum values)
         LOG_LEVEL MIN_LOG_LEVEL;
+
+        ///< Datagrams received per recvmmsg call (0 for 32, otherwise 1-1024)
+        unsigned int RECV_BATCH_SIZE;
+
+        ///< Receive UDP_GRO coalesced datagrams on kernels that support it (0 = disable, 1 = enable)
+        int RECV_GRO;
+
+        ///< Worker threads running the receive callback (0 = run it on the receiving thread)
+        unsigned int THREADPOOL_THREADS;
+
+        ///< Queued datagrams per worker when offloading (0 for 1024)
+        unsigned int THREADPOOL_QUEUE_LENGTH;
+    };
+
+    /**
+     * @brief Message framing configuration of SPSockTcp::SetFramer()
+     */
+    struct SPFrameConfig
+    {
+        ///< Framing strategy (valid FRAME_MODE enum values)
+        FRAME_MODE MODE;
+
+        ///< Length header width in bytes (FRAME_MODE_LENGTH: 1, 2, 4 or 8)
+        unsigned int HEADER_SIZE;
+
+        ///< Length header byte order (FRAME_MODE_LENGTH: true for big endian/network order)
+        bool HEADER_BIG_ENDIAN;
+
+        ///< Whether the length header value counts the header itself (FRAME_MODE_LENGTH)
+        bool LENGTH_INCLUDES_HEADER;
+
+        ///< Delimiter ending every frame (FRAME_MODE_DELIMITER)
+        char DELIMITER[8];
+
+        ///< Delimiter length in bytes (FRAME_MODE_DELIMITER: 1-8)
+        unsigned int DELIMITER_SIZE;
+
+        ///< Maximum frame size including header or delimiter (0 for READ_BSIZE, otherwise ≤ READ_BSIZE); larger frames close the connection
+        unsigned int MAX_FRAME_SIZE;
+    };
+
+    /**
+     * @brief Counters of datagrams offloaded to the UDP worker pool
+     */
+    struct SPUdpOffloadStats
+    {
+        unsigned long long dispatched; ///< Datagrams handed to a worker
+        unsigned long long dropped;    ///< Datagrams dropped because no buffer or queue slot was free
+    };
+
+/**
+ * @brief Number of buckets of a latency histogram
+ * @details Values below 16ns get one bucket each, larger values four buckets per power of two
+ *          (at most 25% relative error). The last bucket also counts everything above ~16 minutes.
+ */
+#define SPSOCK_METRICS_BUCKETS 160
+
+    /**
+     * @brief Latency histogram in nanoseconds
+     */
+    struct SPLatencyStats
+    {
+        unsigned long long count;                            ///< Number of samples
+        unsigned long long sum;                              ///< Sum of all samples
+        unsigned long long max;                              ///< Largest sample
+        unsigned long long buckets[SPSOCK_METRICS_BUCKETS]; ///< Samples per bucket, see SPMetricsBucketBound()
+    };
+
+    /**
+     * @brief Snapshot of the TCP event loop metrics
+     * @details Counters accumulate since the event loop started; gauges are sampled by
+     *          the IO loops after each wait and summed over all loops.
+     */
+    struct SPTcpMetrics
+    {
+        unsigned long long waits;          ///< Returns of epoll_wait()/io_uring_enter()
+        unsigned long long events;         ///< Events (or completions) processed
+        unsigned long long accepted;       ///< Connections accepted
+        unsigned long long connected;      ///< Outbound connections established (Connect())
+        unsigned long long adopted;        ///< Connections handed over by the predecessor (TakeOver())
+        unsigned long long closed;         ///< Connections closed
+        unsigned long long inlineCalls;    ///< Callbacks run on the IO loops
+        unsigned long long pooledCalls;    ///< Callbacks submitted to the worker thread pool
+        unsigned long long submitFailures; ///< Submissions rejected by a full pool queue (connection rearmed instead)
+        unsigned long long closeListed;    ///< Connections closed through a loop's close list
+        unsigned long long steals;         ///< Tasks stolen between worker queues
+        unsigned int closeListMax;         ///< Longest close list drained at once
+        unsigned int queued;               ///< Tasks waiting in the worker queues
+        unsigned int connections;          ///< Active connections
+        unsigned int freeBuffers[3];       ///< Free pooled buffers (read, write, chunk)
+        unsigned int totalBuffers[3];      ///< Buffers carved from live pool blocks (read, write, chunk)
+        SPLatencyStats queueWait;          ///< Time tasks spent in the worker queues (with timing enabled)
+        SPLatencyStats callback;           ///< Run time of read/write/timer callbacks (with timing enabled)
+    };
+
+    /**
+     * @brief Gets the largest value counted by a latency histogram bucket
+     * @param index Bucket index (below SPSOCK_METRICS_BUCKETS)
+     * @return Inclusive upper bound in nanoseconds (ULLONG_MAX for the last bucket)
+     */
+    unsigned long long SPMetricsBucketBound(unsigned int index);
+
+    /**
+     * @brief Binary peer address handed to callbacks in place of a formatted string
+     * @details Also serves as a pre-resolved destination for SPSockUdp::SendTo()/Connect()
+     */
+    struct SPPeerAddr
+    {
+        unsigned short family;  ///< ADDRESS_FAMILY_INET or ADDRESS_FAMILY_INET6
+        unsigned short port;    ///< Port number (host byte order)
+        unsigned char addr[16]; ///< Address in network byte order (IPv4 uses the first 4 bytes)
+    };
+
+    /**
+     * @brief Formats the address part of a binary peer address
+     * @param peer Peer address to format
+     * @param ip Output buffer, at least INET6_ADDRSTRLEN bytes
+     * @param size Size of the output buffer
+     * @return ip, or nullptr if the address could not be formatted
+     */
+    const char *SPFormatPeer(const SPPeerAddr *peer, char *ip, size_t size);
+
+    /**
+     * @brief Parses an address string into a binary peer address
+     * @param ip IPv4 or IPv6 address string (use "::ffff:a.b.c.d" for IPv4 peers of an IPv6 socket)
+     * @param port Port number (host byte order)
+     * @param peer Binary peer address to fill
+     * @return false if ip format incorrect
+     * @note Resolve once and reuse the result with SendTo()/Connect() to skip inet_pton per send
+     */
+    bool SPResolvePeer(const char *ip, unsigned short port, SPPeerAddr *peer);
+
+    /**
+     * @brief Datagram entry of a batched receive or send
+     * @note Received datagrams carry the binary peer only (ip is nullptr).
+     *       Sending uses ip/port when ip is set, otherwise peer.
+     */
+    struct SPUdpDatagram
+    {
+        const char *data;    ///< Payload
+        size_t size;         ///< Payload size in bytes
+        const char *ip;      ///< Peer IP address (nullptr to use peer)
+        unsigned short port; ///< Peer port number (used with ip)
+        SPPeerAddr peer;     ///< Binary peer address
     };
 }
 
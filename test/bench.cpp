@@ -0,0 +1,682 @@
+#include "../SPSock.h"
+
+#include <sys/wait.h>
+#include <algorithm>
+#include <vector>
+
+using namespace HSLL;
+
+/**
+ * @brief Traffic pattern driven by the load generator
+ */
+enum BENCH_PATTERN
+{
+    PATTERN_ECHO,   ///< One request in flight per connection
+    PATTERN_RPC,    ///< `depth` pipelined requests in flight per connection
+    PATTERN_STREAM, ///< Continuous bulk transfer in both directions
+    PATTERN_UDP,    ///< `depth` datagrams in flight per socket
+};
+
+static const char *patternNames[] = {"echo", "rpc", "stream", "udp"};
+
+/**
+ * @brief Bytes a stream connection keeps in flight
+ */
+#define BENCH_STREAM_WINDOW (256 * 1024)
+
+/**
+ * @brief Command line options
+ */
+struct BenchOptions
+{
+    int pattern = -1;            ///< Pattern to run (-1 for all)
+    unsigned int conns = 64;     ///< Connections (UDP sockets) in total
+    unsigned int threads = 2;    ///< Load generator threads
+    unsigned int seconds = 3;    ///< Measured duration of every run
+    unsigned int size = 64;      ///< Request size in bytes (write size of the stream pattern)
+    unsigned int depth = 8;      ///< Requests in flight per connection (rpc/udp)
+    unsigned short port = 4568;  ///< Port of the server under test
+    bool sweep = false;          ///< Run every configuration of the sweep
+};
+
+/**
+ * @brief Server configuration under test
+ */
+struct BenchConfig
+{
+    const char *name;
+    SPTcpConfig config;
+};
+
+#define BENCH_TCP_CONFIG(rb, wb, submit, process, ratio, accept, chunk, dispatch, engine, trigger, busy)      \
+    {                                                                                                          \
+        rb * 1024, wb * 1024, 16, 64, 5000, EPOLLIN, 10000, submit, process, ratio, LOG_LEVEL_ERROR,           \
+            accept, 0, chunk * 1024, dispatch, engine, 0, trigger, nullptr, nullptr, 0, AFFINITY_MODE_NONE,    \
+            32, busy                                                                                           \
+    }
+
+static const BenchConfig configs[] = {
+    {"default", BENCH_TCP_CONFIG(16, 32, 10, 5, 0.6, ACCEPT_MODE_MAIN, 0, DISPATCH_MODE_POOL, IO_ENGINE_EPOLL, TRIGGER_MODE_ONESHOT, 0)},
+    {"buffers-4k", BENCH_TCP_CONFIG(4, 4, 10, 5, 0.6, ACCEPT_MODE_MAIN, 0, DISPATCH_MODE_POOL, IO_ENGINE_EPOLL, TRIGGER_MODE_ONESHOT, 0)},
+    {"buffers-64k", BENCH_TCP_CONFIG(64, 64, 10, 5, 0.6, ACCEPT_MODE_MAIN, 0, DISPATCH_MODE_POOL, IO_ENGINE_EPOLL, TRIGGER_MODE_ONESHOT, 0)},
+    {"chunk-4k", BENCH_TCP_CONFIG(16, 32, 10, 5, 0.6, ACCEPT_MODE_MAIN, 4, DISPATCH_MODE_POOL, IO_ENGINE_EPOLL, TRIGGER_MODE_ONESHOT, 0)},
+    {"chunk-16k", BENCH_TCP_CONFIG(16, 32, 10, 5, 0.6, ACCEPT_MODE_MAIN, 16, DISPATCH_MODE_POOL, IO_ENGINE_EPOLL, TRIGGER_MODE_ONESHOT, 0)},
+    {"batch-1", BENCH_TCP_CONFIG(16, 32, 1, 1, 0.6, ACCEPT_MODE_MAIN, 0, DISPATCH_MODE_POOL, IO_ENGINE_EPOLL, TRIGGER_MODE_ONESHOT, 0)},
+    {"batch-32", BENCH_TCP_CONFIG(16, 32, 32, 16, 0.6, ACCEPT_MODE_MAIN, 0, DISPATCH_MODE_POOL, IO_ENGINE_EPOLL, TRIGGER_MODE_ONESHOT, 0)},
+    {"workers-0.3", BENCH_TCP_CONFIG(16, 32, 10, 5, 0.3, ACCEPT_MODE_MAIN, 0, DISPATCH_MODE_POOL, IO_ENGINE_EPOLL, TRIGGER_MODE_ONESHOT, 0)},
+    {"workers-0.9", BENCH_TCP_CONFIG(16, 32, 10, 5, 0.9, ACCEPT_MODE_MAIN, 0, DISPATCH_MODE_POOL, IO_ENGINE_EPOLL, TRIGGER_MODE_ONESHOT, 0)},
+    {"reuseport", BENCH_TCP_CONFIG(16, 32, 10, 5, 0.6, ACCEPT_MODE_REUSEPORT, 0, DISPATCH_MODE_POOL, IO_ENGINE_EPOLL, TRIGGER_MODE_ONESHOT, 0)},
+    {"edge", BENCH_TCP_CONFIG(16, 32, 10, 5, 0.6, ACCEPT_MODE_MAIN, 0, DISPATCH_MODE_POOL, IO_ENGINE_EPOLL, TRIGGER_MODE_EDGE, 0)},
+    {"inline", BENCH_TCP_CONFIG(16, 32, 10, 5, 0.6, ACCEPT_MODE_MAIN, 0, DISPATCH_MODE_INLINE, IO_ENGINE_EPOLL, TRIGGER_MODE_ONESHOT, 0)},
+    {"inline-edge", BENCH_TCP_CONFIG(16, 32, 10, 5, 0.6, ACCEPT_MODE_MAIN, 0, DISPATCH_MODE_INLINE, IO_ENGINE_EPOLL, TRIGGER_MODE_EDGE, 0)},
+    {"uring", BENCH_TCP_CONFIG(16, 32, 10, 5, 0.6, ACCEPT_MODE_MAIN, 0, DISPATCH_MODE_POOL, IO_ENGINE_URING, TRIGGER_MODE_ONESHOT, 0)},
+    {"uring-inline", BENCH_TCP_CONFIG(16, 32, 10, 5, 0.6, ACCEPT_MODE_MAIN, 0, DISPATCH_MODE_INLINE, IO_ENGINE_URING, TRIGGER_MODE_ONESHOT, 0)},
+    {"busy-50", BENCH_TCP_CONFIG(16, 32, 10, 5, 0.6, ACCEPT_MODE_MAIN, 0, DISPATCH_MODE_POOL, IO_ENGINE_EPOLL, TRIGGER_MODE_ONESHOT, 50)},
+    {"inline-busy", BENCH_TCP_CONFIG(16, 32, 10, 5, 0.6, ACCEPT_MODE_MAIN, 0, DISPATCH_MODE_INLINE, IO_ENGINE_EPOLL, TRIGGER_MODE_ONESHOT, 50)},
+};
+
+/**
+ * @brief Results of one load generator thread
+ */
+struct BenchResult
+{
+    unsigned long long requests = 0;       ///< Completed requests (datagrams echoed back)
+    unsigned long long sent = 0;           ///< Bytes written
+    unsigned long long received = 0;       ///< Bytes read
+    unsigned long long lost = 0;           ///< Datagrams given up on (udp)
+    unsigned long long errors = 0;         ///< Connections that failed during the run
+    std::vector<unsigned int> latencies;   ///< Request latencies in nanoseconds
+    std::vector<unsigned long long> bytes; ///< Bytes read per connection
+};
+
+/**
+ * @brief Client side state of one connection (or UDP socket)
+ */
+struct BenchConn
+{
+    int fd = -1;
+    unsigned int inflight = 0;           ///< Requests sent and not yet answered
+    unsigned int offset = 0;             ///< Bytes of the current request already written
+    unsigned int partial = 0;            ///< Bytes of the current response already read
+    unsigned long long sent = 0;         ///< Bytes written in total (stream)
+    unsigned long long received = 0;     ///< Bytes read in total
+    unsigned long long lastReply = 0;    ///< Time of the last datagram received (udp)
+    std::vector<unsigned long long> ts;  ///< Send times of the requests in flight (FIFO)
+    size_t head = 0;                     ///< Oldest entry of ts
+};
+
+static unsigned long long Now()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int Connect(const BenchOptions &opt, bool udp)
+{
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(opt.port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    int fd = socket(AF_INET, udp ? SOCK_DGRAM : SOCK_STREAM, 0);
+    if (fd == -1)
+        return -1;
+
+    if (connect(fd, (sockaddr *)&addr, sizeof(addr)) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    int one = 1;
+    if (!udp)
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+}
+
+/**
+ * @brief Records the completion of the oldest request of a connection
+ */
+static void Complete(BenchConn &conn, BenchResult &result, unsigned long long now, unsigned long long end)
+{
+    unsigned long long start = conn.ts[conn.head];
+    conn.head = (conn.head + 1) % conn.ts.size();
+    conn.inflight--;
+
+    if (now <= end)
+    {
+        unsigned long long ns = now - start;
+        result.latencies.push_back(ns > 0xffffffffULL ? 0xffffffffU : (unsigned int)ns);
+        result.requests++;
+    }
+}
+
+/**
+ * @brief Writes requests until the connection has `depth` in flight or the socket is full
+ * @return false if the connection failed
+ */
+static bool FillTcp(BenchConn &conn, const BenchOptions &opt, unsigned int depth, const char *payload, BenchResult &result)
+{
+    while (conn.inflight < depth || conn.offset)
+    {
+        if (conn.offset == 0)
+            conn.ts[(conn.head + conn.inflight) % conn.ts.size()] = Now();
+
+        ssize_t n = send(conn.fd, payload + conn.offset, opt.size - conn.offset, MSG_NOSIGNAL);
+        if (n < 0)
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+
+        result.sent += n;
+        conn.offset += n;
+        if (conn.offset == opt.size)
+        {
+            conn.offset = 0;
+            conn.inflight++;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Runs a TCP pattern on the connections of one thread
+ */
+static void RunTcp(const BenchOptions &opt, unsigned int conns, BenchResult &result)
+{
+    const unsigned int depth = (opt.pattern == PATTERN_ECHO) ? 1 : opt.depth;
+    const bool stream = (opt.pattern == PATTERN_STREAM);
+    std::vector<char> payload(opt.size, 'x');
+    std::vector<char> buf(65536);
+    std::vector<BenchConn> list(conns);
+
+    int epfd = epoll_create1(0);
+
+    for (auto &conn : list)
+    {
+        if ((conn.fd = Connect(opt, false)) == -1)
+        {
+            result.errors++;
+            continue;
+        }
+
+        conn.ts.resize(depth + 1);
+        epoll_event ev = {EPOLLIN | EPOLLOUT | EPOLLET};
+        ev.data.ptr = &conn;
+        epoll_ctl(epfd, EPOLL_CTL_ADD, conn.fd, &ev);
+    }
+
+    epoll_event events[256];
+    const unsigned long long end = Now() + opt.seconds * 1000000000ULL;
+
+    while (Now() < end)
+    {
+        int nfds = epoll_wait(epfd, events, 256, 10);
+
+        for (int i = 0; i < nfds; i++)
+        {
+            BenchConn &conn = *(BenchConn *)events[i].data.ptr;
+            if (conn.fd == -1)
+                continue;
+
+            bool ok = true;
+            ssize_t n;
+
+            while ((n = recv(conn.fd, buf.data(), buf.size(), 0)) > 0)
+            {
+                conn.received += n;
+                result.received += n;
+                if (stream)
+                    continue;
+
+                conn.partial += n;
+                unsigned long long now = Now();
+                while (conn.partial >= opt.size && conn.inflight)
+                {
+                    conn.partial -= opt.size;
+                    Complete(conn, result, now, end);
+                }
+            }
+
+            if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK))
+                ok = false;
+
+            if (ok && stream)
+            {
+                while (conn.sent - conn.received < BENCH_STREAM_WINDOW)
+                {
+                    size_t len = std::min<unsigned long long>(opt.size, BENCH_STREAM_WINDOW - (conn.sent - conn.received));
+                    if ((n = send(conn.fd, payload.data(), len, MSG_NOSIGNAL)) < 0)
+                    {
+                        ok = (errno == EAGAIN || errno == EWOULDBLOCK);
+                        break;
+                    }
+
+                    conn.sent += n;
+                    result.sent += n;
+                }
+            }
+            else if (ok)
+            {
+                ok = FillTcp(conn, opt, depth, payload.data(), result);
+            }
+
+            if (!ok)
+            {
+                result.errors++;
+                close(conn.fd);
+                conn.fd = -1;
+            }
+        }
+    }
+
+    for (auto &conn : list)
+    {
+        if (stream)
+            result.requests += conn.received / opt.size;
+
+        result.bytes.push_back(conn.received);
+        if (conn.fd != -1)
+            close(conn.fd);
+    }
+    close(epfd);
+}
+
+/**
+ * @brief Runs the UDP flood on the sockets of one thread
+ * @details Every datagram carries its send time; sockets that received nothing for 50ms
+ *          write off their datagrams in flight as lost and start over.
+ */
+static void RunUdp(const BenchOptions &opt, unsigned int conns, BenchResult &result)
+{
+    const unsigned int size = std::max(opt.size, (unsigned int)sizeof(unsigned long long));
+    std::vector<char> payload(size, 'x');
+    std::vector<char> buf(65536);
+    std::vector<BenchConn> list(conns);
+
+    int epfd = epoll_create1(0);
+
+    for (auto &conn : list)
+    {
+        if ((conn.fd = Connect(opt, true)) == -1)
+        {
+            result.errors++;
+            continue;
+        }
+
+        epoll_event ev = {EPOLLIN};
+        ev.data.ptr = &conn;
+        epoll_ctl(epfd, EPOLL_CTL_ADD, conn.fd, &ev);
+    }
+
+    epoll_event events[256];
+    const unsigned long long end = Now() + opt.seconds * 1000000000ULL;
+    unsigned long long now = Now();
+
+    while (now < end)
+    {
+        for (auto &conn : list)
+        {
+            if (conn.fd == -1)
+                continue;
+
+            if (conn.inflight && now - conn.lastReply > 50000000ULL)
+            {
+                result.lost += conn.inflight;
+                conn.inflight = 0;
+            }
+
+            while (conn.inflight < opt.depth)
+            {
+                unsigned long long stamp = Now();
+                memcpy(payload.data(), &stamp, sizeof(stamp));
+                if (send(conn.fd, payload.data(), size, 0) != (ssize_t)size)
+                    break;
+
+                if (conn.inflight++ == 0)
+                    conn.lastReply = stamp;
+                result.sent += size;
+            }
+        }
+
+        int nfds = epoll_wait(epfd, events, 256, 10);
+        now = Now();
+
+        for (int i = 0; i < nfds; i++)
+        {
+            BenchConn &conn = *(BenchConn *)events[i].data.ptr;
+            ssize_t n;
+
+            while ((n = recv(conn.fd, buf.data(), buf.size(), 0)) >= (ssize_t)sizeof(unsigned long long))
+            {
+                unsigned long long stamp;
+                memcpy(&stamp, buf.data(), sizeof(stamp));
+
+                conn.received += n;
+                conn.lastReply = now;
+                result.received += n;
+
+                if (conn.inflight)
+                    conn.inflight--;
+
+                if (now <= end)
+                {
+                    unsigned long long ns = now - stamp;
+                    result.latencies.push_back(ns > 0xffffffffULL ? 0xffffffffU : (unsigned int)ns);
+                    result.requests++;
+                }
+            }
+        }
+    }
+
+    for (auto &conn : list)
+    {
+        result.bytes.push_back(conn.received);
+        if (conn.fd != -1)
+            close(conn.fd);
+    }
+    close(epfd);
+}
+
+static void EchoProc(SOCKController *controller)
+{
+    if (controller->isPeerClosed())
+    {
+        controller->close();
+        return;
+    }
+
+    if (controller->writeBack() < 0)
+    {
+        controller->close();
+        return;
+    }
+
+    bool ret;
+    if (controller->getReadBufferSize())
+        ret = controller->enableEvents(false, true);
+    else
+        ret = controller->enableEvents(true, false);
+
+    if (!ret)
+        controller->close();
+}
+
+static void EchoUdp(void *ctx, int fd, const char *data, size_t size, const SPPeerAddr *peer)
+{
+    ((SPSockUdp<ADDRESS_FAMILY_INET> *)ctx)->SendTo(fd, data, size, peer);
+}
+
+/**
+ * @brief Runs the server under test until SIGINT (forked child)
+ */
+static int Serve(const BenchOptions &opt, const BenchConfig &config)
+{
+    if (opt.pattern == PATTERN_UDP)
+    {
+        SPSockUdp<ADDRESS_FAMILY_INET>::Config({4 * 1024 * 1024, 1452, LOG_LEVEL_ERROR, 0, 0, 0, 0});
+        auto ins = SPSockUdp<ADDRESS_FAMILY_INET>::GetInstance();
+
+        if (!ins->Bind(opt.port) || !ins->SetCallback(EchoUdp, ins) || !ins->SetSignalExit(SIGINT))
+            return 1;
+
+        ins->EventLoop();
+        ins->Release();
+        return 0;
+    }
+
+    SPSockTcp<ADDRESS_FAMILY_INET>::Config(config.config);
+    auto ins = SPSockTcp<ADDRESS_FAMILY_INET>::GetInstance();
+
+    if (!ins->SetCallback(nullptr, nullptr, EchoProc, EchoProc) || !ins->SetSignalExit(SIGINT) ||
+        !ins->Listen(opt.port))
+        return 1;
+
+    ins->EventLoop();
+    ins->Release();
+    return 0;
+}
+
+/**
+ * @brief Waits until the forked server answers
+ */
+static bool WaitReady(const BenchOptions &opt)
+{
+    for (int i = 0; i < 300; i++)
+    {
+        int fd = Connect(opt, opt.pattern == PATTERN_UDP);
+        if (fd != -1 && opt.pattern != PATTERN_UDP)
+        {
+            close(fd);
+            return true;
+        }
+
+        if (fd != -1)
+        {
+            char probe[8] = {};
+            pollfd pfd = {fd, POLLIN, 0};
+            bool ok = send(fd, probe, sizeof(probe), 0) == sizeof(probe) && poll(&pfd, 1, 10) == 1;
+            close(fd);
+            if (ok)
+                return true;
+        }
+        else
+        {
+            usleep(10000);
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Gets the resident set size of a process
+ * @return Bytes resident (0 if /proc is unavailable)
+ */
+static unsigned long long Rss(pid_t pid)
+{
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/statm", (int)pid);
+
+    FILE *file = fopen(path, "r");
+    if (!file)
+        return 0;
+
+    unsigned long long size, resident = 0;
+    if (fscanf(file, "%llu %llu", &size, &resident) != 2)
+        resident = 0;
+
+    fclose(file);
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+static double Percentile(std::vector<unsigned int> &samples, double p)
+{
+    if (samples.empty())
+        return 0;
+
+    size_t index = std::min(samples.size() - 1, (size_t)(p * samples.size()));
+    std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+    return samples[index] / 1000.0;
+}
+
+/**
+ * @brief Runs one pattern against one configuration and prints its result row
+ * @return false if the server could not be started
+ */
+static bool Run(BenchOptions opt, const BenchConfig &config)
+{
+    pid_t pid = fork();
+    if (pid == 0)
+        exit(Serve(opt, config));
+
+    if (pid < 0 || !WaitReady(opt))
+    {
+        if (pid > 0)
+        {
+            kill(pid, SIGKILL);
+            waitpid(pid, nullptr, 0);
+        }
+        fprintf(stderr, "%s/%s: server did not start\n", patternNames[opt.pattern], config.name);
+        return false;
+    }
+
+    std::vector<BenchResult> results(opt.threads);
+    std::vector<std::thread> threads;
+    unsigned long long idleRss = Rss(pid);
+
+    for (unsigned int i = 0; i < opt.threads; i++)
+    {
+        unsigned int conns = opt.conns / opt.threads + (i < opt.conns % opt.threads ? 1 : 0);
+        threads.emplace_back(opt.pattern == PATTERN_UDP ? RunUdp : RunTcp, std::cref(opt), conns, std::ref(results[i]));
+    }
+
+    // The server's footprint is sampled halfway through, with every connection established and busy
+    std::this_thread::sleep_for(std::chrono::milliseconds(opt.seconds * 500));
+    unsigned long long loadRss = Rss(pid);
+
+    for (auto &thread : threads)
+        thread.join();
+
+    kill(pid, SIGINT);
+    waitpid(pid, nullptr, 0);
+
+    BenchResult total;
+    for (auto &result : results)
+    {
+        total.requests += result.requests;
+        total.sent += result.sent;
+        total.received += result.received;
+        total.lost += result.lost;
+        total.errors += result.errors;
+        total.latencies.insert(total.latencies.end(), result.latencies.begin(), result.latencies.end());
+        total.bytes.insert(total.bytes.end(), result.bytes.begin(), result.bytes.end());
+    }
+
+    unsigned long long minBytes = total.bytes.empty() ? 0 : *std::min_element(total.bytes.begin(), total.bytes.end());
+    unsigned long long maxBytes = total.bytes.empty() ? 0 : *std::max_element(total.bytes.begin(), total.bytes.end());
+    unsigned long long rssPerConn = loadRss > idleRss ? (loadRss - idleRss) / opt.conns : 0;
+    double seconds = opt.seconds;
+
+    printf("%-7s %-12s %11.0f %9.2f %9.1f %9.1f %9.1f %10llu %12llu %12llu %12llu %6llu %5llu\n",
+           patternNames[opt.pattern], config.name, total.requests / seconds,
+           total.received / seconds / (1024 * 1024), Percentile(total.latencies, 0.5),
+           Percentile(total.latencies, 0.99), Percentile(total.latencies, 0.999), rssPerConn,
+           total.bytes.empty() ? 0 : total.received / total.bytes.size(), minBytes, maxBytes,
+           total.lost, total.errors);
+    fflush(stdout);
+    return true;
+}
+
+static void Usage(const char *name)
+{
+    printf("usage: %s [--pattern echo|rpc|stream|udp] [--conns N] [--threads N] [--seconds N]\n"
+           "          [--size BYTES] [--depth N] [--port PORT] [--config NAME] [--sweep]\n"
+           "configs:",
+           name);
+    for (auto &config : configs)
+        printf(" %s", config.name);
+    printf("\n");
+}
+
+int main(int argc, char **argv) // g++ -O2 ../*.cpp bench.cpp -o bench
+{
+    BenchOptions opt;
+    const BenchConfig *only = &configs[0];
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        const char *value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+
+        if (!strcmp(arg, "--sweep"))
+        {
+            opt.sweep = true;
+            continue;
+        }
+
+        if (!value)
+        {
+            Usage(argv[0]);
+            return 1;
+        }
+        i++;
+
+        if (!strcmp(arg, "--pattern"))
+        {
+            for (int p = 0; p < 4; p++)
+                if (!strcmp(value, patternNames[p]))
+                    opt.pattern = p;
+
+            if (opt.pattern == -1)
+            {
+                Usage(argv[0]);
+                return 1;
+            }
+        }
+        else if (!strcmp(arg, "--config"))
+        {
+            only = nullptr;
+            for (auto &config : configs)
+                if (!strcmp(value, config.name))
+                    only = &config;
+
+            if (!only)
+            {
+                Usage(argv[0]);
+                return 1;
+            }
+        }
+        else if (!strcmp(arg, "--conns"))
+            opt.conns = atoi(value);
+        else if (!strcmp(arg, "--threads"))
+            opt.threads = atoi(value);
+        else if (!strcmp(arg, "--seconds"))
+            opt.seconds = atoi(value);
+        else if (!strcmp(arg, "--size"))
+            opt.size = atoi(value);
+        else if (!strcmp(arg, "--depth"))
+            opt.depth = atoi(value);
+        else if (!strcmp(arg, "--port"))
+            opt.port = atoi(value);
+        else
+        {
+            Usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (!opt.conns || !opt.threads || !opt.seconds || !opt.size || !opt.depth || opt.threads > opt.conns)
+    {
+        Usage(argv[0]);
+        return 1;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+
+    printf("%-7s %-12s %11s %9s %9s %9s %9s %10s %12s %12s %12s %6s %5s\n", "pattern", "config", "req/s", "MiB/s",
+           "p50(us)", "p99(us)", "p999(us)", "rss/conn", "rx/conn", "rx min", "rx max", "lost", "err");
+    fflush(stdout);
+
+    bool ok = true;
+    for (int p = 0; p < 4; p++)
+    {
+        if (opt.pattern != -1 && opt.pattern != p)
+            continue;
+
+        BenchOptions run = opt;
+        run.pattern = p;
+
+        // The UDP server does not use SPTcpConfig, so it runs once per sweep
+        if (!opt.sweep || p == PATTERN_UDP)
+        {
+            ok &= Run(run, *only);
+            continue;
+        }
+
+        for (auto &config : configs)
+            ok &= Run(run, config);
+    }
+
+    return ok ? 0 : 1;
+}
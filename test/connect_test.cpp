@@ -0,0 +1,91 @@
+#include "../SPSock.h"
+
+#include <cstring>
+#include <thread>
+
+using namespace HSLL;
+
+// Outbound connection of a client that only registers a read callback: the peer greets first
+// and the client answers from the read callback.
+
+std::atomic<bool> passed{false};
+
+void client_read_proc(SOCKController *controller)
+{
+    if (controller->isPeerClosed())
+    {
+        controller->close();
+        return;
+    }
+
+    char buf[64];
+    size_t len = controller->read(buf, sizeof(buf));
+    if (len == 4 && memcmp(buf, "ping", 4) == 0)
+        controller->write("pong", 4);
+
+    if (!controller->enableEvents(true, false))
+        controller->close();
+}
+
+void server(int listenfd)
+{
+    timeval tv = {5, 0};
+    setsockopt(listenfd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    int fd = accept(listenfd, nullptr, nullptr);
+    if (fd == -1)
+        return;
+
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    char buf[4];
+    if (send(fd, "ping", 4, MSG_NOSIGNAL) == 4 && recv(fd, buf, 4, MSG_WAITALL) == 4 && memcmp(buf, "pong", 4) == 0)
+        passed = true;
+
+    close(fd);
+}
+
+int main(int argc, char **argv) // g++ -o3 ../*.cpp connect_test.cpp -o test && ./test [edge]
+{
+    bool edge = argc > 1 && strcmp(argv[1], "edge") == 0;
+    SPSockTcp<ADDRESS_FAMILY_INET>::Config({16 * 1024, 32 * 1024, 16, 64, 10000, EPOLLIN, 20000, 10, 5, 0.9, LOG_LEVEL_INFO,
+                                            ACCEPT_MODE_MAIN, 0, 0, DISPATCH_MODE_POOL, IO_ENGINE_EPOLL, 0,
+                                            edge ? TRIGGER_MODE_EDGE : TRIGGER_MODE_ONESHOT});
+
+    int listenfd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(4568);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int reuse = 1;
+    setsockopt(listenfd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    if (bind(listenfd, (sockaddr *)&addr, sizeof(addr)) == -1 || listen(listenfd, 1) == -1)
+        return -1;
+
+    auto ins = SPSockTcp<ADDRESS_FAMILY_INET>::GetInstance();
+
+    if (ins->SetCallback(nullptr, nullptr, client_read_proc, nullptr) == false)
+        return -1;
+    if (ins->Listen(4567) == false)
+        return -1;
+
+    std::thread peer(server, listenfd);
+    std::thread driver([ins]
+                       {
+                           while (!ins->Connect("127.0.0.1", 4568, nullptr, 3000))
+                               usleep(10000);
+
+                           for (int i = 0; i < 500 && !passed; i++)
+                               usleep(10000);
+
+                           ins->SetExitFlag(); });
+
+    ins->EventLoop();
+    driver.join();
+    peer.join();
+    close(listenfd);
+    ins->Release();
+
+    printf("%s\n", passed ? "PASS" : "FAIL");
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,108 @@
+#include "../SPSock.h"
+
+#include <openssl/ssl.h>
+#include <cstring>
+#include <thread>
+
+using namespace HSLL;
+
+// TLS listener that only registers a read callback: the client speaks first, possibly within the
+// same flight that completes the handshake, and the server echoes from the read callback.
+
+std::atomic<bool> passed{false};
+
+void echo_read_proc(SOCKController *controller)
+{
+    if (controller->isPeerClosed())
+    {
+        controller->close();
+        return;
+    }
+
+    char buf[64];
+    size_t len = controller->read(buf, sizeof(buf));
+    if (len && controller->write(buf, len) != len)
+    {
+        controller->close();
+        return;
+    }
+
+    if (!controller->enableEvents(true, false))
+        controller->close();
+}
+
+bool client()
+{
+    SSL_CTX *ctx = SSL_CTX_new(TLS_client_method());
+    if (!ctx)
+        return false;
+
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(4567);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    timeval tv = {5, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    bool ok = false;
+    if (connect(fd, (sockaddr *)&addr, sizeof(addr)) == 0)
+    {
+        SSL *ssl = SSL_new(ctx);
+        SSL_set_fd(ssl, fd);
+
+        char buf[4];
+        size_t got = 0;
+        if (SSL_connect(ssl) == 1 && SSL_write(ssl, "ping", 4) == 4)
+        {
+            int ret;
+            while (got < 4 && (ret = SSL_read(ssl, buf + got, 4 - got)) > 0)
+                got += ret;
+        }
+
+        ok = got == 4 && memcmp(buf, "ping", 4) == 0;
+        SSL_shutdown(ssl);
+        SSL_free(ssl);
+    }
+
+    close(fd);
+    SSL_CTX_free(ctx);
+    return ok;
+}
+
+int main(int argc, char **argv) // g++ -o3 -DSPSOCK_TLS ../*.cpp tls_test.cpp -o test -lssl -lcrypto && ./test cert.pem key.pem [edge]
+{
+    if (argc < 3)
+    {
+        printf("usage: %s cert.pem key.pem [edge]\n", argv[0]);
+        return -1;
+    }
+
+    bool edge = argc > 3 && strcmp(argv[3], "edge") == 0;
+    SPSockTcp<ADDRESS_FAMILY_INET>::Config({16 * 1024, 32 * 1024, 16, 64, 10000, EPOLLIN, 20000, 10, 5, 0.9, LOG_LEVEL_INFO,
+                                            ACCEPT_MODE_MAIN, 0, 0, DISPATCH_MODE_POOL, IO_ENGINE_EPOLL, 0,
+                                            edge ? TRIGGER_MODE_EDGE : TRIGGER_MODE_ONESHOT});
+
+    auto ins = SPSockTcp<ADDRESS_FAMILY_INET>::GetInstance();
+
+    if (ins->SetCallback(nullptr, nullptr, echo_read_proc, nullptr) == false)
+        return -1;
+    if (ins->EnableTls(argv[1], argv[2]) == false)
+        return -1;
+    if (ins->Listen(4567) == false)
+        return -1;
+
+    std::thread driver([ins]
+                       {
+                           for (int i = 0; i < 3 && !passed; i++)
+                               passed = client();
+
+                           ins->SetExitFlag(); });
+
+    ins->EventLoop();
+    driver.join();
+    ins->Release();
+
+    printf("%s\n", passed ? "PASS" : "FAIL");
+    return passed ? 0 : 1;
+}